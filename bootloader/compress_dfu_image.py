@@ -0,0 +1,160 @@
+#!/usr/bin/env python3
+
+# Compresses a MCUBoot image for the DFU service of InfiniTime.
+#
+# The output starts with a 12 bytes header:
+#   uint32_t magic          0x5a4c5450 ("PTLZ")
+#   uint32_t size           size of the decompressed image
+#   uint16_t crc            CRC16 (CCITT, 0xFFFF) of the decompressed image
+#   uint8_t  windowBits     log2 of the size of the window
+#   uint8_t  lookaheadBits  log2 of the maximum length of a match
+# followed by a heatshrink compatible bit stream (MSB first):
+#   1 + 8 bits                         : literal byte
+#   0 + windowBits + lookaheadBits bits : copy (count + 1) bytes from (index + 1) bytes before
+# All the fields of the header are little endian.
+#
+# The watch keeps the last 2^windowBits bytes in RAM, so the window must not be larger than
+# what DfuService::ImageDecoder supports (1 KB).
+
+import argparse
+import struct
+import sys
+
+MAGIC = 0x5A4C5450
+WINDOW_BITS = 10
+LOOKAHEAD_BITS = 4
+MAX_CHAIN = 128
+
+
+def crc16(data):
+    crc = 0xFFFF
+    for byte in data:
+        crc = ((crc >> 8) | (crc << 8)) & 0xFFFF
+        crc ^= byte
+        crc ^= (crc & 0xFF) >> 4
+        crc ^= (crc << 12) & 0xFFFF
+        crc ^= ((crc & 0xFF) << 5) & 0xFFFF
+    return crc
+
+
+class BitWriter:
+    def __init__(self):
+        self.output = bytearray()
+        self.current = 0
+        self.count = 0
+
+    def write(self, value, nbBits):
+        for i in range(nbBits - 1, -1, -1):
+            self.current = (self.current << 1) | ((value >> i) & 1)
+            self.count += 1
+            if self.count == 8:
+                self.output.append(self.current)
+                self.current = 0
+                self.count = 0
+
+    def flush(self):
+        if self.count > 0:
+            self.output.append(self.current << (8 - self.count))
+            self.current = 0
+            self.count = 0
+        return bytes(self.output)
+
+
+def compress(data, windowBits, lookaheadBits):
+    windowSize = 1 << windowBits
+    maxLength = 1 << lookaheadBits
+    # A copy costs 1 + windowBits + lookaheadBits bits, a literal costs 9 bits
+    minLength = (1 + windowBits + lookaheadBits) // 9 + 1
+
+    writer = BitWriter()
+    positions = {}
+    index = 0
+    while index < len(data):
+        bestLength = 0
+        bestDistance = 0
+        key = bytes(data[index:index + 2])
+        candidates = positions.get(key, [])
+        for candidate in reversed(candidates[-MAX_CHAIN:]):
+            distance = index - candidate
+            if distance > windowSize:
+                break
+            length = 0
+            while length < maxLength and index + length < len(data) and data[candidate + length] == data[index + length]:
+                length += 1
+            if length > bestLength:
+                bestLength = length
+                bestDistance = distance
+                if length == maxLength:
+                    break
+
+        if bestLength >= minLength:
+            writer.write(0, 1)
+            writer.write(bestDistance - 1, windowBits)
+            writer.write(bestLength - 1, lookaheadBits)
+            step = bestLength
+        else:
+            writer.write(1, 1)
+            writer.write(data[index], 8)
+            step = 1
+
+        for i in range(index, index + step):
+            positions.setdefault(bytes(data[i:i + 2]), []).append(i)
+        index += step
+
+    return writer.flush()
+
+
+def decompress(stream):
+    magic, size, crc, windowBits, lookaheadBits = struct.unpack_from("<IIHBB", stream)
+    if magic != MAGIC:
+        raise ValueError("bad magic number")
+    output = bytearray()
+    bits = "".join(format(byte, "08b") for byte in stream[12:])
+    position = 0
+    while len(output) < size:
+        tag = bits[position]
+        position += 1
+        if tag == "1":
+            output.append(int(bits[position:position + 8], 2))
+            position += 8
+        else:
+            distance = int(bits[position:position + windowBits], 2) + 1
+            position += windowBits
+            count = int(bits[position:position + lookaheadBits], 2) + 1
+            position += lookaheadBits
+            for _ in range(count):
+                output.append(output[-distance])
+    if crc16(output[:size]) != crc:
+        raise ValueError("bad CRC")
+    return bytes(output[:size])
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Compress a firmware image for the DFU service of InfiniTime")
+    parser.add_argument("input", help="MCUBoot image (.bin)")
+    parser.add_argument("output", help="compressed image (.bin)")
+    parser.add_argument("--window-bits", type=int, default=WINDOW_BITS, choices=range(4, WINDOW_BITS + 1))
+    parser.add_argument("--lookahead-bits", type=int, default=LOOKAHEAD_BITS, choices=range(3, 9))
+    parser.add_argument("--verify", action="store_true", help="decompress the output and compare it to the input")
+    args = parser.parse_args()
+
+    if args.lookahead_bits >= args.window_bits:
+        sys.exit("lookahead-bits must be smaller than window-bits")
+
+    with open(args.input, "rb") as f:
+        data = f.read()
+
+    stream = struct.pack("<IIHBB", MAGIC, len(data), crc16(data), args.window_bits, args.lookahead_bits)
+    stream += compress(data, args.window_bits, args.lookahead_bits)
+
+    if args.verify and decompress(stream) != data:
+        sys.exit("verification failed")
+
+    with open(args.output, "wb") as f:
+        f.write(stream)
+
+    print("{}: {} -> {} bytes ({:.1f}%)".format(args.output, len(data), len(stream), 100.0 * len(stream) / len(data)))
+
+
+if __name__ == "__main__":
+    main()
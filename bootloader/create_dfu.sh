@@ -1,3 +1,7 @@
 #!/bin/bash
 
-adafruit-nrfutil dfu genpkg --dev-type 0x0052 --application image.bin dfu.zip
\ No newline at end of file
+adafruit-nrfutil dfu genpkg --dev-type 0x0052 --application image.bin dfu.zip
+
+# Same image, compressed. Only supported by InfiniTime versions that can decompress the DFU images
+$(dirname "$0")/compress_dfu_image.py --verify image.bin image-compressed.bin
+adafruit-nrfutil dfu genpkg --dev-type 0x0052 --application image-compressed.bin dfu-compressed.zip
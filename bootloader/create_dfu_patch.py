@@ -0,0 +1,165 @@
+#!/usr/bin/env python3
+
+# Creates a patch that updates the image running on the watch (old MCUBoot image) to a new image.
+#
+# The patch starts with a 16 bytes header:
+#   uint32_t magic       0x4c445450 ("PTDL")
+#   uint32_t size        size of the new image
+#   uint16_t crc         CRC16 (CCITT, 0xFFFF) of the new image
+#   uint16_t sourceCrc   CRC16 of the first 'sourceSize' bytes of the running image
+#   uint32_t sourceSize  size of the running image
+# followed by control blocks, as in bsdiff:
+#   uint32_t addSize     add the next 'addSize' bytes of the patch to the running image
+#   uint32_t insertSize  copy the next 'insertSize' bytes of the patch
+#   int32_t  seek        move forward (or backward) in the running image
+# All the fields are little endian.
+#
+# The diff bytes are mostly zeros, so the patch is compressed with compress_dfu_image.py, unless
+# --no-compression is given. The result is packed with adafruit-nrfutil like a normal image.
+
+import argparse
+import os
+import struct
+import sys
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+import compress_dfu_image
+
+MAGIC = 0x4C445450
+BLOCK_SIZE = 8
+# Number of mismatches tolerated while extending a match
+MAX_PENALTY = 16
+
+
+def extend(old, new, oldPosition, newPosition):
+    """Returns the length of the approximate match, and its score (matching bytes - mismatching bytes)."""
+    score = 0
+    bestScore = 0
+    bestLength = 0
+    length = 0
+    while oldPosition + length < len(old) and newPosition + length < len(new):
+        if old[oldPosition + length] == new[newPosition + length]:
+            score += 1
+        else:
+            score -= 1
+        length += 1
+        if score > bestScore:
+            bestScore = score
+            bestLength = length
+        elif score < bestScore - MAX_PENALTY:
+            break
+    return bestLength, bestScore
+
+
+def diff(old, new):
+    """Returns a list of (newPosition, length, oldPosition) approximate matches."""
+    index = {}
+    for i in range(len(old) - BLOCK_SIZE + 1):
+        index.setdefault(old[i:i + BLOCK_SIZE], i)
+
+    matches = []
+    offset = 0
+    position = 0
+    while position < len(new):
+        candidates = []
+        # Continue with the same offset as the previous match first: most of the code does not move
+        if 0 <= position + offset < len(old):
+            candidates.append(position + offset)
+        found = index.get(new[position:position + BLOCK_SIZE])
+        if found is not None:
+            candidates.append(found)
+
+        bestLength, bestScore, bestOld = 0, 0, 0
+        for candidate in candidates:
+            length, score = extend(old, new, candidate, position)
+            if score > bestScore:
+                bestLength, bestScore, bestOld = length, score, candidate
+
+        if bestScore >= BLOCK_SIZE:
+            matches.append((position, bestLength, bestOld))
+            offset = bestOld - position
+            position += bestLength
+        else:
+            position += 1
+    return matches
+
+
+def create_patch(old, new):
+    matches = diff(old, new)
+    patch = bytearray(struct.pack("<IIHHI", MAGIC, len(new), compress_dfu_image.crc16(new),
+                                  compress_dfu_image.crc16(old), len(old)))
+
+    # Bytes before the first match
+    firstNew = matches[0][0] if matches else len(new)
+    firstOld = matches[0][2] if matches else 0
+    patch += struct.pack("<IIi", 0, firstNew, firstOld)
+    patch += new[:firstNew]
+
+    for i, (newPosition, length, oldPosition) in enumerate(matches):
+        nextNew = matches[i + 1][0] if i + 1 < len(matches) else len(new)
+        nextOld = matches[i + 1][2] if i + 1 < len(matches) else oldPosition + length
+        patch += struct.pack("<IIi", length, nextNew - (newPosition + length), nextOld - (oldPosition + length))
+        patch += bytes((new[newPosition + k] - old[oldPosition + k]) & 0xFF for k in range(length))
+        patch += new[newPosition + length:nextNew]
+    return bytes(patch)
+
+
+def apply_patch(old, patch):
+    magic, size, crc, sourceCrc, sourceSize = struct.unpack_from("<IIHHI", patch)
+    if magic != MAGIC or sourceSize != len(old) or sourceCrc != compress_dfu_image.crc16(old):
+        raise ValueError("the patch does not match the old image")
+    output = bytearray()
+    position = 16
+    oldPosition = 0
+    while len(output) < size:
+        addSize, insertSize, seek = struct.unpack_from("<IIi", patch, position)
+        position += 12
+        for k in range(addSize):
+            output.append((old[oldPosition + k] + patch[position + k]) & 0xFF)
+        position += addSize
+        oldPosition += addSize
+        output += patch[position:position + insertSize]
+        position += insertSize
+        oldPosition += seek
+    if compress_dfu_image.crc16(output) != crc:
+        raise ValueError("bad CRC")
+    return bytes(output)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Create a patch from the running firmware image to a new one")
+    parser.add_argument("old", help="MCUBoot image running on the watch (.bin)")
+    parser.add_argument("new", help="new MCUBoot image (.bin)")
+    parser.add_argument("output", help="patch (.bin)")
+    parser.add_argument("--no-compression", action="store_true", help="do not compress the patch")
+    parser.add_argument("--verify", action="store_true", help="apply the patch and compare the result to the new image")
+    args = parser.parse_args()
+
+    with open(args.old, "rb") as f:
+        old = f.read()
+    with open(args.new, "rb") as f:
+        new = f.read()
+
+    patch = create_patch(old, new)
+    if args.verify and apply_patch(old, patch) != new:
+        sys.exit("verification failed")
+
+    stream = patch
+    if not args.no_compression:
+        # Long matches are more useful than for a whole image: most of the diff bytes are zeros
+        windowBits = compress_dfu_image.WINDOW_BITS
+        lookaheadBits = 8
+        stream = struct.pack("<IIHBB", compress_dfu_image.MAGIC, len(patch), compress_dfu_image.crc16(patch), windowBits,
+                             lookaheadBits)
+        stream += compress_dfu_image.compress(patch, windowBits, lookaheadBits)
+        if args.verify and compress_dfu_image.decompress(stream) != patch:
+            sys.exit("verification failed")
+
+    with open(args.output, "wb") as f:
+        f.write(stream)
+
+    print("{}: {} -> {} bytes ({:.1f}%)".format(args.output, len(new), len(stream), 100.0 * len(stream) / len(new)))
+
+
+if __name__ == "__main__":
+    main()
@@ -1,8 +1,11 @@
 #include "components/ble/DfuService.h"
+#include <algorithm>
 #include <cstring>
 #include "components/ble/BleController.h"
+#include "drivers/InternalFlash.h"
 #include "drivers/SpiNorFlash.h"
 #include "systemtask/SystemTask.h"
+#include <nimble/nimble_port.h>
 #include <nrf_log.h>
 
 using namespace Pinetime::Controllers;
@@ -27,12 +30,19 @@ void TimeoutTimerCallback(TimerHandle_t xTimer) {
   dfuService->OnTimeout();
 }
 
+void ImageValidatedCallback(ble_npl_event* event) {
+  auto dfuService = static_cast<DfuService*>(ble_npl_event_get_arg(event));
+  dfuService->OnImageValidated();
+}
+
 DfuService::DfuService(Pinetime::System::SystemTask& systemTask,
                        Pinetime::Controllers::Ble& bleController,
                        Pinetime::Drivers::SpiNorFlash& spiNorFlash)
   : systemTask {systemTask},
     bleController {bleController},
-    dfuImage {spiNorFlash},
+    dfuImage {spiNorFlash, imageValidatedEvent},
+    imagePatcher {dfuImage},
+    imageDecoder {imagePatcher},
     characteristicDefinition {{
                                 .uuid = &packetCharacteristicUuid.u,
                                 .access_cb = DfuServiceCallback,
@@ -66,6 +76,7 @@ DfuService::DfuService(Pinetime::System::SystemTask& systemTask,
       {0},
     } {
   timeoutTimer = xTimerCreate("notificationTimer", 10000, pdFALSE, this, TimeoutTimerCallback);
+  ble_npl_event_init(&imageValidatedEvent, ImageValidatedCallback, this);
 }
 
 void DfuService::Init() {
@@ -129,7 +140,7 @@ int DfuService::WritePacketHandler(uint16_t connectionHandle, os_mbuf* om) {
         vTaskDelay(50); // 50ms
       }
 
-      dfuImage.Erase();
+      dfuImage.Start();
 
       uint8_t data[] {16, 1, 1};
       notificationManager.Send(connectionHandle, controlPointCharacteristicHandle, data, 3);
@@ -161,7 +172,11 @@ int DfuService::WritePacketHandler(uint16_t connectionHandle, os_mbuf* om) {
 
     case States::Data: {
       nbPacketReceived++;
-      dfuImage.Append(om->om_data, om->om_len);
+      imageDecoder.Append(om->om_data, om->om_len);
+      if (imageDecoder.HasFailed()) {
+        AbortTransfer(connectionHandle, ErrorCodes::OperationFailed);
+        return 0;
+      }
       bytesReceived += om->om_len;
       bleController.FirmwareUpdateCurrentBytes(bytesReceived);
 
@@ -174,7 +189,7 @@ int DfuService::WritePacketHandler(uint16_t connectionHandle, os_mbuf* om) {
         NRF_LOG_INFO("[DFU] -> Send packet notification: %d bytes received", bytesReceived);
         notificationManager.Send(connectionHandle, controlPointCharacteristicHandle, data, 5);
       }
-      if (dfuImage.IsComplete()) {
+      if (bytesReceived == applicationSize) {
         uint8_t data[3] {static_cast<uint8_t>(Opcodes::Response),
                          static_cast<uint8_t>(Opcodes::ReceiveFirmwareImage),
                          static_cast<uint8_t>(ErrorCodes::NoError)};
@@ -247,7 +262,11 @@ int DfuService::ControlPointHandler(uint16_t connectionHandle, os_mbuf* om) {
         return 0;
       }
       // TODO the chunk size is dependent of the implementation of the host application...
-      dfuImage.Init(20, applicationSize, expectedCrc);
+      if (!imagePatcher.Init(applicationSize, expectedCrc)) {
+        AbortTransfer(connectionHandle, ErrorCodes::DataSizeExceedsLimits);
+        return 0;
+      }
+      imageDecoder.Init();
       NRF_LOG_INFO("[DFU] -> Starting receive firmware");
       state = States::Data;
       return 0;
@@ -259,26 +278,14 @@ int DfuService::ControlPointHandler(uint16_t connectionHandle, os_mbuf* om) {
 
       NRF_LOG_INFO("[DFU] -> Validate firmware image requested -- %d", connectionHandle);
 
-      if (dfuImage.Validate()) {
-        state = States::Validated;
-        bleController.State(Pinetime::Controllers::Ble::FirmwareUpdateStates::Validated);
-        NRF_LOG_INFO("Image OK");
-
-        uint8_t data[3] {static_cast<uint8_t>(Opcodes::Response),
-                         static_cast<uint8_t>(Opcodes::ValidateFirmware),
-                         static_cast<uint8_t>(ErrorCodes::NoError)};
-        notificationManager.AsyncSend(connectionHandle, controlPointCharacteristicHandle, data, 3);
+      // The worker task checks the CRC of the image once it is written, the response is sent by OnImageValidated()
+      state = States::Validating;
+      validationConnectionHandle = connectionHandle;
+      if (imageDecoder.IsComplete() && imagePatcher.IsComplete()) {
+        dfuImage.Validate();
       } else {
-        NRF_LOG_INFO("Image Error : bad CRC");
-
-        uint8_t data[3] {static_cast<uint8_t>(Opcodes::Response),
-                         static_cast<uint8_t>(Opcodes::ValidateFirmware),
-                         static_cast<uint8_t>(ErrorCodes::CrcError)};
-        notificationManager.AsyncSend(connectionHandle, controlPointCharacteristicHandle, data, 3);
-        bleController.State(Pinetime::Controllers::Ble::FirmwareUpdateStates::Error);
-        Reset();
+        OnImageValidated();
       }
-
       return 0;
     }
     case Opcodes::ActivateImageAndReset:
@@ -295,6 +302,43 @@ int DfuService::ControlPointHandler(uint16_t connectionHandle, os_mbuf* om) {
   }
 }
 
+void DfuService::AbortTransfer(uint16_t connectionHandle, ErrorCodes error) {
+  NRF_LOG_INFO("[DFU] -> Abort transfer, error %d", error);
+  uint8_t data[3] {static_cast<uint8_t>(Opcodes::Response),
+                   static_cast<uint8_t>(Opcodes::ReceiveFirmwareImage),
+                   static_cast<uint8_t>(error)};
+  notificationManager.Send(connectionHandle, controlPointCharacteristicHandle, data, 3);
+  bleController.State(Pinetime::Controllers::Ble::FirmwareUpdateStates::Error);
+  Reset();
+}
+
+void DfuService::OnImageValidated() {
+  if (state != States::Validating) {
+    // The transfer was aborted in the meantime
+    return;
+  }
+
+  if (imageDecoder.IsComplete() && imagePatcher.IsComplete() && dfuImage.IsValid()) {
+    state = States::Validated;
+    bleController.State(Pinetime::Controllers::Ble::FirmwareUpdateStates::Validated);
+    NRF_LOG_INFO("Image OK");
+
+    uint8_t data[3] {static_cast<uint8_t>(Opcodes::Response),
+                     static_cast<uint8_t>(Opcodes::ValidateFirmware),
+                     static_cast<uint8_t>(ErrorCodes::NoError)};
+    notificationManager.Send(validationConnectionHandle, controlPointCharacteristicHandle, data, 3);
+  } else {
+    NRF_LOG_INFO("Image Error : bad CRC");
+
+    uint8_t data[3] {static_cast<uint8_t>(Opcodes::Response),
+                     static_cast<uint8_t>(Opcodes::ValidateFirmware),
+                     static_cast<uint8_t>(ErrorCodes::CrcError)};
+    notificationManager.Send(validationConnectionHandle, controlPointCharacteristicHandle, data, 3);
+    bleController.State(Pinetime::Controllers::Ble::FirmwareUpdateStates::Error);
+    Reset();
+  }
+}
+
 void DfuService::OnTimeout() {
   bleController.State(Pinetime::Controllers::Ble::FirmwareUpdateStates::Error);
   Reset();
@@ -350,34 +394,179 @@ void DfuService::NotificationManager::Reset() {
   xTimerStop(timer, 0);
 }
 
-void DfuService::DfuImage::Init(size_t chunkSize, size_t totalSize, uint16_t expectedCrc) {
+void DfuService::DfuImage::Start() {
+  if (taskHandle == nullptr) {
+    requests = xQueueCreate(nbRequests, sizeof(Request));
+    freeBuffers = xQueueCreate(nbBuffers, sizeof(uint8_t));
+    for (uint8_t i = 0; i < nbBuffers; i++) {
+      xQueueSend(freeBuffers, &i, 0);
+    }
+    // The worker runs at the priority of the NimBLE host task: at the idle priority, it would only run when all the
+    // other tasks are blocked, and the NimBLE host task would wait for free buffers.
+    if (pdPASS != xTaskCreate(DfuImage::Process, "DFU", taskStackSize, this, 1, &taskHandle)) {
+      APP_ERROR_HANDLER(NRF_ERROR_NO_MEM);
+    }
+  }
+
+  // Give back the buffer of a previous transfer that was interrupted
+  if (currentBuffer != noBuffer) {
+    xQueueSend(freeBuffers, &currentBuffer, 0);
+    currentBuffer = noBuffer;
+  }
+  ready = false;
+  totalSize = 0;
+  bufferWriteIndex = 0;
+  totalWriteIndex = 0;
+
+  failed = false;
+  valid = false;
+
+  Request request {Request::Types::Start, noBuffer, false, 0, 0, 0};
+  xQueueSend(requests, &request, portMAX_DELAY);
+}
+
+bool DfuService::DfuImage::Init(size_t chunkSize, size_t totalSize, uint16_t expectedCrc) {
+  ready = false;
   if (chunkSize != 20)
-    return;
+    return false;
+  // The file system is located right after the slot in the external flash memory
+  if (totalSize == 0 || totalSize > maxSize) {
+    NRF_LOG_INFO("[DFU] Invalid image size : %d (max %d)", totalSize, maxSize);
+    return false;
+  }
   this->chunkSize = chunkSize;
   this->totalSize = totalSize;
-  this->expectedCrc = expectedCrc;
   this->ready = true;
+
+  Request request {Request::Types::Init, noBuffer, false, expectedCrc, 0, static_cast<uint32_t>(totalSize)};
+  xQueueSend(requests, &request, portMAX_DELAY);
+  return true;
+}
+
+void DfuService::DfuImage::CheckSource(uint32_t offset, uint32_t size, uint16_t crc) {
+  Request request {Request::Types::CheckSource, noBuffer, false, crc, offset, size};
+  xQueueSend(requests, &request, portMAX_DELAY);
+}
+
+void DfuService::DfuImage::Validate() {
+  Request request {Request::Types::Validate, noBuffer, false, 0, 0, 0};
+  xQueueSend(requests, &request, portMAX_DELAY);
+}
+
+bool DfuService::DfuImage::IsValid() const {
+  return valid;
+}
+
+bool DfuService::DfuImage::HasFailed() const {
+  return failed;
 }
 
-void DfuService::DfuImage::Append(uint8_t* data, size_t size) {
+void DfuService::DfuImage::Append(const uint8_t* data, size_t size) {
   if (!ready)
     return;
-  ASSERT(size <= 20);
+  size = std::min(size, totalSize - (totalWriteIndex + bufferWriteIndex));
+
+  while (size > 0) {
+    if (currentBuffer == noBuffer) {
+      // Only blocks if the worker is late by nbBuffers buffers
+      xQueueReceive(freeBuffers, &currentBuffer, portMAX_DELAY);
+    }
+
+    const size_t copySize = std::min(size, bufferSize - bufferWriteIndex);
+    std::memcpy(buffers[currentBuffer] + bufferWriteIndex, data, copySize);
+    bufferWriteIndex += copySize;
+    data += copySize;
+    size -= copySize;
+
+    const bool isLast = (totalWriteIndex + bufferWriteIndex == totalSize);
+    if (bufferWriteIndex == bufferSize || isLast) {
+      Request request {Request::Types::Write,
+                       currentBuffer,
+                       isLast,
+                       0,
+                       static_cast<uint32_t>(totalWriteIndex),
+                       static_cast<uint32_t>(bufferWriteIndex)};
+      xQueueSend(requests, &request, portMAX_DELAY);
+      totalWriteIndex += bufferWriteIndex;
+      bufferWriteIndex = 0;
+      currentBuffer = noBuffer;
+    }
+  }
+}
+
+void DfuService::DfuImage::Process(void* instance) {
+  auto* dfuImage = static_cast<DfuImage*>(instance);
+  dfuImage->Work();
+}
+
+void DfuService::DfuImage::Work() {
+  while (true) {
+    // Erase ahead of the write cursor while there is nothing to write
+    const size_t eraseLimit = std::min(flushedSize + eraseAheadSize, (imageSize > 0) ? imageSize : maxSize);
+    const TickType_t timeout = (erasedSize < eraseLimit) ? 0 : portMAX_DELAY;
 
-  std::memcpy(tempBuffer + bufferWriteIndex, data, size);
-  bufferWriteIndex += size;
+    Request request;
+    if (xQueueReceive(requests, &request, timeout) != pdTRUE) {
+      EraseUpTo(erasedSize + 1);
+      continue;
+    }
 
-  if (bufferWriteIndex == bufferSize) {
-    spiNorFlash.Write(writeOffset + totalWriteIndex, tempBuffer, bufferWriteIndex);
-    totalWriteIndex += bufferWriteIndex;
-    bufferWriteIndex = 0;
+    switch (request.type) {
+      case Request::Types::Start:
+        imageSize = 0;
+        erasedSize = 0;
+        flushedSize = 0;
+        failed = false;
+        valid = false;
+        break;
+      case Request::Types::Init:
+        imageSize = request.size;
+        expectedCrc = request.crc;
+        break;
+      case Request::Types::CheckSource:
+        if (!SourceMatches(request.offset, request.size, request.crc)) {
+          failed = true;
+        }
+        break;
+      case Request::Types::Write:
+        EraseUpTo(request.offset + request.size);
+        spiNorFlash.Write(writeOffset + request.offset, buffers[request.buffer], request.size);
+        flushedSize = request.offset + request.size;
+        xQueueSend(freeBuffers, &request.buffer, 0);
+
+        if (request.isLast) {
+          if (flushedSize < maxSize) {
+            // The sectors between the end of the image and the trailer are not used by MCUBoot
+            const size_t trailerOffset = std::max(maxSize - trailerSize, erasedSize);
+            if (trailerOffset < maxSize) {
+              spiNorFlash.Erase(writeOffset + trailerOffset, maxSize - trailerOffset);
+              erasedSize = maxSize;
+            }
+          }
+        }
+        break;
+      case Request::Types::Validate: {
+        // All the writes were processed before this request
+        const uint16_t crc = ComputeImageCrc();
+        valid = !failed && flushedSize == imageSize && crc == expectedCrc;
+        NRF_LOG_INFO("[DFU] Image CRC = %u, expected %u", crc, expectedCrc);
+        // MCUBoot will only swap to the new image once it is marked with the magic number
+        if (valid && imageSize < maxSize) {
+          WriteMagicNumber();
+        }
+        NRF_LOG_INFO("[DFU] Stack high-water mark : %d words", uxTaskGetStackHighWaterMark(nullptr));
+        ble_npl_eventq_put(nimble_port_get_dflt_eventq(), &validatedEvent);
+      } break;
+    }
   }
+}
 
-  if (bufferWriteIndex > 0 && totalWriteIndex + bufferWriteIndex == totalSize) {
-    spiNorFlash.Write(writeOffset + totalWriteIndex, tempBuffer, bufferWriteIndex);
-    totalWriteIndex += bufferWriteIndex;
-    if (totalSize < maxSize)
-      WriteMagicNumber();
+void DfuService::DfuImage::EraseUpTo(size_t offset) {
+  // Never erase beyond the slot
+  offset = std::min(offset, maxSize);
+  while (erasedSize < offset) {
+    spiNorFlash.SectorErase(writeOffset + erasedSize);
+    erasedSize += sectorSize;
   }
 }
 
@@ -394,31 +583,41 @@ void DfuService::DfuImage::WriteMagicNumber() {
   spiNorFlash.Write(offset, reinterpret_cast<const uint8_t*>(magic), 4 * sizeof(uint32_t));
 }
 
-void DfuService::DfuImage::Erase() {
-  for (size_t erased = 0; erased < maxSize; erased += 0x1000) {
-    spiNorFlash.SectorErase(writeOffset + erased);
-  }
-}
-
-bool DfuService::DfuImage::Validate() {
-  uint32_t chunkSize = 200;
+uint16_t DfuService::DfuImage::ComputeImageCrc() {
+  // The NimBLE host task does not append data while the image is validated: all the buffers are free
+  uint8_t* readBuffer = buffers[0];
+  uint32_t chunkSize = bufferSize;
   size_t currentOffset = 0;
   uint16_t crc = 0;
 
   bool first = true;
-  while (currentOffset < totalSize) {
-    uint32_t readSize = (totalSize - currentOffset) > chunkSize ? chunkSize : (totalSize - currentOffset);
+  while (currentOffset < imageSize) {
+    uint32_t readSize = (imageSize - currentOffset) > chunkSize ? chunkSize : (imageSize - currentOffset);
 
-    spiNorFlash.Read(writeOffset + currentOffset, tempBuffer, readSize);
+    spiNorFlash.Read(writeOffset + currentOffset, readBuffer, readSize);
     if (first) {
-      crc = ComputeCrc(tempBuffer, readSize, NULL);
+      crc = ComputeCrc(readBuffer, readSize, NULL);
       first = false;
     } else
-      crc = ComputeCrc(tempBuffer, readSize, &crc);
+      crc = ComputeCrc(readBuffer, readSize, &crc);
     currentOffset += readSize;
   }
+  return crc;
+}
 
-  return (crc == expectedCrc);
+bool DfuService::DfuImage::SourceMatches(uint32_t offset, uint32_t size, uint16_t crc) {
+  uint16_t sourceCrc = 0xffff;
+  uint8_t buffer[64];
+  for (uint32_t position = 0; position < size; position += sizeof(buffer)) {
+    const size_t readSize = std::min(sizeof(buffer), static_cast<size_t>(size - position));
+    Pinetime::Drivers::InternalFlash::Read(offset + position, buffer, readSize);
+    sourceCrc = ComputeCrc(buffer, readSize, &sourceCrc);
+  }
+  if (sourceCrc != crc) {
+    NRF_LOG_INFO("[DFU] The patch does not match the running image (CRC = %u)", sourceCrc);
+    return false;
+  }
+  return true;
 }
 
 uint16_t DfuService::DfuImage::ComputeCrc(uint8_t const* p_data, uint32_t size, uint16_t const* p_crc) {
@@ -440,3 +639,270 @@ bool DfuService::DfuImage::IsComplete() {
     return false;
   return totalWriteIndex == totalSize;
 }
+
+bool DfuService::ImagePatcher::Init(size_t imageSize, uint16_t expectedCrc) {
+  state = States::Header;
+  headerIndex = 0;
+  outputIndex = 0;
+  return dfuImage.Init(20, imageSize, expectedCrc);
+}
+
+void DfuService::ImagePatcher::Append(const uint8_t* data, size_t size) {
+  while (size > 0) {
+    size_t n = 1;
+    switch (state) {
+      case States::Header:
+        header[headerIndex++] = *data;
+        DecodeHeader();
+        break;
+      case States::Raw:
+        dfuImage.Append(data, size);
+        return;
+      case States::Control:
+        header[headerIndex++] = *data;
+        if (headerIndex == controlSize)
+          DecodeControl();
+        break;
+      case States::Add: {
+        uint8_t buffer[32];
+        n = std::min({size, static_cast<size_t>(addSize), sizeof(buffer)});
+        if (sourcePosition > sourceSize || n > sourceSize - sourcePosition) {
+          NRF_LOG_INFO("[DFU] Patch reads outside of the running image");
+          state = States::Error;
+          return;
+        }
+        Pinetime::Drivers::InternalFlash::Read(primarySlotOffset + sourcePosition, buffer, n);
+        for (size_t i = 0; i < n; i++) {
+          buffer[i] += data[i];
+        }
+        sourcePosition += n;
+        addSize -= n;
+        Output(buffer, n);
+      } break;
+      case States::Insert:
+        n = std::min(size, static_cast<size_t>(insertSize));
+        insertSize -= n;
+        Output(data, n);
+        break;
+      case States::Done:
+      case States::Error:
+        return;
+    }
+    data += n;
+    size -= n;
+  }
+}
+
+bool DfuService::ImagePatcher::IsComplete() const {
+  return state == States::Raw || state == States::Done;
+}
+
+bool DfuService::ImagePatcher::HasFailed() const {
+  return state == States::Error || dfuImage.HasFailed();
+}
+
+void DfuService::ImagePatcher::DecodeHeader() {
+  if (headerIndex == sizeof(magic)) {
+    uint32_t value = header[0] + (header[1] << 8) + (header[2] << 16) + (header[3] << 24);
+    if (value != magic) {
+      state = States::Raw;
+      dfuImage.Append(header, headerIndex);
+    }
+  } else if (headerIndex == headerSize) {
+    imageSize = header[4] + (header[5] << 8) + (header[6] << 16) + (header[7] << 24);
+    uint16_t imageCrc = header[8] + (header[9] << 8);
+    uint16_t sourceCrc = header[10] + (header[11] << 8);
+    sourceSize = header[12] + (header[13] << 8) + (header[14] << 16) + (header[15] << 24);
+    NRF_LOG_INFO("[DFU] Patch : size = %d, CRC = %u, running image size = %d, CRC = %u", imageSize, imageCrc, sourceSize, sourceCrc);
+
+    if (imageSize == 0 || imageSize > slotSize || sourceSize > slotSize) {
+      state = States::Error;
+      return;
+    }
+
+    if (!dfuImage.Init(20, imageSize, imageCrc)) {
+      state = States::Error;
+      return;
+    }
+    // The patch can only be applied to the image it was created from. The worker task checks it while the patch is
+    // received, and the transfer is aborted if it does not match.
+    dfuImage.CheckSource(primarySlotOffset, sourceSize, sourceCrc);
+    sourcePosition = 0;
+    headerIndex = 0;
+    state = States::Control;
+  }
+}
+
+void DfuService::ImagePatcher::DecodeControl() {
+  addSize = header[0] + (header[1] << 8) + (header[2] << 16) + (header[3] << 24);
+  insertSize = header[4] + (header[5] << 8) + (header[6] << 16) + (header[7] << 24);
+  seek = static_cast<int32_t>(header[8] + (header[9] << 8) + (header[10] << 16) + (header[11] << 24));
+  headerIndex = 0;
+  NextControl();
+}
+
+void DfuService::ImagePatcher::Output(const uint8_t* data, size_t size) {
+  dfuImage.Append(data, size);
+  outputIndex += size;
+  if (outputIndex >= imageSize) {
+    state = States::Done;
+    return;
+  }
+  NextControl();
+}
+
+void DfuService::ImagePatcher::NextControl() {
+  if (addSize > 0) {
+    state = States::Add;
+  } else if (insertSize > 0) {
+    state = States::Insert;
+  } else {
+    sourcePosition += seek;
+    state = States::Control;
+  }
+}
+
+void DfuService::ImageDecoder::Init() {
+  state = States::Header;
+  headerIndex = 0;
+  imageSize = 0;
+  outputIndex = 0;
+  flushedIndex = 0;
+  bits = 0;
+  nbBits = 0;
+}
+
+void DfuService::ImageDecoder::Append(const uint8_t* data, size_t size) {
+  for (size_t i = 0; i < size; i++) {
+    switch (state) {
+      case States::Header:
+        header[headerIndex++] = data[i];
+        DecodeHeader();
+        break;
+      case States::Raw:
+        imagePatcher.Append(data + i, size - i);
+        return;
+      case States::Done:
+      case States::Error:
+        i = size;
+        break;
+      default:
+        bits = (bits << 8) | data[i];
+        nbBits += 8;
+        Decode();
+        break;
+    }
+  }
+  Flush();
+}
+
+bool DfuService::ImageDecoder::IsComplete() const {
+  return state == States::Raw || state == States::Done;
+}
+
+bool DfuService::ImageDecoder::HasFailed() const {
+  return state == States::Error || imagePatcher.HasFailed();
+}
+
+void DfuService::ImageDecoder::DecodeHeader() {
+  if (headerIndex == sizeof(magic)) {
+    uint32_t value = header[0] + (header[1] << 8) + (header[2] << 16) + (header[3] << 24);
+    if (value != magic) {
+      NRF_LOG_INFO("[DFU] Uncompressed image");
+      state = States::Raw;
+      imagePatcher.Append(header, headerIndex);
+    }
+  } else if (headerIndex == headerSize) {
+    imageSize = header[4] + (header[5] << 8) + (header[6] << 16) + (header[7] << 24);
+    uint16_t crc = header[8] + (header[9] << 8);
+    windowBits = header[10];
+    lookaheadBits = header[11];
+    NRF_LOG_INFO("[DFU] Compressed image : size = %d, CRC = %u, window = %d, lookahead = %d",
+                 imageSize,
+                 crc,
+                 windowBits,
+                 lookaheadBits);
+
+    if (imageSize == 0 || imageSize > slotSize) {
+      NRF_LOG_INFO("[DFU] Invalid decompressed size");
+      state = States::Error;
+      return;
+    }
+    if (windowBits > maxWindowBits || lookaheadBits >= windowBits || lookaheadBits == 0) {
+      NRF_LOG_INFO("[DFU] Unsupported compression parameters");
+      state = States::Error;
+      return;
+    }
+    // The CRC sent in the init packet is the CRC of the compressed data
+    if (!imagePatcher.Init(imageSize, crc)) {
+      state = States::Error;
+      return;
+    }
+    state = States::Tag;
+  }
+}
+
+void DfuService::ImageDecoder::Decode() {
+  uint16_t value;
+  while (state != States::Done) {
+    switch (state) {
+      case States::Tag:
+        if (!GetBits(1, value))
+          return;
+        state = (value != 0) ? States::Literal : States::Index;
+        break;
+      case States::Literal:
+        if (!GetBits(8, value))
+          return;
+        state = States::Tag;
+        Output(static_cast<uint8_t>(value));
+        break;
+      case States::Index:
+        if (!GetBits(windowBits, backrefIndex))
+          return;
+        state = States::Count;
+        break;
+      case States::Count: {
+        if (!GetBits(lookaheadBits, value))
+          return;
+        state = States::Tag;
+        const uint32_t distance = backrefIndex + 1u;
+        for (uint16_t i = 0; i <= value; i++) {
+          Output(window[(outputIndex - distance) & (windowSize - 1)]);
+        }
+      } break;
+      default:
+        return;
+    }
+  }
+}
+
+bool DfuService::ImageDecoder::GetBits(uint8_t count, uint16_t& value) {
+  if (nbBits < count)
+    return false;
+  nbBits -= count;
+  value = (bits >> nbBits) & ((1u << count) - 1);
+  return true;
+}
+
+void DfuService::ImageDecoder::Output(uint8_t value) {
+  if (state == States::Done)
+    return;
+  // Do not overwrite the data that has not been appended to the image yet
+  if (outputIndex - flushedIndex == windowSize)
+    Flush();
+
+  window[outputIndex & (windowSize - 1)] = value;
+  outputIndex++;
+  if (outputIndex == imageSize)
+    state = States::Done;
+}
+
+void DfuService::ImageDecoder::Flush() {
+  while (flushedIndex != outputIndex) {
+    const size_t start = flushedIndex & (windowSize - 1);
+    const size_t size = std::min<size_t>(outputIndex - flushedIndex, windowSize - start);
+    imagePatcher.Append(window + start, size);
+    flushedIndex += size;
+  }
+}
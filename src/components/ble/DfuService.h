@@ -2,10 +2,15 @@
 
 #include <cstdint>
 #include <array>
+#include <FreeRTOS.h>
+#include <queue.h>
+#include <semphr.h>
+#include <task.h>
 
 #define min // workaround: nimble's min/max macros conflict with libstdc++
 #define max
 #include <host/ble_gap.h>
+#include <nimble/nimble_npl.h>
 #undef max
 #undef min
 
@@ -46,19 +51,61 @@ namespace Pinetime {
         void OnNotificationTimer();
         void Reset();
       };
+      // The image is received in the NimBLE host task and written to the flash memory by a worker task:
+      // the received data is staged in a small ring of buffers, and the sectors are erased just ahead of the
+      // write cursor while the worker has nothing to write, so that the reception never waits for the flash.
+      // The worker also computes the CRCs, which take too long to be computed in the NimBLE host task.
       class DfuImage {
       public:
-        DfuImage(Pinetime::Drivers::SpiNorFlash& spiNorFlash) : spiNorFlash {spiNorFlash} {
+        DfuImage(Pinetime::Drivers::SpiNorFlash& spiNorFlash, ble_npl_event& validatedEvent)
+          : spiNorFlash {spiNorFlash}, validatedEvent {validatedEvent} {
         }
-        void Init(size_t chunkSize, size_t totalSize, uint16_t expectedCrc);
-        void Erase();
-        void Append(uint8_t* data, size_t size);
-        bool Validate();
+        void Start();
+        bool Init(size_t chunkSize, size_t totalSize, uint16_t expectedCrc);
+        void Append(const uint8_t* data, size_t size);
+        // The image fails if the CRC of [offset, offset + size[ in the internal flash memory is not 'crc'
+        void CheckSource(uint32_t offset, uint32_t size, uint16_t crc);
+        // Checks the CRC of the image once it is written, then puts validatedEvent in the event queue of NimBLE
+        void Validate();
+        bool IsValid() const;
+        bool HasFailed() const;
         bool IsComplete();
+        static uint16_t ComputeCrc(uint8_t const* p_data, uint32_t size, uint16_t const* p_crc);
 
       private:
+        // The worker only knows about the transfer through these requests
+        struct Request {
+          enum class Types : uint8_t { Start, Init, CheckSource, Write, Validate };
+          Types type;
+          uint8_t buffer;
+          bool isLast;
+          uint16_t crc;    // Init: expected CRC of the image. CheckSource: expected CRC of the source.
+          uint32_t offset; // CheckSource: address of the source in the internal flash memory
+          uint32_t size;   // Init: size of the image. CheckSource: size of the source. Write: size of the data in the buffer.
+        };
+
+        static void Process(void* instance);
+        void Work();
+        void EraseUpTo(size_t offset);
+        bool SourceMatches(uint32_t offset, uint32_t size, uint16_t crc);
+        uint16_t ComputeImageCrc();
+
         Pinetime::Drivers::SpiNorFlash& spiNorFlash;
         static constexpr size_t bufferSize = 200;
+        static constexpr uint8_t nbBuffers = 4;
+        static constexpr uint8_t noBuffer = 0xff;
+        // Start, up to 2 Init (the patch and the compressed image headers re-initialize the image), CheckSource, the
+        // writes and Validate
+        static constexpr uint8_t nbRequests = nbBuffers + 5;
+        // In words. -fstack-usage gives 730 bytes for the deepest call chain (the CRC of the image, from
+        // SpiNorFlash::Read() down to SpiMaster::Submit()), to which add up to 230 bytes for FreeRTOS and the exception
+        // and context switch frames (with the FPU context). The high-water mark is logged once the image is validated.
+        static constexpr uint16_t taskStackSize = 300;
+        static constexpr size_t sectorSize = 0x1000;
+        static constexpr size_t eraseAheadSize = 8 * sectorSize;
+        // MCUBoot's image trailer (swap status and magic number) is located in the last sectors of the slot
+        static constexpr size_t trailerSize = 2 * sectorSize;
+        // Owned by the NimBLE host task
         bool ready = false;
         size_t chunkSize = 0;
         size_t totalSize = 0;
@@ -66,17 +113,115 @@ namespace Pinetime {
         size_t bufferWriteIndex = 0;
         size_t totalWriteIndex = 0;
         static constexpr size_t writeOffset = 0x40000;
-        uint8_t tempBuffer[bufferSize];
+        uint8_t buffers[nbBuffers][bufferSize];
+        uint8_t currentBuffer = noBuffer;
+
+        TaskHandle_t taskHandle = nullptr;
+        QueueHandle_t requests;
+        QueueHandle_t freeBuffers;
+        ble_npl_event& validatedEvent;
+        // Owned by the worker task
+        size_t imageSize = 0;
         uint16_t expectedCrc = 0;
+        size_t erasedSize = 0;
+        size_t flushedSize = 0;
+        // Written by the worker task, read by the NimBLE host task
+        volatile bool failed = false;
+        volatile bool valid = false;
 
         void WriteMagicNumber();
-        uint16_t ComputeCrc(uint8_t const* p_data, uint32_t size, uint16_t const* p_crc);
       };
 
+      // Applies the patches produced by bootloader/create_dfu_patch.py to the image running from the primary slot
+      // (internal flash memory) and appends the resulting image to the DfuImage. A patch is a header (magic number,
+      // size and CRC of the new image, size and CRC of the running image) followed by bsdiff-like control blocks:
+      // add 'addSize' diff bytes to the running image, insert 'insertSize' new bytes, move in the running image
+      // by 'seek' bytes. Any other data is passed to the DfuImage unchanged.
+      class ImagePatcher {
+      public:
+        ImagePatcher(DfuImage& dfuImage) : dfuImage {dfuImage} {
+        }
+        bool Init(size_t imageSize, uint16_t expectedCrc);
+        void Append(const uint8_t* data, size_t size);
+        bool IsComplete() const;
+        bool HasFailed() const;
+
+      private:
+        enum class States : uint8_t { Header, Raw, Control, Add, Insert, Done, Error };
+
+        void DecodeHeader();
+        void DecodeControl();
+        void Output(const uint8_t* data, size_t size);
+        void NextControl();
+
+        DfuImage& dfuImage;
+        static constexpr uint32_t magic = 0x4c445450; // "PTDL"
+        static constexpr size_t headerSize = 16;
+        static constexpr size_t controlSize = 12;
+        static constexpr uint32_t primarySlotOffset = 0x8000;
+        static constexpr size_t slotSize = 475136;
+        States state = States::Header;
+        uint8_t header[headerSize];
+        size_t headerIndex = 0;
+        uint32_t imageSize = 0;
+        uint32_t outputIndex = 0;
+        uint32_t sourceSize = 0;
+        uint32_t sourcePosition = 0;
+        uint32_t addSize = 0;
+        uint32_t insertSize = 0;
+        int32_t seek = 0;
+      };
+
+      // Decompresses on the fly the images produced by bootloader/compress_dfu_image.py: a header (magic number,
+      // size and CRC of the decompressed data) followed by a heatshrink (LZSS) bit stream. Any other data is
+      // passed to the ImagePatcher unchanged, so that uncompressed images are still accepted.
+      class ImageDecoder {
+      public:
+        ImageDecoder(ImagePatcher& imagePatcher) : imagePatcher {imagePatcher} {
+        }
+        void Init();
+        void Append(const uint8_t* data, size_t size);
+        bool IsComplete() const;
+        bool HasFailed() const;
+
+      private:
+        enum class States : uint8_t { Header, Raw, Tag, Literal, Index, Count, Done, Error };
+
+        void DecodeHeader();
+        void Decode();
+        bool GetBits(uint8_t count, uint16_t& value);
+        void Output(uint8_t value);
+        void Flush();
+
+        ImagePatcher& imagePatcher;
+        static constexpr uint32_t magic = 0x5a4c5450; // "PTLZ"
+        static constexpr size_t headerSize = 12;
+        static constexpr size_t slotSize = 475136;
+        static constexpr uint8_t maxWindowBits = 10;
+        static constexpr size_t windowSize = 1 << maxWindowBits;
+        States state = States::Header;
+        uint8_t header[headerSize];
+        size_t headerIndex = 0;
+        uint8_t windowBits = 0;
+        uint8_t lookaheadBits = 0;
+        uint32_t imageSize = 0;
+        uint32_t outputIndex = 0;
+        uint32_t flushedIndex = 0;
+        uint32_t bits = 0;
+        uint8_t nbBits = 0;
+        uint16_t backrefIndex = 0;
+        uint8_t window[windowSize];
+      };
+
+      void OnImageValidated();
+
     private:
       Pinetime::System::SystemTask& systemTask;
       Pinetime::Controllers::Ble& bleController;
+      ble_npl_event imageValidatedEvent;
       DfuImage dfuImage;
+      ImagePatcher imagePatcher;
+      ImageDecoder imageDecoder;
       NotificationManager notificationManager;
 
       static constexpr uint16_t dfuServiceId {0x1530};
@@ -108,7 +253,7 @@ namespace Pinetime {
       uint16_t controlPointCharacteristicHandle;
       uint16_t revisionCharacteristicHandle;
 
-      enum class States : uint8_t { Idle, Init, Start, Data, Validate, Validated };
+      enum class States : uint8_t { Idle, Init, Start, Data, Validate, Validating, Validated };
       States state = States::Idle;
 
       enum class ImageTypes : uint8_t {
@@ -147,10 +292,12 @@ namespace Pinetime {
       uint32_t bootloaderSize = 0;
       uint32_t applicationSize = 0;
       uint16_t expectedCrc = 0;
+      uint16_t validationConnectionHandle = 0;
 
       int SendDfuRevision(os_mbuf* om) const;
       int WritePacketHandler(uint16_t connectionHandle, os_mbuf* om);
       int ControlPointHandler(uint16_t connectionHandle, os_mbuf* om);
+      void AbortTransfer(uint16_t connectionHandle, ErrorCodes error);
 
       TimerHandle_t timeoutTimer;
     };
@@ -1,4 +1,5 @@
 #include <nrf_log.h>
+#include <nimble/nimble_port.h>
 #include "FSService.h"
 #include "components/ble/BleController.h"
 #include "systemtask/SystemTask.h"
@@ -14,6 +15,11 @@ int FSServiceCallback(uint16_t conn_handle, uint16_t attr_handle, struct ble_gat
   return fsService->OnFSServiceRequested(conn_handle, attr_handle, ctxt);
 }
 
+void FSServiceRetryCallback(ble_npl_event* event) {
+  auto* fsService = static_cast<FSService*>(ble_npl_event_get_arg(event));
+  fsService->OnRetryTimer();
+}
+
 FSService::FSService(Pinetime::System::SystemTask& systemTask, Pinetime::Controllers::FS& fs)
   : systemTask {systemTask},
     fs {fs},
@@ -26,7 +32,7 @@ FSService::FSService(Pinetime::System::SystemTask& systemTask, Pinetime::Control
                                 .uuid = &fsTransferUuid.u,
                                 .access_cb = FSServiceCallback,
                                 .arg = this,
-                                .flags = BLE_GATT_CHR_F_WRITE | BLE_GATT_CHR_F_READ | BLE_GATT_CHR_F_NOTIFY,
+                                .flags = BLE_GATT_CHR_F_WRITE | BLE_GATT_CHR_F_WRITE_NO_RSP | BLE_GATT_CHR_F_READ | BLE_GATT_CHR_F_NOTIFY,
                                 .val_handle = &transferCharacteristicHandle,
                               },
                               {0}},
@@ -46,6 +52,8 @@ void FSService::Init() {
 
   res = ble_gatts_add_svcs(serviceDefinition);
   ASSERT(res == 0);
+
+  ble_npl_callout_init(&retryTimer, nimble_port_get_dflt_eventq(), FSServiceRetryCallback, this);
 }
 
 int FSService::OnFSServiceRequested(uint16_t connectionHandle, uint16_t attributeHandle, ble_gatt_access_ctxt* context) {
@@ -60,8 +68,28 @@ int FSService::OnFSServiceRequested(uint16_t connectionHandle, uint16_t attribut
   return 0;
 }
 
+void FSService::Reset() {
+  if (window > 0) {
+    StopWindowedTransfer();
+  }
+}
+
 int FSService::FSCommandHandler(uint16_t connectionHandle, os_mbuf* om) {
   auto command = static_cast<commands>(om->om_data[0]);
+  // The chunks of a windowed transfer skip the wake up sequence below: the watch is kept awake until the end
+  // of the transfer.
+  if (window > 0) {
+    if (state == FSState::WRITE && command == commands::WRITE_DATA) {
+      WindowedWriteData(connectionHandle, om);
+      return 0;
+    }
+    if (state == FSState::READ && command == commands::READ_PACING) {
+      WindowedReadPacing(connectionHandle, om);
+      return 0;
+    }
+    // Any other command aborts the transfer
+    StopWindowedTransfer();
+  }
   NRF_LOG_INFO("[FS_S] -> FSCommandHandler Command %d", command);
   // Just always make sure we are awake...
   systemTask.PushMessage(Pinetime::System::Messages::StartFileTransfer);
@@ -82,10 +110,15 @@ int FSService::FSCommandHandler(uint16_t connectionHandle, os_mbuf* om) {
       }
       memcpy(filepath, header->pathstr, plen);
       filepath[plen] = 0; // Copy and null terminate string
+      if (header->window > 0) {
+        StartWindowedRead(connectionHandle, header);
+        break;
+      }
       ReadResponse resp;
       os_mbuf* om;
       resp.command = commands::READ_DATA;
       resp.status = 0x01;
+      resp.window = 0;
       resp.chunkoff = header->chunkoff;
       int res = fs.Stat(filepath, &info);
       if (res == LFS_ERR_NOENT && info.type != LFS_TYPE_DIR) {
@@ -114,6 +147,7 @@ int FSService::FSCommandHandler(uint16_t connectionHandle, os_mbuf* om) {
       ReadResponse resp;
       resp.command = commands::READ_DATA;
       resp.status = 0x01;
+      resp.window = 0;
       resp.chunkoff = header->chunkoff;
       int res = fs.Stat(filepath, &info);
       if (res == LFS_ERR_NOENT && info.type != LFS_TYPE_DIR) {
@@ -150,16 +184,22 @@ int FSService::FSCommandHandler(uint16_t connectionHandle, os_mbuf* om) {
       memcpy(filepath, header->pathstr, plen);
       filepath[plen] = 0; // Copy and null terminate string
       fileSize = header->totalSize;
+      if (header->window > 0) {
+        StartWindowedWrite(connectionHandle, header);
+        break;
+      }
       WriteResponse resp;
       resp.command = commands::WRITE_PACING;
+      resp.window = 0;
       resp.offset = header->offset;
       resp.modTime = 0;
 
       int res = fs.FileOpen(&f, filepath, LFS_O_RDWR | LFS_O_CREAT);
       if (res == 0) {
         fs.FileClose(&f);
-        resp.status = (res == 0) ? 0x01 : (int8_t) res;
+        fs.InvalidateFileHash(filepath);
       }
+      resp.status = (res == 0) ? 0x01 : (int8_t) res;
       resp.freespace = std::min(fs.getSize() - (fs.GetFSSize() * fs.getBlockSize()), fileSize - header->offset);
       auto* om = ble_hs_mbuf_from_flat(&resp, sizeof(WriteResponse));
       ble_gattc_notify_custom(connectionHandle, transferCharacteristicHandle, om);
@@ -170,6 +210,7 @@ int FSService::FSCommandHandler(uint16_t connectionHandle, os_mbuf* om) {
       auto* header = (WritePacing*) om->om_data;
       WriteResponse resp;
       resp.command = commands::WRITE_PACING;
+      resp.window = 0;
       resp.offset = header->offset;
       int res = 0;
 
@@ -297,12 +338,38 @@ int FSService::FSCommandHandler(uint16_t connectionHandle, os_mbuf* om) {
       resp.status = (res == 0) ? 1 : res;
       auto* om = ble_hs_mbuf_from_flat(&resp, sizeof(MoveResponse));
       ble_gattc_notify_custom(connectionHandle, transferCharacteristicHandle, om);
+      break;
+    }
+    case commands::HASH: {
+      NRF_LOG_INFO("[FS_S] -> Hash");
+      auto* header = (HashHeader*) om->om_data;
+      uint16_t plen = header->pathlen;
+      if (plen > maxpathlen) {
+        return -1;
+      }
+      char path[plen + 1] = {0};
+      memcpy(path, header->pathstr, plen);
+      path[plen] = 0; // Copy and null terminate string
+      HashResponse resp {};
+      resp.command = commands::HASH_STATUS;
+      uint32_t hash = 0;
+      uint32_t size = 0;
+      int res = fs.FileHash(path, hash, size);
+      resp.status = (res == 0) ? 0x01 : (int8_t) res;
+      resp.hash = hash;
+      resp.size = size;
+      auto* om = ble_hs_mbuf_from_flat(&resp, sizeof(HashResponse));
+      ble_gattc_notify_custom(connectionHandle, transferCharacteristicHandle, om);
+      break;
     }
     default:
       break;
   }
   NRF_LOG_INFO("[FS_S] -> done ");
-  systemTask.PushMessage(Pinetime::System::Messages::StopFileTransfer);
+  // A windowed transfer keeps the watch awake until it is finished
+  if (window == 0) {
+    systemTask.PushMessage(Pinetime::System::Messages::StopFileTransfer);
+  }
   return 0;
 }
 
@@ -328,3 +395,216 @@ void FSService::prepareReadDataResp(ReadHeader* header, ReadResponse* resp) {
     fs.FileClose(&f);
   }
 }
+
+void FSService::StartWindowedRead(uint16_t connectionHandle, ReadHeader* header) {
+  NRF_LOG_INFO("[FS_S] -> Windowed read, window = %d, chunk size = %d", header->window, header->chunksize);
+  lfs_info info = {0};
+  int res = fs.Stat(filepath, &info);
+  if (res == 0) {
+    res = (info.type == LFS_TYPE_REG) ? fs.FileOpen(&transferFile, filepath, LFS_O_RDONLY) : LFS_ERR_ISDIR;
+  }
+  if (res == 0 && header->chunksize == 0) {
+    fs.FileClose(&transferFile);
+    res = LFS_ERR_INVAL;
+  }
+  if (res != 0) {
+    ReadResponse resp;
+    resp.command = commands::READ_DATA;
+    resp.status = (int8_t) res;
+    resp.window = 0;
+    resp.chunkoff = header->chunkoff;
+    resp.totallen = 0;
+    resp.chunklen = 0;
+    auto* om = ble_hs_mbuf_from_flat(&resp, sizeof(ReadResponse));
+    ble_gattc_notify_custom(connectionHandle, transferCharacteristicHandle, om);
+    return;
+  }
+
+  state = FSState::READ;
+  window = std::min(header->window, maxWindow);
+  fileSize = info.size;
+  chunkSize = header->chunksize;
+  transferOffset = header->chunkoff;
+  ackedOffset = header->chunkoff;
+  retries = 0;
+
+  if (transferOffset >= static_cast<uint32_t>(fileSize)) {
+    // Nothing to send (empty file, or offset at the end of the file): no READ_PACING would end the transfer
+    ReadResponse resp;
+    resp.command = commands::READ_DATA;
+    resp.status = 0x01;
+    resp.window = window;
+    resp.chunkoff = transferOffset;
+    resp.totallen = fileSize;
+    resp.chunklen = 0;
+    auto* om = ble_hs_mbuf_from_flat(&resp, sizeof(ReadResponse));
+    ble_gattc_notify_custom(connectionHandle, transferCharacteristicHandle, om);
+    StopWindowedTransfer();
+    return;
+  }
+
+  fs.FileSeek(&transferFile, transferOffset);
+  SendReadChunks(connectionHandle);
+}
+
+void FSService::WindowedReadPacing(uint16_t connectionHandle, os_mbuf* om) {
+  if (om->om_len < sizeof(ReadPacing)) {
+    return;
+  }
+  auto* header = (ReadPacing*) om->om_data;
+  // The client has received everything before chunkoff
+  if (header->chunkoff > ackedOffset) {
+    ackedOffset = header->chunkoff;
+  }
+  if (ackedOffset >= static_cast<uint32_t>(fileSize)) {
+    StopWindowedTransfer();
+    return;
+  }
+  if (ackedOffset > transferOffset) {
+    transferOffset = ackedOffset;
+    fs.FileSeek(&transferFile, transferOffset);
+  }
+  SendReadChunks(connectionHandle);
+}
+
+void FSService::SendReadChunks(uint16_t connectionHandle) {
+  while (transferOffset < static_cast<uint32_t>(fileSize) && transferOffset < ackedOffset + (window * chunkSize)) {
+    ReadResponse resp;
+    resp.command = commands::READ_DATA;
+    resp.status = 0x01;
+    resp.window = window;
+    resp.chunkoff = transferOffset;
+    resp.totallen = fileSize;
+    resp.chunklen = std::min(chunkSize, fileSize - transferOffset);
+
+    auto* om = ble_hs_mbuf_from_flat(&resp, sizeof(ReadResponse));
+    // Read the data straight into the notification
+    auto* data = (om != nullptr) ? static_cast<uint8_t*>(os_mbuf_extend(om, resp.chunklen)) : nullptr;
+    if (data == nullptr || fs.FileRead(&transferFile, data, resp.chunklen) != static_cast<int>(resp.chunklen)) {
+      NRF_LOG_INFO("[FS_S] -> Windowed read failed at offset %d", transferOffset);
+      if (om != nullptr) {
+        os_mbuf_free_chain(om);
+      }
+      resp.status = (int8_t) LFS_ERR_IO;
+      resp.chunklen = 0;
+      om = ble_hs_mbuf_from_flat(&resp, sizeof(ReadResponse));
+      ble_gattc_notify_custom(connectionHandle, transferCharacteristicHandle, om);
+      StopWindowedTransfer();
+      return;
+    }
+
+    if (ble_gattc_notify_custom(connectionHandle, transferCharacteristicHandle, om) != 0) {
+      // Out of buffers: the next READ_PACING will resume the transfer, unless there is nothing in flight
+      fs.FileSeek(&transferFile, transferOffset);
+      if (transferOffset == ackedOffset) {
+        if (++retries > maxRetries) {
+          NRF_LOG_INFO("[FS_S] -> Windowed read stalled at offset %d", transferOffset);
+          StopWindowedTransfer();
+          return;
+        }
+        retryConnectionHandle = connectionHandle;
+        ble_npl_callout_reset(&retryTimer, retryDelay);
+      }
+      return;
+    }
+    retries = 0;
+    transferOffset += resp.chunklen;
+  }
+}
+
+void FSService::OnRetryTimer() {
+  if (window > 0 && state == FSState::READ) {
+    SendReadChunks(retryConnectionHandle);
+  }
+}
+
+void FSService::StartWindowedWrite(uint16_t connectionHandle, WriteHeader* header) {
+  NRF_LOG_INFO("[FS_S] -> Windowed write, window = %d, size = %d", header->window, header->totalSize);
+  int res = fs.FileOpen(&transferFile, filepath, LFS_O_RDWR | LFS_O_CREAT);
+  if (res == 0) {
+    fs.InvalidateFileHash(filepath);
+    res = fs.FileSeek(&transferFile, header->offset);
+    if (res < 0) {
+      fs.FileClose(&transferFile);
+    }
+  }
+
+  transferOffset = header->offset;
+  if (res >= 0) {
+    state = FSState::WRITE;
+    window = std::min(header->window, maxWindow);
+  }
+  SendWriteAck(connectionHandle, (res >= 0) ? 0x01 : (int8_t) res);
+
+  if (window > 0 && transferOffset >= static_cast<uint32_t>(fileSize)) {
+    StopWindowedTransfer();
+  }
+}
+
+void FSService::WindowedWriteData(uint16_t connectionHandle, os_mbuf* om) {
+  // The header must be in the first buffer of the chain
+  const uint32_t packetLength = OS_MBUF_PKTLEN(om);
+  if (packetLength < sizeof(WritePacing) || om->om_len < sizeof(WritePacing)) {
+    SendWriteAck(connectionHandle, 0x01);
+    return;
+  }
+  auto* header = (WritePacing*) om->om_data;
+  if (header->offset != transferOffset || header->dataSize > packetLength - sizeof(WritePacing)) {
+    // Out of order chunk: tell the client where to restart from
+    SendWriteAck(connectionHandle, 0x01);
+    return;
+  }
+
+  // Write straight from the mbuf chain
+  int res = 0;
+  uint32_t remaining = header->dataSize;
+  uint32_t offset = sizeof(WritePacing);
+  for (os_mbuf* segment = om; segment != nullptr && remaining > 0 && res >= 0; segment = SLIST_NEXT(segment, om_next)) {
+    if (offset >= segment->om_len) {
+      offset -= segment->om_len;
+      continue;
+    }
+    const uint32_t size = std::min<uint32_t>(segment->om_len - offset, remaining);
+    res = fs.FileWrite(&transferFile, segment->om_data + offset, size);
+    remaining -= size;
+    offset = 0;
+  }
+  if (res < 0) {
+    NRF_LOG_INFO("[FS_S] -> Windowed write failed at offset %d", transferOffset);
+    StopWindowedTransfer();
+    SendWriteAck(connectionHandle, (int8_t) res);
+    return;
+  }
+
+  transferOffset += header->dataSize;
+  chunksSinceAck++;
+  if (transferOffset >= static_cast<uint32_t>(fileSize)) {
+    // Only acknowledge the last chunk once the file is committed
+    StopWindowedTransfer();
+    SendWriteAck(connectionHandle, 0x01);
+  } else if (chunksSinceAck >= (window + 1) / 2) {
+    SendWriteAck(connectionHandle, 0x01);
+  }
+}
+
+void FSService::SendWriteAck(uint16_t connectionHandle, int8_t status) {
+  WriteResponse resp;
+  resp.command = commands::WRITE_PACING;
+  resp.status = status;
+  resp.window = window;
+  resp.offset = transferOffset;
+  resp.modTime = 0;
+  resp.freespace = std::min(fs.getSize() - (fs.GetFSSize() * fs.getBlockSize()), fileSize - transferOffset);
+  chunksSinceAck = 0;
+  auto* om = ble_hs_mbuf_from_flat(&resp, sizeof(WriteResponse));
+  ble_gattc_notify_custom(connectionHandle, transferCharacteristicHandle, om);
+}
+
+void FSService::StopWindowedTransfer() {
+  NRF_LOG_INFO("[FS_S] -> Windowed transfer done at offset %d", transferOffset);
+  ble_npl_callout_stop(&retryTimer);
+  fs.FileClose(&transferFile);
+  window = 0;
+  state = FSState::IDLE;
+  systemTask.PushMessage(Pinetime::System::Messages::StopFileTransfer);
+}
@@ -2,6 +2,7 @@
 #define min // workaround: nimble's min/max macros conflict with libstdc++
 #define max
 #include <host/ble_gap.h>
+#include <nimble/nimble_npl.h>
 #undef max
 #undef min
 
@@ -20,6 +21,8 @@ namespace Pinetime {
 
       int OnFSServiceRequested(uint16_t connectionHandle, uint16_t attributeHandle, ble_gatt_access_ctxt* context);
       void NotifyFSRaw(uint16_t connectionHandle);
+      void Reset();
+      void OnRetryTimer();
 
     private:
       Pinetime::System::SystemTask& systemTask;
@@ -27,7 +30,7 @@ namespace Pinetime {
       static constexpr uint16_t FSServiceId {0xFEBB};
       static constexpr uint16_t fsVersionId {0x0100};
       static constexpr uint16_t fsTransferId {0x0200};
-      uint16_t fsVersion = {0x0004};
+      uint16_t fsVersion = {0x0006};
       static constexpr uint16_t maxpathlen = 256;
       static constexpr ble_uuid16_t fsServiceUuid {
         .u {.type = BLE_UUID_TYPE_16},
@@ -61,19 +64,40 @@ namespace Pinetime {
         LISTDIR = 0x50,
         LISTDIR_ENTRY = 0x51,
         MOVE = 0x60,
-        MOVE_STATUS = 0x61
+        MOVE_STATUS = 0x61,
+        HASH = 0x70,
+        HASH_STATUS = 0x71
       };
       enum class FSState : uint8_t {
         IDLE = 0x00,
         READ = 0x01,
         WRITE = 0x02,
       };
-      FSState state;
+      FSState state = FSState::IDLE;
       char filepath[maxpathlen]; // TODO ..ugh fixed filepath len
       int fileSize;
+
+      // Windowed transfers (version >= 5): when READ or WRITE asks for a window, up to 'window' chunks may be in
+      // flight. The file stays open until the end of the transfer, the chunks are not paced one by one but
+      // acknowledged cumulatively (READ_PACING from the client, WRITE_PACING from the watch).
+      static constexpr uint8_t maxWindow = 8;
+      uint8_t window = 0;
+      lfs_file_t transferFile;
+      uint32_t transferOffset = 0; // next chunk to send (READ) or to receive (WRITE)
+      uint32_t ackedOffset = 0;
+      uint32_t chunkSize = 0;
+      uint8_t chunksSinceAck = 0;
+      // When the notifications cannot be sent and none is in flight, no READ_PACING will resume the read: it is
+      // retried later from the NimBLE host task
+      static constexpr uint32_t retryDelay = 10; // ticks
+      static constexpr uint8_t maxRetries = 50;
+      ble_npl_callout retryTimer;
+      uint16_t retryConnectionHandle = 0;
+      uint8_t retries = 0;
+
       using ReadHeader = struct __attribute__((packed)) {
         commands command;
-        uint8_t padding;
+        uint8_t window;
         uint16_t pathlen;
         uint32_t chunkoff;
         uint32_t chunksize;
@@ -83,7 +107,7 @@ namespace Pinetime {
       using ReadResponse = struct __attribute__((packed)) {
         commands command;
         uint8_t status;
-        uint16_t padding;
+        uint16_t window;
         uint32_t chunkoff;
         uint32_t totallen;
         uint32_t chunklen;
@@ -99,7 +123,7 @@ namespace Pinetime {
 
       using WriteHeader = struct __attribute__((packed)) {
         commands command;
-        uint8_t padding;
+        uint8_t window;
         uint16_t pathlen;
         uint32_t offset;
         uint64_t modTime;
@@ -110,7 +134,7 @@ namespace Pinetime {
       using WriteResponse = struct __attribute__((packed)) {
         commands command;
         uint8_t status;
-        uint16_t padding;
+        uint16_t window;
         uint32_t offset;
         uint64_t modTime;
         uint32_t freespace;
@@ -184,8 +208,31 @@ namespace Pinetime {
         uint8_t status;
       };
 
+      using HashHeader = struct __attribute__((packed)) {
+        commands command;
+        uint8_t padding;
+        uint16_t pathlen;
+        char pathstr[];
+      };
+
+      using HashResponse = struct __attribute__((packed)) {
+        commands command;
+        uint8_t status;
+        uint16_t padding;
+        uint32_t hash;
+        uint32_t size;
+      };
+
       int FSCommandHandler(uint16_t connectionHandle, os_mbuf* om);
       void prepareReadDataResp(ReadHeader* header, ReadResponse* resp);
+
+      void StartWindowedRead(uint16_t connectionHandle, ReadHeader* header);
+      void StartWindowedWrite(uint16_t connectionHandle, WriteHeader* header);
+      void WindowedReadPacing(uint16_t connectionHandle, os_mbuf* om);
+      void WindowedWriteData(uint16_t connectionHandle, os_mbuf* om);
+      void SendReadChunks(uint16_t connectionHandle);
+      void SendWriteAck(uint16_t connectionHandle, int8_t status);
+      void StopWindowedTransfer();
     };
   }
 }
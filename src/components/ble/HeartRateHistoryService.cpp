@@ -0,0 +1,98 @@
+#include "components/ble/HeartRateHistoryService.h"
+#include "components/heartrate/HeartRateHistory.h"
+#include <nrf_log.h>
+
+using namespace Pinetime::Controllers;
+
+namespace {
+  // 0005yyxx-78fc-48fe-8e23-433b3a1942d0
+  constexpr ble_uuid128_t CharUuid(uint8_t x, uint8_t y) {
+    return ble_uuid128_t {.u = {.type = BLE_UUID_TYPE_128},
+                          .value = {0xd0, 0x42, 0x19, 0x3a, 0x3b, 0x43, 0x23, 0x8e, 0xfe, 0x48, 0xfc, 0x78, x, y, 0x05, 0x00}};
+  }
+
+  // 00050000-78fc-48fe-8e23-433b3a1942d0
+  constexpr ble_uuid128_t BaseUuid() {
+    return CharUuid(0x00, 0x00);
+  }
+
+  constexpr ble_uuid128_t heartRateHistoryServiceUuid {BaseUuid()};
+  constexpr ble_uuid128_t historyCharUuid {CharUuid(0x01, 0x00)};
+
+  int HeartRateHistoryServiceCallback(uint16_t conn_handle, uint16_t attr_handle, struct ble_gatt_access_ctxt* ctxt, void* arg) {
+    auto* heartRateHistoryService = static_cast<HeartRateHistoryService*>(arg);
+    return heartRateHistoryService->OnHistoryRequested(conn_handle, attr_handle, ctxt);
+  }
+
+  void HistoryReadCallback(ble_npl_event* event) {
+    auto* heartRateHistoryService = static_cast<HeartRateHistoryService*>(ble_npl_event_get_arg(event));
+    heartRateHistoryService->OnHistoryRead();
+  }
+}
+
+HeartRateHistoryService::HeartRateHistoryService(Controllers::HeartRateHistory& heartRateHistory)
+  : heartRateHistory {heartRateHistory},
+    characteristicDefinition {{.uuid = &historyCharUuid.u,
+                               .access_cb = HeartRateHistoryServiceCallback,
+                               .arg = this,
+                               .flags = BLE_GATT_CHR_F_WRITE | BLE_GATT_CHR_F_NOTIFY,
+                               .val_handle = &historyHandle},
+                              {0}},
+    serviceDefinition {
+      {.type = BLE_GATT_SVC_TYPE_PRIMARY, .uuid = &heartRateHistoryServiceUuid.u, .characteristics = characteristicDefinition},
+      {0},
+    } {
+  ble_npl_event_init(&historyReadEvent, HistoryReadCallback, this);
+}
+
+void HeartRateHistoryService::Init() {
+  int res = 0;
+  res = ble_gatts_count_cfg(serviceDefinition);
+  ASSERT(res == 0);
+
+  res = ble_gatts_add_svcs(serviceDefinition);
+  ASSERT(res == 0);
+}
+
+int HeartRateHistoryService::OnHistoryRequested(uint16_t connectionHandle, uint16_t attributeHandle, ble_gatt_access_ctxt* context) {
+  if (attributeHandle != historyHandle || context->op != BLE_GATT_ACCESS_OP_WRITE_CHR) {
+    return 0;
+  }
+
+  uint8_t request[4];
+  if (OS_MBUF_PKTLEN(context->om) != sizeof(request) || os_mbuf_copydata(context->om, 0, sizeof(request), request) != 0) {
+    return BLE_ATT_ERR_INVALID_ATTR_VALUE_LEN;
+  }
+  const uint32_t since = request[0] | (request[1] << 8) | (request[2] << 16) | (static_cast<uint32_t>(request[3]) << 24);
+
+  // As many records as the MTU allows
+  const size_t mtu = ble_att_mtu(connectionHandle);
+  size_t maxRecords = (mtu > 3 + headerSize) ? (mtu - 3 - headerSize) / HeartRateHistory::recordSize : 0;
+  if (maxRecords > maxRecordsPerNotification) {
+    maxRecords = maxRecordsPerNotification;
+  }
+  if (maxRecords == 0) {
+    return BLE_ATT_ERR_INSUFFICIENT_RES;
+  }
+
+  if (readPending || !heartRateHistory.RequestRead(since, maxRecords, historyReadEvent)) {
+    return BLE_ATT_ERR_INSUFFICIENT_RES;
+  }
+  readPending = true;
+  readConnectionHandle = connectionHandle;
+  readSince = since;
+  return 0;
+}
+
+void HeartRateHistoryService::OnHistoryRead() {
+  uint8_t buffer[headerSize + maxRecordsPerNotification * HeartRateHistory::recordSize];
+  bool more = false;
+  const size_t count = heartRateHistory.TakeReadResult(buffer + headerSize, more);
+  readPending = false;
+  NRF_LOG_INFO("[HeartRateHistory] %d records since %d", count, readSince);
+
+  buffer[0] = static_cast<uint8_t>(count);
+  buffer[1] = more ? 0x01 : 0x00;
+  auto* om = ble_hs_mbuf_from_flat(buffer, headerSize + count * HeartRateHistory::recordSize);
+  ble_gattc_notify_custom(readConnectionHandle, historyHandle, om);
+}
@@ -0,0 +1,49 @@
+#pragma once
+#define min // workaround: nimble's min/max macros conflict with libstdc++
+#define max
+#include <host/ble_gap.h>
+#undef max
+#undef min
+#include <nimble/nimble_npl.h>
+
+namespace Pinetime {
+  namespace Controllers {
+    class HeartRateHistory;
+
+    /*
+     * Bulk read of the background heart rate measurements (see HeartRateHistory).
+     * The client writes the timestamp of the last record it received (uint32_t, 0 to read the whole history) on the
+     * history characteristic, and the watch answers with a notification:
+     *
+     *   uint8_t count   number of records in the notification
+     *   uint8_t flags   bit 0: more records are available, write the timestamp of the last record to get them
+     *   count records of 6 bytes (uint32_t timestamp, uint8_t heart rate, uint8_t duration)
+     *
+     * The records are read by SystemTask: the notification is sent when they are ready, and the requests written in
+     * the meantime are rejected (insufficient resources).
+     */
+    class HeartRateHistoryService {
+    public:
+      explicit HeartRateHistoryService(Controllers::HeartRateHistory& heartRateHistory);
+      void Init();
+      int OnHistoryRequested(uint16_t connectionHandle, uint16_t attributeHandle, ble_gatt_access_ctxt* context);
+      void OnHistoryRead();
+
+    private:
+      static constexpr size_t headerSize = 2;
+      static constexpr size_t maxRecordsPerNotification = 20;
+
+      Controllers::HeartRateHistory& heartRateHistory;
+
+      ble_npl_event historyReadEvent;
+      bool readPending = false;
+      uint16_t readConnectionHandle = 0;
+      uint32_t readSince = 0;
+
+      struct ble_gatt_chr_def characteristicDefinition[2];
+      struct ble_gatt_svc_def serviceDefinition[2];
+
+      uint16_t historyHandle;
+    };
+  }
+}
@@ -1,6 +1,7 @@
 #include "components/ble/HeartRateService.h"
 #include "components/heartrate/HeartRateController.h"
 #include "systemtask/SystemTask.h"
+#include <nimble/nimble_port.h>
 #include <nrf_log.h>
 
 using namespace Pinetime::Controllers;
@@ -13,6 +14,11 @@ namespace {
     auto* heartRateService = static_cast<HeartRateService*>(arg);
     return heartRateService->OnHeartRateRequested(conn_handle, attr_handle, ctxt);
   }
+
+  void RRIntervalsTimerCallback(ble_npl_event* event) {
+    auto* heartRateService = static_cast<HeartRateService*>(ble_npl_event_get_arg(event));
+    heartRateService->OnRRIntervalsTimer();
+  }
 }
 
 // TODO Refactoring - remove dependency to SystemTask
@@ -43,6 +49,8 @@ void HeartRateService::Init() {
 
   res = ble_gatts_add_svcs(serviceDefinition);
   ASSERT(res == 0);
+
+  ble_npl_callout_init(&rrIntervalsTimer, nimble_port_get_dflt_eventq(), RRIntervalsTimerCallback, this);
 }
 
 int HeartRateService::OnHeartRateRequested(uint16_t connectionHandle, uint16_t attributeHandle, ble_gatt_access_ctxt* context) {
@@ -57,11 +65,52 @@ int HeartRateService::OnHeartRateRequested(uint16_t connectionHandle, uint16_t a
 }
 
 void HeartRateService::OnNewHeartRateValue(uint8_t heartRateValue) {
-  if (!heartRateMeasurementNotificationEnable)
+  if (!heartRateMeasurementNotificationEnable) {
+    nbRRIntervals = 0;
+    return;
+  }
+
+  NotifyHeartRate();
+}
+
+void HeartRateService::OnNewRRInterval(uint16_t interval) {
+  if (!heartRateMeasurementNotificationEnable) {
+    nbRRIntervals = 0;
     return;
+  }
+
+  taskENTER_CRITICAL();
+  rrIntervals[nbRRIntervals++] = interval;
+  const uint8_t count = nbRRIntervals;
+  taskEXIT_CRITICAL();
+  if (count == 1) {
+    ble_npl_callout_reset(&rrIntervalsTimer, rrIntervalsMaxDelay);
+  } else if (count == rrIntervalsPerNotification) {
+    NotifyHeartRate();
+  }
+}
 
-  uint8_t buffer[2] = {0, heartRateController.HeartRate()}; // [0] = flags, [1] = hr value
-  auto* om = ble_hs_mbuf_from_flat(buffer, 2);
+void HeartRateService::OnRRIntervalsTimer() {
+  if (nbRRIntervals > 0) {
+    NotifyHeartRate();
+  }
+}
+
+void HeartRateService::NotifyHeartRate() {
+  // [0] = flags, [1] = hr value, then the RR intervals (uint16_t, oldest first)
+  uint8_t buffer[2 + (rrIntervalsPerNotification * 2)] = {0, heartRateController.HeartRate()};
+  size_t length = 2;
+  taskENTER_CRITICAL();
+  if (nbRRIntervals > 0) {
+    buffer[0] |= rrIntervalPresent;
+    for (uint8_t i = 0; i < nbRRIntervals; i++) {
+      buffer[length++] = static_cast<uint8_t>(rrIntervals[i]);
+      buffer[length++] = static_cast<uint8_t>(rrIntervals[i] >> 8);
+    }
+    nbRRIntervals = 0;
+  }
+  taskEXIT_CRITICAL();
+  ble_npl_callout_stop(&rrIntervalsTimer);
 
   uint16_t connectionHandle = system.nimble().connHandle();
 
@@ -69,6 +118,7 @@ void HeartRateService::OnNewHeartRateValue(uint8_t heartRateValue) {
     return;
   }
 
+  auto* om = ble_hs_mbuf_from_flat(buffer, length);
   ble_gattc_notify_custom(connectionHandle, heartRateMeasurementHandle, om);
 }
 
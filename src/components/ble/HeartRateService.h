@@ -2,9 +2,11 @@
 #define min // workaround: nimble's min/max macros conflict with libstdc++
 #define max
 #include <host/ble_gap.h>
+#include <array>
 #include <atomic>
 #undef max
 #undef min
+#include <nimble/nimble_npl.h>
 
 namespace Pinetime {
   namespace System {
@@ -18,11 +20,23 @@ namespace Pinetime {
       void Init();
       int OnHeartRateRequested(uint16_t connectionHandle, uint16_t attributeHandle, ble_gatt_access_ctxt* context);
       void OnNewHeartRateValue(uint8_t hearRateValue);
+      // The RR intervals are sent with the heart rate, several at once: when rrIntervalsPerNotification intervals
+      // are pending, or rrIntervalsMaxDelay after the first of them, whichever comes first. A change of the heart
+      // rate also sends the pending intervals.
+      void OnNewRRInterval(uint16_t interval);
+      void OnRRIntervalsTimer();
 
       void SubscribeNotification(uint16_t connectionHandle, uint16_t attributeHandle);
       void UnsubscribeNotification(uint16_t connectionHandle, uint16_t attributeHandle);
 
     private:
+      void NotifyHeartRate();
+
+      static constexpr uint8_t rrIntervalPresent = 0x10;
+      // 9 intervals fit in a notification with the default MTU
+      static constexpr uint8_t rrIntervalsPerNotification = 4;
+      static constexpr uint32_t rrIntervalsMaxDelay = 1024; // ticks (1 s)
+
       Pinetime::System::SystemTask& system;
       Controllers::HeartRateController& heartRateController;
       static constexpr uint16_t heartRateServiceId {0x180D};
@@ -37,6 +51,10 @@ namespace Pinetime {
 
       uint16_t heartRateMeasurementHandle;
       std::atomic_bool heartRateMeasurementNotificationEnable {false};
+      // Filled by the heart rate task, sent by this task or by the NimBLE host task (timer)
+      std::array<uint16_t, rrIntervalsPerNotification> rrIntervals;
+      uint8_t nbRRIntervals = 0;
+      ble_npl_callout rrIntervalsTimer;
     };
   }
 }
@@ -1,10 +1,17 @@
 #include "components/fs/FS.h"
+#include <algorithm>
 #include <cstring>
 #include <littlefs/lfs.h>
+#include <littlefs/lfs_util.h>
 #include <lvgl/lvgl.h>
 
 using namespace Pinetime::Controllers;
 
+namespace {
+  constexpr const char* resourcePackPath = "/resources.pack";
+  constexpr const char* resourcePackMarkerPath = "/resources.pack.installed";
+}
+
 FS::FS(Pinetime::Drivers::SpiNorFlash& driver)
   : flashDriver {driver},
     lfsConfig {
@@ -25,7 +32,8 @@ FS::FS(Pinetime::Drivers::SpiNorFlash& driver)
 
       .name_max = 50,
       .attr_max = 50,
-    } {
+    },
+    resourcePack {driver, resourcePackAddress, resourcePackSize} {
 }
 
 void FS::Init() {
@@ -43,6 +51,20 @@ void FS::Init() {
     }
   }
 
+#ifdef USE_RESOURCE_PACK
+  // A file system created without the resource pack partition may use blocks of the partition. The traversal
+  // reports every block in use (metadata and file contents) to CheckBlock(), and fails if it has to read one
+  // of these blocks, which are out of the range given to littlefs.
+  if (lfs_fs_traverse(&lfs, CheckBlock, nullptr) < 0) {
+    lfs_unmount(&lfs);
+    lfs_format(&lfs, &lfsConfig);
+    err = lfs_mount(&lfs, &lfsConfig);
+    if (err != LFS_ERR_OK) {
+      return;
+    }
+  }
+#endif
+
 #ifndef PINETIME_IS_RECOVERY
   VerifyResource();
   LVGLFileSystemInit();
@@ -52,9 +74,22 @@ void FS::Init() {
 void FS::VerifyResource() {
   // validate the resource metadata
   resourcesValid = true;
+
+  // A pack uploaded before the last reset is installed by SystemTask, once the watchdog is running
+  resourcePack.Init();
+}
+
+bool FS::ResourceAvailable(const char* path) {
+  ResourcePack::File packFile;
+  lfs_info info;
+  return resourcePack.Open(path, packFile) || (lfs_stat(&lfs, path, &info) == LFS_ERR_OK && info.type == LFS_TYPE_REG);
 }
 
 int FS::FileOpen(lfs_file_t* file_p, const char* fileName, const int flags) {
+  // Without the resource pack partition, a pack could never be installed: refuse its upload
+  if (resourcePackSize == 0 && (flags & LFS_O_CREAT) != 0 && std::strcmp(fileName, resourcePackPath) == 0) {
+    return LFS_ERR_NOSPC;
+  }
   return lfs_file_open(&lfs, file_p, fileName, flags);
 }
 
@@ -105,11 +140,142 @@ lfs_ssize_t FS::GetFSSize() {
   return lfs_fs_size(&lfs);
 }
 
+int FS::FileHash(const char* path, uint32_t& hash, uint32_t& fileSize) {
+  lfs_info info;
+  int res = lfs_stat(&lfs, path, &info);
+  if (res == LFS_ERR_NOENT && std::strcmp(path, resourcePackPath) == 0)
+    return ResourcePackHash(hash, fileSize);
+  if (res < 0)
+    return res;
+  if (info.type != LFS_TYPE_REG)
+    return LFS_ERR_ISDIR;
+
+  FileHashAttribute attribute;
+  if (lfs_getattr(&lfs, path, hashAttribute, &attribute, sizeof(attribute)) == sizeof(attribute) && attribute.size == info.size) {
+    hash = attribute.hash;
+    fileSize = attribute.size;
+    return 0;
+  }
+
+  lfs_file_t file;
+  res = lfs_file_open(&lfs, &file, path, LFS_O_RDONLY);
+  if (res < 0)
+    return res;
+  uint32_t crc = 0xffffffff;
+  uint8_t buffer[64];
+  lfs_ssize_t readSize;
+  while ((readSize = lfs_file_read(&lfs, &file, buffer, sizeof(buffer))) > 0) {
+    crc = lfs_crc(crc, buffer, readSize);
+  }
+  lfs_file_close(&lfs, &file);
+  if (readSize < 0)
+    return readSize;
+
+  attribute.hash = crc ^ 0xffffffff;
+  attribute.size = info.size;
+  lfs_setattr(&lfs, path, hashAttribute, &attribute, sizeof(attribute));
+  hash = attribute.hash;
+  fileSize = attribute.size;
+  return 0;
+}
+
+int FS::InvalidateFileHash(const char* path) {
+  if (std::strcmp(path, resourcePackPath) == 0) {
+    packInstallOffset = 0;
+  }
+  return lfs_removeattr(&lfs, path, hashAttribute);
+}
+
+int FS::ResourcePackHash(uint32_t& hash, uint32_t& fileSize) {
+  lfs_file_t file;
+  int res = lfs_file_open(&lfs, &file, resourcePackMarkerPath, LFS_O_RDONLY);
+  if (res < 0)
+    return res;
+  ResourcePackMarker marker;
+  res = lfs_file_read(&lfs, &file, &marker, sizeof(marker));
+  lfs_file_close(&lfs, &file);
+  if (res != sizeof(marker) || !resourcePack.IsValid() || marker.packCrc != resourcePack.Crc())
+    return LFS_ERR_NOENT;
+
+  hash = marker.fileHash.hash;
+  fileSize = marker.fileHash.size;
+  return 0;
+}
+
+bool FS::InstallResourcePack() {
+  lfs_file_t file;
+  if (lfs_file_open(&lfs, &file, resourcePackPath, LFS_O_RDONLY) < 0) {
+    packInstallOffset = 0;
+    return false;
+  }
+
+  bool failed = false;
+  if (packInstallOffset == 0) {
+    const lfs_soff_t fileSize = lfs_file_size(&lfs, &file);
+    if (fileSize < static_cast<lfs_soff_t>(sizeof(packInstallHeader))) {
+      // Still being uploaded
+      lfs_file_close(&lfs, &file);
+      return false;
+    }
+    if (lfs_file_read(&lfs, &file, packInstallHeader, sizeof(packInstallHeader)) != sizeof(packInstallHeader) ||
+        !ResourcePack::CheckHeader(packInstallHeader, packInstallSize)) {
+      failed = true;
+    } else if (fileSize < static_cast<lfs_soff_t>(packInstallSize)) {
+      lfs_file_close(&lfs, &file);
+      return false;
+    } else {
+      // The marker of the previous pack is removed before the partition is erased
+      lfs_remove(&lfs, resourcePackMarkerPath);
+      failed = !resourcePack.Begin(packInstallSize);
+      packInstallOffset = sizeof(packInstallHeader);
+      packInstallFileCrc = lfs_crc(0xffffffff, packInstallHeader, sizeof(packInstallHeader));
+    }
+  }
+
+  if (!failed) {
+    const uint32_t stepEnd = std::min(packInstallOffset + resourcePackInstallStep, packInstallSize);
+    failed = lfs_file_seek(&lfs, &file, packInstallOffset, LFS_SEEK_SET) < 0;
+    uint8_t buffer[64];
+    while (!failed && packInstallOffset < stepEnd) {
+      const lfs_ssize_t readSize =
+        lfs_file_read(&lfs, &file, buffer, std::min(sizeof(buffer), static_cast<size_t>(stepEnd - packInstallOffset)));
+      failed = readSize <= 0 || !resourcePack.Program(packInstallOffset, buffer, readSize);
+      if (!failed) {
+        packInstallFileCrc = lfs_crc(packInstallFileCrc, buffer, readSize);
+        packInstallOffset += readSize;
+      }
+    }
+  }
+  lfs_file_close(&lfs, &file);
+  if (!failed && packInstallOffset < packInstallSize) {
+    return true;
+  }
+
+  if (!failed && resourcePack.Commit(packInstallHeader)) {
+    ResourcePackMarker marker;
+    marker.packCrc = resourcePack.Crc();
+    marker.fileHash.hash = packInstallFileCrc ^ 0xffffffff;
+    marker.fileHash.size = packInstallSize;
+    if (lfs_file_open(&lfs, &file, resourcePackMarkerPath, LFS_O_WRONLY | LFS_O_CREAT | LFS_O_TRUNC) >= 0) {
+      lfs_file_write(&lfs, &file, &marker, sizeof(marker));
+      lfs_file_close(&lfs, &file);
+    }
+  }
+  // A pack that cannot be installed would be retried forever
+  lfs_remove(&lfs, resourcePackPath);
+  packInstallOffset = 0;
+  return false;
+}
+
 /*
 
     ----------- Interface between littlefs and SpiNorFlash -----------
 
 */
+int FS::CheckBlock(void* /*context*/, lfs_block_t block) {
+  return (block < size / blockSize) ? LFS_ERR_OK : LFS_ERR_CORRUPT;
+}
+
 int FS::SectorSync(const struct lfs_config* c) {
   return 0;
 }
@@ -117,6 +283,7 @@ int FS::SectorSync(const struct lfs_config* c) {
 int FS::SectorErase(const struct lfs_config* c, lfs_block_t block) {
   Pinetime::Controllers::FS& lfs = *(static_cast<Pinetime::Controllers::FS*>(c->context));
   const size_t address = startAddress + (block * blockSize);
+  lfs.InvalidateCache(address, blockSize);
   lfs.flashDriver.SectorErase(address);
   return lfs.flashDriver.EraseFailed() ? -1 : 0;
 }
@@ -124,6 +291,7 @@ int FS::SectorErase(const struct lfs_config* c, lfs_block_t block) {
 int FS::SectorProg(const struct lfs_config* c, lfs_block_t block, lfs_off_t off, const void* buffer, lfs_size_t size) {
   Pinetime::Controllers::FS& lfs = *(static_cast<Pinetime::Controllers::FS*>(c->context));
   const size_t address = startAddress + (block * blockSize) + off;
+  lfs.InvalidateCache(address, size);
   lfs.flashDriver.Write(address, (uint8_t*) buffer, size);
   return lfs.flashDriver.ProgramFailed() ? -1 : 0;
 }
@@ -131,10 +299,59 @@ int FS::SectorProg(const struct lfs_config* c, lfs_block_t block, lfs_off_t off,
 int FS::SectorRead(const struct lfs_config* c, lfs_block_t block, lfs_off_t off, void* buffer, lfs_size_t size) {
   Pinetime::Controllers::FS& lfs = *(static_cast<Pinetime::Controllers::FS*>(c->context));
   const size_t address = startAddress + (block * blockSize) + off;
-  lfs.flashDriver.Read(address, static_cast<uint8_t*>(buffer), size);
+  lfs.CachedRead(address, static_cast<uint8_t*>(buffer), size);
   return 0;
 }
 
+void FS::CachedRead(size_t address, uint8_t* buffer, size_t size) {
+  // Large reads would evict all the lines: read them directly from the flash memory
+  if (size >= cacheLineSize) {
+    flashDriver.Read(address, buffer, size);
+    return;
+  }
+
+  while (size > 0) {
+    const CacheLine& line = GetCacheLine(address - (address % cacheLineSize));
+    const size_t offset = address - line.address;
+    const size_t length = std::min(size, cacheLineSize - offset);
+    std::memcpy(buffer, line.data + offset, length);
+    address += length;
+    buffer += length;
+    size -= length;
+  }
+}
+
+FS::CacheLine& FS::GetCacheLine(size_t address) {
+  cacheUseCounter++;
+
+  CacheLine* victim = &cache[0];
+  for (auto& line : cache) {
+    if (line.valid && line.address == address) {
+      cacheStatistics.hits++;
+      line.lastUse = cacheUseCounter;
+      return line;
+    }
+    if (victim->valid && (!line.valid || line.lastUse < victim->lastUse)) {
+      victim = &line;
+    }
+  }
+
+  cacheStatistics.misses++;
+  flashDriver.Read(address, victim->data, cacheLineSize);
+  victim->address = address;
+  victim->lastUse = cacheUseCounter;
+  victim->valid = true;
+  return *victim;
+}
+
+void FS::InvalidateCache(size_t address, size_t size) {
+  for (auto& line : cache) {
+    if (line.address < address + size && address < line.address + cacheLineSize) {
+      line.valid = false;
+    }
+  }
+}
+
 /*
 
     ----------- LVGL filesystem integration -----------
@@ -142,12 +359,25 @@ int FS::SectorRead(const struct lfs_config* c, lfs_block_t block, lfs_off_t off,
 */
 
 namespace {
+  // The resources are read from the resource pack when it contains them, from littlefs otherwise
+  struct LvglFile {
+    bool packed;
+    union {
+      lfs_file_t file;
+      ResourcePack::File packFile;
+    };
+  };
+
   lv_fs_res_t lvglOpen(lv_fs_drv_t* drv, void* file_p, const char* path, lv_fs_mode_t mode) {
-    lfs_file_t* file = static_cast<lfs_file_t*>(file_p);
+    LvglFile* file = static_cast<LvglFile*>(file_p);
     FS* filesys = static_cast<FS*>(drv->user_data);
-    int res = filesys->FileOpen(file, path, LFS_O_RDONLY);
+    file->packed = filesys->Resources().Open(path, file->packFile);
+    if (file->packed) {
+      return LV_FS_RES_OK;
+    }
+    int res = filesys->FileOpen(&file->file, path, LFS_O_RDONLY);
     if (res == 0) {
-      if (file->type == 0) {
+      if (file->file.type == 0) {
         return LV_FS_RES_FS_ERR;
       } else {
         return LV_FS_RES_OK;
@@ -158,24 +388,61 @@ namespace {
 
   lv_fs_res_t lvglClose(lv_fs_drv_t* drv, void* file_p) {
     FS* filesys = static_cast<FS*>(drv->user_data);
-    lfs_file_t* file = static_cast<lfs_file_t*>(file_p);
-    filesys->FileClose(file);
+    LvglFile* file = static_cast<LvglFile*>(file_p);
+    if (!file->packed) {
+      filesys->FileClose(&file->file);
+    }
 
     return LV_FS_RES_OK;
   }
 
   lv_fs_res_t lvglRead(lv_fs_drv_t* drv, void* file_p, void* buf, uint32_t btr, uint32_t* br) {
     FS* filesys = static_cast<FS*>(drv->user_data);
-    lfs_file_t* file = static_cast<lfs_file_t*>(file_p);
-    filesys->FileRead(file, static_cast<uint8_t*>(buf), btr);
+    LvglFile* file = static_cast<LvglFile*>(file_p);
+    if (file->packed) {
+      *br = filesys->Resources().Read(file->packFile, static_cast<uint8_t*>(buf), btr);
+      return LV_FS_RES_OK;
+    }
+    filesys->FileRead(&file->file, static_cast<uint8_t*>(buf), btr);
     *br = btr;
     return LV_FS_RES_OK;
   }
 
   lv_fs_res_t lvglSeek(lv_fs_drv_t* drv, void* file_p, uint32_t pos) {
     FS* filesys = static_cast<FS*>(drv->user_data);
-    lfs_file_t* file = static_cast<lfs_file_t*>(file_p);
-    filesys->FileSeek(file, pos);
+    LvglFile* file = static_cast<LvglFile*>(file_p);
+    if (file->packed) {
+      return filesys->Resources().Seek(file->packFile, pos) ? LV_FS_RES_OK : LV_FS_RES_INV_PARAM;
+    }
+    filesys->FileSeek(&file->file, pos);
+    return LV_FS_RES_OK;
+  }
+
+  lv_fs_res_t lvglPackOpen(lv_fs_drv_t* drv, void* file_p, const char* path, lv_fs_mode_t mode) {
+    ResourcePack* pack = static_cast<ResourcePack*>(drv->user_data);
+    if (mode != LV_FS_MODE_RD) {
+      return LV_FS_RES_DENIED;
+    }
+    return pack->Open(path, *static_cast<ResourcePack::File*>(file_p)) ? LV_FS_RES_OK : LV_FS_RES_NOT_EX;
+  }
+
+  lv_fs_res_t lvglPackClose(lv_fs_drv_t* /*drv*/, void* /*file_p*/) {
+    return LV_FS_RES_OK;
+  }
+
+  lv_fs_res_t lvglPackRead(lv_fs_drv_t* drv, void* file_p, void* buf, uint32_t btr, uint32_t* br) {
+    ResourcePack* pack = static_cast<ResourcePack*>(drv->user_data);
+    *br = pack->Read(*static_cast<ResourcePack::File*>(file_p), static_cast<uint8_t*>(buf), btr);
+    return LV_FS_RES_OK;
+  }
+
+  lv_fs_res_t lvglPackSeek(lv_fs_drv_t* drv, void* file_p, uint32_t pos) {
+    ResourcePack* pack = static_cast<ResourcePack*>(drv->user_data);
+    return pack->Seek(*static_cast<ResourcePack::File*>(file_p), pos) ? LV_FS_RES_OK : LV_FS_RES_INV_PARAM;
+  }
+
+  lv_fs_res_t lvglPackTell(lv_fs_drv_t* /*drv*/, void* file_p, uint32_t* pos_p) {
+    *pos_p = static_cast<ResourcePack::File*>(file_p)->position;
     return LV_FS_RES_OK;
   }
 }
@@ -185,7 +452,7 @@ void FS::LVGLFileSystemInit() {
   lv_fs_drv_t fs_drv;
   lv_fs_drv_init(&fs_drv);
 
-  fs_drv.file_size = sizeof(lfs_file_t);
+  fs_drv.file_size = sizeof(LvglFile);
   fs_drv.letter = 'F';
   fs_drv.open_cb = lvglOpen;
   fs_drv.close_cb = lvglClose;
@@ -195,4 +462,20 @@ void FS::LVGLFileSystemInit() {
   fs_drv.user_data = this;
 
   lv_fs_drv_register(&fs_drv);
+
+  // Resources of the resource pack, without going through littlefs: "R:/fonts/font.bin"
+  lv_fs_drv_t pack_drv;
+  lv_fs_drv_init(&pack_drv);
+
+  pack_drv.file_size = sizeof(ResourcePack::File);
+  pack_drv.letter = 'R';
+  pack_drv.open_cb = lvglPackOpen;
+  pack_drv.close_cb = lvglPackClose;
+  pack_drv.read_cb = lvglPackRead;
+  pack_drv.seek_cb = lvglPackSeek;
+  pack_drv.tell_cb = lvglPackTell;
+
+  pack_drv.user_data = &resourcePack;
+
+  lv_fs_drv_register(&pack_drv);
 }
\ No newline at end of file
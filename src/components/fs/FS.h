@@ -1,7 +1,9 @@
 #pragma once
 
+#include <array>
 #include <cstdint>
 #include "drivers/SpiNorFlash.h"
+#include "components/fs/ResourcePack.h"
 #include <littlefs/lfs.h>
 
 namespace Pinetime {
@@ -32,6 +34,24 @@ namespace Pinetime {
       int Stat(const char* path, lfs_info* info);
       void VerifyResource();
 
+      // CRC32 (as computed by zlib) of the content of a file. It is cached in a littlefs attribute of the file
+      // along with the size of the file; InvalidateFileHash() must be called when the file is modified.
+      int FileHash(const char* path, uint32_t& hash, uint32_t& fileSize);
+      int InvalidateFileHash(const char* path);
+
+      ResourcePack& Resources() {
+        return resourcePack;
+      }
+      // True if the resource is in the resource pack or in the file system. The lv_fs driver 'F' reads both.
+      bool ResourceAvailable(const char* path);
+      // Copies /resources.pack (uploaded like any other file) to the resource pack partition, and deletes it.
+      // Each call copies the next resourcePackInstallStep bytes, so that the caller can handle its other events
+      // between two steps, and returns true until the installation is finished. Nothing is done while the file is
+      // incomplete, and the installation starts over when InvalidateFileHash() is called for the file (new upload).
+      // Once the pack is installed, FileHash() still answers for /resources.pack, so that it is not uploaded again.
+      bool InstallResourcePack();
+      static constexpr uint32_t resourcePackInstallStep = ResourcePack::eraseBlockSize;
+
       static size_t getSize() {
         return size;
       }
@@ -39,6 +59,15 @@ namespace Pinetime {
         return blockSize;
       }
 
+      struct CacheStatistics {
+        uint32_t hits = 0;
+        uint32_t misses = 0;
+      };
+
+      const CacheStatistics& GetCacheStatistics() const {
+        return cacheStatistics;
+      }
+
     private:
       Pinetime::Drivers::SpiNorFlash& flashDriver;
 
@@ -61,15 +90,49 @@ namespace Pinetime {
        *          |                                       |
        *          |                                       |
        *          |                                       |
+       * 0x380000 +---------------------------------------+
+       *          |  Resource pack (USE_RESOURCE_PACK)    |
+       *          |  512 KBytes                           |
+       *          |                                       |
        * 0x400000 +---------------------------------------+
        *
+       * The resource pack partition is optional: without USE_RESOURCE_PACK, the file system extends to the end
+       * of the memory. When the partition is enabled on a watch whose file system used the end of the memory,
+       * the file system is formatted.
        */
+#ifdef USE_RESOURCE_PACK
+      static constexpr size_t resourcePackAddress = 0x380000;
+      static constexpr size_t resourcePackSize = 0x080000;
+#else
+      static constexpr size_t resourcePackAddress = 0x400000;
+      static constexpr size_t resourcePackSize = 0;
+#endif
       static constexpr size_t startAddress = 0x0B4000;
-      static constexpr size_t size = 0x34C000;
+      static constexpr size_t size = resourcePackAddress - startAddress;
       static constexpr size_t blockSize = 4096;
 
       bool resourcesValid = false;
+
+      static constexpr uint8_t hashAttribute = 'H';
+      struct FileHashAttribute {
+        uint32_t hash;
+        uint32_t size;
+      };
       const struct lfs_config lfsConfig;
+      ResourcePack resourcePack;
+
+      // Hash of /resources.pack, kept in a small file after the installation: it is valid as long as the
+      // partition holds the pack with the same CRC.
+      struct ResourcePackMarker {
+        uint32_t packCrc;
+        FileHashAttribute fileHash;
+      };
+      uint8_t packInstallHeader[ResourcePack::headerSize];
+      uint32_t packInstallSize = 0;
+      // 0 while no installation is running
+      uint32_t packInstallOffset = 0;
+      uint32_t packInstallFileCrc = 0;
+      int ResourcePackHash(uint32_t& hash, uint32_t& fileSize);
 
       lfs_t lfs;
 
@@ -77,6 +140,32 @@ namespace Pinetime {
       static int SectorErase(const struct lfs_config* c, lfs_block_t block);
       static int SectorProg(const struct lfs_config* c, lfs_block_t block, lfs_off_t off, const void* buffer, lfs_size_t size);
       static int SectorRead(const struct lfs_config* c, lfs_block_t block, lfs_off_t off, void* buffer, lfs_size_t size);
+      static int CheckBlock(void* context, lfs_block_t block);
+
+      /*
+       * Read cache between littlefs and SpiNorFlash
+       *
+       * littlefs reads the flash memory in small chunks (read_size). Each small read loads the whole
+       * line of the flash memory that contains it, so that the following reads of the same line
+       * (usually the next ones, when reading a file sequentially) do not access the flash memory.
+       * The least recently used line is replaced on a miss. Lines are invalidated when the flash
+       * memory is programmed or erased.
+       */
+      static constexpr size_t cacheLineSize = 256;
+      static constexpr uint8_t nbCacheLines = 4;
+      struct CacheLine {
+        size_t address = 0;
+        uint32_t lastUse = 0;
+        bool valid = false;
+        uint8_t data[cacheLineSize];
+      };
+      std::array<CacheLine, nbCacheLines> cache;
+      uint32_t cacheUseCounter = 0;
+      CacheStatistics cacheStatistics;
+
+      void CachedRead(size_t address, uint8_t* buffer, size_t size);
+      CacheLine& GetCacheLine(size_t address);
+      void InvalidateCache(size_t address, size_t size);
     };
   }
 }
@@ -0,0 +1,175 @@
+#include "components/fs/ResourcePack.h"
+#include <algorithm>
+#include <cstring>
+#include <littlefs/lfs_util.h>
+#include "drivers/SpiNorFlash.h"
+
+using namespace Pinetime::Controllers;
+
+namespace {
+  uint16_t Read16(const uint8_t* data) {
+    return data[0] | (data[1] << 8);
+  }
+
+  uint32_t Read32(const uint8_t* data) {
+    return data[0] | (data[1] << 8) | (data[2] << 16) | (static_cast<uint32_t>(data[3]) << 24);
+  }
+}
+
+ResourcePack::ResourcePack(Pinetime::Drivers::SpiNorFlash& flashDriver, uint32_t address, uint32_t size)
+  : flashDriver {flashDriver}, address {address}, size {size} {
+}
+
+void ResourcePack::Init() {
+  nbEntries = 0;
+  packSize = 0;
+  packCrc = 0;
+  if (size == 0) {
+    return;
+  }
+
+  uint8_t header[headerSize];
+  flashDriver.Read(address, header, sizeof(header));
+  uint32_t headerPackSize;
+  // The CRC is only checked when the pack is installed
+  if (CheckHeader(header, headerPackSize) && headerPackSize <= size) {
+    nbEntries = Read16(header + 6);
+    packSize = headerPackSize;
+    packCrc = Read32(header + 12);
+  }
+}
+
+bool ResourcePack::CheckHeader(const uint8_t* header, uint32_t& packSize) {
+  if (Read32(header) != magic || Read16(header + 4) != version) {
+    return false;
+  }
+  const uint16_t count = Read16(header + 6);
+  packSize = Read32(header + 8);
+  return count > 0 && packSize >= headerSize + count * entrySize;
+}
+
+bool ResourcePack::Open(const char* path, File& file) {
+  // LVGL removes the leading '/' from the paths given to the drivers ("F:/fonts/font.bin" -> "fonts/font.bin"),
+  // littlefs accepts both, the index holds absolute paths
+  char absolutePath[maxPathSize];
+  if (path[0] != '/') {
+    if (std::strlen(path) + 1 >= maxPathSize) {
+      return false;
+    }
+    absolutePath[0] = '/';
+    std::strcpy(absolutePath + 1, path);
+    path = absolutePath;
+  }
+  if (!IsValid() || std::strlen(path) >= maxPathSize) {
+    return false;
+  }
+
+  uint16_t low = 0;
+  uint16_t high = nbEntries;
+  uint8_t entry[entrySize];
+  while (low < high) {
+    const uint16_t middle = (low + high) / 2;
+    flashDriver.Read(address + headerSize + middle * entrySize, entry, sizeof(entry));
+    const int comparison = std::strncmp(path, reinterpret_cast<const char*>(entry), maxPathSize);
+    if (comparison == 0) {
+      const uint32_t offset = Read32(entry + maxPathSize);
+      const uint32_t fileSize = Read32(entry + maxPathSize + 4);
+      if (offset > packSize || fileSize > packSize - offset) {
+        return false;
+      }
+      file = {address + offset, fileSize, 0, generation};
+      return true;
+    }
+    if (comparison < 0) {
+      high = middle;
+    } else {
+      low = middle + 1;
+    }
+  }
+  return false;
+}
+
+uint32_t ResourcePack::Read(File& file, uint8_t* buffer, uint32_t length) {
+  if (file.generation != generation) {
+    return 0;
+  }
+  length = std::min(length, file.size - file.position);
+  if (length > 0) {
+    flashDriver.Read(file.address + file.position, buffer, length);
+    file.position += length;
+  }
+  return length;
+}
+
+bool ResourcePack::Seek(File& file, uint32_t position) {
+  if (file.generation != generation || position > file.size) {
+    return false;
+  }
+  file.position = position;
+  return true;
+}
+
+bool ResourcePack::Begin(uint32_t newPackSize) {
+  if (newPackSize > size) {
+    return false;
+  }
+  // The header is erased first: the partition does not contain a valid pack until Commit()
+  generation++;
+  nbEntries = 0;
+  packSize = 0;
+  packCrc = 0;
+  erasedSize = 0;
+  programmedSize = headerSize;
+  programmedCrc = 0xffffffff;
+  return EraseUpTo(headerSize);
+}
+
+bool ResourcePack::Program(uint32_t offset, const uint8_t* data, size_t length) {
+  if (offset != programmedSize || offset + length > size || !EraseUpTo(offset + length)) {
+    return false;
+  }
+  flashDriver.Write(address + offset, data, length);
+  if (flashDriver.ProgramFailed()) {
+    return false;
+  }
+
+  // Check what was actually written in the flash memory, without reading the whole pack again in Commit()
+  uint8_t buffer[64];
+  for (size_t done = 0; done < length; done += sizeof(buffer)) {
+    const size_t readSize = std::min(length - done, sizeof(buffer));
+    flashDriver.Read(address + offset + done, buffer, readSize);
+    programmedCrc = lfs_crc(programmedCrc, buffer, readSize);
+  }
+  programmedSize += length;
+  return true;
+}
+
+bool ResourcePack::EraseUpTo(uint32_t end) {
+  while (erasedSize < end) {
+    const uint32_t eraseSize = (size - erasedSize > eraseBlockSize) ? eraseBlockSize : size - erasedSize;
+    flashDriver.Erase(address + erasedSize, eraseSize);
+    if (flashDriver.EraseFailed()) {
+      return false;
+    }
+    erasedSize += eraseSize;
+  }
+  return true;
+}
+
+bool ResourcePack::Commit(const uint8_t* header) {
+  uint32_t headerPackSize;
+  if (!CheckHeader(header, headerPackSize) || headerPackSize > size) {
+    return false;
+  }
+
+  if (programmedSize != headerPackSize || (programmedCrc ^ 0xffffffff) != Read32(header + 12)) {
+    return false;
+  }
+
+  flashDriver.Write(address, header, headerSize);
+  if (flashDriver.ProgramFailed()) {
+    return false;
+  }
+  Init();
+  return IsValid();
+}
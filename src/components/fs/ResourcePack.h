@@ -0,0 +1,88 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace Pinetime {
+  namespace Drivers {
+    class SpiNorFlash;
+  }
+
+  namespace Controllers {
+    /*
+     * Read-only pack of resources (fonts, images,...) stored in a dedicated partition of the external flash memory
+     * (see the map in FS.h), outside of littlefs. The pack is generated by generate-package.py (--pack):
+     *
+     *   Header (16 bytes)
+     *     uint32_t magic     0x4b505450 ("PTPK")
+     *     uint16_t version   1
+     *     uint16_t count     number of entries in the index
+     *     uint32_t size      size of the pack, header included
+     *     uint32_t crc       CRC32 (zlib) of the pack, after the header
+     *   Index (count * 48 bytes), sorted by path
+     *     char     path[40]  absolute path of the resource (as in littlefs), padded with zeros
+     *     uint32_t offset    offset of the content from the start of the pack, multiple of 16
+     *     uint32_t size      size of the content
+     *   Contents
+     *
+     * Opening a resource is a binary search in the index, and reading it a direct read of the flash memory.
+     * All the fields are little endian.
+     */
+    class ResourcePack {
+    public:
+      struct File {
+        uint32_t address;
+        uint32_t size;
+        uint32_t position;
+        // The files opened before the installation of a new pack cannot be read anymore
+        uint32_t generation;
+      };
+
+      ResourcePack(Pinetime::Drivers::SpiNorFlash& flashDriver, uint32_t address, uint32_t size);
+
+      void Init();
+      bool IsValid() const {
+        return nbEntries > 0;
+      }
+      // CRC of the installed pack, as written in its header
+      uint32_t Crc() const {
+        return packCrc;
+      }
+
+      // The path is absolute, the leading '/' may be omitted
+      bool Open(const char* path, File& file);
+      uint32_t Read(File& file, uint8_t* buffer, uint32_t length);
+      bool Seek(File& file, uint32_t position);
+
+      // Installation of a new pack: the pack is invalid until Commit() succeeds. The pack is programmed in order,
+      // from the end of the header, and what is programmed is read back to check the CRC of the pack.
+      static constexpr size_t headerSize = 16;
+      // The partition is erased by sectors as Program() reaches them, so that no call lasts too long
+      static constexpr uint32_t eraseBlockSize = 0x1000;
+      static bool CheckHeader(const uint8_t* header, uint32_t& packSize);
+      bool Begin(uint32_t newPackSize);
+      bool Program(uint32_t offset, const uint8_t* data, size_t length);
+      bool Commit(const uint8_t* header);
+
+    private:
+
+      static constexpr uint32_t magic = 0x4b505450;
+      static constexpr uint16_t version = 1;
+      static constexpr size_t maxPathSize = 40;
+      static constexpr size_t entrySize = maxPathSize + 8;
+
+      Pinetime::Drivers::SpiNorFlash& flashDriver;
+      const uint32_t address;
+      const uint32_t size;
+      uint16_t nbEntries = 0;
+      uint32_t packSize = 0;
+      uint32_t packCrc = 0;
+      uint32_t erasedSize = 0;
+      uint32_t programmedSize = 0;
+      uint32_t programmedCrc = 0;
+      uint32_t generation = 0;
+
+      bool EraseUpTo(uint32_t end);
+    };
+  }
+}
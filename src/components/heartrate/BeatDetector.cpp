@@ -0,0 +1,117 @@
+#include "components/heartrate/BeatDetector.h"
+
+using namespace Pinetime::Controllers;
+
+// Butterworth high-pass filter at 0.4 Hz, low-pass filter of Ppg, for a sample rate of 25.6 Hz
+BeatDetector::BeatDetector()
+  : hpf {0.93293158, -1.86586315, 0.93293158, -1.86135999, 0.87036631},
+    lpf {0.11595249, 0.23190498, 0.11595249, -0.72168143, 0.18549138} {
+}
+
+bool BeatDetector::Step(uint32_t spl, uint32_t timestamp, Beat& beat) {
+  const int32_t value = lpf.Step(hpf.Step((static_cast<int32_t>(spl) - offset) * (1 << fractionalBits)));
+
+  bool found = false;
+  if (nbSamples == 2) {
+    const int32_t y0 = samples[0];
+    const int32_t y1 = samples[1];
+    const int32_t y2 = value;
+    // The baseline of the signal drifts (breathing, movements): a peak is measured from the lowest sample before it
+    const int32_t rise = y1 - trough;
+    if (y1 > y0 && y1 >= y2 && rise > 0 && rise * 3 >= envelope * 2) {
+      // Vertex of the parabola through the 3 samples: between -1/2 and 1/2 sample from the middle one
+      const int32_t curvature = y0 - (2 * y1) + y2; // < 0
+      const int32_t period = static_cast<int32_t>(y2 > y0 ? timestamp - timestamps[1] : timestamps[1] - timestamps[0]);
+      const int32_t shift = ((y0 - y2) * period) / (2 * curvature);
+      const uint32_t peakTimestamp = timestamps[1] + static_cast<uint32_t>(shift);
+
+      // A pulse can have several maxima (dicrotic wave, noise): the beat is the highest one
+      if (!peakPending || peakTimestamp - pendingPeakTimestamp >= PeakWindow()) {
+        if (peakPending)
+          found = AddBeat(pendingPeakTimestamp, beat);
+        peakPending = true;
+        pendingPeakTimestamp = peakTimestamp;
+        pendingPeakValue = samples[1];
+      } else if (samples[1] > pendingPeakValue) {
+        pendingPeakTimestamp = peakTimestamp;
+        pendingPeakValue = samples[1];
+      }
+      if (rise > envelope)
+        envelope = rise;
+      trough = samples[1];
+    }
+  }
+  if (peakPending && timestamp - pendingPeakTimestamp >= PeakWindow()) {
+    peakPending = false;
+    found = AddBeat(pendingPeakTimestamp, beat);
+  }
+
+  // The envelope follows the amplitude of the peaks and decays slowly between them
+  envelope -= envelope >> 6;
+  if (nbSamples == 0 || value < trough)
+    trough = value;
+
+  if (nbSamples == 2) {
+    samples[0] = samples[1];
+    timestamps[0] = timestamps[1];
+  } else {
+    nbSamples++;
+  }
+  samples[nbSamples - 1] = value;
+  timestamps[nbSamples - 1] = timestamp;
+  return found;
+}
+
+uint32_t BeatDetector::PeakWindow() const {
+  const uint32_t halfInterval = averageInterval / 2;
+  return halfInterval > minInterval ? halfInterval : minInterval;
+}
+
+bool BeatDetector::AddBeat(uint32_t timestamp, Beat& beat) {
+  if (!lastBeatValid) {
+    lastBeat = timestamp;
+    lastBeatValid = true;
+    return false;
+  }
+
+  const uint32_t interval = timestamp - lastBeat;
+  if (interval > maxInterval) {
+    // At least one beat was missed
+    lastBeat = timestamp;
+    return false;
+  }
+
+  const bool tooShort = interval * 10 < averageInterval * 7u;
+  const bool tooLong = interval * 10 > averageInterval * 13u;
+  if (averageInterval != 0 && (tooShort || tooLong)) {
+    rejectedIntervals++;
+    if (rejectedIntervals < maxRejectedIntervals) {
+      // A peak too early is ignored, a peak too late follows a missed beat
+      if (tooLong)
+        lastBeat = timestamp;
+      return false;
+    }
+    averageInterval = 0;
+  }
+  rejectedIntervals = 0;
+  lastBeat = timestamp;
+  averageInterval = averageInterval == 0 ? interval : ((averageInterval * 7u) + interval) / 8;
+
+  beat.timestamp = timestamp;
+  beat.interval = static_cast<uint16_t>(interval);
+  return true;
+}
+
+void BeatDetector::SetOffset(uint32_t offset) {
+  this->offset = static_cast<int32_t>(offset);
+  Reset();
+}
+
+void BeatDetector::Reset() {
+  nbSamples = 0;
+  envelope = 0;
+  peakPending = false;
+  lastBeatValid = false;
+  averageInterval = 0;
+  rejectedIntervals = 0;
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstdint>
+#include "components/heartrate/Biquad.h"
+
+namespace Pinetime {
+  namespace Controllers {
+    /*
+     * Streaming detection of the heart beats in the samples of the sensor, to measure the interval between consecutive
+     * beats (RR interval). It processes the same samples as Ppg, but with its own band-pass filter: the high-pass
+     * filter of Ppg distorts the pulses below 60 bpm, and its gain control clips their peaks.
+     *
+     * A beat is the highest local maximum of the signal within a window (minInterval, or half of the recent intervals),
+     * which rises above the previous minimum by 2/3 of the recent amplitude of the pulses at least. Its time is
+     * interpolated between the samples, which are too far apart (~39 ms) to give the intervals directly. A beat is
+     * reported at the end of its window, once no higher peak can replace it. The intervals too short or too long
+     * compared to the recent ones are artifacts (noise, missed beat) and are not reported.
+     *
+     * The timestamps and the intervals are in 1/1024 s, the unit of the FreeRTOS ticks and of the RR intervals of the
+     * BLE Heart Rate Measurement characteristic.
+     */
+    class BeatDetector {
+    public:
+      struct Beat {
+        uint32_t timestamp;
+        uint16_t interval; // Since the previous beat
+      };
+
+      BeatDetector();
+      // Returns true if the sample ends a beat, described in 'beat'
+      bool Step(uint32_t spl, uint32_t timestamp, Beat& beat);
+
+      void SetOffset(uint32_t offset);
+      void Reset();
+
+    private:
+      // 200 bpm to 30 bpm, in 1/1024 s
+      static constexpr uint32_t minInterval = 1024 * 60 / 200;
+      static constexpr uint32_t maxInterval = 1024 * 60 / 30;
+      // After this number of consecutive rejected intervals, the heart rate is assumed to have changed
+      static constexpr uint8_t maxRejectedIntervals = 3;
+      // Number of fractional bits of the samples given to the filters
+      static constexpr int fractionalBits = 4;
+
+      int32_t offset = 0;
+      Biquad hpf;
+      Biquad lpf;
+
+      // Last 2 filtered samples
+      int32_t samples[2];
+      uint32_t timestamps[2];
+      uint8_t nbSamples = 0;
+      int32_t trough = 0;
+      int32_t envelope = 0;
+
+      bool peakPending = false;
+      uint32_t pendingPeakTimestamp = 0;
+      int32_t pendingPeakValue = 0;
+
+      uint32_t lastBeat = 0;
+      bool lastBeatValid = false;
+      uint16_t averageInterval = 0;
+      uint8_t rejectedIntervals = 0;
+
+      uint32_t PeakWindow() const;
+      bool AddBeat(uint32_t timestamp, Beat& beat);
+    };
+  }
+}
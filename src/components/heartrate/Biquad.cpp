@@ -5,19 +5,36 @@
 */
 
 #include "components/heartrate/Biquad.h"
+#include <cmath>
 
 using namespace Pinetime::Controllers;
 
+namespace {
+  int16_t ToFixed(float coefficient, int bits) {
+    return static_cast<int16_t>(std::lround(coefficient * (1 << bits)));
+  }
+
+  int32_t Round(int64_t value, int bits) {
+    return static_cast<int32_t>((value + (1 << (bits - 1))) >> bits);
+  }
+}
+
 /** Original implementation from wasp-os : https://github.com/daniel-thompson/wasp-os/blob/master/wasp/ppg.py */
-Biquad::Biquad(float b0, float b1, float b2, float a1, float a2) : b0 {b0}, b1 {b1}, b2 {b2}, a1 {a1}, a2 {a2} {
+Biquad::Biquad(float b0, float b1, float b2, float a1, float a2)
+  : b0 {ToFixed(b0, coefficientBits)},
+    b1 {ToFixed(b1, coefficientBits)},
+    b2 {ToFixed(b2, coefficientBits)},
+    a1 {ToFixed(a1, coefficientBits)},
+    a2 {ToFixed(a2, coefficientBits)} {
 }
 
-float Biquad::Step(float x) {
+int32_t Biquad::Step(int32_t x) {
   auto v1 = this->v1;
   auto v2 = this->v2;
 
-  auto v = x - (a1 * v1) - (a2 * v2);
-  auto y = (b0 * v) + (b1 * v1) + (b2 * v2);
+  // 32x32 -> 64 bits products (SMULL/SMLAL on the Cortex-M4)
+  auto v = x - Round((static_cast<int64_t>(a1) * v1) + (static_cast<int64_t>(a2) * v2), coefficientBits);
+  auto y = Round((static_cast<int64_t>(b0) * v) + (static_cast<int64_t>(b1) * v1) + (static_cast<int64_t>(b2) * v2), coefficientBits);
 
   this->v2 = v1;
   this->v1 = v;
@@ -1,22 +1,27 @@
 #pragma once
 
+#include <cstdint>
+
 namespace Pinetime {
   namespace Controllers {
-    /// Direct Form II Biquad Filter
+    /// Direct Form II Biquad Filter, in fixed point
     class Biquad {
     public:
+      // The coefficients are converted to Q2.14. The samples are integers, in the fixed-point format of the caller.
       Biquad(float b0, float b1, float b2, float a1, float a2);
-      float Step(float x);
+      int32_t Step(int32_t x);
 
     private:
-      float b0;
-      float b1;
-      float b2;
-      float a1;
-      float a2;
+      static constexpr int coefficientBits = 14;
+
+      int16_t b0;
+      int16_t b1;
+      int16_t b2;
+      int16_t a1;
+      int16_t a2;
 
-      float v1 = 0.0f;
-      float v2 = 0.0f;
+      int32_t v1 = 0;
+      int32_t v2 = 0;
     };
   }
 }
@@ -12,6 +12,10 @@ void HeartRateController::Update(HeartRateController::States newState, uint8_t h
   }
 }
 
+void HeartRateController::AddRRInterval(uint16_t interval) {
+  service->OnNewRRInterval(interval);
+}
+
 void HeartRateController::Start() {
   if (task != nullptr) {
     state = States::NotEnoughData;
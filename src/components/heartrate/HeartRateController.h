@@ -19,6 +19,8 @@ namespace Pinetime {
       void Start();
       void Stop();
       void Update(States newState, uint8_t heartRate);
+      // Interval between the last 2 beats, in 1/1024 s
+      void AddRRInterval(uint16_t interval);
 
       void SetHeartRateTask(Applications::HeartRateTask* task);
       States State() const {
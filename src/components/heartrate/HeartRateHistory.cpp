@@ -0,0 +1,137 @@
+#include "components/heartrate/HeartRateHistory.h"
+#include <chrono>
+#include <cstring>
+#include <nimble/nimble_port.h>
+#include <nrf_log.h>
+#include "components/datetime/DateTimeController.h"
+#include "systemtask/SystemTask.h"
+
+using namespace Pinetime::Controllers;
+
+namespace {
+  constexpr const char* historyFileName = "/hrhist.new";
+  constexpr const char* oldHistoryFileName = "/hrhist.old";
+
+  uint32_t Read32(const uint8_t* data) {
+    return data[0] | (data[1] << 8) | (data[2] << 16) | (static_cast<uint32_t>(data[3]) << 24);
+  }
+}
+
+HeartRateHistory::HeartRateHistory(FS& fs, DateTime& dateTimeController) : fs {fs}, dateTimeController {dateTimeController} {
+}
+
+void HeartRateHistory::Init(Pinetime::System::SystemTask* systemTask) {
+  this->systemTask = systemTask;
+  pendingRecords = xQueueCreate(maxPendingRecords, sizeof(Record));
+  readRequests = xQueueCreate(1, sizeof(ReadRequest));
+  readResults = xQueueCreate(1, sizeof(ReadResult));
+}
+
+void HeartRateHistory::Add(uint8_t heartRate, uint8_t duration) {
+  const auto now = std::chrono::duration_cast<std::chrono::seconds>(dateTimeController.UTCDateTime().time_since_epoch());
+  Record record {static_cast<uint32_t>(now.count()), heartRate, duration};
+  if (xQueueSend(pendingRecords, &record, 0) != pdPASS) {
+    NRF_LOG_INFO("[HeartRateHistory] Record dropped");
+    return;
+  }
+  systemTask->PushMessage(Pinetime::System::Messages::SaveHeartRateHistory);
+}
+
+void HeartRateHistory::Commit() {
+  Record record;
+  while (xQueueReceive(pendingRecords, &record, 0) == pdPASS) {
+    if (!Write(record)) {
+      NRF_LOG_INFO("[HeartRateHistory] Write failed");
+    }
+  }
+}
+
+bool HeartRateHistory::Write(const Record& record) {
+  lfs_info info;
+  if (fs.Stat(historyFileName, &info) == LFS_ERR_OK && info.size + recordSize > maxFileSize) {
+    // The previous records are dropped, the most recent ones remain in the old file
+    fs.FileDelete(oldHistoryFileName);
+    if (fs.Rename(historyFileName, oldHistoryFileName) != LFS_ERR_OK) {
+      return false;
+    }
+  }
+
+  lfs_file_t file;
+  if (fs.FileOpen(&file, historyFileName, LFS_O_WRONLY | LFS_O_CREAT | LFS_O_APPEND) != LFS_ERR_OK) {
+    return false;
+  }
+  const uint8_t data[recordSize] = {static_cast<uint8_t>(record.timestamp),
+                                    static_cast<uint8_t>(record.timestamp >> 8),
+                                    static_cast<uint8_t>(record.timestamp >> 16),
+                                    static_cast<uint8_t>(record.timestamp >> 24),
+                                    record.heartRate,
+                                    record.duration};
+  const int written = fs.FileWrite(&file, data, recordSize);
+  fs.FileClose(&file);
+  return written == static_cast<int>(recordSize);
+}
+
+bool HeartRateHistory::RequestRead(uint32_t since, size_t maxRecords, ble_npl_event& readDone) {
+  ReadRequest request {since, static_cast<uint8_t>((maxRecords < maxReadRecords) ? maxRecords : maxReadRecords), &readDone};
+  if (xQueueSend(readRequests, &request, 0) != pdPASS) {
+    return false;
+  }
+  systemTask->PushMessage(Pinetime::System::Messages::ReadHeartRateHistory);
+  return true;
+}
+
+size_t HeartRateHistory::TakeReadResult(uint8_t* buffer, bool& more) {
+  ReadResult result;
+  more = false;
+  if (xQueueReceive(readResults, &result, 0) != pdPASS) {
+    return 0;
+  }
+  std::memcpy(buffer, result.records, result.count * recordSize);
+  more = result.more;
+  return result.count;
+}
+
+void HeartRateHistory::ProcessReadRequests() {
+  ReadRequest request;
+  while (xQueueReceive(readRequests, &request, 0) == pdPASS) {
+    bool more = false;
+    readResult.count = static_cast<uint8_t>(ReadRecords(request.since, readResult.records, request.maxRecords, more));
+    readResult.more = more;
+    xQueueOverwrite(readResults, &readResult);
+    ble_npl_eventq_put(nimble_port_get_dflt_eventq(), request.readDone);
+  }
+}
+
+size_t HeartRateHistory::ReadRecords(uint32_t since, uint8_t* buffer, size_t maxRecords, bool& more) {
+  more = false;
+  size_t count = ReadFile(oldHistoryFileName, since, buffer, 0, maxRecords, more);
+  if (!more) {
+    count = ReadFile(historyFileName, since, buffer, count, maxRecords, more);
+  }
+  return count;
+}
+
+size_t HeartRateHistory::ReadFile(const char* path, uint32_t since, uint8_t* buffer, size_t count, size_t maxRecords, bool& more) {
+  lfs_file_t file;
+  if (fs.FileOpen(&file, path, LFS_O_RDONLY) != LFS_ERR_OK) {
+    return count;
+  }
+
+  uint8_t records[8 * recordSize];
+  int length;
+  while (!more && (length = fs.FileRead(&file, records, sizeof(records))) >= static_cast<int>(recordSize)) {
+    for (size_t offset = 0; offset + recordSize <= static_cast<size_t>(length); offset += recordSize) {
+      if (Read32(records + offset) <= since) {
+        continue;
+      }
+      if (count == maxRecords) {
+        more = true;
+        break;
+      }
+      std::memcpy(buffer + (count * recordSize), records + offset, recordSize);
+      count++;
+    }
+  }
+  fs.FileClose(&file);
+  return count;
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <FreeRTOS.h>
+#include <queue.h>
+#include <nimble/nimble_npl.h>
+#include "components/fs/FS.h"
+
+namespace Pinetime {
+  namespace System {
+    class SystemTask;
+  }
+  namespace Controllers {
+    class DateTime;
+
+    /*
+     * History of the background heart rate measurements, stored in littlefs as records of 6 bytes:
+     *
+     *   uint32_t timestamp   UTC time of the measurement, in seconds since the epoch
+     *   uint8_t  heartRate   bpm
+     *   uint8_t  duration    time the sensor was powered to get the measurement, in seconds
+     *
+     * The records are appended to /hrhist.new. When it is full, it replaces /hrhist.old: the history keeps between
+     * maxFileSize and 2 * maxFileSize bytes of the most recent records.
+     */
+    class HeartRateHistory {
+    public:
+      static constexpr size_t recordSize = 6;
+      static constexpr size_t maxReadRecords = 20;
+
+      HeartRateHistory(FS& fs, DateTime& dateTimeController);
+
+      void Init(Pinetime::System::SystemTask* systemTask);
+
+      // Can be called from any task: the records are written to the file system by SystemTask (Commit())
+      void Add(uint8_t heartRate, uint8_t duration);
+      void Commit();
+
+      // Asks for the records more recent than 'since', oldest first, up to maxRecords records (at most maxReadRecords).
+      // Can be called from any task: the files are read by SystemTask (ProcessReadRequests()), between two commits,
+      // which then puts 'readDone' in the default NimBLE event queue. Returns false if a request is already pending.
+      bool RequestRead(uint32_t since, size_t maxRecords, ble_npl_event& readDone);
+      // Copies the records of the last request into 'buffer'. Returns the number of records copied, 'more' tells
+      // whether more recent records were left out.
+      size_t TakeReadResult(uint8_t* buffer, bool& more);
+      void ProcessReadRequests();
+
+    private:
+      struct Record {
+        uint32_t timestamp;
+        uint8_t heartRate;
+        uint8_t duration;
+      };
+
+      static constexpr size_t maxFileSize = 2040; // 340 records
+      static constexpr UBaseType_t maxPendingRecords = 4;
+
+      struct ReadRequest {
+        uint32_t since;
+        uint8_t maxRecords;
+        ble_npl_event* readDone;
+      };
+      // The records are returned by value, through a queue, to the task that handles 'readDone'
+      struct ReadResult {
+        uint8_t count;
+        bool more;
+        uint8_t records[maxReadRecords * recordSize];
+      };
+
+      FS& fs;
+      DateTime& dateTimeController;
+      Pinetime::System::SystemTask* systemTask = nullptr;
+      QueueHandle_t pendingRecords = nullptr;
+      QueueHandle_t readRequests = nullptr;
+      QueueHandle_t readResults = nullptr;
+      // Owned by SystemTask
+      ReadResult readResult;
+
+      bool Write(const Record& record);
+      size_t ReadRecords(uint32_t since, uint8_t* buffer, size_t maxRecords, bool& more);
+      size_t ReadFile(const char* path, uint32_t since, uint8_t* buffer, size_t count, size_t maxRecords, bool& more);
+    };
+  }
+}
@@ -5,93 +5,125 @@
 */
 
 #include "components/heartrate/Ppg.h"
-#include <vector>
-#include <nrf_log.h>
+#include <algorithm>
+#include <limits>
 using namespace Pinetime::Controllers;
 
 /** Original implementation from wasp-os : https://github.com/daniel-thompson/wasp-os/blob/master/wasp/ppg.py */
-namespace {
-  int Compare(int8_t* d1, int8_t* d2, size_t count) {
-    int e = 0;
-    for (size_t i = 0; i < count; i++) {
-      auto d = d1[i] - d2[i];
-      e += d * d;
-    }
-    return e;
-  }
-
-  int CompareShift(int8_t* d, int shift, size_t count) {
-    return Compare(d + shift, d, count - shift);
-  }
-
-  int Trough(int8_t* d, size_t size, uint8_t mn, uint8_t mx) {
-    auto z2 = CompareShift(d, mn - 2, size);
-    auto z1 = CompareShift(d, mn - 1, size);
-    for (int i = mn; i < mx + 1; i++) {
-      auto z = CompareShift(d, i, size);
-      if (z2 > z1 && z1 < z)
-        return i;
-      z2 = z1;
-      z1 = z;
-    }
-    return -1;
-  }
-}
-
 Ppg::Ppg()
   : hpf {0.87033078, -1.74066156, 0.87033078, -1.72377617, 0.75754694},
-    agc {20, 0.971, 2},
+    agc {20 << fractionalBits, 0.971, 2},
     lpf {0.11595249, 0.23190498, 0.11595249, -0.72168143, 0.18549138} {
 }
 
-int8_t Ppg::Preprocess(float spl) {
-  spl -= offset;
-  spl = hpf.Step(spl);
-  spl = agc.Step(spl);
-  spl = lpf.Step(spl);
+int8_t Ppg::Preprocess(uint32_t spl) {
+  int32_t value = (static_cast<int32_t>(spl) - offset) * (1 << fractionalBits);
+  value = hpf.Step(value);
+  value = agc.Step(value);
+  value = lpf.Step(value);
 
-  auto spl_int = static_cast<int8_t>(spl);
+  value /= 1 << Ptagc::outputFractionalBits;
+  value = std::max<int32_t>(std::numeric_limits<int8_t>::min(), std::min<int32_t>(value, std::numeric_limits<int8_t>::max()));
+  auto spl_int = static_cast<int8_t>(value);
 
-  if (dataIndex < 200)
+  if (dataIndex < windowSize)
     data[dataIndex++] = spl_int;
   return spl_int;
 }
 
-float Ppg::HeartRate() {
-  if (dataIndex < 200)
+int Ppg::HeartRate() {
+  if (dataIndex < windowSize)
     return 0;
 
-  NRF_LOG_INFO("PREPROCESS, offset = %d", offset);
   auto hr = ProcessHeartRate();
   dataIndex = 0;
   return hr;
 }
-float Ppg::ProcessHeartRate() {
-  auto t0 = Trough(data.data(), dataIndex, 7, 48);
+
+int Ppg::CompareShift(size_t shift) const {
+  int e = 0;
+  for (size_t i = shift; i < dataIndex; i++) {
+    const int d = data[i] - data[i - shift];
+    e += d * d;
+  }
+  return e;
+}
+
+// Returns the first lag in [mn, mx] at which the differences are a local minimum, -1 if none
+int Ppg::Trough(size_t mn, size_t mx) const {
+  // The lags for which there is no pair of samples in the window are not meaningful
+  mx = std::min(mx, dataIndex - 2);
+  if (mn < 1 || mn > mx)
+    return -1;
+
+  auto z2 = CompareShift(mn - 1);
+  auto z1 = CompareShift(mn);
+  for (size_t i = mn + 1; i < mx + 2; i++) {
+    auto z = CompareShift(i);
+    if (z2 > z1 && z1 < z)
+      return i - 1;
+    z2 = z1;
+    z1 = z;
+  }
+  return -1;
+}
+
+// Returns the lag in [mn, mx] at which the mean of the differences is the lowest, -1 if it is at a bound of the range
+// (the trough is outside of it)
+int Ppg::Minimum(size_t mn, size_t mx) const {
+  mx = std::min(mx, dataIndex - 1);
+  if (mn > mx)
+    return -1;
+
+  // The differences are summed on dataIndex - lag pairs of samples: z(i) / (dataIndex - i) < z(lag) / (dataIndex - lag)
+  size_t lag = mn;
+  int64_t z = CompareShift(mn);
+  for (size_t i = mn + 1; i < mx + 1; i++) {
+    int64_t zi = CompareShift(i);
+    if (zi * (dataIndex - lag) < z * (dataIndex - i)) {
+      lag = i;
+      z = zi;
+    }
+  }
+  if (lag == mn || lag == mx)
+    return -1;
+  return lag;
+}
+
+int Ppg::ProcessHeartRate() const {
+  // The first trough gives an approximation of the period, which is refined on its multiples
+  auto t0 = Trough(7, 48);
   if (t0 < 0)
     return 0;
 
-  float t1 = t0 * 2;
-  t1 = Trough(data.data(), dataIndex, t1 - 5, t1 + 5);
+  auto t1 = Minimum(t0 * 2 - 5, t0 * 2 + 5);
   if (t1 < 0)
     return 0;
 
-  float t2 = static_cast<int>(t1 * 3) / 2;
-  t2 = Trough(data.data(), dataIndex, t2 - 5, t2 + 5);
+  // The trough of the dicrotic wave, at about half of the period, is much shallower than the one at twice its lag
+  if (static_cast<int64_t>(CompareShift(t1)) * (dataIndex - t0) * 4 < static_cast<int64_t>(CompareShift(t0)) * (dataIndex - t1)) {
+    t0 = t1;
+    t1 = Minimum(t0 * 2 - 5, t0 * 2 + 5);
+    if (t1 < 0)
+      return 0;
+  }
+
+  auto t2 = Minimum((t1 * 3) / 2 - 3, (t1 * 3) / 2 + 3);
   if (t2 < 0)
     return 0;
 
-  float t3 = static_cast<int>(t2 * 4) / 3;
-  t3 = Trough(data.data(), dataIndex, t3 - 4, t3 + 4);
+  auto t3 = Minimum((t2 * 4) / 3 - 3, (t2 * 4) / 3 + 3);
+
+  // Rounded to the nearest bpm
   if (t3 < 0)
-    return static_cast<int>(60 * 24 * 3) / static_cast<int>(t2);
+    return (samplesPerMinute * 3 + t2 / 2) / t2;
 
-  return static_cast<int>(60 * 24 * 4) / static_cast<int>(t3);
+  return (samplesPerMinute * 4 + t3 / 2) / t3;
 }
 
-void Ppg::SetOffset(uint16_t offset) {
-  this->offset = offset;
-  dataIndex = 0;
+void Ppg::SetOffset(uint32_t offset) {
+  this->offset = static_cast<int32_t>(offset);
+  Reset();
 }
 
 void Ppg::Reset() {
@@ -11,21 +11,31 @@ namespace Pinetime {
     class Ppg {
     public:
       Ppg();
-      int8_t Preprocess(float spl);
-      float HeartRate();
+      int8_t Preprocess(uint32_t spl);
+      // Returns 0 until the window is full, then an estimation of the heart rate on the window, which starts over
+      int HeartRate();
 
-      void SetOffset(uint16_t i);
+      void SetOffset(uint32_t offset);
       void Reset();
 
     private:
-      std::array<int8_t, 200> data;
+      static constexpr size_t windowSize = 200;
+      // HeartRateTask reads a sample every 40 ticks of the 1024 Hz FreeRTOS tick (25.6 Hz)
+      static constexpr int samplesPerMinute = 60 * 1024 / 40;
+      // Number of fractional bits of the samples given to the filters
+      static constexpr int fractionalBits = 4;
+
+      std::array<int8_t, windowSize> data;
       size_t dataIndex = 0;
-      float offset;
+      int32_t offset = 0;
       Biquad hpf;
       Ptagc agc;
       Biquad lpf;
 
-      float ProcessHeartRate();
+      int CompareShift(size_t shift) const;
+      int Trough(size_t mn, size_t mx) const;
+      int Minimum(size_t mn, size_t mx) const;
+      int ProcessHeartRate() const;
     };
   }
 }
@@ -5,23 +5,33 @@
 */
 
 #include "components/heartrate/Ptagc.h"
+#include <algorithm>
 #include <cmath>
+#include <cstdlib>
+#include <limits>
 
 using namespace Pinetime::Controllers;
 
 /** Original implementation from wasp-os : https://github.com/daniel-thompson/wasp-os/blob/master/wasp/ppg.py */
-Ptagc::Ptagc(float start, float decay, float threshold) : peak {start}, decay {decay}, boost {1.0f / decay}, threshold {threshold} {
+Ptagc::Ptagc(int32_t start, float decay, int32_t threshold)
+  : peak {start << peakFractionalBits},
+    decay {static_cast<uint16_t>(std::lround(decay * (1 << factorBits)))},
+    boost {static_cast<uint32_t>(std::lround((1 << factorBits) / decay))},
+    threshold {threshold} {
 }
 
-float Ptagc::Step(float spl) {
-  if (std::abs(spl) > peak)
-    peak *= boost;
+int32_t Ptagc::Step(int32_t spl) {
+  const int64_t magnitude = static_cast<int64_t>(std::abs(spl)) << peakFractionalBits;
+  if (magnitude > peak)
+    peak = static_cast<int32_t>(std::min((static_cast<int64_t>(peak) * boost) >> factorBits,
+                                         static_cast<int64_t>(std::numeric_limits<int32_t>::max())));
   else
-    peak *= decay;
+    // The peak must not decay to 0: the boost could not make it grow anymore
+    peak = std::max(static_cast<int32_t>((static_cast<int64_t>(peak) * decay) >> factorBits), 1 << peakFractionalBits);
 
-  if ((spl > (peak * threshold)) || (spl < (peak * -threshold)))
-    return 0.0f;
+  if (magnitude > static_cast<int64_t>(peak) * threshold)
+    return 0;
 
-  spl = 100.0f * spl / (2.0f * peak);
-  return spl;
+  // 100 * spl / (2 * peak)
+  return static_cast<int32_t>((static_cast<int64_t>(spl) * (50 << (outputFractionalBits + peakFractionalBits))) / peak);
 }
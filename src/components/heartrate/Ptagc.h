@@ -1,17 +1,28 @@
 #pragma once
 
+#include <cstdint>
+
 namespace Pinetime {
   namespace Controllers {
+    /// Peak tracking automatic gain control, in fixed point
     class Ptagc {
     public:
-      Ptagc(float start, float decay, float threshold);
-      float Step(float spl);
+      // start is in the unit of the input samples
+      Ptagc(int32_t start, float decay, int32_t threshold);
+      // Returns the sample scaled to [-100 * threshold / 2, 100 * threshold / 2], with outputFractionalBits fractional bits
+      int32_t Step(int32_t spl);
+
+      static constexpr int outputFractionalBits = 8;
 
     private:
-      float peak;
-      float decay;
-      float boost;
-      float threshold;
+      // The peak is tracked with more precision than the input samples
+      static constexpr int peakFractionalBits = 8;
+      static constexpr int factorBits = 15;
+
+      int32_t peak;
+      uint16_t decay; // Q15
+      uint32_t boost; // Q15, > 1
+      int32_t threshold;
     };
   }
 }
@@ -1,7 +1,13 @@
 #include "components/motion/MotionController.h"
 #include "os/os_cputime.h"
+#include <algorithm>
 using namespace Pinetime::Controllers;
 
+namespace {
+  // Ticks between two samples of the FIFO (100Hz)
+  constexpr int32_t samplePeriod = configTICK_RATE_HZ / 100;
+}
+
 void MotionController::Update(int16_t x, int16_t y, int16_t z, uint32_t nbSteps) {
   if (this->nbSteps != nbSteps && service != nullptr) {
     service->OnNewStepCountValue(nbSteps);
@@ -21,7 +27,33 @@ void MotionController::Update(int16_t x, int16_t y, int16_t z, uint32_t nbSteps)
   }
 }
 
+void MotionController::AddSamples(const Pinetime::Drivers::Bma421::Sample* samples, uint8_t nbSamples) {
+  for (uint8_t i = 0; i < nbSamples; i++) {
+    sampleBuffer[sampleBufferHead] = samples[i];
+    sampleBufferHead = (sampleBufferHead + 1) % sampleBufferSize;
+  }
+  nbNewRaiseSamples = std::min<uint8_t>(nbNewRaiseSamples + nbSamples, sampleBufferSize);
+  nbNewShakeSamples = std::min<uint8_t>(nbNewShakeSamples + nbSamples, sampleBufferSize);
+}
+
 bool MotionController::Should_RaiseWake(bool isSleeping) {
+  if (nbNewRaiseSamples == 0) {
+    return IsRaiseWakeSample(x, y, z, isSleeping);
+  }
+
+  // Check all the samples received since the last call so that quick wrist movements are not missed
+  bool wake = false;
+  for (uint8_t i = nbNewRaiseSamples; i > 0; i--) {
+    const auto& sample = sampleBuffer[(sampleBufferHead + sampleBufferSize - i) % sampleBufferSize];
+    if (IsRaiseWakeSample(sample.x, sample.y, sample.z, isSleeping)) {
+      wake = true;
+    }
+  }
+  nbNewRaiseSamples = 0;
+  return wake;
+}
+
+bool MotionController::IsRaiseWakeSample(int16_t x, int16_t y, int16_t z, bool isSleeping) {
   if ((x + 335) <= 670 && z < 0) {
     if (not isSleeping) {
       if (y <= 0) {
@@ -45,23 +77,42 @@ bool MotionController::Should_RaiseWake(bool isSleeping) {
 }
 
 bool MotionController::Should_ShakeWake(uint16_t thresh) {
-  bool wake = false;
-  auto diff = xTaskGetTickCount() - lastShakeTime;
-  lastShakeTime = xTaskGetTickCount();
-  /* Currently Polling at 10hz, If this ever goes faster scalar and EMA might need adjusting */
-  int32_t speed = std::abs(z + (y / 2) + (x / 4) - lastYForShake - lastZForShake) / diff * 100;
-  //(.2 * speed) + ((1 - .2) * accumulatedspeed);
-  // implemented without floats as .25Alpha
-  accumulatedspeed = (speed / 5) + ((accumulatedspeed / 5) * 4);
+  if (nbNewShakeSamples == 0) {
+    auto diff = xTaskGetTickCount() - lastShakeTime;
+    lastShakeTime = xTaskGetTickCount();
+    /* Currently Polling at 10hz, If this ever goes faster scalar and EMA might need adjusting */
+    int32_t speed = ShakeDelta(x, y, z) / diff * 100;
+    //(.2 * speed) + ((1 - .2) * accumulatedspeed);
+    // implemented without floats as .25Alpha
+    accumulatedspeed = (speed / 5) + ((accumulatedspeed / 5) * 4);
+    return accumulatedspeed > thresh;
+  }
 
-  if (accumulatedspeed > thresh) {
-    wake = true;
+  // Check all the samples received since the last call so that short shakes are not missed.
+  // At 100Hz, an alpha of 1/45 makes the average decay as fast per 100ms as the alpha of .2 at 10hz,
+  // so that the thresholds keep their meaning.
+  lastShakeTime = xTaskGetTickCount();
+  bool wake = false;
+  for (uint8_t i = nbNewShakeSamples; i > 0; i--) {
+    const auto& sample = sampleBuffer[(sampleBufferHead + sampleBufferSize - i) % sampleBufferSize];
+    int32_t speed = ShakeDelta(sample.x, sample.y, sample.z) * 100 / samplePeriod;
+    accumulatedspeed += (speed - accumulatedspeed) / 45;
+    if (accumulatedspeed > thresh) {
+      wake = true;
+    }
   }
+  nbNewShakeSamples = 0;
+  return wake;
+}
+
+int32_t MotionController::ShakeDelta(int16_t x, int16_t y, int16_t z) {
+  int32_t delta = std::abs(z + (y / 2) + (x / 4) - lastYForShake - lastZForShake);
   lastXForShake = x / 4;
   lastYForShake = y / 2;
   lastZForShake = z;
-  return wake;
+  return delta;
 }
+
 int32_t MotionController::currentShakeSpeed() {
   return accumulatedspeed;
 }
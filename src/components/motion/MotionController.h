@@ -1,5 +1,6 @@
 #pragma once
 
+#include <array>
 #include <cstdint>
 #include <drivers/Bma421.h>
 #include <components/ble/MotionService.h>
@@ -15,6 +16,7 @@ namespace Pinetime {
       };
 
       void Update(int16_t x, int16_t y, int16_t z, uint32_t nbSteps);
+      void AddSamples(const Pinetime::Drivers::Bma421::Sample* samples, uint8_t nbSamples);
 
       int16_t X() const {
         return x;
@@ -52,6 +54,9 @@ namespace Pinetime {
       void SetService(Pinetime::Controllers::MotionService* service);
 
     private:
+      bool IsRaiseWakeSample(int16_t x, int16_t y, int16_t z, bool isSleeping);
+      int32_t ShakeDelta(int16_t x, int16_t y, int16_t z);
+
       uint32_t nbSteps;
       uint32_t currentTripSteps = 0;
       int16_t x;
@@ -67,6 +72,14 @@ namespace Pinetime {
       int16_t lastZForShake = 0;
       int32_t accumulatedspeed = 0;
       uint32_t lastShakeTime = 0;
+
+      // Full rate samples from the motion sensor FIFO
+      static constexpr uint8_t sampleBufferSize = 32;
+      std::array<Pinetime::Drivers::Bma421::Sample, sampleBufferSize> sampleBuffer;
+      uint8_t sampleBufferHead = 0;
+      // Each detector processes the samples received since its previous call
+      uint8_t nbNewRaiseSamples = 0;
+      uint8_t nbNewShakeSamples = 0;
     };
   }
 }
\ No newline at end of file
@@ -1,13 +1,50 @@
 #include "components/settings/Settings.h"
+#include <cstddef>
 #include <cstdlib>
 #include <cstring>
+#include <nrf_log.h>
+#include "systemtask/SystemTask.h"
 
 using namespace Pinetime::Controllers;
 
+namespace {
+  constexpr const char* logFileName = "/settings.log";
+  constexpr const char* compactedLogFileName = "/settings.tmp";
+  constexpr const char* legacyFileName = "/settings.dat";
+
+  void SaveTimerCallback(TimerHandle_t xTimer) {
+    auto* settings = static_cast<Settings*>(pvTimerGetTimerID(xTimer));
+    settings->OnSaveTimer();
+  }
+}
+
+const Settings::Field Settings::fields[] = {
+  {Ids::StepsGoal, offsetof(SettingsData, stepsGoal), sizeof(SettingsData::stepsGoal)},
+  {Ids::ScreenTimeOut, offsetof(SettingsData, screenTimeOut), sizeof(SettingsData::screenTimeOut)},
+  {Ids::ClockType, offsetof(SettingsData, clockType), sizeof(SettingsData::clockType)},
+  {Ids::NotificationStatus, offsetof(SettingsData, notificationStatus), sizeof(SettingsData::notificationStatus)},
+  {Ids::ClockFace, offsetof(SettingsData, clockFace), sizeof(SettingsData::clockFace)},
+  {Ids::ChimesOption, offsetof(SettingsData, chimesOption), sizeof(SettingsData::chimesOption)},
+  {Ids::PTSColorTime, offsetof(SettingsData, PTS.ColorTime), sizeof(PineTimeStyle::ColorTime)},
+  {Ids::PTSColorBar, offsetof(SettingsData, PTS.ColorBar), sizeof(PineTimeStyle::ColorBar)},
+  {Ids::PTSColorBG, offsetof(SettingsData, PTS.ColorBG), sizeof(PineTimeStyle::ColorBG)},
+  {Ids::PTSGaugeStyle, offsetof(SettingsData, PTS.gaugeStyle), sizeof(PineTimeStyle::gaugeStyle)},
+  {Ids::InfineatShowSideCover, offsetof(SettingsData, watchFaceInfineat.showSideCover), sizeof(WatchFaceInfineat::showSideCover)},
+  {Ids::InfineatColorIndex, offsetof(SettingsData, watchFaceInfineat.colorIndex), sizeof(WatchFaceInfineat::colorIndex)},
+  {Ids::WakeUpMode, offsetof(SettingsData, wakeUpMode), sizeof(SettingsData::wakeUpMode)},
+  {Ids::ShakeWakeThreshold, offsetof(SettingsData, shakeWakeThreshold), sizeof(SettingsData::shakeWakeThreshold)},
+  {Ids::BrightLevel, offsetof(SettingsData, brightLevel), sizeof(SettingsData::brightLevel)},
+  {Ids::HeartRateBackgroundInterval,
+   offsetof(SettingsData, heartRateBackgroundInterval),
+   sizeof(SettingsData::heartRateBackgroundInterval)},
+};
+
 Settings::Settings(Pinetime::Controllers::FS& fs) : fs {fs} {
 }
 
-void Settings::Init() {
+void Settings::Init(Pinetime::System::SystemTask* systemTask) {
+  this->systemTask = systemTask;
+  saveTimer = xTimerCreate("Settings", saveDelay, pdFALSE, this, SaveTimerCallback);
 
   // Load default settings from Flash
   LoadSettingsFromFile();
@@ -17,31 +54,213 @@ void Settings::SaveSettings() {
 
   // verify if is necessary to save
   if (settingsChanged) {
-    SaveSettingsToFile();
+    commitPending = true;
+    // Postpone the write while the settings keep changing
+    xTimerReset(saveTimer, 0);
   }
   settingsChanged = false;
 }
 
+void Settings::OnSaveTimer() {
+  systemTask->PushMessage(Pinetime::System::Messages::SaveSettings);
+}
+
+void Settings::CommitSettings() {
+  // The settings are modified by DisplayApp while SystemTask writes them: write a consistent copy
+  SettingsData snapshot;
+  taskENTER_CRITICAL();
+  const bool pending = commitPending;
+  commitPending = false;
+  snapshot = settings;
+  taskEXIT_CRITICAL();
+  if (!pending) {
+    return;
+  }
+  xTimerStop(saveTimer, 0);
+
+  size_t size = 0;
+  for (const auto& field : fields) {
+    if (FieldChanged(snapshot, field)) {
+      size += field.size + recordOverhead;
+    }
+  }
+  if (size == 0) {
+    return;
+  }
+
+  bool written = false;
+  lfs_file_t logFile;
+  int res = LFS_ERR_NOENT;
+  if (logSize + size <= maxLogSize) {
+    // The log is only created by CompactLog(), which starts it with the version record
+    res = fs.FileOpen(&logFile, logFileName, LFS_O_WRONLY | LFS_O_APPEND);
+  }
+  if (res == LFS_ERR_NOENT) {
+    written = CompactLog(snapshot);
+  } else if (res == LFS_ERR_OK) {
+    written = true;
+    // Only the fields that changed since the last commit are appended
+    for (const auto& field : fields) {
+      if (FieldChanged(snapshot, field)) {
+        if (WriteRecord(logFile, field.id, reinterpret_cast<const uint8_t*>(&snapshot) + field.offset, field.size)) {
+          logSize += field.size + recordOverhead;
+        } else {
+          written = false;
+        }
+      }
+    }
+    fs.FileClose(&logFile);
+    if (written) {
+      savedSettings = snapshot;
+    }
+  }
+  if (!written) {
+    // Keep the commit pending so that it is retried at the next save or before going to sleep
+    commitPending = true;
+    return;
+  }
+
+  saveStatistics.commits++;
+  NRF_LOG_INFO("[Settings] Commit : %d bytes, log size = %d bytes, %d bytes written in %d records, %d commits, %d compactions",
+               size,
+               logSize,
+               saveStatistics.bytesWritten,
+               saveStatistics.records,
+               saveStatistics.commits,
+               saveStatistics.compactions);
+}
+
 void Settings::LoadSettingsFromFile() {
+  lfs_file_t logFile;
+
+  if (fs.FileOpen(&logFile, logFileName, LFS_O_RDONLY) != LFS_ERR_OK) {
+    // First boot with the log: import the settings of the previous firmware, if any
+    if (LoadLegacySettings()) {
+      CompactLog(settings);
+      fs.FileDelete(legacyFileName);
+    }
+    savedSettings = settings;
+    return;
+  }
+
+  uint32_t version = 0;
+  uint8_t record[recordOverhead + maxFieldSize];
+  bool corrupted = false;
+  logSize = 0;
+  while (fs.FileRead(&logFile, record, 2) == 2) {
+    const uint8_t size = record[1];
+    if (size > maxFieldSize || fs.FileRead(&logFile, record + 2, size + 1) != size + 1 || Checksum(record, size + 2) != record[size + 2]) {
+      corrupted = true;
+      break;
+    }
+    logSize += size + recordOverhead;
+
+    const auto id = static_cast<Ids>(record[0]);
+    if (id == Ids::Version && size == sizeof(version)) {
+      std::memcpy(&version, record + 2, sizeof(version));
+    } else {
+      ApplyRecord(id, record + 2, size);
+    }
+  }
+  fs.FileClose(&logFile);
+
+  if (version != settingsVersion) {
+    MigrateSettings(version);
+  }
+  savedSettings = settings;
+
+  // Rewrite the log at the next commit rather than appending after a damaged record
+  if (corrupted || version != settingsVersion) {
+    NRF_LOG_INFO("[Settings] The log will be compacted (corrupted = %d, version = %d)", corrupted, version);
+    logSize = maxLogSize;
+  }
+}
+
+bool Settings::LoadLegacySettings() {
   SettingsData bufferSettings;
   lfs_file_t settingsFile;
 
-  if (fs.FileOpen(&settingsFile, "/settings.dat", LFS_O_RDONLY) != LFS_ERR_OK) {
-    return;
+  if (fs.FileOpen(&settingsFile, legacyFileName, LFS_O_RDONLY) != LFS_ERR_OK) {
+    return false;
   }
   fs.FileRead(&settingsFile, reinterpret_cast<uint8_t*>(&bufferSettings), sizeof(settings));
   fs.FileClose(&settingsFile);
-  if (bufferSettings.version == settingsVersion) {
-    settings = bufferSettings;
+  if (bufferSettings.version != legacySettingsVersion) {
+    return false;
   }
+  settings = bufferSettings;
+  settings.version = settingsVersion;
+  return true;
 }
 
-void Settings::SaveSettingsToFile() {
-  lfs_file_t settingsFile;
+void Settings::ApplyRecord(Ids id, const uint8_t* data, uint8_t size) {
+  for (const auto& field : fields) {
+    if (field.id == id) {
+      // A record whose size does not match anymore needs a migration: keep the default value
+      if (field.size == size) {
+        std::memcpy(reinterpret_cast<uint8_t*>(&settings) + field.offset, data, size);
+      }
+      return;
+    }
+  }
+}
 
-  if (fs.FileOpen(&settingsFile, "/settings.dat", LFS_O_WRONLY | LFS_O_CREAT) != LFS_ERR_OK) {
-    return;
+void Settings::MigrateSettings(uint32_t fromVersion) {
+  // The records of older versions are compatible with this one. Convert the records here when the meaning or the
+  // encoding of an existing id changes.
+  NRF_LOG_INFO("[Settings] Migration from version %d to %d", fromVersion, settingsVersion);
+}
+
+bool Settings::CompactLog(const SettingsData& data) {
+  // Write the new log next to the current one: the rename is atomic, one of them is always complete
+  lfs_file_t logFile;
+  if (fs.FileOpen(&logFile, compactedLogFileName, LFS_O_WRONLY | LFS_O_CREAT | LFS_O_TRUNC) != LFS_ERR_OK) {
+    return false;
   }
-  fs.FileWrite(&settingsFile, reinterpret_cast<uint8_t*>(&settings), sizeof(settings));
-  fs.FileClose(&settingsFile);
+  uint32_t version = settingsVersion;
+  bool written = WriteRecord(logFile, Ids::Version, &version, sizeof(version));
+  size_t size = sizeof(version) + recordOverhead;
+  for (const auto& field : fields) {
+    written = written && WriteRecord(logFile, field.id, reinterpret_cast<const uint8_t*>(&data) + field.offset, field.size);
+    size += field.size + recordOverhead;
+  }
+  fs.FileClose(&logFile);
+  if (!written || fs.Rename(compactedLogFileName, logFileName) != LFS_ERR_OK) {
+    return false;
+  }
+
+  logSize = size;
+  savedSettings = data;
+  saveStatistics.compactions++;
+  return true;
+}
+
+bool Settings::FieldChanged(const SettingsData& data, const Field& field) const {
+  return std::memcmp(reinterpret_cast<const uint8_t*>(&data) + field.offset,
+                     reinterpret_cast<const uint8_t*>(&savedSettings) + field.offset,
+                     field.size) != 0;
+}
+
+bool Settings::WriteRecord(lfs_file_t& file, Ids id, const void* data, uint8_t size) {
+  uint8_t record[recordOverhead + maxFieldSize];
+  record[0] = static_cast<uint8_t>(id);
+  record[1] = size;
+  std::memcpy(record + 2, data, size);
+  record[size + 2] = Checksum(record, size + 2);
+
+  const int recordSize = size + recordOverhead;
+  if (fs.FileWrite(&file, record, recordSize) != recordSize) {
+    return false;
+  }
+  saveStatistics.records++;
+  saveStatistics.bytesWritten += recordSize;
+  return true;
+}
+
+uint8_t Settings::Checksum(const uint8_t* data, size_t size) {
+  uint8_t sum = 0;
+  for (size_t i = 0; i < size; i++) {
+    sum += data[i];
+  }
+  return static_cast<uint8_t>(~sum);
 }
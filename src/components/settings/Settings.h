@@ -1,10 +1,15 @@
 #pragma once
 #include <cstdint>
 #include <bitset>
+#include <FreeRTOS.h>
+#include <timers.h>
 #include "components/brightness/BrightnessController.h"
 #include "components/fs/FS.h"
 
 namespace Pinetime {
+  namespace System {
+    class SystemTask;
+  }
   namespace Controllers {
     class Settings {
     public:
@@ -57,8 +62,23 @@ namespace Pinetime {
       Settings(Settings&&) = delete;
       Settings& operator=(Settings&&) = delete;
 
-      void Init();
+      void Init(System::SystemTask* systemTask);
+      // Schedules the write of the changed settings: they are committed by CommitSettings() when no setting has
+      // changed for saveDelay ms, or before going to sleep
       void SaveSettings();
+      void CommitSettings();
+      void OnSaveTimer();
+
+      struct SaveStatistics {
+        uint32_t commits = 0;
+        uint32_t records = 0;
+        uint32_t bytesWritten = 0;
+        uint32_t compactions = 0;
+      };
+
+      const SaveStatistics& GetSaveStatistics() const {
+        return saveStatistics;
+      }
 
       void SetClockFace(uint8_t face) {
         if (face != settings.clockFace) {
@@ -243,6 +263,18 @@ namespace Pinetime {
         return settings.stepsGoal;
       };
 
+      // Interval between the background heart rate measurements, in minutes (0 = disabled)
+      void SetHeartRateBackgroundInterval(uint16_t minutes) {
+        if (minutes != settings.heartRateBackgroundInterval) {
+          settingsChanged = true;
+        }
+        settings.heartRateBackgroundInterval = minutes;
+      };
+
+      uint16_t GetHeartRateBackgroundInterval() const {
+        return settings.heartRateBackgroundInterval;
+      };
+
       void SetBleRadioEnabled(bool enabled) {
         bleRadioEnabled = enabled;
       };
@@ -253,8 +285,49 @@ namespace Pinetime {
 
     private:
       Pinetime::Controllers::FS& fs;
+      System::SystemTask* systemTask = nullptr;
+
+      /*
+       * The settings are saved in /settings.log, as a log of records: each record holds the new value of one field
+       * of SettingsData (id, size, value, checksum). Only the fields that changed are appended to the log, and the
+       * log is compacted (rewritten with one record per field) when it grows above maxLogSize. Loading the settings
+       * replays the log over the default values: the fields that are unknown or whose size changed are ignored,
+       * so that adding a setting does not reset all the others.
+       * Never reuse or renumber the ids.
+       */
+      static constexpr uint32_t settingsVersion = 0x0005;
+      // Version of the SettingsData struct stored as is in /settings.dat by the previous firmwares
+      static constexpr uint32_t legacySettingsVersion = 0x0004;
+      enum class Ids : uint8_t {
+        Version = 0,
+        StepsGoal = 1,
+        ScreenTimeOut = 2,
+        ClockType = 3,
+        NotificationStatus = 4,
+        ClockFace = 5,
+        ChimesOption = 6,
+        PTSColorTime = 7,
+        PTSColorBar = 8,
+        PTSColorBG = 9,
+        PTSGaugeStyle = 10,
+        InfineatShowSideCover = 11,
+        InfineatColorIndex = 12,
+        WakeUpMode = 13,
+        ShakeWakeThreshold = 14,
+        BrightLevel = 15,
+        HeartRateBackgroundInterval = 16,
+      };
+      struct Field {
+        Ids id;
+        uint8_t offset;
+        uint8_t size;
+      };
+      static const Field fields[];
+      static constexpr uint8_t maxFieldSize = 8;
+      static constexpr size_t recordOverhead = 3;
+      static constexpr size_t maxLogSize = 256;
+      static constexpr TickType_t saveDelay = pdMS_TO_TICKS(2000);
 
-      static constexpr uint32_t settingsVersion = 0x0004;
       struct SettingsData {
         uint32_t version = settingsVersion;
         uint32_t stepsGoal = 10000;
@@ -273,10 +346,18 @@ namespace Pinetime {
         std::bitset<4> wakeUpMode {0};
         uint16_t shakeWakeThreshold = 150;
         Controllers::BrightnessController::Levels brightLevel = Controllers::BrightnessController::Levels::Medium;
+
+        uint16_t heartRateBackgroundInterval = 0;
       };
 
       SettingsData settings;
+      // Settings as they are in the log
+      SettingsData savedSettings;
       bool settingsChanged = false;
+      bool commitPending = false;
+      size_t logSize = 0;
+      TimerHandle_t saveTimer;
+      SaveStatistics saveStatistics;
 
       uint8_t appMenu = 0;
       uint8_t settingsMenu = 0;
@@ -287,7 +368,13 @@ namespace Pinetime {
       bool bleRadioEnabled = true;
 
       void LoadSettingsFromFile();
-      void SaveSettingsToFile();
+      bool LoadLegacySettings();
+      void ApplyRecord(Ids id, const uint8_t* data, uint8_t size);
+      void MigrateSettings(uint32_t fromVersion);
+      bool CompactLog(const SettingsData& data);
+      bool FieldChanged(const SettingsData& data, const Field& field) const;
+      bool WriteRecord(lfs_file_t& file, Ids id, const void* data, uint8_t size);
+      static uint8_t Checksum(const uint8_t* data, size_t size);
     };
   }
 }
@@ -1,5 +1,6 @@
 #include "displayapp/DisplayApp.h"
 #include <libraries/log/nrf_log.h>
+#include <nrf.h>
 #include "displayapp/screens/HeartRate.h"
 #include "displayapp/screens/Motion.h"
 #include "displayapp/screens/Timer.h"
@@ -46,6 +47,7 @@
 #include "displayapp/screens/settings/SettingSetDate.h"
 #include "displayapp/screens/settings/SettingSetTime.h"
 #include "displayapp/screens/settings/SettingChimes.h"
+#include "displayapp/screens/settings/SettingHeartRate.h"
 #include "displayapp/screens/settings/SettingShakeThreshold.h"
 #include "displayapp/screens/settings/SettingBluetooth.h"
 
@@ -99,6 +101,10 @@ DisplayApp::DisplayApp(Drivers::St7789& lcd,
 void DisplayApp::Start(System::BootErrors error) {
   msgQueue = xQueueCreate(queueSize, itemSize);
 
+  // The cycle counter times the render statistics. It only runs by default when a debugger is attached.
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+  DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
   bootError = error;
 
   if (error == System::BootErrors::TouchController) {
@@ -117,9 +123,6 @@ void DisplayApp::Process(void* instance) {
   NRF_LOG_INFO("displayapp task started!");
   app->InitHw();
 
-  // Send a dummy notification to unlock the lvgl display driver for the first iteration
-  xTaskNotifyGive(xTaskGetCurrentTaskHandle());
-
   while (true) {
     app->Refresh();
   }
@@ -144,7 +147,17 @@ void DisplayApp::Refresh() {
       if (!currentScreen->IsRunning()) {
         LoadPreviousScreen();
       }
-      queueTimeout = lv_task_handler();
+      {
+        const uint32_t handlerStart = DWT->CYCCNT;
+        queueTimeout = lv_task_handler();
+        renderStatistics.handlerTime += (DWT->CYCCNT - handlerStart) / cyclesPerMicrosecond;
+        renderStatistics.handlerCalls++;
+      }
+#ifdef RENDER_STATISTICS_TOUR
+      if (xTaskGetTickCount() - tourAppStart >= tourAppDuration) {
+        NextTourApp();
+      }
+#endif
       break;
     default:
       queueTimeout = portMAX_DELAY;
@@ -169,6 +182,7 @@ void DisplayApp::Refresh() {
         state = States::Idle;
         break;
       case Messages::GoToRunning:
+        RefreshWatchFace();
         ApplyBrightness();
         state = States::Running;
         break;
@@ -176,8 +190,8 @@ void DisplayApp::Refresh() {
         PushMessageToSystemTask(System::Messages::UpdateTimeOut);
         break;
       case Messages::UpdateBleConnection:
-        //        clockScreen.SetBleConnectionState(bleController.IsConnected() ? Screens::Clock::BleConnectionStates::Connected :
-        //        Screens::Clock::BleConnectionStates::NotConnected);
+      case Messages::UpdateBatteryLevel:
+        RefreshWatchFace();
         break;
       case Messages::NewNotification:
         LoadApp(Apps::NotificationsPreview, DisplayApp::FullRefreshDirections::Down);
@@ -271,8 +285,7 @@ void DisplayApp::Refresh() {
         PushMessageToSystemTask(System::Messages::BleRadioEnableToggle);
         break;
       case Messages::UpdateDateTime:
-        // Added to remove warning
-        // What should happen here?
+        RefreshWatchFace();
         break;
       case Messages::Clock:
         LoadApp(Apps::Clock, DisplayApp::FullRefreshDirections::None);
@@ -305,12 +318,21 @@ void DisplayApp::LoadApp(Apps app, DisplayApp::FullRefreshDirections direction)
   touchHandler.CancelTap();
   ApplyBrightness();
 
+  // The previous app is reported once its screen is destroyed, with the time of the destruction
+  lv_mem_monitor_t memory;
+  lv_mem_monitor(&memory);
+  renderStatistics.memoryUsedAtEnd = memory.total_size - memory.free_size;
+  const uint32_t teardownStart = DWT->CYCCNT;
   currentScreen.reset(nullptr);
+  renderStatistics.teardownTime = (DWT->CYCCNT - teardownStart) / cyclesPerMicrosecond;
+  ReportRenderStatistics();
+
   SetFullRefresh(direction);
 
   // default return to launcher
   ReturnApp(Apps::Launcher, FullRefreshDirections::Down, TouchEvents::SwipeDown);
 
+  const uint32_t constructionStart = DWT->CYCCNT;
   switch (app) {
     case Apps::Launcher:
       currentScreen =
@@ -421,6 +443,10 @@ void DisplayApp::LoadApp(Apps app, DisplayApp::FullRefreshDirections direction)
       currentScreen = std::make_unique<Screens::SettingChimes>(this, settingsController);
       ReturnApp(Apps::Settings, FullRefreshDirections::Down, TouchEvents::SwipeDown);
       break;
+    case Apps::SettingHeartRate:
+      currentScreen = std::make_unique<Screens::SettingHeartRate>(this, settingsController);
+      ReturnApp(Apps::Settings, FullRefreshDirections::Down, TouchEvents::SwipeDown);
+      break;
     case Apps::SettingShakeThreshold:
       currentScreen = std::make_unique<Screens::SettingShakeThreshold>(this, settingsController, motionController, *systemTask);
       ReturnApp(Apps::Settings, FullRefreshDirections::Down, TouchEvents::SwipeDown);
@@ -441,7 +467,8 @@ void DisplayApp::LoadApp(Apps app, DisplayApp::FullRefreshDirections direction)
                                                             bleController,
                                                             watchdog,
                                                             motionController,
-                                                            touchPanel);
+                                                            touchPanel,
+                                                            lvgl);
       ReturnApp(Apps::Settings, FullRefreshDirections::Down, TouchEvents::SwipeDown);
       break;
     case Apps::FlashLight:
@@ -480,9 +507,58 @@ void DisplayApp::LoadApp(Apps app, DisplayApp::FullRefreshDirections direction)
       currentScreen = std::make_unique<Screens::Steps>(this, motionController, settingsController);
       break;
   }
+  const uint32_t constructionEnd = DWT->CYCCNT;
   currentApp = app;
+
+  lv_mem_monitor(&memory);
+  const auto& flushStatistics = lvgl.GetFlushStatistics();
+  renderStatistics = {};
+  renderStatistics.constructionTime = (constructionEnd - constructionStart) / cyclesPerMicrosecond;
+  renderStatistics.startFrames = flushStatistics.frames;
+  renderStatistics.startBytes = flushStatistics.totalBytes;
+  renderStatistics.memoryUsed = memory.total_size - memory.free_size;
 }
 
+void DisplayApp::ReportRenderStatistics() {
+  if (currentApp == Apps::None) {
+    return;
+  }
+  // One "key=value" line per app so that the RTT log can be parsed by a script.
+  // Times are in µs: construct and teardown are the construction and the destruction of the screen, handler is the sum
+  // of all lv_task_handler() calls.
+  // mem and endmem are the LVGL memory used after the construction of the app and when it is left. LVGL cannot reset
+  // its peak: bootmaxmem is the peak since boot, for all the apps.
+  lv_mem_monitor_t memory;
+  lv_mem_monitor(&memory);
+  const auto& flushStatistics = lvgl.GetFlushStatistics();
+  NRF_LOG_INFO("[Render] app=%d construct=%lu teardown=%lu mem=%lu endmem=%lu bootmaxmem=%lu",
+               static_cast<int>(currentApp),
+               renderStatistics.constructionTime,
+               renderStatistics.teardownTime,
+               renderStatistics.memoryUsed,
+               renderStatistics.memoryUsedAtEnd,
+               memory.max_used);
+  NRF_LOG_INFO("[Render] app=%d handler=%lu calls=%lu frames=%lu bytes=%lu",
+               static_cast<int>(currentApp),
+               renderStatistics.handlerTime,
+               renderStatistics.handlerCalls,
+               flushStatistics.frames - renderStatistics.startFrames,
+               flushStatistics.totalBytes - renderStatistics.startBytes);
+}
+
+#ifdef RENDER_STATISTICS_TOUR
+void DisplayApp::NextTourApp() {
+  // The apps that close themselves return to another app: the tour keeps its own position. Weather has no screen.
+  do {
+    tourApp = (tourApp == Apps::Error) ? Apps::Launcher : static_cast<Apps>(static_cast<int>(tourApp) + 1);
+  } while (tourApp == Apps::Weather);
+  LoadApp(tourApp, DisplayApp::FullRefreshDirections::None);
+  tourAppStart = xTaskGetTickCount();
+  // Keeps the screen on for the next app
+  PushMessageToSystemTask(System::Messages::UpdateTimeOut);
+}
+#endif
+
 void DisplayApp::PushMessage(Messages msg) {
   if (in_isr()) {
     BaseType_t xHigherPriorityTaskWoken;
@@ -496,6 +572,12 @@ void DisplayApp::PushMessage(Messages msg) {
   }
 }
 
+void DisplayApp::RefreshWatchFace() {
+  if (currentApp == Apps::Clock) {
+    currentScreen->RefreshNow();
+  }
+}
+
 void DisplayApp::SetFullRefresh(DisplayApp::FullRefreshDirections direction) {
   switch (direction) {
     case DisplayApp::FullRefreshDirections::Down:
@@ -106,6 +106,31 @@ namespace Pinetime {
       std::unique_ptr<Screens::Screen> currentScreen;
 
       Apps currentApp = Apps::None;
+
+      // Render cost of the current app, reported in the log when the next app is loaded. The times are measured in µs
+      // with the cycle counter of the CPU (DWT->CYCCNT).
+      struct RenderStatistics {
+        uint32_t constructionTime = 0;
+        uint32_t teardownTime = 0;
+        uint32_t handlerTime = 0;
+        uint32_t handlerCalls = 0;
+        uint32_t startFrames = 0;
+        uint32_t startBytes = 0;
+        uint32_t memoryUsed = 0;
+        uint32_t memoryUsedAtEnd = 0;
+      };
+      static constexpr uint32_t cyclesPerMicrosecond = 64;
+      RenderStatistics renderStatistics;
+      void ReportRenderStatistics();
+
+#ifdef RENDER_STATISTICS_TOUR
+      // Loads each app of Apps.h in turn, so that the render statistics of all the apps are reported
+      static constexpr TickType_t tourAppDuration = pdMS_TO_TICKS(5000);
+      Apps tourApp = Apps::None;
+      TickType_t tourAppStart = 0;
+      void NextTourApp();
+#endif
+
       Apps returnToApp = Apps::None;
       FullRefreshDirections returnDirection = FullRefreshDirections::None;
       TouchEvents returnTouchEvent = TouchEvents::None;
@@ -117,6 +142,7 @@ namespace Pinetime {
       void ReturnApp(Apps app, DisplayApp::FullRefreshDirections direction, TouchEvents touchEvent);
       void LoadApp(Apps app, DisplayApp::FullRefreshDirections direction);
       void PushMessageToSystemTask(Pinetime::System::Messages message);
+      void RefreshWatchFace();
 
       Apps nextApp = Apps::None;
       DisplayApp::FullRefreshDirections nextDirection;
@@ -16,6 +16,16 @@ static void disp_flush(lv_disp_drv_t* disp_drv, const lv_area_t* area, lv_color_
   lvgl->FlushDisplay(area, color_p);
 }
 
+static void disp_wait(lv_disp_drv_t* disp_drv) {
+  auto* lvgl = static_cast<LittleVgl*>(disp_drv->user_data);
+  lvgl->WaitFlush();
+}
+
+static void monitor(lv_disp_drv_t* disp_drv, uint32_t time, uint32_t /*px*/) {
+  auto* lvgl = static_cast<LittleVgl*>(disp_drv->user_data);
+  lvgl->OnFrameRefreshed(time);
+}
+
 static void rounder(lv_disp_drv_t* disp_drv, lv_area_t* area) {
   auto* lvgl = static_cast<LittleVgl*>(disp_drv->user_data);
   if (lvgl->GetFullRefresh()) {
@@ -57,6 +67,8 @@ void LittleVgl::InitDisplay() {
   disp_drv.buffer = &disp_buf_2;
   disp_drv.user_data = this;
   disp_drv.rounder_cb = rounder;
+  disp_drv.wait_cb = disp_wait;
+  disp_drv.monitor_cb = monitor;
 
   /*Finally register the driver*/
   lv_disp_drv_register(&disp_drv);
@@ -90,12 +102,19 @@ void LittleVgl::SetFullRefresh(FullRefreshDirections direction) {
   fullRefresh = true;
 }
 
+void LittleVgl::WaitFlush() {
+  // LVGL calls this in a loop until the buffer currently being sent is released by lv_disp_flush_ready().
+  // The SPI driver notifies the display task at the end of each transfer, so block instead of spinning.
+  ulTaskNotifyTake(pdTRUE, 200);
+}
+
 void LittleVgl::FlushDisplay(const lv_area_t* area, lv_color_t* color_p) {
   uint16_t y1, y2, width, height = 0;
 
-  ulTaskNotifyTake(pdTRUE, 200);
-  // Notification is still needed (even if there is a mutex on SPI) because of the DataCommand pin
-  // which cannot be set/clear during a transfer.
+  // Both buffers (buf2_1 and buf2_2) are used alternately: this function only starts the transfer of the
+  // current buffer and returns, so that LVGL can render the next area into the other buffer while the
+  // previous one is being sent. lv_disp_flush_ready() is called by the SPI driver when the transfer is done.
+  // LVGL does not call this function again before that, so no transfer is running at this point.
 
   if ((scrollDirection == LittleVgl::FullRefreshDirections::Down) && (area->y2 == visibleNbLines - 1)) {
     writeOffset = ((writeOffset + totalNbLines) - visibleNbLines) % totalNbLines;
@@ -109,6 +128,16 @@ void LittleVgl::FlushDisplay(const lv_area_t* area, lv_color_t* color_p) {
   width = (area->x2 - area->x1) + 1;
   height = (area->y2 - area->y1) + 1;
 
+  if (frameAreas == 0) {
+    frameStartAddressWindows = lcd.AddressWindowCount();
+  }
+  frameAreas++;
+  frameBytes += width * height * 2;
+
+  auto onFlushComplete = [this]() {
+    OnFlushComplete();
+  };
+
   if (scrollDirection == LittleVgl::FullRefreshDirections::Down) {
 
     if (area->y2 < visibleNbLines - 1) {
@@ -144,6 +173,9 @@ void LittleVgl::FlushDisplay(const lv_area_t* area, lv_color_t* color_p) {
       lcd.VerticalScrollStartAddress(scrollOffset);
     }
   } else if (scrollDirection == FullRefreshDirections::Left or scrollDirection == FullRefreshDirections::LeftAnim) {
+    // Horizontal transitions cannot use the scrolling trick above: the ST7789 only scrolls along the gate lines
+    // (VSCSAD), and MADCTL only changes how the MCU writes are mapped into the RAM, not how the RAM is scanned
+    // out to the panel. LVGL renders these transitions as full height columns, so each pixel is still sent once.
     if (area->x2 == visibleNbLines - 1) {
       scrollDirection = FullRefreshDirections::None;
       lv_disp_set_direction(lv_disp_get_default(), 0);
@@ -160,22 +192,48 @@ void LittleVgl::FlushDisplay(const lv_area_t* area, lv_color_t* color_p) {
 
     if (height > 0) {
       lcd.DrawBuffer(area->x1, y1, width, height, reinterpret_cast<const uint8_t*>(color_p), width * height * 2);
-      ulTaskNotifyTake(pdTRUE, 100);
     }
 
     uint16_t pixOffset = width * height;
     height = y2 + 1;
-    lcd.DrawBuffer(area->x1, 0, width, height, reinterpret_cast<const uint8_t*>(color_p + pixOffset), width * height * 2);
+    lcd.DrawBuffer(area->x1,
+                   0,
+                   width,
+                   height,
+                   reinterpret_cast<const uint8_t*>(color_p + pixOffset),
+                   width * height * 2,
+                   onFlushComplete);
 
   } else {
-    lcd.DrawBuffer(area->x1, y1, width, height, reinterpret_cast<const uint8_t*>(color_p), width * height * 2);
+    lcd.DrawBuffer(area->x1,
+                   y1,
+                   width,
+                   height,
+                   reinterpret_cast<const uint8_t*>(color_p),
+                   width * height * 2,
+                   onFlushComplete);
   }
+}
 
+void LittleVgl::OnFlushComplete() {
   // IMPORTANT!!!
   // Inform the graphics library that you are ready with the flushing
+  // Called from the SPI interrupt handler: lv_disp_flush_ready() only clears the 'flushing' flags of the buffer.
   lv_disp_flush_ready(&disp_drv);
 }
 
+void LittleVgl::OnFrameRefreshed(uint32_t time) {
+  flushStatistics.frames++;
+  flushStatistics.areas = frameAreas;
+  flushStatistics.addressWindows = lcd.AddressWindowCount() - frameStartAddressWindows;
+  flushStatistics.bytes = frameBytes;
+  flushStatistics.totalBytes += frameBytes;
+  flushStatistics.time = time;
+
+  frameAreas = 0;
+  frameBytes = 0;
+}
+
 void LittleVgl::SetNewTouchPoint(uint16_t x, uint16_t y, bool contact) {
   tap_x = x;
   tap_y = y;
@@ -12,6 +12,17 @@ namespace Pinetime {
     class LittleVgl {
     public:
       enum class FullRefreshDirections { None, Up, Down, Left, Right, LeftAnim, RightAnim };
+
+      struct FlushStatistics {
+        uint32_t frames = 0;
+        uint32_t totalBytes = 0;
+        // The following values are for the last refreshed frame
+        uint16_t areas = 0;
+        uint16_t addressWindows = 0;
+        uint32_t bytes = 0;
+        uint32_t time = 0; // ms, from the start of the rendering to the last flush, as measured by LVGL
+      };
+
       LittleVgl(Pinetime::Drivers::St7789& lcd, Pinetime::Drivers::Cst816S& touchPanel);
 
       LittleVgl(const LittleVgl&) = delete;
@@ -22,10 +33,16 @@ namespace Pinetime {
       void Init();
 
       void FlushDisplay(const lv_area_t* area, lv_color_t* color_p);
+      void WaitFlush();
+      void OnFrameRefreshed(uint32_t time);
       bool GetTouchPadInfo(lv_indev_data_t* ptr);
       void SetFullRefresh(FullRefreshDirections direction);
       void SetNewTouchPoint(uint16_t x, uint16_t y, bool contact);
 
+      const FlushStatistics& GetFlushStatistics() const {
+        return flushStatistics;
+      }
+
       bool GetFullRefresh() {
         bool returnValue = fullRefresh;
         if (fullRefresh) {
@@ -38,6 +55,7 @@ namespace Pinetime {
       void InitDisplay();
       void InitTouchpad();
       void InitTheme();
+      void OnFlushComplete();
 
       Pinetime::Drivers::St7789& lcd;
       Pinetime::Drivers::Cst816S& touchPanel;
@@ -59,6 +77,11 @@ namespace Pinetime {
       uint16_t writeOffset = 0;
       uint16_t scrollOffset = 0;
 
+      FlushStatistics flushStatistics;
+      uint16_t frameAreas = 0;
+      uint32_t frameBytes = 0;
+      uint32_t frameStartAddressWindows = 0;
+
       uint16_t tap_x = 0;
       uint16_t tap_y = 0;
       bool tapped = false;
@@ -22,7 +22,8 @@ namespace Pinetime {
         ShowPairingKey,
         AlarmTriggered,
         Clock,
-        BleRadioEnableToggle
+        BleRadioEnableToggle,
+        UpdateBatteryLevel
       };
     }
   }
@@ -0,0 +1,617 @@
+#include "displayapp/StreamingFont.h"
+#include <algorithm>
+#include <cstring>
+
+using namespace Pinetime::Components;
+
+// Layout of the tables of the binary format of lv_font_conv. All the fields are little endian.
+struct StreamingFont::FontHeader {
+  uint32_t version;
+  uint16_t tablesCount;
+  uint16_t fontSize;
+  uint16_t ascent;
+  int16_t descent;
+  uint16_t typoAscent;
+  int16_t typoDescent;
+  uint16_t typoLineGap;
+  int16_t minY;
+  int16_t maxY;
+  uint16_t defaultAdvanceWidth;
+  uint16_t kerningScale;
+  uint8_t indexToLocFormat;
+  uint8_t glyphIdFormat;
+  uint8_t advanceWidthFormat;
+  uint8_t bitsPerPixel;
+  uint8_t xyBits;
+  uint8_t whBits;
+  uint8_t advanceWidthBits;
+  uint8_t compressionId;
+  uint8_t subpixelsMode;
+  uint8_t padding;
+  int16_t underlinePosition;
+  uint16_t underlineThickness;
+};
+
+namespace {
+  struct CmapHeader {
+    uint32_t dataOffset;
+    uint32_t rangeStart;
+    uint16_t rangeLength;
+    uint16_t glyphIdStart;
+    uint16_t dataEntriesCount;
+    uint8_t formatType;
+    uint8_t padding;
+  };
+  static_assert(sizeof(CmapHeader) == 16, "CmapHeader must match the cmap tables of the font files");
+
+  constexpr size_t labelSize = 8;
+  // Size of the fields that describe a glyph (advance width, offsets and size of the box) before its bitmap
+  constexpr size_t maxGlyphHeaderSize = 8;
+
+  class BitReader {
+  public:
+    explicit BitReader(const uint8_t* data) : data {data} {
+    }
+
+    uint32_t Read(uint8_t nbBits) {
+      uint32_t value = 0;
+      for (uint8_t i = 0; i < nbBits; i++) {
+        value = (value << 1) | ((data[position >> 3] >> (7 - (position & 7))) & 1);
+        position++;
+      }
+      return value;
+    }
+
+    int32_t ReadSigned(uint8_t nbBits) {
+      uint32_t value = Read(nbBits);
+      if (nbBits > 0 && (value & (1 << (nbBits - 1))) != 0) {
+        value |= ~0u << nbBits;
+      }
+      return static_cast<int32_t>(value);
+    }
+
+  private:
+    const uint8_t* data;
+    uint32_t position = 0;
+  };
+
+  size_t AlignedSize(size_t size) {
+    return (size + 3) & ~static_cast<size_t>(3);
+  }
+}
+
+StreamingFont::StreamingFont(Pinetime::Controllers::FS& fs) : fs {fs} {
+}
+
+StreamingFont::~StreamingFont() {
+  Unload();
+}
+
+lv_font_t* StreamingFont::Load(const char* path) {
+  Unload();
+
+  if (fs.Resources().Open(path, packFile)) {
+    packed = true;
+  } else if (fs.FileOpen(&file, path, LFS_O_RDONLY) >= 0) {
+    fileOpen = true;
+  } else {
+    return nullptr;
+  }
+
+  if (!LoadIndex()) {
+    Unload();
+    return nullptr;
+  }
+
+  font.get_glyph_dsc = GetGlyphDescription;
+  font.get_glyph_bitmap = GetGlyphBitmap;
+  font.dsc = this;
+  return &font;
+}
+
+void StreamingFont::Unload() {
+  if (fileOpen) {
+    fs.FileClose(&file);
+    fileOpen = false;
+  }
+  packed = false;
+
+  for (void* buffer : {static_cast<void*>(cmaps),
+                       static_cast<void*>(cmapData),
+                       static_cast<void*>(glyphs),
+                       static_cast<void*>(kerningData),
+                       static_cast<void*>(cache)}) {
+    if (buffer != nullptr) {
+      lv_mem_free(buffer);
+    }
+  }
+  cmaps = nullptr;
+  cmapData = nullptr;
+  glyphs = nullptr;
+  kerningData = nullptr;
+  cache = nullptr;
+  nbCmaps = 0;
+  nbGlyphs = 0;
+  kerningType = KerningTypes::None;
+  cacheCapacity = 0;
+  nbCacheEntries = 0;
+  font = {};
+}
+
+bool StreamingFont::LoadIndex() {
+  static_assert(sizeof(FontHeader) == 40, "FontHeader must match the header of the font files");
+  const int32_t headerLength = ReadLabel(0, "head");
+  FontHeader header;
+  if (headerLength < 0 || !Read(labelSize, &header, sizeof(header))) {
+    return false;
+  }
+  // Compressed bitmaps would have to be decompressed in RAM
+  if (header.compressionId != 0 || (header.bitsPerPixel != 1 && header.bitsPerPixel != 2 && header.bitsPerPixel != 4 &&
+                                    header.bitsPerPixel != 8)) {
+    return false;
+  }
+  bpp = header.bitsPerPixel;
+  glyphIdFormat = header.glyphIdFormat;
+  kerningScale = header.kerningScale;
+
+  const uint32_t cmapsStart = headerLength;
+  const int32_t cmapsLength = ReadLabel(cmapsStart, "cmap");
+  if (cmapsLength < 0 || !LoadCmaps(cmapsStart)) {
+    return false;
+  }
+
+  const uint32_t locaStart = cmapsStart + cmapsLength;
+  const int32_t locaLength = ReadLabel(locaStart, "loca");
+  if (locaLength < 0) {
+    return false;
+  }
+  const uint32_t glyphsStart = locaStart + locaLength;
+  const int32_t glyphsLength = ReadLabel(glyphsStart, "glyf");
+  if (glyphsLength < 0 || !LoadGlyphs(header, locaStart, glyphsStart, glyphsLength)) {
+    return false;
+  }
+  if (header.tablesCount == 4 && !LoadKerning(glyphsStart + glyphsLength)) {
+    return false;
+  }
+
+  // The cache must be able to hold the largest glyph
+  uint16_t largestBitmap = 0;
+  for (uint16_t i = 0; i < nbGlyphs; i++) {
+    largestBitmap = std::max(largestBitmap, glyphs[i].bitmapSize);
+  }
+  cacheCapacity = std::max(static_cast<uint16_t>(cacheSize), largestBitmap);
+  cache = static_cast<uint8_t*>(lv_mem_alloc(cacheCapacity));
+  if (cache == nullptr) {
+    return false;
+  }
+
+  font.line_height = header.ascent - header.descent;
+  font.base_line = -header.descent;
+  font.subpx = header.subpixelsMode;
+  font.underline_position = header.underlinePosition;
+  font.underline_thickness = header.underlineThickness;
+  return true;
+}
+
+bool StreamingFont::LoadCmaps(uint32_t cmapsStart) {
+  uint32_t count;
+  if (!Read(cmapsStart + labelSize, &count, sizeof(count)) || count == 0 || count > UINT16_MAX) {
+    return false;
+  }
+  nbCmaps = count;
+  cmaps = static_cast<Cmap*>(lv_mem_alloc(sizeof(Cmap) * nbCmaps));
+  if (cmaps == nullptr) {
+    return false;
+  }
+
+  // The unicode and glyph id lists of all the cmaps are loaded in a single buffer
+  size_t dataSize = 0;
+  const uint32_t headersStart = cmapsStart + labelSize + sizeof(count);
+  for (uint16_t i = 0; i < nbCmaps; i++) {
+    CmapHeader header;
+    if (!Read(headersStart + i * sizeof(CmapHeader), &header, sizeof(header))) {
+      return false;
+    }
+    cmaps[i] = {header.rangeStart,
+                header.rangeLength,
+                header.glyphIdStart,
+                header.dataEntriesCount,
+                static_cast<CmapTypes>(header.formatType),
+                nullptr,
+                nullptr};
+    switch (cmaps[i].type) {
+      case CmapTypes::Format0Full:
+        dataSize += AlignedSize(header.dataEntriesCount);
+        break;
+      case CmapTypes::SparseFull:
+        dataSize += 2 * AlignedSize(header.dataEntriesCount * sizeof(uint16_t));
+        break;
+      case CmapTypes::SparseTiny:
+        dataSize += AlignedSize(header.dataEntriesCount * sizeof(uint16_t));
+        break;
+      case CmapTypes::Format0Tiny:
+        break;
+      default:
+        return false;
+    }
+  }
+  if (dataSize == 0) {
+    return true;
+  }
+
+  cmapData = static_cast<uint8_t*>(lv_mem_alloc(dataSize));
+  if (cmapData == nullptr) {
+    return false;
+  }
+  uint8_t* data = cmapData;
+  for (uint16_t i = 0; i < nbCmaps; i++) {
+    CmapHeader header;
+    if (!Read(headersStart + i * sizeof(CmapHeader), &header, sizeof(header))) {
+      return false;
+    }
+    const uint32_t position = cmapsStart + header.dataOffset;
+    const size_t listSize = header.dataEntriesCount * sizeof(uint16_t);
+    switch (cmaps[i].type) {
+      case CmapTypes::Format0Full:
+        if (!Read(position, data, header.dataEntriesCount)) {
+          return false;
+        }
+        cmaps[i].glyphIdOffsets = data;
+        data += AlignedSize(header.dataEntriesCount);
+        break;
+      case CmapTypes::SparseFull:
+      case CmapTypes::SparseTiny:
+        if (!Read(position, data, listSize)) {
+          return false;
+        }
+        cmaps[i].unicodes = reinterpret_cast<const uint16_t*>(data);
+        data += AlignedSize(listSize);
+        if (cmaps[i].type == CmapTypes::SparseFull) {
+          if (!Read(position + listSize, data, listSize)) {
+            return false;
+          }
+          cmaps[i].glyphIdOffsets = data;
+          data += AlignedSize(listSize);
+        }
+        break;
+      default:
+        break;
+    }
+  }
+  return true;
+}
+
+bool StreamingFont::LoadGlyphs(const FontHeader& header, uint32_t locaStart, uint32_t glyphsStart, uint32_t glyphsLength) {
+  uint32_t count;
+  if (!Read(locaStart + labelSize, &count, sizeof(count)) || count == 0 || count > UINT16_MAX) {
+    return false;
+  }
+  nbGlyphs = count;
+  glyphs = static_cast<Glyph*>(lv_mem_alloc(sizeof(Glyph) * nbGlyphs));
+  if (glyphs == nullptr) {
+    return false;
+  }
+
+  const uint32_t headerBits = header.advanceWidthBits + 2 * header.xyBits + 2 * header.whBits;
+  if (headerBits > maxGlyphHeaderSize * 8) {
+    return false;
+  }
+  const size_t locaEntrySize = (header.indexToLocFormat == 0) ? sizeof(uint16_t) : sizeof(uint32_t);
+
+  auto readLocation = [&](uint16_t index, uint32_t& location) {
+    if (index == nbGlyphs) {
+      location = glyphsLength;
+      return true;
+    }
+    location = 0;
+    return Read(locaStart + labelSize + sizeof(count) + index * locaEntrySize, &location, locaEntrySize);
+  };
+
+  uint32_t location;
+  if (!readLocation(0, location)) {
+    return false;
+  }
+  for (uint16_t i = 0; i < nbGlyphs; i++) {
+    uint32_t nextLocation;
+    if (!readLocation(i + 1, nextLocation) || nextLocation < location) {
+      return false;
+    }
+    uint8_t data[maxGlyphHeaderSize] = {};
+    const size_t glyphSize = nextLocation - location;
+    if (!Read(glyphsStart + location, data, std::min(glyphSize, maxGlyphHeaderSize))) {
+      return false;
+    }
+
+    BitReader reader(data);
+    Glyph& glyph = glyphs[i];
+    // Decoded as lv_font_load() does
+    glyph.advanceWidth = (header.advanceWidthBits == 0) ? header.defaultAdvanceWidth : reader.Read(header.advanceWidthBits);
+    if (header.advanceWidthFormat == 0) {
+      glyph.advanceWidth *= 16;
+    }
+    glyph.offsetX = reader.ReadSigned(header.xyBits);
+    glyph.offsetY = reader.ReadSigned(header.xyBits);
+    glyph.width = reader.Read(header.whBits);
+    glyph.height = reader.Read(header.whBits);
+    glyph.bitmapOffset = glyphsStart + location + headerBits / 8;
+    glyph.bitmapShift = headerBits % 8;
+    glyph.bitmapSize = (glyph.width * glyph.height != 0 && glyphSize > headerBits / 8) ? glyphSize - headerBits / 8 : 0;
+
+    // The first glyph is reserved
+    if (i == 0) {
+      glyph = {};
+    }
+    location = nextLocation;
+  }
+  return true;
+}
+
+bool StreamingFont::LoadKerning(uint32_t kerningStart) {
+  if (ReadLabel(kerningStart, "kern") < 0) {
+    return false;
+  }
+  uint8_t format[4];
+  uint32_t position = kerningStart + labelSize;
+  if (!Read(position, format, sizeof(format))) {
+    return false;
+  }
+  position += sizeof(format);
+
+  if (format[0] == 0) {
+    // Sorted pairs of glyph ids, followed by the values
+    if (!Read(position, &kerningPairs, sizeof(kerningPairs))) {
+      return false;
+    }
+    position += sizeof(kerningPairs);
+    const size_t idsSize = kerningPairs * 2 * ((glyphIdFormat == 0) ? sizeof(uint8_t) : sizeof(uint16_t));
+    kerningData = static_cast<uint8_t*>(lv_mem_alloc(idsSize + kerningPairs));
+    if (kerningData == nullptr || !Read(position, kerningData, idsSize + kerningPairs)) {
+      return false;
+    }
+    kerningPairValues = reinterpret_cast<const int8_t*>(kerningData + idsSize);
+    kerningType = KerningTypes::Pairs;
+    return true;
+  }
+
+  if (format[0] == 3) {
+    // Class of each glyph on the left side and on the right side, followed by the table of the values
+    uint8_t classes[4];
+    if (!Read(position, classes, sizeof(classes))) {
+      return false;
+    }
+    position += sizeof(classes);
+    kerningClassMappingLength = classes[0] | (classes[1] << 8);
+    const uint8_t rows = classes[2];
+    kerningColumns = classes[3];
+    const size_t size = 2 * kerningClassMappingLength + rows * kerningColumns;
+    kerningData = static_cast<uint8_t*>(lv_mem_alloc(size));
+    if (kerningData == nullptr || !Read(position, kerningData, size)) {
+      return false;
+    }
+    kerningRightClasses = kerningData + kerningClassMappingLength;
+    kerningClassValues = reinterpret_cast<const int8_t*>(kerningData + 2 * kerningClassMappingLength);
+    kerningType = KerningTypes::Classes;
+    return true;
+  }
+
+  return false;
+}
+
+int32_t StreamingFont::ReadLabel(uint32_t position, const char* label) {
+  uint8_t data[labelSize];
+  if (!Read(position, data, sizeof(data)) || std::memcmp(data + 4, label, 4) != 0) {
+    return -1;
+  }
+  uint32_t length;
+  std::memcpy(&length, data, sizeof(length));
+  return static_cast<int32_t>(length);
+}
+
+bool StreamingFont::Read(uint32_t position, void* buffer, size_t size) {
+  if (packed) {
+    return fs.Resources().Seek(packFile, position) &&
+           fs.Resources().Read(packFile, static_cast<uint8_t*>(buffer), size) == static_cast<uint32_t>(size);
+  }
+  if (fs.FileSeek(&file, position) < 0) {
+    return false;
+  }
+  return fs.FileRead(&file, static_cast<uint8_t*>(buffer), size) == static_cast<int>(size);
+}
+
+uint16_t StreamingFont::GetGlyphId(uint32_t letter) const {
+  for (uint16_t i = 0; i < nbCmaps; i++) {
+    const Cmap& cmap = cmaps[i];
+    const uint32_t code = letter - cmap.rangeStart;
+    if (letter < cmap.rangeStart || code >= cmap.rangeLength) {
+      continue;
+    }
+
+    uint32_t id = 0;
+    switch (cmap.type) {
+      case CmapTypes::Format0Tiny:
+        id = cmap.glyphIdStart + code;
+        break;
+      case CmapTypes::Format0Full:
+        if (code >= cmap.entries) {
+          return 0;
+        }
+        id = cmap.glyphIdStart + static_cast<const uint8_t*>(cmap.glyphIdOffsets)[code];
+        break;
+      case CmapTypes::SparseTiny:
+      case CmapTypes::SparseFull: {
+        const uint16_t* end = cmap.unicodes + cmap.entries;
+        const uint16_t* found = std::lower_bound(cmap.unicodes, end, code);
+        if (found == end || *found != code) {
+          return 0;
+        }
+        const uint16_t index = found - cmap.unicodes;
+        if (cmap.type == CmapTypes::SparseTiny) {
+          id = cmap.glyphIdStart + index;
+        } else {
+          id = cmap.glyphIdStart + static_cast<const uint16_t*>(cmap.glyphIdOffsets)[index];
+        }
+      } break;
+    }
+    // The ids come from the font file and index the glyph table: an invalid one is handled as a missing glyph
+    return (id < nbGlyphs) ? static_cast<uint16_t>(id) : 0;
+  }
+  return 0;
+}
+
+int8_t StreamingFont::GetKerning(uint16_t leftGlyphId, uint16_t rightGlyphId) const {
+  if (kerningType == KerningTypes::Pairs) {
+    // The pairs are sorted by left glyph id, then by right glyph id
+    uint32_t low = 0;
+    uint32_t high = kerningPairs;
+    while (low < high) {
+      const uint32_t middle = (low + high) / 2;
+      uint16_t left;
+      uint16_t right;
+      if (glyphIdFormat == 0) {
+        left = kerningData[2 * middle];
+        right = kerningData[2 * middle + 1];
+      } else {
+        const uint8_t* ids = kerningData + 4 * middle;
+        left = ids[0] | (ids[1] << 8);
+        right = ids[2] | (ids[3] << 8);
+      }
+      if (left == leftGlyphId && right == rightGlyphId) {
+        return kerningPairValues[middle];
+      }
+      if (left < leftGlyphId || (left == leftGlyphId && right < rightGlyphId)) {
+        low = middle + 1;
+      } else {
+        high = middle;
+      }
+    }
+  } else if (kerningType == KerningTypes::Classes) {
+    if (leftGlyphId >= kerningClassMappingLength || rightGlyphId >= kerningClassMappingLength) {
+      return 0;
+    }
+    const uint8_t leftClass = kerningData[leftGlyphId];
+    const uint8_t rightClass = kerningRightClasses[rightGlyphId];
+    if (leftClass > 0 && rightClass > 0) {
+      return kerningClassValues[(leftClass - 1) * kerningColumns + (rightClass - 1)];
+    }
+  }
+  return 0;
+}
+
+const uint8_t* StreamingFont::GetBitmap(uint16_t glyphId) {
+  const Glyph& glyph = glyphs[glyphId];
+  if (glyph.bitmapSize == 0) {
+    return nullptr;
+  }
+
+  cacheUseCounter++;
+  for (uint8_t i = 0; i < nbCacheEntries; i++) {
+    if (cacheEntries[i].glyphId == glyphId) {
+      cacheEntries[i].lastUse = cacheUseCounter;
+      cacheStatistics.hits++;
+      return cache + cacheEntries[i].offset;
+    }
+  }
+
+  cacheStatistics.misses++;
+  CacheEntry* entry = AllocateCacheEntry(glyph.bitmapSize);
+  uint8_t* bitmap = cache + entry->offset;
+  if (!Read(glyph.bitmapOffset, bitmap, glyph.bitmapSize)) {
+    EvictCacheEntry(nbCacheEntries - 1);
+    return nullptr;
+  }
+  cacheStatistics.bytesRead += glyph.bitmapSize;
+
+  // The bitmap follows the description of the glyph without padding: align it on the first byte
+  if (glyph.bitmapShift != 0) {
+    for (uint16_t i = 0; i < glyph.bitmapSize; i++) {
+      const uint8_t next = (i + 1 < glyph.bitmapSize) ? bitmap[i + 1] : 0;
+      bitmap[i] = (bitmap[i] << glyph.bitmapShift) | (next >> (8 - glyph.bitmapShift));
+    }
+  }
+  entry->glyphId = glyphId;
+  entry->lastUse = cacheUseCounter;
+  return bitmap;
+}
+
+StreamingFont::CacheEntry* StreamingFont::AllocateCacheEntry(uint16_t size) {
+  // The entries are stored contiguously, in the order of the table: a new entry is added at the end
+  auto usedSize = [this]() {
+    return (nbCacheEntries == 0) ? 0 : cacheEntries[nbCacheEntries - 1].offset + cacheEntries[nbCacheEntries - 1].size;
+  };
+  while (nbCacheEntries == maxCacheEntries || cacheCapacity - usedSize() < size) {
+    uint8_t leastRecentlyUsed = 0;
+    for (uint8_t i = 1; i < nbCacheEntries; i++) {
+      if (cacheEntries[i].lastUse < cacheEntries[leastRecentlyUsed].lastUse) {
+        leastRecentlyUsed = i;
+      }
+    }
+    EvictCacheEntry(leastRecentlyUsed);
+  }
+
+  CacheEntry& entry = cacheEntries[nbCacheEntries];
+  entry.offset = usedSize();
+  entry.size = size;
+  nbCacheEntries++;
+  return &entry;
+}
+
+void StreamingFont::EvictCacheEntry(uint8_t index) {
+  // Move the following entries down to keep the free space at the end of the cache
+  const uint16_t offset = cacheEntries[index].offset;
+  const uint16_t size = cacheEntries[index].size;
+  const uint16_t end = cacheEntries[nbCacheEntries - 1].offset + cacheEntries[nbCacheEntries - 1].size;
+  std::memmove(cache + offset, cache + offset + size, end - (offset + size));
+  for (uint8_t i = index; i + 1 < nbCacheEntries; i++) {
+    cacheEntries[i] = cacheEntries[i + 1];
+    cacheEntries[i].offset -= size;
+  }
+  nbCacheEntries--;
+}
+
+bool StreamingFont::GetGlyphDescription(const lv_font_t* font, lv_font_glyph_dsc_t* dsc, uint32_t letter, uint32_t nextLetter) {
+  auto* self = static_cast<StreamingFont*>(font->dsc);
+  bool isTab = false;
+  if (letter == '\t') {
+    letter = ' ';
+    isTab = true;
+  }
+
+  const uint16_t glyphId = self->GetGlyphId(letter);
+  if (glyphId == 0) {
+    return false;
+  }
+
+  int32_t kerning = 0;
+  if (self->kerningType != KerningTypes::None && nextLetter != 0) {
+    const uint16_t nextGlyphId = self->GetGlyphId(nextLetter);
+    if (nextGlyphId != 0) {
+      kerning = (self->GetKerning(glyphId, nextGlyphId) * self->kerningScale) >> 4;
+    }
+  }
+
+  const Glyph& glyph = self->glyphs[glyphId];
+  int32_t advanceWidth = glyph.advanceWidth;
+  if (isTab) {
+    advanceWidth *= 2;
+  }
+  advanceWidth += kerning;
+  dsc->adv_w = (advanceWidth + (1 << 3)) >> 4;
+  dsc->box_w = isTab ? glyph.width * 2 : glyph.width;
+  dsc->box_h = glyph.height;
+  dsc->ofs_x = glyph.offsetX;
+  dsc->ofs_y = glyph.offsetY;
+  dsc->bpp = self->bpp;
+  return true;
+}
+
+const uint8_t* StreamingFont::GetGlyphBitmap(const lv_font_t* font, uint32_t letter) {
+  auto* self = static_cast<StreamingFont*>(font->dsc);
+  if (letter == '\t') {
+    letter = ' ';
+  }
+  const uint16_t glyphId = self->GetGlyphId(letter);
+  if (glyphId == 0) {
+    return nullptr;
+  }
+  return self->GetBitmap(glyphId);
+}
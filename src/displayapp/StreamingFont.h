@@ -0,0 +1,133 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <lvgl/lvgl.h>
+#include "components/fs/FS.h"
+
+namespace Pinetime {
+  namespace Components {
+    /*
+     * LVGL font read from a font file in the binary format of lv_font_conv (--format bin), like lv_font_load().
+     *
+     * lv_font_load() loads the whole font, bitmaps included, in the LVGL heap. This class only loads the index of
+     * the font (character maps, glyph descriptions and kerning) and reads the bitmaps of the glyphs from the file
+     * when they are drawn. The bitmaps are kept in a small LRU cache, so that redrawing the same glyphs does not
+     * access the file system. The file is kept open until the font is unloaded. The font is read from the resource
+     * pack when it contains the file.
+     *
+     * Only uncompressed fonts are supported (lv_font_conv --no-compress).
+     */
+    class StreamingFont {
+    public:
+      explicit StreamingFont(Pinetime::Controllers::FS& fs);
+      ~StreamingFont();
+
+      StreamingFont(const StreamingFont&) = delete;
+      StreamingFont& operator=(const StreamingFont&) = delete;
+      StreamingFont(StreamingFont&&) = delete;
+      StreamingFont& operator=(StreamingFont&&) = delete;
+
+      // Returns nullptr if the file does not exist or is not a valid font
+      lv_font_t* Load(const char* path);
+      void Unload();
+
+      struct CacheStatistics {
+        uint32_t hits = 0;
+        uint32_t misses = 0;
+        uint32_t bytesRead = 0;
+      };
+
+      const CacheStatistics& GetCacheStatistics() const {
+        return cacheStatistics;
+      }
+
+    private:
+      static bool GetGlyphDescription(const lv_font_t* font, lv_font_glyph_dsc_t* dsc, uint32_t letter, uint32_t nextLetter);
+      static const uint8_t* GetGlyphBitmap(const lv_font_t* font, uint32_t letter);
+
+      struct FontHeader;
+
+      enum class CmapTypes : uint8_t { Format0Full = 0, SparseFull = 1, Format0Tiny = 2, SparseTiny = 3 };
+      struct Cmap {
+        uint32_t rangeStart;
+        uint16_t rangeLength;
+        uint16_t glyphIdStart;
+        uint16_t entries;
+        CmapTypes type;
+        const uint16_t* unicodes;
+        const void* glyphIdOffsets;
+      };
+
+      struct Glyph {
+        uint32_t bitmapOffset; // In the file
+        uint16_t bitmapSize;
+        uint16_t advanceWidth; // 1/16 px
+        uint16_t width;
+        uint16_t height;
+        int16_t offsetX;
+        int16_t offsetY;
+        uint8_t bitmapShift; // The bitmap starts at this bit of the first byte
+      };
+
+      enum class KerningTypes : uint8_t { None, Pairs, Classes };
+
+      struct CacheEntry {
+        uint16_t glyphId = 0;
+        uint16_t offset = 0;
+        uint16_t size = 0;
+        uint32_t lastUse = 0;
+      };
+
+      static constexpr size_t cacheSize = 1536;
+      static constexpr uint8_t maxCacheEntries = 8;
+
+      bool LoadIndex();
+      bool LoadCmaps(uint32_t cmapsStart);
+      bool LoadGlyphs(const FontHeader& header, uint32_t locaStart, uint32_t glyphsStart, uint32_t glyphsLength);
+      bool LoadKerning(uint32_t kerningStart);
+      int32_t ReadLabel(uint32_t position, const char* label);
+      bool Read(uint32_t position, void* buffer, size_t size);
+
+      uint16_t GetGlyphId(uint32_t letter) const;
+      int8_t GetKerning(uint16_t leftGlyphId, uint16_t rightGlyphId) const;
+      const uint8_t* GetBitmap(uint16_t glyphId);
+      CacheEntry* AllocateCacheEntry(uint16_t size);
+      void EvictCacheEntry(uint8_t index);
+
+      Pinetime::Controllers::FS& fs;
+      lfs_file_t file;
+      bool fileOpen = false;
+      Pinetime::Controllers::ResourcePack::File packFile;
+      bool packed = false;
+      lv_font_t font {};
+
+      uint8_t bpp = 0;
+      uint8_t glyphIdFormat = 0;
+      uint16_t kerningScale = 0;
+
+      // The index of the font is allocated in the LVGL heap
+      uint16_t nbCmaps = 0;
+      Cmap* cmaps = nullptr;
+      uint8_t* cmapData = nullptr;
+      uint16_t nbGlyphs = 0;
+      Glyph* glyphs = nullptr;
+
+      KerningTypes kerningType = KerningTypes::None;
+      uint8_t* kerningData = nullptr;
+      uint32_t kerningPairs = 0;
+      const int8_t* kerningPairValues = nullptr;
+      uint16_t kerningClassMappingLength = 0;
+      uint8_t kerningColumns = 0;
+      const uint8_t* kerningRightClasses = nullptr;
+      const int8_t* kerningClassValues = nullptr;
+
+      uint8_t* cache = nullptr;
+      uint16_t cacheCapacity = 0;
+      CacheEntry cacheEntries[maxCacheEntries];
+      uint8_t nbCacheEntries = 0;
+      uint32_t cacheUseCounter = 0;
+      CacheStatistics cacheStatistics;
+    };
+  }
+}
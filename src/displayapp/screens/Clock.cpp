@@ -73,6 +73,12 @@ bool Clock::OnButtonPushed() {
   return screen->OnButtonPushed();
 }
 
+void Clock::Refresh() {
+  // The watch faces without seconds only refresh themselves once per second, DisplayApp calls this when the time,
+  // the battery or the BLE connection changes so that they are updated immediately.
+  screen->RefreshNow();
+}
+
 std::unique_ptr<Screen> Clock::WatchFaceDigitalScreen() {
   return std::make_unique<Screens::WatchFaceDigital>(app,
                                                      dateTimeController,
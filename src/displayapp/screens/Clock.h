@@ -36,6 +36,8 @@ namespace Pinetime {
         bool OnButtonPushed() override;
 
       private:
+        void Refresh() override;
+
         Controllers::DateTime& dateTimeController;
         Controllers::Battery& batteryController;
         Controllers::Ble& bleController;
@@ -50,6 +50,11 @@ namespace Pinetime {
 
         static void RefreshTaskCallback(lv_task_t* task);
 
+        /** Refresh the content of the screen now instead of waiting for its refresh task */
+        void RefreshNow() {
+          Refresh();
+        }
+
         bool IsRunning() const {
           return running;
         }
@@ -8,6 +8,7 @@
 #include "displayapp/screens/Screen.h"
 #include "components/datetime/DateTimeController.h"
 #include "components/ble/BleController.h"
+#include "displayapp/StreamingFont.h"
 
 namespace Pinetime {
   namespace Controllers {
@@ -102,6 +103,9 @@ namespace Pinetime {
         Controllers::MotionController& motionController;
 
         lv_task_t* taskRefresh;
+        Components::StreamingFont streamingFontDot40;
+        Components::StreamingFont streamingFontSegment40;
+        Components::StreamingFont streamingFontSegment115;
         lv_font_t* font_dot40 = nullptr;
         lv_font_t* font_segment40 = nullptr;
         lv_font_t* font_segment115 = nullptr;
@@ -35,17 +35,12 @@ WatchFaceInfineat::WatchFaceInfineat(DisplayApp* app,
     bleController {bleController},
     notificationManager {notificationManager},
     settingsController {settingsController},
-    motionController {motionController} {
-  lfs_file f = {};
-  if (filesystem.FileOpen(&f, "/fonts/teko.bin", LFS_O_RDONLY) >= 0) {
-    filesystem.FileClose(&f);
-    font_teko = lv_font_load("F:/fonts/teko.bin");
-  }
-
-  if (filesystem.FileOpen(&f, "/fonts/bebas.bin", LFS_O_RDONLY) >= 0) {
-    filesystem.FileClose(&f);
-    font_bebas = lv_font_load("F:/fonts/bebas.bin");
-  }
+    motionController {motionController},
+    streamingFontTeko {filesystem},
+    streamingFontBebas {filesystem} {
+  // Only the index of the fonts is loaded, the glyphs are read from the files when they are drawn
+  font_teko = streamingFontTeko.Load("/fonts/teko.bin");
+  font_bebas = streamingFontBebas.Load("/fonts/bebas.bin");
 
   // Black background covering the whole screen
   background = lv_obj_create(lv_scr_act(), nullptr);
@@ -323,7 +318,7 @@ WatchFaceInfineat::WatchFaceInfineat(DisplayApp* app,
   lv_label_set_text_static(labelBtnSettings, Symbols::settings);
   lv_obj_set_hidden(btnSettings, true);
 
-  taskRefresh = lv_task_create(RefreshTaskCallback, LV_DISP_DEF_REFR_PERIOD, LV_TASK_PRIO_MID, this);
+  taskRefresh = lv_task_create(RefreshTaskCallback, 1000, LV_TASK_PRIO_MID, this);
   Refresh();
 }
 
@@ -341,13 +336,6 @@ WatchFaceInfineat::~WatchFaceInfineat() {
   lv_style_reset(&line8Style);
   lv_style_reset(&lineBatteryStyle);
 
-  if (font_bebas != nullptr) {
-    lv_font_free(font_bebas);
-  }
-  if (font_teko != nullptr) {
-    lv_font_free(font_teko);
-  }
-
   lv_obj_clean(lv_scr_act());
 }
 
@@ -611,22 +599,6 @@ void WatchFaceInfineat::ToggleBatteryIndicatorColor(bool showSideCover) {
 }
 
 bool WatchFaceInfineat::IsAvailable(Pinetime::Controllers::FS& filesystem) {
-  lfs_file file = {};
-
-  if (filesystem.FileOpen(&file, "/fonts/teko.bin", LFS_O_RDONLY) < 0) {
-    return false;
-  }
-
-  filesystem.FileClose(&file);
-  if (filesystem.FileOpen(&file, "/fonts/bebas.bin", LFS_O_RDONLY) < 0) {
-    return false;
-  }
-
-  filesystem.FileClose(&file);
-  if (filesystem.FileOpen(&file, "/images/pine_small.bin", LFS_O_RDONLY) < 0) {
-    return false;
-  }
-
-  filesystem.FileClose(&file);
-  return true;
+  return filesystem.ResourceAvailable("/fonts/teko.bin") && filesystem.ResourceAvailable("/fonts/bebas.bin") &&
+         filesystem.ResourceAvailable("/images/pine_small.bin");
 }
@@ -6,6 +6,7 @@
 #include <memory>
 #include "displayapp/screens/Screen.h"
 #include "components/datetime/DateTimeController.h"
+#include "displayapp/StreamingFont.h"
 
 namespace Pinetime {
   namespace Controllers {
@@ -139,6 +140,8 @@ namespace Pinetime {
         void ToggleBatteryIndicatorColor(bool showSideCover);
 
         lv_task_t* taskRefresh;
+        Components::StreamingFont streamingFontTeko;
+        Components::StreamingFont streamingFontBebas;
         lv_font_t* font_teko = nullptr;
         lv_font_t* font_bebas = nullptr;
       };
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstdint>
+#include <lvgl/lvgl.h>
+#include "components/settings/Settings.h"
+#include "displayapp/screens/Screen.h"
+#include <array>
+
+namespace Pinetime {
+
+  namespace Applications {
+    namespace Screens {
+
+      class SettingHeartRate : public Screen {
+      public:
+        SettingHeartRate(DisplayApp* app, Pinetime::Controllers::Settings& settingsController);
+        ~SettingHeartRate() override;
+
+        void UpdateSelected(lv_obj_t* object, lv_event_t event);
+
+      private:
+        // Interval between the background measurements
+        struct Option {
+          uint16_t minutes;
+          const char* name;
+        };
+        static constexpr std::array<Option, 4> options = {{{0, "Off"}, {10, "Every 10 mins"}, {30, "Every 30 mins"}, {60, "Every hour"}}};
+
+        std::array<lv_obj_t*, options.size()> cbOption;
+
+        Controllers::Settings& settingsController;
+      };
+    }
+  }
+}
@@ -46,10 +46,10 @@ namespace Pinetime {
           {Symbols::check, "Firmware", Apps::FirmwareValidation},
           {Symbols::bluetooth, "Bluetooth", Apps::SettingBluetooth},
 
+          {Symbols::heartBeat, "Heart rate", Apps::SettingHeartRate},
           {Symbols::list, "About", Apps::SysInfo},
           {Symbols::none, "None", Apps::None},
           {Symbols::none, "None", Apps::None},
-          {Symbols::none, "None", Apps::None},
         }};
         ScreenList<nScreens> screens;
       };
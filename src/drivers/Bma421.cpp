@@ -83,6 +83,34 @@ void Bma421::Init() {
   if (ret != BMA4_OK)
     return;
 
+  // Accumulate the samples in the FIFO (headerless mode, accelerometer only) and raise INT1 when
+  // the watermark is reached, so that the samples can be read in bursts.
+  ret = bma4_set_fifo_config(BMA4_FIFO_HEADER, BMA4_DISABLE, &bma);
+  if (ret != BMA4_OK)
+    return;
+
+  ret = bma4_set_fifo_config(BMA4_FIFO_ACCEL, BMA4_ENABLE, &bma);
+  if (ret != BMA4_OK)
+    return;
+
+  ret = bma4_set_fifo_wm(fifoWatermark * BMA4_FIFO_A_LENGTH, &bma);
+  if (ret != BMA4_OK)
+    return;
+
+  struct bma4_int_pin_config pinConfig;
+  pinConfig.edge_ctrl = BMA4_LEVEL_TRIGGER;
+  pinConfig.lvl = BMA4_ACTIVE_HIGH;
+  pinConfig.od = BMA4_PUSH_PULL;
+  pinConfig.output_en = BMA4_OUTPUT_ENABLE;
+  pinConfig.input_en = BMA4_INPUT_DISABLE;
+  ret = bma4_set_int_pin_config(&pinConfig, BMA4_INTR1_MAP, &bma);
+  if (ret != BMA4_OK)
+    return;
+
+  ret = bma4_map_interrupt(BMA4_INTR1_MAP, BMA4_FIFO_WM_INT, BMA4_ENABLE, &bma);
+  if (ret != BMA4_OK)
+    return;
+
   isOk = true;
 }
 
@@ -102,21 +130,61 @@ void Bma421::Write(uint8_t registerAddress, const uint8_t* data, size_t size) {
 Bma421::Values Bma421::Process() {
   if (not isOk)
     return {};
-  struct bma4_accel data;
-  bma4_read_accel_xyz(&data, &bma);
 
-  uint32_t steps = 0;
-  bma423_step_counter_output(&steps, &bma);
+  // INT_STAT_0 (0x1C) to FIFO_LENGTH_1 (0x25) in a single transaction: the interrupt status (cleared on read),
+  // the step counter and the FIFO length
+  uint8_t status[BMA4_FIFO_LENGTH_0_ADDR + BMA4_FIFO_DATA_LENGTH - BMA4_INT_STAT_0_ADDR];
+  Read(BMA4_INT_STAT_0_ADDR, status, sizeof(status));
+
+  const uint8_t* stepCounter = status + (BMA4_STEP_CNT_OUT_0_ADDR - BMA4_INT_STAT_0_ADDR);
+  uint32_t steps = stepCounter[0] | (stepCounter[1] << 8) | (stepCounter[2] << 16) | (static_cast<uint32_t>(stepCounter[3]) << 24);
 
-  int32_t temperature;
-  bma4_get_temperature(&temperature, BMA4_DEG, &bma);
-  temperature = temperature / 1000;
+  const uint8_t* fifoLength = status + (BMA4_FIFO_LENGTH_0_ADDR - BMA4_INT_STAT_0_ADDR);
+  ReadFifo(fifoLength[0] | ((fifoLength[1] & BMA4_FIFO_BYTE_COUNTER_MSB_MSK) << 8));
 
-  uint8_t activity = 0;
-  bma423_activity_output(&activity, &bma);
+  if (nbFifoSamples == 0) {
+    struct bma4_accel data;
+    bma4_read_accel_xyz(&data, &bma);
+    // X and Y axis are swapped because of the way the sensor is mounted in the PineTime
+    return {steps, data.y, data.x, data.z};
+  }
 
-  // X and Y axis are swapped because of the way the sensor is mounted in the PineTime
-  return {steps, data.y, data.x, data.z};
+  const auto& last = fifoSamples[nbFifoSamples - 1];
+  return {steps, last.x, last.y, last.z, fifoSamples, nbFifoSamples};
+}
+
+void Bma421::ReadFifo(uint16_t length) {
+  nbFifoSamples = 0;
+
+  if (length > sizeof(fifoBuffer)) {
+    // The FIFO has not been read for a while: the old samples are not interesting anymore
+    bma4_set_command_register(0xB0, &bma); // FIFO flush
+  } else if (length >= BMA4_FIFO_A_LENGTH) {
+    // The FIFO is configured in Init() (headerless mode, accelerometer only): read the data directly
+    // instead of bma4_read_fifo_data(), which reads FIFO_CONFIG_1 in an additional transaction.
+    struct bma4_fifo_frame fifo = {};
+    fifo.data = fifoBuffer;
+    fifo.length = length - (length % BMA4_FIFO_A_LENGTH);
+    fifo.fifo_header_enable = 0;
+    fifo.fifo_data_enable = BMA4_FIFO_A_ENABLE;
+    Read(BMA4_FIFO_DATA_ADDR, fifo.data, fifo.length);
+
+    uint16_t nbFrames = maxFifoSamples;
+    bma4_extract_accel(fifoAccel, &nbFrames, &fifo, &bma);
+    for (uint16_t i = 0; i < nbFrames; i++) {
+      // X and Y axis are swapped because of the way the sensor is mounted in the PineTime
+      fifoSamples[i] = {fifoAccel[i].y, fifoAccel[i].x, fifoAccel[i].z};
+    }
+    nbFifoSamples = nbFrames;
+  }
+
+  // The interrupt status was read before the FIFO was drained. If the watermark was reached, read it again
+  // so that the latched interrupt is cleared and INT1 rises again at the next watermark. When the FIFO is
+  // polled every 100ms while running, the watermark is never reached and this transaction is skipped.
+  if (length >= fifoWatermark * BMA4_FIFO_A_LENGTH) {
+    uint8_t interruptStatus[2];
+    Read(BMA4_INT_STAT_0_ADDR, interruptStatus, sizeof(interruptStatus));
+  }
 }
 bool Bma421::IsOk() const {
   return isOk;
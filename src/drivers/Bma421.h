@@ -7,11 +7,19 @@ namespace Pinetime {
     class Bma421 {
     public:
       enum class DeviceTypes : uint8_t { Unknown, BMA421, BMA425 };
+      struct Sample {
+        int16_t x;
+        int16_t y;
+        int16_t z;
+      };
       struct Values {
         uint32_t steps;
         int16_t x;
         int16_t y;
         int16_t z;
+        // Samples read from the FIFO since the previous call to Process(), oldest first
+        const Sample* samples = nullptr;
+        uint8_t nbSamples = 0;
       };
       Bma421(TwiMaster& twiMaster, uint8_t twiAddress);
       Bma421(const Bma421&) = delete;
@@ -34,6 +42,7 @@ namespace Pinetime {
 
     private:
       void Reset();
+      void ReadFifo(uint16_t length);
 
       TwiMaster& twiMaster;
       uint8_t deviceAddress = 0x18;
@@ -41,6 +50,14 @@ namespace Pinetime {
       bool isOk = false;
       bool isResetOk = false;
       DeviceTypes deviceType = DeviceTypes::Unknown;
+
+      // The FIFO watermark interrupt is raised every 20 samples (200ms at 100Hz)
+      static constexpr uint8_t fifoWatermark = 20;
+      static constexpr uint8_t maxFifoSamples = 32;
+      uint8_t fifoBuffer[maxFifoSamples * BMA4_FIFO_A_LENGTH];
+      bma4_accel fifoAccel[maxFifoSamples];
+      Sample fifoSamples[maxFifoSamples];
+      uint8_t nbFifoSamples = 0;
     };
   }
 }
\ No newline at end of file
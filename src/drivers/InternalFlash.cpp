@@ -1,5 +1,6 @@
 #include "drivers/InternalFlash.h"
 #include <mdk/nrf.h>
+#include <cstring>
 using namespace Pinetime::Drivers;
 
 void InternalFlash::ErasePage(uint32_t address) {
@@ -34,6 +35,11 @@ void InternalFlash::WriteWord(uint32_t address, uint32_t value) {
   __DSB();
 }
 
+void InternalFlash::Read(uint32_t address, uint8_t* buffer, size_t size) {
+  // The internal flash memory is memory mapped
+  std::memcpy(buffer, reinterpret_cast<const void*>(address), size);
+}
+
 void InternalFlash::Wait() {
   while (NRF_NVMC->READY == NVMC_READY_READY_Busy) {
     ;
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
 
 namespace Pinetime {
@@ -8,6 +9,7 @@ namespace Pinetime {
     public:
       static void ErasePage(uint32_t address);
       static void WriteWord(uint32_t address, uint32_t value);
+      static void Read(uint32_t address, uint8_t* buffer, size_t size);
 
     private:
       static inline void Wait();
@@ -26,6 +26,16 @@ bool Spi::WriteCmdAndBuffer(const uint8_t* cmd, size_t cmdSize, const uint8_t* d
   return spiMaster.WriteCmdAndBuffer(pinCsn, cmd, cmdSize, data, dataSize);
 }
 
+bool Spi::Submit(SpiMaster::Transaction transaction) {
+  transaction.pinCsn = pinCsn;
+  return spiMaster.Submit(transaction);
+}
+
+bool Spi::Transfer(SpiMaster::Transaction transaction) {
+  transaction.pinCsn = pinCsn;
+  return spiMaster.Transfer(transaction);
+}
+
 bool Spi::Init() {
   nrf_gpio_pin_set(pinCsn); /* disable Set slave select (inactive high) */
   return true;
@@ -17,6 +17,9 @@ namespace Pinetime {
       bool Write(const uint8_t* data, size_t size);
       bool Read(uint8_t* cmd, size_t cmdSize, uint8_t* data, size_t dataSize);
       bool WriteCmdAndBuffer(const uint8_t* cmd, size_t cmdSize, const uint8_t* data, size_t dataSize);
+      // See SpiMaster::Submit() and SpiMaster::Transfer(). The CS pin of the transaction is set by this class.
+      bool Submit(SpiMaster::Transaction transaction);
+      bool Transfer(SpiMaster::Transaction transaction);
       void Sleep();
       void Wakeup();
 
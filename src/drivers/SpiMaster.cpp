@@ -6,13 +6,29 @@
 
 using namespace Pinetime::Drivers;
 
+namespace {
+  // EasyDMA MAXCNT is 8 bits wide on the nRF52832
+  constexpr size_t MaxDmaTransferSize = 255;
+  // Buffers that cannot be divided into chunks at least this large are sent as
+  // an ArrayList of MaxDmaTransferSize chunks followed by a regular transfer for the remainder
+  constexpr size_t MinArrayListChunkSize = 128;
+
+  // PPI channel 0 and GPIOTE channel 0 are used by the workaround for FTPAN-58.
+  // NimBLE uses PPI channels 4, 5 and 17 to 19.
+  constexpr uint8_t ArrayListChainPpiChannel = 1; // END -> START (in ArrayListPpiGroup)
+  constexpr uint8_t ArrayListCountPpiChannel = 2; // END -> TIMER COUNT
+  constexpr uint8_t ArrayListStopPpiChannel = 3;  // TIMER COMPARE[0] -> disable ArrayListPpiGroup
+  constexpr uint8_t ArrayListPpiGroup = 0;
+  NRF_TIMER_Type* const ArrayListTimer = NRF_TIMER3;
+}
+
 SpiMaster::SpiMaster(const SpiMaster::SpiModule spi, const SpiMaster::Parameters& params) : spi {spi}, params {params} {
 }
 
 bool SpiMaster::Init() {
-  if (mutex == nullptr) {
-    mutex = xSemaphoreCreateBinary();
-    ASSERT(mutex != nullptr);
+  if (freeSlots == nullptr) {
+    freeSlots = xSemaphoreCreateCounting(QueueSize, QueueSize);
+    ASSERT(freeSlots != nullptr);
   }
 
   /* Configure GPIO pins used for pselsck, pselmosi, pselmiso and pselss for SPI0 */
@@ -90,7 +106,8 @@ bool SpiMaster::Init() {
   NRFX_IRQ_PRIORITY_SET(SPIM0_SPIS0_TWIM0_TWIS0_SPI0_TWI0_IRQn, 2);
   NRFX_IRQ_ENABLE(SPIM0_SPIS0_TWIM0_TWIS0_SPI0_TWI0_IRQn);
 
-  xSemaphoreGive(mutex);
+  SetupArrayList(spiBaseAddress);
+
   return true;
 }
 
@@ -100,8 +117,8 @@ void SpiMaster::SetupWorkaroundForFtpan58(NRF_SPIM_Type* spim, uint32_t ppi_chan
                                        (GPIOTE_CONFIG_POLARITY_Toggle << GPIOTE_CONFIG_POLARITY_Pos);
 
   // Stop the spim instance when SCK toggles.
-  NRF_PPI->CH[ppi_channel].EEP = (uint32_t) &NRF_GPIOTE->EVENTS_IN[gpiote_channel];
-  NRF_PPI->CH[ppi_channel].TEP = (uint32_t) &spim->TASKS_STOP;
+  NRF_PPI->CH[ppi_channel].EEP = (uintptr_t) &NRF_GPIOTE->EVENTS_IN[gpiote_channel];
+  NRF_PPI->CH[ppi_channel].TEP = (uintptr_t) &spim->TASKS_STOP;
   NRF_PPI->CHENSET = 1U << ppi_channel;
   spiBaseAddress->EVENTS_END = 0;
 
@@ -116,44 +133,115 @@ void SpiMaster::DisableWorkaroundForFtpan58(NRF_SPIM_Type* spim, uint32_t ppi_ch
   NRF_PPI->CH[ppi_channel].EEP = 0;
   NRF_PPI->CH[ppi_channel].TEP = 0;
   NRF_PPI->CHENSET = ppi_channel;
-  spiBaseAddress->EVENTS_END = 0;
+  // EVENTS_END is not cleared: the interrupt fires as soon as it is re-enabled, so that the
+  // interrupt handler continues the transaction like after any other transfer.
   spim->INTENSET = (1 << 6);
   spim->INTENSET = (1 << 1);
   spim->INTENSET = (1 << 19);
 }
 
+void SpiMaster::SetupArrayList(NRF_SPIM_Type* spim) {
+  // Large buffers are sent as a list of equally sized chunks (EasyDMA ArrayList): the END event of each chunk
+  // restarts the SPIM (which moves TXD.PTR to the next chunk) and is counted by a TIMER in counter mode.
+  // The chaining is disabled when the next to last chunk is done, and the TIMER raises a single interrupt
+  // when the last one is done.
+  ArrayListTimer->TASKS_STOP = 1;
+  ArrayListTimer->MODE = TIMER_MODE_MODE_LowPowerCounter;
+  ArrayListTimer->BITMODE = TIMER_BITMODE_BITMODE_16Bit;
+  ArrayListTimer->SHORTS = TIMER_SHORTS_COMPARE1_STOP_Msk;
+  ArrayListTimer->INTENSET = TIMER_INTENSET_COMPARE1_Msk;
+
+  NRF_PPI->CH[ArrayListChainPpiChannel].EEP = (uintptr_t) &spim->EVENTS_END;
+  NRF_PPI->CH[ArrayListChainPpiChannel].TEP = (uintptr_t) &spim->TASKS_START;
+  NRF_PPI->CH[ArrayListCountPpiChannel].EEP = (uintptr_t) &spim->EVENTS_END;
+  NRF_PPI->CH[ArrayListCountPpiChannel].TEP = (uintptr_t) &ArrayListTimer->TASKS_COUNT;
+  NRF_PPI->CH[ArrayListStopPpiChannel].EEP = (uintptr_t) &ArrayListTimer->EVENTS_COMPARE[0];
+  NRF_PPI->CH[ArrayListStopPpiChannel].TEP = (uintptr_t) &NRF_PPI->TASKS_CHG[ArrayListPpiGroup].DIS;
+  NRF_PPI->CHG[ArrayListPpiGroup] = 1U << ArrayListChainPpiChannel;
+  NRF_PPI->CHENCLR = (1U << ArrayListChainPpiChannel) | (1U << ArrayListCountPpiChannel) | (1U << ArrayListStopPpiChannel);
+
+  NRFX_IRQ_PRIORITY_SET(TIMER3_IRQn, 2);
+  NRFX_IRQ_ENABLE(TIMER3_IRQn);
+}
+
+size_t SpiMaster::ArrayListChunkSize(size_t size) {
+  // Use the largest chunk size that divides the buffer, so that it can be sent in a single ArrayList.
+  // Buffers from LVGL are made of full lines of 240 pixels (480 bytes), so 240 is used in most cases.
+  for (size_t chunkSize = MaxDmaTransferSize; chunkSize >= MinArrayListChunkSize; chunkSize--) {
+    if ((size % chunkSize) == 0) {
+      return chunkSize;
+    }
+  }
+  return MaxDmaTransferSize;
+}
+
+void SpiMaster::PrepareTxArrayList(const volatile uintptr_t bufferAddress, const size_t chunkSize, const size_t chunkCount) {
+  // Only the TIMER interrupt is needed for this transfer
+  spiBaseAddress->INTENCLR = (1 << 6);
+  spiBaseAddress->INTENCLR = (1 << 1);
+  spiBaseAddress->INTENCLR = (1 << 19);
+
+  PrepareTx(bufferAddress, chunkSize);
+  spiBaseAddress->TXD.LIST = SPIM_TXD_LIST_LIST_ArrayList;
+
+  ArrayListTimer->TASKS_CLEAR = 1;
+  ArrayListTimer->EVENTS_COMPARE[0] = 0;
+  ArrayListTimer->EVENTS_COMPARE[1] = 0;
+  ArrayListTimer->CC[0] = chunkCount - 1;
+  ArrayListTimer->CC[1] = chunkCount;
+  ArrayListTimer->TASKS_START = 1;
+
+  NRF_PPI->CHENSET = (1U << ArrayListChainPpiChannel) | (1U << ArrayListCountPpiChannel) | (1U << ArrayListStopPpiChannel);
+}
+
+void SpiMaster::DisableArrayList() {
+  NRF_PPI->CHENCLR = (1U << ArrayListChainPpiChannel) | (1U << ArrayListCountPpiChannel) | (1U << ArrayListStopPpiChannel);
+  ArrayListTimer->TASKS_STOP = 1;
+
+  spiBaseAddress->TXD.LIST = 0;
+  spiBaseAddress->EVENTS_END = 0;
+  spiBaseAddress->EVENTS_STARTED = 0;
+  spiBaseAddress->EVENTS_STOPPED = 0;
+  spiBaseAddress->INTENSET = (1 << 6);
+  spiBaseAddress->INTENSET = (1 << 1);
+  spiBaseAddress->INTENSET = (1 << 19);
+}
+
+void SpiMaster::OnArrayListEndEvent() {
+  DisableArrayList();
+  // Send the remaining bytes (if any) and continue the transaction
+  OnEndEvent();
+}
+
 void SpiMaster::OnEndEvent() {
-  if (currentBufferAddr == 0) {
+  if (phase == Phases::Idle) {
     return;
   }
 
-  auto s = currentBufferSize;
-  if (s > 0) {
-    auto currentSize = std::min((size_t) 255, s);
-    PrepareTx(currentBufferAddr, currentSize);
-    currentBufferAddr += currentSize;
-    currentBufferSize -= currentSize;
+#ifdef DEBUG
+  interruptCount++;
+  currentTransferInterruptCount++;
+#endif
 
-    spiBaseAddress->TASKS_START = 1;
-  } else {
-    BaseType_t xHigherPriorityTaskWoken = pdFALSE;
-    if (taskToNotify != nullptr) {
-      vTaskNotifyGiveFromISR(taskToNotify, &xHigherPriorityTaskWoken);
-      portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
-    }
+  if (currentBufferSize > 0) {
+    ContinuePhase();
+    return;
+  }
 
-    nrf_gpio_pin_set(this->pinCsn);
-    currentBufferAddr = 0;
-    BaseType_t xHigherPriorityTaskWoken2 = pdFALSE;
-    xSemaphoreGiveFromISR(mutex, &xHigherPriorityTaskWoken2);
-    portYIELD_FROM_ISR(xHigherPriorityTaskWoken | xHigherPriorityTaskWoken2);
+  switch (phase) {
+    case Phases::Command:
+      StartDataPhase();
+      break;
+    default:
+      CompleteTransaction();
+      break;
   }
 }
 
 void SpiMaster::OnStartedEvent() {
 }
 
-void SpiMaster::PrepareTx(const volatile uint32_t bufferAddress, const volatile size_t size) {
+void SpiMaster::PrepareTx(const volatile uintptr_t bufferAddress, const volatile size_t size) {
   spiBaseAddress->TXD.PTR = bufferAddress;
   spiBaseAddress->TXD.MAXCNT = size;
   spiBaseAddress->TXD.LIST = 0;
@@ -163,10 +251,7 @@ void SpiMaster::PrepareTx(const volatile uint32_t bufferAddress, const volatile
   spiBaseAddress->EVENTS_END = 0;
 }
 
-void SpiMaster::PrepareRx(const volatile uint32_t cmdAddress,
-                          const volatile size_t cmdSize,
-                          const volatile uint32_t bufferAddress,
-                          const volatile size_t size) {
+void SpiMaster::PrepareRx(const volatile uintptr_t bufferAddress, const volatile size_t size) {
   spiBaseAddress->TXD.PTR = 0;
   spiBaseAddress->TXD.MAXCNT = 0;
   spiBaseAddress->TXD.LIST = 0;
@@ -176,77 +261,202 @@ void SpiMaster::PrepareRx(const volatile uint32_t cmdAddress,
   spiBaseAddress->EVENTS_END = 0;
 }
 
-bool SpiMaster::Write(uint8_t pinCsn, const uint8_t* data, size_t size) {
-  if (data == nullptr)
+bool SpiMaster::Submit(const Transaction& transaction) {
+  if (transaction.pinCsn == NoPin || transaction.commandSize > MaxCommandSize) {
+    return false;
+  }
+  if (transaction.txSize > 0 && transaction.rxSize > 0) {
+    return false;
+  }
+  if (transaction.commandSize == 0 && transaction.txSize == 0 && transaction.rxSize == 0) {
     return false;
-  auto ok = xSemaphoreTake(mutex, portMAX_DELAY);
+  }
+  if ((transaction.txSize > 0 && transaction.txData == nullptr) || (transaction.rxSize > 0 && transaction.rxData == nullptr)) {
+    return false;
+  }
+
+  auto ok = xSemaphoreTake(freeSlots, portMAX_DELAY);
   ASSERT(ok == true);
-  taskToNotify = xTaskGetCurrentTaskHandle();
 
-  this->pinCsn = pinCsn;
+  taskENTER_CRITICAL();
+  auto slot = (queueHead + queueCount) % QueueSize;
+  queue[slot] = transaction;
+  tasksToNotify[slot] = xTaskGetCurrentTaskHandle();
+  queueCount++;
+  if (phase == Phases::Idle) {
+    StartTransaction();
+  }
+  taskEXIT_CRITICAL();
 
-  if (size == 1) {
-    SetupWorkaroundForFtpan58(spiBaseAddress, 0, 0);
+  return true;
+}
+
+bool SpiMaster::Transfer(Transaction transaction) {
+  volatile bool done = false;
+  transaction.completeHook = [&done]() {
+    done = true;
+  };
+
+  if (!Submit(transaction)) {
+    return false;
+  }
+
+  // The SPI driver notifies the task when its transactions are done. The notification
+  // may also come from a previous asynchronous transaction, so check that this one is done.
+  while (!done) {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+  }
+  return true;
+}
+
+void SpiMaster::StartTransaction() {
+  const auto& transaction = queue[queueHead];
+#ifdef DEBUG
+  transferCount++;
+  currentTransferInterruptCount = 0;
+#endif
+
+  nrf_gpio_pin_clear(transaction.pinCsn);
+
+  if (transaction.commandSize > 0) {
+    if (transaction.pinDataCommand != NoPin) {
+      nrf_gpio_pin_clear(transaction.pinDataCommand);
+    }
+    phase = Phases::Command;
+    currentBufferAddr = (uintptr_t) transaction.command.data();
+    currentBufferSize = transaction.commandSize;
+    ContinuePhase();
   } else {
-    DisableWorkaroundForFtpan58(spiBaseAddress, 0, 0);
+    StartDataPhase();
   }
+}
 
-  nrf_gpio_pin_clear(this->pinCsn);
+void SpiMaster::StartDataPhase() {
+  const auto& transaction = queue[queueHead];
 
-  currentBufferAddr = (uint32_t) data;
-  currentBufferSize = size;
+  if (transaction.txSize > 0) {
+    if (transaction.pinDataCommand != NoPin) {
+      nrf_gpio_pin_set(transaction.pinDataCommand);
+    }
+    phase = Phases::Transmit;
+    currentBufferAddr = (uintptr_t) transaction.txData;
+    currentBufferSize = transaction.txSize;
+    ContinuePhase();
+  } else if (transaction.rxSize > 0) {
+    phase = Phases::Receive;
+    currentBufferAddr = (uintptr_t) transaction.rxData;
+    currentBufferSize = transaction.rxSize;
+    ContinuePhase();
+  } else {
+    CompleteTransaction();
+  }
+}
 
-  auto currentSize = std::min((size_t) 255, (size_t) currentBufferSize);
-  PrepareTx(currentBufferAddr, currentSize);
-  currentBufferSize -= currentSize;
-  currentBufferAddr += currentSize;
-  spiBaseAddress->TASKS_START = 1;
+void SpiMaster::ContinuePhase() {
+  auto size = currentBufferSize;
+  auto address = currentBufferAddr;
+
+  if (phase == Phases::Receive) {
+    auto currentSize = std::min(MaxDmaTransferSize, size);
+    PrepareRx(address, currentSize);
+    currentBufferAddr = address + currentSize;
+    currentBufferSize = size - currentSize;
+    spiBaseAddress->TASKS_START = 1;
+    return;
+  }
 
   if (size == 1) {
+    // The END event is left pending by DisableWorkaroundForFtpan58(), the interrupt handler continues from there.
+    SetupWorkaroundForFtpan58(spiBaseAddress, 0, 0);
+    PrepareTx(address, 1);
+    currentBufferAddr = address + 1;
+    currentBufferSize = 0;
+    spiBaseAddress->TASKS_START = 1;
     while (spiBaseAddress->EVENTS_END == 0)
       ;
-    nrf_gpio_pin_set(this->pinCsn);
-    currentBufferAddr = 0;
-    xSemaphoreGive(mutex);
+    DisableWorkaroundForFtpan58(spiBaseAddress, 0, 0);
+    return;
   }
 
-  return true;
+  const size_t chunkSize = size > MaxDmaTransferSize ? ArrayListChunkSize(size) : size;
+  const size_t chunkCount = size / chunkSize;
+  if (chunkCount >= 2) {
+    PrepareTxArrayList(address, chunkSize, chunkCount);
+    currentBufferAddr = address + chunkSize * chunkCount;
+    currentBufferSize = size - chunkSize * chunkCount;
+  } else {
+    // A single chunk cannot be sent as an ArrayList (the chain would never be stopped): the rest of the buffer is
+    // sent from the interrupt handler
+    auto currentSize = std::min(MaxDmaTransferSize, size);
+    PrepareTx(address, currentSize);
+    currentBufferAddr = address + currentSize;
+    currentBufferSize = size - currentSize;
+  }
+  spiBaseAddress->TASKS_START = 1;
 }
 
-bool SpiMaster::Read(uint8_t pinCsn, uint8_t* cmd, size_t cmdSize, uint8_t* data, size_t dataSize) {
-  xSemaphoreTake(mutex, portMAX_DELAY);
+void SpiMaster::CompleteTransaction() {
+  auto& transaction = queue[queueHead];
+  nrf_gpio_pin_set(transaction.pinCsn);
 
-  taskToNotify = nullptr;
+  if (transaction.completeHook != nullptr) {
+    transaction.completeHook();
+    transaction.completeHook = nullptr;
+  }
 
-  this->pinCsn = pinCsn;
-  DisableWorkaroundForFtpan58(spiBaseAddress, 0, 0);
-  spiBaseAddress->INTENCLR = (1 << 6);
-  spiBaseAddress->INTENCLR = (1 << 1);
-  spiBaseAddress->INTENCLR = (1 << 19);
+  BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+  if (tasksToNotify[queueHead] != nullptr) {
+    vTaskNotifyGiveFromISR(tasksToNotify[queueHead], &xHigherPriorityTaskWoken);
+  }
 
-  nrf_gpio_pin_clear(this->pinCsn);
+#ifdef DEBUG
+  lastTransferInterruptCount = currentTransferInterruptCount;
+#endif
 
-  currentBufferAddr = 0;
-  currentBufferSize = 0;
+  queueHead = (queueHead + 1) % QueueSize;
+  queueCount--;
+  phase = Phases::Idle;
+  BaseType_t xHigherPriorityTaskWoken2 = pdFALSE;
+  xSemaphoreGiveFromISR(freeSlots, &xHigherPriorityTaskWoken2);
 
-  PrepareTx((uint32_t) cmd, cmdSize);
-  spiBaseAddress->TASKS_START = 1;
-  while (spiBaseAddress->EVENTS_END == 0)
-    ;
+  // Execute the next transaction right away, without going back to the tasks
+  if (queueCount > 0) {
+    StartTransaction();
+  }
 
-  PrepareRx((uint32_t) cmd, cmdSize, (uint32_t) data, dataSize);
-  spiBaseAddress->TASKS_START = 1;
+  portYIELD_FROM_ISR(xHigherPriorityTaskWoken | xHigherPriorityTaskWoken2);
+}
+
+bool SpiMaster::Write(uint8_t pinCsn, const uint8_t* data, size_t size) {
+  if (data == nullptr)
+    return false;
 
-  while (spiBaseAddress->EVENTS_END == 0)
-    ;
-  nrf_gpio_pin_set(this->pinCsn);
+  Transaction transaction;
+  transaction.pinCsn = pinCsn;
+  transaction.txData = data;
+  transaction.txSize = size;
+  return Transfer(transaction);
+}
 
-  xSemaphoreGive(mutex);
+bool SpiMaster::Read(uint8_t pinCsn, uint8_t* cmd, size_t cmdSize, uint8_t* data, size_t dataSize) {
+  if (cmdSize > MaxCommandSize)
+    return false;
 
-  return true;
+  Transaction transaction;
+  transaction.pinCsn = pinCsn;
+  std::copy(cmd, cmd + cmdSize, transaction.command.begin());
+  transaction.commandSize = cmdSize;
+  transaction.rxData = data;
+  transaction.rxSize = dataSize;
+  return Transfer(transaction);
 }
 
 void SpiMaster::Sleep() {
+  // Let the queued transactions complete before disabling the SPIM
+  while (queueCount > 0) {
+    vTaskDelay(1);
+  }
+
   while (spiBaseAddress->ENABLE != 0) {
     spiBaseAddress->ENABLE = (SPIM_ENABLE_ENABLE_Disabled << SPIM_ENABLE_ENABLE_Pos);
   }
@@ -263,34 +473,14 @@ void SpiMaster::Wakeup() {
 }
 
 bool SpiMaster::WriteCmdAndBuffer(uint8_t pinCsn, const uint8_t* cmd, size_t cmdSize, const uint8_t* data, size_t dataSize) {
-  xSemaphoreTake(mutex, portMAX_DELAY);
-
-  taskToNotify = nullptr;
-
-  this->pinCsn = pinCsn;
-  DisableWorkaroundForFtpan58(spiBaseAddress, 0, 0);
-  spiBaseAddress->INTENCLR = (1 << 6);
-  spiBaseAddress->INTENCLR = (1 << 1);
-  spiBaseAddress->INTENCLR = (1 << 19);
-
-  nrf_gpio_pin_clear(this->pinCsn);
-
-  currentBufferAddr = 0;
-  currentBufferSize = 0;
-
-  PrepareTx((uint32_t) cmd, cmdSize);
-  spiBaseAddress->TASKS_START = 1;
-  while (spiBaseAddress->EVENTS_END == 0)
-    ;
-
-  PrepareTx((uint32_t) data, dataSize);
-  spiBaseAddress->TASKS_START = 1;
-
-  while (spiBaseAddress->EVENTS_END == 0)
-    ;
-  nrf_gpio_pin_set(this->pinCsn);
-
-  xSemaphoreGive(mutex);
+  if (cmdSize > MaxCommandSize)
+    return false;
 
-  return true;
+  Transaction transaction;
+  transaction.pinCsn = pinCsn;
+  std::copy(cmd, cmd + cmdSize, transaction.command.begin());
+  transaction.commandSize = cmdSize;
+  transaction.txData = data;
+  transaction.txSize = dataSize;
+  return Transfer(transaction);
 }
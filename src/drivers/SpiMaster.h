@@ -1,6 +1,8 @@
 #pragma once
+#include <array>
 #include <cstddef>
 #include <cstdint>
+#include <functional>
 
 #include <FreeRTOS.h>
 #include <semphr.h>
@@ -23,6 +25,26 @@ namespace Pinetime {
         uint8_t pinMISO;
       };
 
+      static constexpr uint8_t NoPin = 0xff;
+      static constexpr size_t MaxCommandSize = 4;
+
+      // The CS pin is held low during the whole transaction. The command bytes are sent first
+      // (with the data/command pin low, if any), then txData is sent (with the data/command pin high)
+      // or rxData is received. The command bytes are copied into the queue, the data buffers are not.
+      struct Transaction {
+        uint8_t pinCsn = NoPin;
+        uint8_t pinDataCommand = NoPin;
+        std::array<uint8_t, MaxCommandSize> command {};
+        uint8_t commandSize = 0;
+        const uint8_t* txData = nullptr;
+        size_t txSize = 0;
+        uint8_t* rxData = nullptr;
+        size_t rxSize = 0;
+        // Called from the SPI interrupt handler when the transaction is done.
+        // It is stored in the queue: keep the captures small (a pointer) so that it does not allocate.
+        std::function<void()> completeHook;
+      };
+
       SpiMaster(const SpiModule spi, const Parameters& params);
       SpiMaster(const SpiMaster&) = delete;
       SpiMaster& operator=(const SpiMaster&) = delete;
@@ -30,6 +52,14 @@ namespace Pinetime {
       SpiMaster& operator=(SpiMaster&&) = delete;
 
       bool Init();
+
+      // Queues the transaction and returns immediately. Transactions are executed back-to-back from the
+      // interrupt handler, in the order they were submitted. The data buffers must remain valid until
+      // completeHook is called. The calling task is notified (xTaskNotifyGive) when the transaction is done.
+      bool Submit(const Transaction& transaction);
+      // Queues the transaction and blocks the calling task until it is done (completeHook is not used).
+      bool Transfer(Transaction transaction);
+
       bool Write(uint8_t pinCsn, const uint8_t* data, size_t size);
       bool Read(uint8_t pinCsn, uint8_t* cmd, size_t cmdSize, uint8_t* data, size_t dataSize);
 
@@ -37,29 +67,63 @@ namespace Pinetime {
 
       void OnStartedEvent();
       void OnEndEvent();
+      void OnArrayListEndEvent();
+
+#ifdef DEBUG
+      struct Statistics {
+        uint32_t transfers;
+        uint32_t interrupts;
+        uint32_t lastTransferInterrupts;
+      };
+
+      Statistics GetStatistics() const {
+        return {transferCount, interruptCount, lastTransferInterruptCount};
+      }
+#endif
 
       void Sleep();
       void Wakeup();
 
     private:
+      static constexpr uint8_t QueueSize = 8;
+      enum class Phases : uint8_t { Idle, Command, Transmit, Receive };
+
       void SetupWorkaroundForFtpan58(NRF_SPIM_Type* spim, uint32_t ppi_channel, uint32_t gpiote_channel);
       void DisableWorkaroundForFtpan58(NRF_SPIM_Type* spim, uint32_t ppi_channel, uint32_t gpiote_channel);
-      void PrepareTx(const volatile uint32_t bufferAddress, const volatile size_t size);
-      void PrepareRx(const volatile uint32_t cmdAddress,
-                     const volatile size_t cmdSize,
-                     const volatile uint32_t bufferAddress,
-                     const volatile size_t size);
+      void PrepareTx(const volatile uintptr_t bufferAddress, const volatile size_t size);
+      void PrepareRx(const volatile uintptr_t bufferAddress, const volatile size_t size);
+      void SetupArrayList(NRF_SPIM_Type* spim);
+      void PrepareTxArrayList(const volatile uintptr_t bufferAddress, const size_t chunkSize, const size_t chunkCount);
+      void DisableArrayList();
+      static size_t ArrayListChunkSize(size_t size);
+
+      // Called from the interrupt handler, or from Submit() in a critical section
+      void StartTransaction();
+      void StartDataPhase();
+      void ContinuePhase();
+      void CompleteTransaction();
 
       NRF_SPIM_Type* spiBaseAddress;
-      uint8_t pinCsn;
 
       SpiMaster::SpiModule spi;
       SpiMaster::Parameters params;
 
-      volatile uint32_t currentBufferAddr = 0;
+      std::array<Transaction, QueueSize> queue;
+      std::array<TaskHandle_t, QueueSize> tasksToNotify;
+      volatile uint8_t queueHead = 0;
+      volatile uint8_t queueCount = 0;
+      volatile Phases phase = Phases::Idle;
+      SemaphoreHandle_t freeSlots = nullptr;
+
+      volatile uintptr_t currentBufferAddr = 0;
       volatile size_t currentBufferSize = 0;
-      volatile TaskHandle_t taskToNotify;
-      SemaphoreHandle_t mutex = nullptr;
+
+#ifdef DEBUG
+      volatile uint32_t transferCount = 0;
+      volatile uint32_t interruptCount = 0;
+      volatile uint32_t currentTransferInterruptCount = 0;
+      volatile uint32_t lastTransferInterruptCount = 0;
+#endif
     };
   }
 }
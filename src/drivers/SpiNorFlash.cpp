@@ -10,6 +10,16 @@ SpiNorFlash::SpiNorFlash(Spi& spi) : spi {spi} {
 }
 
 void SpiNorFlash::Init() {
+  if (mutex == nullptr) {
+    mutex = xSemaphoreCreateBinary();
+    xSemaphoreGive(mutex);
+  }
+
+  // The cycle counter times the page programs (WaitEndOfPageProgram()). It only runs by default when a debugger is
+  // attached.
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+  DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
   device_id = ReadIdentificaion();
   NRF_LOG_INFO("[SpiNorFlash] Manufacturer : %d, Memory type : %d, memory density : %d",
                device_id.manufacturer,
@@ -22,7 +32,9 @@ void SpiNorFlash::Uninit() {
 
 void SpiNorFlash::Sleep() {
   auto cmd = static_cast<uint8_t>(Commands::DeepPowerDown);
+  xSemaphoreTake(mutex, portMAX_DELAY);
   spi.Write(&cmd, sizeof(uint8_t));
+  xSemaphoreGive(mutex);
   NRF_LOG_INFO("[SpiNorFlash] Sleep")
 }
 
@@ -31,8 +43,10 @@ void SpiNorFlash::Wakeup() {
   static constexpr uint8_t cmdSize = 4;
   uint8_t cmd[cmdSize] = {static_cast<uint8_t>(Commands::ReleaseFromDeepPowerDown), 0x01, 0x02, 0x03};
   uint8_t id = 0;
+  xSemaphoreTake(mutex, portMAX_DELAY);
   spi.Read(reinterpret_cast<uint8_t*>(&cmd), cmdSize, &id, 1);
-  auto devId = device_id = ReadIdentificaion();
+  auto devId = device_id = ReadIdentification();
+  xSemaphoreGive(mutex);
   if (devId.type != device_id.type) {
     NRF_LOG_INFO("[SpiNorFlash] ID on Wakeup: Failed");
   } else {
@@ -42,6 +56,13 @@ void SpiNorFlash::Wakeup() {
 }
 
 SpiNorFlash::Identification SpiNorFlash::ReadIdentificaion() {
+  xSemaphoreTake(mutex, portMAX_DELAY);
+  auto identification = ReadIdentification();
+  xSemaphoreGive(mutex);
+  return identification;
+}
+
+SpiNorFlash::Identification SpiNorFlash::ReadIdentification() {
   auto cmd = static_cast<uint8_t>(Commands::ReadIdentification);
   Identification identification;
   spi.Read(&cmd, 1, reinterpret_cast<uint8_t*>(&identification), sizeof(Identification));
@@ -49,25 +70,36 @@ SpiNorFlash::Identification SpiNorFlash::ReadIdentificaion() {
 }
 
 uint8_t SpiNorFlash::ReadStatusRegister() {
-  auto cmd = static_cast<uint8_t>(Commands::ReadStatusRegister);
-  uint8_t status;
-  spi.Read(&cmd, sizeof(cmd), &status, sizeof(uint8_t));
+  xSemaphoreTake(mutex, portMAX_DELAY);
+  auto status = ReadRegister(Commands::ReadStatusRegister);
+  xSemaphoreGive(mutex);
   return status;
 }
 
 bool SpiNorFlash::WriteInProgress() {
-  return (ReadStatusRegister() & 0x01u) == 0x01u;
+  return (ReadStatusRegister() & statusWriteInProgress) == statusWriteInProgress;
 }
 
 bool SpiNorFlash::WriteEnabled() {
-  return (ReadStatusRegister() & 0x02u) == 0x02u;
+  return (ReadStatusRegister() & statusWriteEnabled) == statusWriteEnabled;
 }
 
 uint8_t SpiNorFlash::ReadConfigurationRegister() {
-  auto cmd = static_cast<uint8_t>(Commands::ReadConfigurationRegister);
-  uint8_t status;
-  spi.Read(&cmd, sizeof(cmd), &status, sizeof(uint8_t));
-  return status;
+  xSemaphoreTake(mutex, portMAX_DELAY);
+  auto configuration = ReadRegister(Commands::ReadConfigurationRegister);
+  xSemaphoreGive(mutex);
+  return configuration;
+}
+
+uint8_t SpiNorFlash::ReadRegister(Commands command) {
+  auto cmd = static_cast<uint8_t>(command);
+  uint8_t value;
+  spi.Read(&cmd, sizeof(cmd), &value, sizeof(uint8_t));
+  return value;
+}
+
+bool SpiNorFlash::Busy() {
+  return (ReadRegister(Commands::ReadStatusRegister) & statusWriteInProgress) == statusWriteInProgress;
 }
 
 void SpiNorFlash::Read(uint32_t address, uint8_t* buffer, size_t size) {
@@ -76,36 +108,99 @@ void SpiNorFlash::Read(uint32_t address, uint8_t* buffer, size_t size) {
                           static_cast<uint8_t>(address >> 16U),
                           static_cast<uint8_t>(address >> 8U),
                           static_cast<uint8_t>(address)};
+
+  xSemaphoreTake(mutex, portMAX_DELAY);
+  // The memory cannot be read while it is being erased: suspend the erase operation during the read
+  const bool suspended = eraseInProgress;
+  if (suspended) {
+    // The erase must run for a while after it was started or resumed before it can be suspended again (tRS), and
+    // back-to-back reads would otherwise prevent it from making progress
+    const uint32_t eraseTime = (DWT->CYCCNT - eraseResumeCycleCount) / cyclesPerMicrosecond;
+    if (eraseTime < minEraseTimeBeforeSuspend) {
+      nrf_delay_us(minEraseTimeBeforeSuspend - eraseTime);
+    }
+
+    SendCommand(Commands::EraseSuspend);
+    while (Busy()) {
+      // The suspend latency is a few tens of µs
+    }
+  }
+
   spi.Read(reinterpret_cast<uint8_t*>(&cmd), cmdSize, buffer, size);
+
+  if (suspended) {
+    SendCommand(Commands::EraseResume);
+    eraseResumeCycleCount = DWT->CYCCNT;
+  }
+  xSemaphoreGive(mutex);
 }
 
 void SpiNorFlash::WriteEnable() {
-  auto cmd = static_cast<uint8_t>(Commands::WriteEnable);
+  xSemaphoreTake(mutex, portMAX_DELAY);
+  SendCommand(Commands::WriteEnable);
+  xSemaphoreGive(mutex);
+}
+
+void SpiNorFlash::SendCommand(Commands command) {
+  auto cmd = static_cast<uint8_t>(command);
   spi.Read(&cmd, sizeof(cmd), nullptr, 0);
 }
 
 void SpiNorFlash::SectorErase(uint32_t sectorAddress) {
+  Erase(Commands::SectorErase, sectorAddress);
+}
+
+void SpiNorFlash::Erase(uint32_t address, size_t size) {
+  uint32_t end = address + size;
+  while (address < end) {
+    if ((address % blockSize64KB) == 0 && (end - address) >= blockSize64KB) {
+      Erase(Commands::BlockErase64KB, address);
+      address += blockSize64KB;
+    } else if ((address % blockSize32KB) == 0 && (end - address) >= blockSize32KB) {
+      Erase(Commands::BlockErase32KB, address);
+      address += blockSize32KB;
+    } else {
+      Erase(Commands::SectorErase, address);
+      address += sectorSize;
+    }
+  }
+}
+
+void SpiNorFlash::Erase(Commands command, uint32_t address) {
   static constexpr uint8_t cmdSize = 4;
-  uint8_t cmd[cmdSize] = {static_cast<uint8_t>(Commands::SectorErase),
-                          static_cast<uint8_t>(sectorAddress >> 16U),
-                          static_cast<uint8_t>(sectorAddress >> 8U),
-                          static_cast<uint8_t>(sectorAddress)};
+  uint8_t cmd[cmdSize] = {static_cast<uint8_t>(command),
+                          static_cast<uint8_t>(address >> 16U),
+                          static_cast<uint8_t>(address >> 8U),
+                          static_cast<uint8_t>(address)};
 
-  WriteEnable();
-  while (!WriteEnabled())
+  xSemaphoreTake(mutex, portMAX_DELAY);
+  SendCommand(Commands::WriteEnable);
+  while ((ReadRegister(Commands::ReadStatusRegister) & statusWriteEnabled) != statusWriteEnabled) {
+    xSemaphoreGive(mutex);
     vTaskDelay(1);
+    xSemaphoreTake(mutex, portMAX_DELAY);
+  }
 
   spi.Read(reinterpret_cast<uint8_t*>(&cmd), cmdSize, nullptr, 0);
+  eraseInProgress = true;
+  eraseResumeCycleCount = DWT->CYCCNT;
+  xSemaphoreGive(mutex);
 
-  while (WriteInProgress())
+  bool done = false;
+  while (!done) {
     vTaskDelay(1);
+    xSemaphoreTake(mutex, portMAX_DELAY);
+    done = !Busy();
+    eraseInProgress = !done;
+    xSemaphoreGive(mutex);
+  }
 }
 
 uint8_t SpiNorFlash::ReadSecurityRegister() {
-  auto cmd = static_cast<uint8_t>(Commands::ReadSecurityRegister);
-  uint8_t status;
-  spi.Read(&cmd, sizeof(cmd), &status, sizeof(uint8_t));
-  return status;
+  xSemaphoreTake(mutex, portMAX_DELAY);
+  auto security = ReadRegister(Commands::ReadSecurityRegister);
+  xSemaphoreGive(mutex);
+  return security;
 }
 
 bool SpiNorFlash::ProgramFailed() {
@@ -117,8 +212,15 @@ bool SpiNorFlash::EraseFailed() {
 }
 
 void SpiNorFlash::Write(uint32_t address, const uint8_t* buffer, size_t size) {
-  static constexpr uint8_t cmdSize = 4;
+  // Programming is not possible while an erase operation is running
+  xSemaphoreTake(mutex, portMAX_DELAY);
+  while (eraseInProgress) {
+    xSemaphoreGive(mutex);
+    vTaskDelay(1);
+    xSemaphoreTake(mutex, portMAX_DELAY);
+  }
 
+  const uint32_t startCycleCount = DWT->CYCCNT;
   size_t len = size;
   uint32_t addr = address;
   const uint8_t* b = buffer;
@@ -126,22 +228,47 @@ void SpiNorFlash::Write(uint32_t address, const uint8_t* buffer, size_t size) {
     uint32_t pageLimit = (addr & ~(pageSize - 1u)) + pageSize;
     uint32_t toWrite = pageLimit - addr > len ? len : pageLimit - addr;
 
-    uint8_t cmd[cmdSize] = {static_cast<uint8_t>(Commands::PageProgram),
-                            static_cast<uint8_t>(addr >> 16U),
-                            static_cast<uint8_t>(addr >> 8U),
-                            static_cast<uint8_t>(addr)};
+    // Write Enable and Page Program are queued back-to-back, the task only waits for the end of the latter
+    SpiMaster::Transaction writeEnable;
+    writeEnable.command[0] = static_cast<uint8_t>(Commands::WriteEnable);
+    writeEnable.commandSize = 1;
+    spi.Submit(writeEnable);
 
-    WriteEnable();
-    while (!WriteEnabled())
-      vTaskDelay(1);
+    SpiMaster::Transaction pageProgram;
+    pageProgram.command = {static_cast<uint8_t>(Commands::PageProgram),
+                           static_cast<uint8_t>(addr >> 16U),
+                           static_cast<uint8_t>(addr >> 8U),
+                           static_cast<uint8_t>(addr)};
+    pageProgram.commandSize = 4;
+    pageProgram.txData = b;
+    pageProgram.txSize = toWrite;
+    spi.Transfer(pageProgram);
 
-    spi.WriteCmdAndBuffer(cmd, cmdSize, b, toWrite);
-
-    while (WriteInProgress())
-      vTaskDelay(1);
+    WaitEndOfPageProgram();
 
     addr += toWrite;
     b += toWrite;
     len -= toWrite;
+    writeStatistics.pages++;
+  }
+  writeStatistics.bytes += size;
+  writeStatistics.time += (DWT->CYCCNT - startCycleCount) / cyclesPerMicrosecond;
+  xSemaphoreGive(mutex);
+}
+
+void SpiNorFlash::WaitEndOfPageProgram() {
+  static constexpr uint32_t maxPollingTime = 3000; // µs
+  const uint32_t startCycleCount = DWT->CYCCNT;
+
+  // A page program takes less than a tick: busy-wait for most of the estimated program time, then poll the
+  // status register. Only yield to the other tasks if the program takes much longer than expected.
+  nrf_delay_us(pageProgramTime * 3 / 4);
+  while (Busy()) {
+    if ((DWT->CYCCNT - startCycleCount) / cyclesPerMicrosecond > maxPollingTime) {
+      vTaskDelay(1);
+    }
   }
+
+  const uint32_t elapsed = (DWT->CYCCNT - startCycleCount) / cyclesPerMicrosecond;
+  pageProgramTime = (pageProgramTime * 7 + elapsed) / 8;
 }
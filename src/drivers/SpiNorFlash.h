@@ -1,4 +1,6 @@
 #pragma once
+#include <FreeRTOS.h>
+#include <semphr.h>
 #include <cstddef>
 #include <cstdint>
 
@@ -28,10 +30,23 @@ namespace Pinetime {
       void Write(uint32_t address, const uint8_t* buffer, size_t size);
       void WriteEnable();
       void SectorErase(uint32_t sectorAddress);
+      // Erases the sectors in [address, address + size[ using the largest block erase commands possible.
+      // address and size must be multiples of the sector size.
+      void Erase(uint32_t address, size_t size);
       uint8_t ReadSecurityRegister();
       bool ProgramFailed();
       bool EraseFailed();
 
+      struct WriteStatistics {
+        uint32_t bytes = 0;
+        uint32_t pages = 0;
+        uint32_t time = 0; // µs spent in Write()
+      };
+
+      const WriteStatistics& GetWriteStatistics() const {
+        return writeStatistics;
+      }
+
       void Init();
       void Uninit();
 
@@ -47,14 +62,44 @@ namespace Pinetime {
         ReadConfigurationRegister = 0x15,
         SectorErase = 0x20,
         ReadSecurityRegister = 0x2B,
+        BlockErase32KB = 0x52,
+        EraseSuspend = 0x75,
+        EraseResume = 0x7A,
         ReadIdentification = 0x9F,
         ReleaseFromDeepPowerDown = 0xAB,
-        DeepPowerDown = 0xB9
+        DeepPowerDown = 0xB9,
+        BlockErase64KB = 0xD8
       };
+      static constexpr uint8_t statusWriteInProgress = 0x01;
+      static constexpr uint8_t statusWriteEnabled = 0x02;
       static constexpr uint16_t pageSize = 256;
+      static constexpr uint32_t sectorSize = 0x1000;
+      static constexpr uint32_t blockSize32KB = 0x8000;
+      static constexpr uint32_t blockSize64KB = 0x10000;
+
+      // The private accessors expect the mutex to be held
+      Identification ReadIdentification();
+      uint8_t ReadRegister(Commands command);
+      void SendCommand(Commands command);
+      bool Busy();
+      void Erase(Commands command, uint32_t address);
+      void WaitEndOfPageProgram();
+
+      static constexpr uint32_t cyclesPerMicrosecond = 64;
+      uint32_t pageProgramTime = 500; // µs, moving average of the previous page programs
+      WriteStatistics writeStatistics;
 
       Spi& spi;
       Identification device_id;
+
+      // Held during each access to the memory. It is released while waiting for the end of an erase
+      // operation, so that Read() can suspend the erase and read the memory in the meantime.
+      SemaphoreHandle_t mutex = nullptr;
+      bool eraseInProgress = false;
+      // Minimum time between the start or the resume of an erase and its suspension. It covers the resume to suspend
+      // latency of the memory (tRS, 100 µs) and guarantees that the erase progresses between two reads.
+      static constexpr uint32_t minEraseTimeBeforeSuspend = 500; // µs
+      uint32_t eraseResumeCycleCount = 0;
     };
   }
 }
@@ -31,17 +31,30 @@ void St7789::Init() {
 }
 
 void St7789::WriteCommand(uint8_t cmd) {
-  nrf_gpio_pin_clear(pinDataCommand);
-  WriteSpi(&cmd, 1);
+  WriteCommand(cmd, nullptr, 0);
 }
 
-void St7789::WriteData(uint8_t data) {
-  nrf_gpio_pin_set(pinDataCommand);
-  WriteSpi(&data, 1);
+void St7789::WriteCommand(uint8_t cmd, const uint8_t* data, size_t size) {
+  // Any other command may move the RAM address pointer
+  addressWindowValid = false;
+
+  SpiMaster::Transaction transaction;
+  transaction.pinDataCommand = pinDataCommand;
+  transaction.command[0] = cmd;
+  transaction.commandSize = 1;
+  transaction.txData = data;
+  transaction.txSize = size;
+  spi.Transfer(transaction);
 }
 
-void St7789::WriteSpi(const uint8_t* data, size_t size) {
-  spi.Write(data, size);
+void St7789::WriteData(uint8_t data) {
+  addressWindowValid = false;
+
+  SpiMaster::Transaction transaction;
+  transaction.pinDataCommand = pinDataCommand;
+  transaction.txData = &data;
+  transaction.txSize = 1;
+  spi.Transfer(transaction);
 }
 
 void St7789::SoftwareReset() {
@@ -110,23 +123,29 @@ void St7789::DisplayOn() {
 }
 
 void St7789::SetAddrWindow(uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1) {
-  WriteCommand(static_cast<uint8_t>(Commands::ColumnAddressSet));
-  WriteData(x0 >> 8);
-  WriteData(x0 & 0xff);
-  WriteData(x1 >> 8);
-  WriteData(x1 & 0xff);
+  uint8_t columns[4] = {static_cast<uint8_t>(x0 >> 8),
+                        static_cast<uint8_t>(x0 & 0xff),
+                        static_cast<uint8_t>(x1 >> 8),
+                        static_cast<uint8_t>(x1 & 0xff)};
+  WriteCommand(static_cast<uint8_t>(Commands::ColumnAddressSet), columns, sizeof(columns));
 
-  WriteCommand(static_cast<uint8_t>(Commands::RowAddressSet));
-  WriteData(y0 >> 8);
-  WriteData(y0 & 0xff);
-  WriteData(y1 >> 8);
-  WriteData(y1 & 0xff);
+  uint8_t rows[4] = {static_cast<uint8_t>(y0 >> 8),
+                     static_cast<uint8_t>(y0 & 0xff),
+                     static_cast<uint8_t>(y1 >> 8),
+                     static_cast<uint8_t>(y1 & 0xff)};
+  WriteCommand(static_cast<uint8_t>(Commands::RowAddressSet), rows, sizeof(rows));
 
-  WriteToRam();
+  addressWindowCount++;
 }
 
-void St7789::WriteToRam() {
-  WriteCommand(static_cast<uint8_t>(Commands::WriteToRam));
+SpiMaster::Transaction St7789::WriteToRam(const uint8_t* data, size_t size, bool continueWrite) {
+  SpiMaster::Transaction transaction;
+  transaction.pinDataCommand = pinDataCommand;
+  transaction.command[0] = static_cast<uint8_t>(continueWrite ? Commands::WriteMemoryContinue : Commands::WriteToRam);
+  transaction.commandSize = 1;
+  transaction.txData = data;
+  transaction.txSize = size;
+  return transaction;
 }
 
 void St7789::SetVdv() {
@@ -142,20 +161,19 @@ void St7789::DisplayOff() {
 }
 
 void St7789::VerticalScrollDefinition(uint16_t topFixedLines, uint16_t scrollLines, uint16_t bottomFixedLines) {
-  WriteCommand(static_cast<uint8_t>(Commands::VerticalScrollDefinition));
-  WriteData(topFixedLines >> 8u);
-  WriteData(topFixedLines & 0x00ffu);
-  WriteData(scrollLines >> 8u);
-  WriteData(scrollLines & 0x00ffu);
-  WriteData(bottomFixedLines >> 8u);
-  WriteData(bottomFixedLines & 0x00ffu);
+  uint8_t data[6] = {static_cast<uint8_t>(topFixedLines >> 8u),
+                     static_cast<uint8_t>(topFixedLines & 0x00ffu),
+                     static_cast<uint8_t>(scrollLines >> 8u),
+                     static_cast<uint8_t>(scrollLines & 0x00ffu),
+                     static_cast<uint8_t>(bottomFixedLines >> 8u),
+                     static_cast<uint8_t>(bottomFixedLines & 0x00ffu)};
+  WriteCommand(static_cast<uint8_t>(Commands::VerticalScrollDefinition), data, sizeof(data));
 }
 
 void St7789::VerticalScrollStartAddress(uint16_t line) {
   verticalScrollingStartAddress = line;
-  WriteCommand(static_cast<uint8_t>(Commands::VerticalScrollStartAddress));
-  WriteData(line >> 8u);
-  WriteData(line & 0x00ffu);
+  uint8_t data[2] = {static_cast<uint8_t>(line >> 8u), static_cast<uint8_t>(line & 0x00ffu)};
+  WriteCommand(static_cast<uint8_t>(Commands::VerticalScrollStartAddress), data, sizeof(data));
 }
 
 void St7789::Uninit() {
@@ -167,15 +185,35 @@ void St7789::DrawPixel(uint16_t x, uint16_t y, uint32_t color) {
   }
 
   SetAddrWindow(x, y, x + 1, y + 1);
+  spi.Transfer(WriteToRam(reinterpret_cast<const uint8_t*>(&color), 2, false));
+  addressWindowValid = false;
+}
+
+void St7789::DrawBuffer(uint16_t x,
+                        uint16_t y,
+                        uint16_t width,
+                        uint16_t height,
+                        const uint8_t* data,
+                        size_t size,
+                        const std::function<void()>& transferCompleteHook) {
+  // LVGL sends each area in several parts of a few lines. When a buffer directly follows the previous one
+  // (same columns, next rows), the RAM address pointer of the controller is already at the right position:
+  // the address window is not set again and the data is sent with 'Memory Write Continue'.
+  // The window is always opened down to the last line of the RAM to allow this.
+  const uint16_t x1 = x + width - 1;
+  const bool continueWrite = addressWindowValid && x == addressWindowX0 && x1 == addressWindowX1 && y == addressWindowNextLine;
+  if (!continueWrite) {
+    SetAddrWindow(x, y, x1, Height - 1);
+    addressWindowX0 = x;
+    addressWindowX1 = x1;
+  }
+  addressWindowNextLine = y + height;
+  addressWindowValid = addressWindowNextLine < Height;
 
-  nrf_gpio_pin_set(pinDataCommand);
-  WriteSpi(reinterpret_cast<const uint8_t*>(&color), 2);
-}
-
-void St7789::DrawBuffer(uint16_t x, uint16_t y, uint16_t width, uint16_t height, const uint8_t* data, size_t size) {
-  SetAddrWindow(x, y, x + width - 1, y + height - 1);
-  nrf_gpio_pin_set(pinDataCommand);
-  WriteSpi(data, size);
+  // The pixel data is not copied: it is sent from the interrupt handler after this function returns
+  auto transaction = WriteToRam(data, size, continueWrite);
+  transaction.completeHook = transferCompleteHook;
+  spi.Submit(transaction);
 }
 
 void St7789::HardwareReset() {
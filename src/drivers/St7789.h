@@ -1,6 +1,8 @@
 #pragma once
 #include <cstddef>
 #include <cstdint>
+#include <functional>
+#include "drivers/SpiMaster.h"
 
 namespace Pinetime {
   namespace Drivers {
@@ -20,16 +22,35 @@ namespace Pinetime {
       void VerticalScrollDefinition(uint16_t topFixedLines, uint16_t scrollLines, uint16_t bottomFixedLines);
       void VerticalScrollStartAddress(uint16_t line);
 
-      void DrawBuffer(uint16_t x, uint16_t y, uint16_t width, uint16_t height, const uint8_t* data, size_t size);
+      // The pixel data is sent asynchronously: DrawBuffer() returns as soon as the transfer is started.
+      // transferCompleteHook is called from the SPI interrupt handler when the transfer is done.
+      void DrawBuffer(uint16_t x,
+                      uint16_t y,
+                      uint16_t width,
+                      uint16_t height,
+                      const uint8_t* data,
+                      size_t size,
+                      const std::function<void()>& transferCompleteHook = nullptr);
 
       void Sleep();
       void Wakeup();
 
+      // Number of address windows (CASET + RASET) sent to the controller since boot
+      uint32_t AddressWindowCount() const {
+        return addressWindowCount;
+      }
+
     private:
       Spi& spi;
       uint8_t pinDataCommand;
       uint8_t verticalScrollingStartAddress = 0;
 
+      bool addressWindowValid = false;
+      uint16_t addressWindowX0 = 0;
+      uint16_t addressWindowX1 = 0;
+      uint16_t addressWindowNextLine = 0;
+      uint32_t addressWindowCount = 0;
+
       void HardwareReset();
       void SoftwareReset();
       void SleepOut();
@@ -38,14 +59,14 @@ namespace Pinetime {
       void MemoryDataAccessControl();
       void DisplayInversionOn();
       void NormalModeOn();
-      void WriteToRam();
+      SpiMaster::Transaction WriteToRam(const uint8_t* data, size_t size, bool continueWrite);
       void DisplayOn();
       void DisplayOff();
 
       void SetAddrWindow(uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1);
       void SetVdv();
       void WriteCommand(uint8_t cmd);
-      void WriteSpi(const uint8_t* data, size_t size);
+      void WriteCommand(uint8_t cmd, const uint8_t* data, size_t size);
 
       enum class Commands : uint8_t {
         SoftwareReset = 0x01,
@@ -62,6 +83,7 @@ namespace Pinetime {
         VerticalScrollDefinition = 0x33,
         VerticalScrollStartAddress = 0x37,
         ColMod = 0x3a,
+        WriteMemoryContinue = 0x3c,
         VdvSet = 0xc4,
       };
       void WriteData(uint8_t data);
@@ -1,12 +1,21 @@
 #include "heartratetask/HeartRateTask.h"
 #include <drivers/Hrs3300.h>
 #include <components/heartrate/HeartRateController.h>
+#include <components/heartrate/HeartRateHistory.h>
+#include <components/settings/Settings.h>
 #include <nrf_log.h>
+#include <algorithm>
+#include <cstdlib>
 
 using namespace Pinetime::Applications;
 
-HeartRateTask::HeartRateTask(Drivers::Hrs3300& heartRateSensor, Controllers::HeartRateController& controller)
-  : heartRateSensor {heartRateSensor}, controller {controller}, ppg {} {
+static_assert(configTICK_RATE_HZ == 1024, "The RR intervals are measured in ticks, and sent in 1/1024 s");
+
+HeartRateTask::HeartRateTask(Drivers::Hrs3300& heartRateSensor,
+                             Controllers::HeartRateController& controller,
+                             Controllers::Settings& settingsController,
+                             Controllers::HeartRateHistory& history)
+  : heartRateSensor {heartRateSensor}, controller {controller}, settingsController {settingsController}, history {history}, ppg {} {
 }
 
 void HeartRateTask::Start() {
@@ -27,7 +36,9 @@ void HeartRateTask::Work() {
   while (true) {
     Messages msg;
     uint32_t delay;
-    if (state == States::Running) {
+    if (backgroundMeasurementStarted)
+      delay = 40;
+    else if (state == States::Running) {
       if (measurementStarted)
         delay = 40;
       else
@@ -35,15 +46,21 @@ void HeartRateTask::Work() {
     } else
       delay = portMAX_DELAY;
 
+    if (!backgroundMeasurementStarted && !(measurementStarted && state == States::Running))
+      delay = std::min(delay, TicksToBackgroundMeasurement());
+
     if (xQueueReceive(messageQueue, &msg, delay)) {
       switch (msg) {
         case Messages::GoToSleep:
-          StopMeasurement();
+          // A background measurement goes on while sleeping
+          if (!backgroundMeasurementStarted)
+            StopMeasurement();
           state = States::Idle;
           break;
         case Messages::WakeUp:
           state = States::Running;
           if (measurementStarted) {
+            backgroundMeasurementStarted = false;
             lastBpm = 0;
             StartMeasurement();
           }
@@ -51,6 +68,7 @@ void HeartRateTask::Work() {
         case Messages::StartMeasurement:
           if (measurementStarted)
             break;
+          backgroundMeasurementStarted = false;
           lastBpm = 0;
           StartMeasurement();
           measurementStarted = true;
@@ -58,15 +76,24 @@ void HeartRateTask::Work() {
         case Messages::StopMeasurement:
           if (!measurementStarted)
             break;
-          StopMeasurement();
+          if (!backgroundMeasurementStarted)
+            StopMeasurement();
           measurementStarted = false;
           break;
       }
     }
 
-    if (measurementStarted) {
-      ppg.Preprocess(static_cast<float>(heartRateSensor.ReadHrs()));
-      auto bpm = ppg.HeartRate();
+    const bool foregroundMeasurement = measurementStarted && state == States::Running;
+    if (!backgroundMeasurementStarted && TicksToBackgroundMeasurement() == 0) {
+      if (foregroundMeasurement)
+        // The user is already measuring the heart rate, skip this one
+        lastBackgroundMeasurement = xTaskGetTickCount();
+      else
+        StartBackgroundMeasurement();
+    }
+
+    if (foregroundMeasurement) {
+      auto bpm = ProcessSample(true);
 
       if (lastBpm == 0 && bpm == 0)
         controller.Update(Controllers::HeartRateController::States::NotEnoughData, 0);
@@ -74,6 +101,8 @@ void HeartRateTask::Work() {
         lastBpm = bpm;
         controller.Update(Controllers::HeartRateController::States::Running, lastBpm);
       }
+    } else if (backgroundMeasurementStarted) {
+      ProcessBackgroundSample();
     }
   }
 }
@@ -91,7 +120,71 @@ void HeartRateTask::PushMessage(HeartRateTask::Messages msg) {
 void HeartRateTask::StartMeasurement() {
   heartRateSensor.Enable();
   vTaskDelay(100);
-  ppg.SetOffset(static_cast<float>(heartRateSensor.ReadHrs()));
+  auto offset = heartRateSensor.ReadHrs();
+#ifdef TRACE_HEARTRATE
+  // The first sample of a trace is the offset (see tools/ppg-replay)
+  NRF_LOG_INFO("HRS,%d,%d", offset, heartRateSensor.ReadAls());
+#endif
+  ppg.SetOffset(offset);
+  beatDetector.SetOffset(offset);
+}
+
+int HeartRateTask::ProcessSample(bool detectBeats) {
+  auto hrs = heartRateSensor.ReadHrs();
+#ifdef TRACE_HEARTRATE
+  NRF_LOG_INFO("HRS,%d,%d", hrs, heartRateSensor.ReadAls());
+#endif
+  ppg.Preprocess(hrs);
+
+  Controllers::BeatDetector::Beat beat;
+  if (detectBeats && beatDetector.Step(hrs, xTaskGetTickCount(), beat))
+    controller.AddRRInterval(beat.interval);
+
+  return ppg.HeartRate();
+}
+
+TickType_t HeartRateTask::TicksToBackgroundMeasurement() const {
+  const uint16_t interval = settingsController.GetHeartRateBackgroundInterval();
+  if (interval == 0)
+    return portMAX_DELAY;
+
+  const TickType_t period = interval * 60 * configTICK_RATE_HZ;
+  const TickType_t elapsed = xTaskGetTickCount() - lastBackgroundMeasurement;
+  return (elapsed >= period) ? 0 : period - elapsed;
+}
+
+void HeartRateTask::StartBackgroundMeasurement() {
+  lastBackgroundMeasurement = xTaskGetTickCount();
+  backgroundMeasurementStarted = true;
+  backgroundReferenceBpm = 0;
+  backgroundStableEstimations = 0;
+  StartMeasurement();
+}
+
+void HeartRateTask::ProcessBackgroundSample() {
+  auto bpm = ProcessSample(false);
+
+  // An estimation is given at the end of each window of samples: the result is confident once consecutive estimations
+  // stay within 5%
+  if (bpm != 0) {
+    if (backgroundStableEstimations > 0 && std::abs(bpm - backgroundReferenceBpm) * 20 <= backgroundReferenceBpm)
+      backgroundStableEstimations++;
+    else {
+      backgroundReferenceBpm = bpm;
+      backgroundStableEstimations = 1;
+    }
+  }
+
+  const TickType_t elapsed = xTaskGetTickCount() - lastBackgroundMeasurement;
+  if (backgroundStableEstimations >= backgroundConfidentEstimations) {
+    history.Add(static_cast<uint8_t>(std::min(bpm, 255)), static_cast<uint8_t>(elapsed / configTICK_RATE_HZ));
+  } else if (elapsed < backgroundTimeout) {
+    return;
+  }
+
+  // The LED is turned off as soon as possible, with or without a result
+  backgroundMeasurementStarted = false;
+  StopMeasurement();
 }
 
 void HeartRateTask::StopMeasurement() {
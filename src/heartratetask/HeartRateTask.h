@@ -2,6 +2,7 @@
 #include <FreeRTOS.h>
 #include <task.h>
 #include <queue.h>
+#include <components/heartrate/BeatDetector.h>
 #include <components/heartrate/Ppg.h>
 
 namespace Pinetime {
@@ -10,6 +11,8 @@ namespace Pinetime {
   }
   namespace Controllers {
     class HeartRateController;
+    class HeartRateHistory;
+    class Settings;
   }
   namespace Applications {
     class HeartRateTask {
@@ -17,7 +20,10 @@ namespace Pinetime {
       enum class Messages : uint8_t { GoToSleep, WakeUp, StartMeasurement, StopMeasurement };
       enum class States { Idle, Running };
 
-      explicit HeartRateTask(Drivers::Hrs3300& heartRateSensor, Controllers::HeartRateController& controller);
+      HeartRateTask(Drivers::Hrs3300& heartRateSensor,
+                    Controllers::HeartRateController& controller,
+                    Controllers::Settings& settingsController,
+                    Controllers::HeartRateHistory& history);
       void Start();
       void Work();
       void PushMessage(Messages msg);
@@ -26,14 +32,33 @@ namespace Pinetime {
       static void Process(void* instance);
       void StartMeasurement();
       void StopMeasurement();
+      // The RR intervals are sent to the controller if detectBeats is true
+      int ProcessSample(bool detectBeats);
+
+      // Background measurements: the sensor is powered every interval set in the settings, until the heart rate is
+      // stable or for backgroundTimeout at most, and the result is written to the history
+      TickType_t TicksToBackgroundMeasurement() const;
+      void StartBackgroundMeasurement();
+      void ProcessBackgroundSample();
+
+      // Ppg gives an estimation every 200 samples (7.8 s): the timeout allows 3 of them
+      static constexpr uint8_t backgroundConfidentEstimations = 2;
+      static constexpr TickType_t backgroundTimeout = 30 * configTICK_RATE_HZ;
 
       TaskHandle_t taskHandle;
       QueueHandle_t messageQueue;
       States state = States::Running;
       Drivers::Hrs3300& heartRateSensor;
       Controllers::HeartRateController& controller;
+      Controllers::Settings& settingsController;
+      Controllers::HeartRateHistory& history;
       Controllers::Ppg ppg;
+      Controllers::BeatDetector beatDetector;
       bool measurementStarted = false;
+      bool backgroundMeasurementStarted = false;
+      TickType_t lastBackgroundMeasurement = 0;
+      int backgroundReferenceBpm = 0;
+      uint8_t backgroundStableEstimations = 0;
     };
 
   }
@@ -36,6 +36,7 @@
 #include "components/motor/MotorController.h"
 #include "components/datetime/DateTimeController.h"
 #include "components/heartrate/HeartRateController.h"
+#include "components/heartrate/HeartRateHistory.h"
 #include "components/fs/FS.h"
 #include "drivers/Spi.h"
 #include "drivers/SpiMaster.h"
@@ -99,13 +100,14 @@ Pinetime::Controllers::Battery batteryController;
 Pinetime::Controllers::Ble bleController;
 
 Pinetime::Controllers::HeartRateController heartRateController;
-Pinetime::Applications::HeartRateTask heartRateApp(heartRateSensor, heartRateController);
 
 Pinetime::Controllers::FS fs {spiNorFlash};
 Pinetime::Controllers::Settings settingsController {fs};
 Pinetime::Controllers::MotorController motorController {};
 
 Pinetime::Controllers::DateTime dateTimeController {settingsController};
+Pinetime::Controllers::HeartRateHistory heartRateHistory {fs, dateTimeController};
+Pinetime::Applications::HeartRateTask heartRateApp(heartRateSensor, heartRateController, settingsController, heartRateHistory);
 Pinetime::Drivers::Watchdog watchdog;
 Pinetime::Drivers::WatchdogView watchdogView(watchdog);
 Pinetime::Controllers::NotificationManager notificationManager;
@@ -153,6 +155,7 @@ Pinetime::System::SystemTask systemTask(spi,
                                         motionSensor,
                                         settingsController,
                                         heartRateController,
+                                        heartRateHistory,
                                         displayApp,
                                         heartRateApp,
                                         fs,
@@ -174,6 +177,11 @@ void nrfx_gpiote_evt_handler(nrfx_gpiote_pin_t pin, nrf_gpiote_polarity_t action
     return;
   }
 
+  if (pin == Pinetime::PinMap::Bma421Irq) {
+    systemTask.PushMessage(Pinetime::System::Messages::OnMotionInterrupt);
+    return;
+  }
+
   BaseType_t xHigherPriorityTaskWoken = pdFALSE;
 
   if (pin == Pinetime::PinMap::PowerPresent and action == NRF_GPIOTE_POLARITY_TOGGLE) {
@@ -232,6 +240,14 @@ void WDT_IRQHandler(void) {
   nrf_wdt_event_clear(NRF_WDT_EVENT_TIMEOUT);
 }
 
+// TIMER3 counts the chunks of the SPI ArrayList transfers
+void TIMER3_IRQHandler(void) {
+  if (NRF_TIMER3->EVENTS_COMPARE[1] == 1) {
+    NRF_TIMER3->EVENTS_COMPARE[1] = 0;
+    spi.OnArrayListEndEvent();
+  }
+}
+
 void npl_freertos_hw_set_isr(int irqn, void (*addr)(void)) {
   switch (irqn) {
     case RADIO_IRQn:
@@ -3,6 +3,8 @@
 import io
 import sys
 import json
+import zlib
+import struct
 import shutil
 import typing
 import os.path
@@ -10,11 +12,41 @@ import argparse
 import subprocess
 from zipfile import ZipFile
 
+PACK_PATH = '/resources.pack'
+PACK_MAGIC = 0x4b505450
+PACK_VERSION = 1
+PACK_PATH_SIZE = 40
+PACK_ALIGNMENT = 16
+
+def create_pack(resources):
+    """Resource pack read by Pinetime::Controllers::ResourcePack (see ResourcePack.h for the format).
+
+    resources: list of (path on the watch, content)
+    """
+    resources = sorted(resources, key=lambda resource: resource[0].encode())
+    index_size = len(resources) * (PACK_PATH_SIZE + 8)
+    offset = 16 + index_size
+    index = b''
+    contents = b''
+    for path, content in resources:
+        if len(path.encode()) >= PACK_PATH_SIZE:
+            sys.exit(f'Error: the path {path} is too long for the resource pack.')
+        padding = -offset % PACK_ALIGNMENT
+        contents += b'\0' * padding
+        offset += padding
+        index += struct.pack(f'<{PACK_PATH_SIZE}sII', path.encode(), offset, len(content))
+        contents += content
+        offset += len(content)
+    body = index + contents
+    header = struct.pack('<IHHII', PACK_MAGIC, PACK_VERSION, len(resources), 16 + len(body), zlib.crc32(body))
+    return header + body
+
 def main():
     ap = argparse.ArgumentParser(description='auto generate LVGL font files from fonts')
     ap.add_argument('--config', '-c', type=str, action='append', help='config file to use')
     ap.add_argument('--obsolete', type=str, help='List of obsolete files')
     ap.add_argument('--output', type=str, help='output file name')
+    ap.add_argument('--pack', action='store_true', help='add all the resources in a resource pack, instead of individual files')
     args = ap.parse_args()
 
     for config_file in args.config:
@@ -32,6 +64,7 @@ def main():
 
     zf = ZipFile(args.output, mode='w')
     resource_files = []
+    pack_resources = []
 
     for config_file in args.config:
         with open(config_file, 'r') as fd:
@@ -40,16 +73,41 @@ def main():
         resource_names = set(data.keys())
         for name in resource_names:
             resource = data[name]
+            path = name + '.bin'
+            if not os.path.exists(path):
+                path = os.path.join(os.path.dirname(sys.argv[0]), path)
+            with open(path, 'rb') as fd:
+                content = fd.read()
+
+            if args.pack:
+                pack_resources.append((resource['target_path'] + name+'.bin', content))
+                continue
+
+            # Same hash as the one returned by the BLE FS hash command: a file that is already on
+            # the watch with the same size and CRC32 does not need to be uploaded again
             resource_files.append({
                 "filename": name+'.bin',
-                "path": resource['target_path'] + name+'.bin'
+                "path": resource['target_path'] + name+'.bin',
+                "size": len(content),
+                "crc32": zlib.crc32(content)
             })
 
-            path = name + '.bin'
-            if not os.path.exists(path):
-                path = os.path.join(os.path.dirname(sys.argv[0]), path)
             zf.write(path)
 
+    if args.pack:
+        # The pack replaces the individual files. The watch installs it in its resource pack partition and
+        # deletes it from the file system, but keeps answering the hash command for it.
+        pack = create_pack(pack_resources)
+        with open('resources.pack', 'wb') as fd:
+            fd.write(pack)
+        resource_files.append({
+            "filename": 'resources.pack',
+            "path": PACK_PATH,
+            "size": len(pack),
+            "crc32": zlib.crc32(pack)
+        })
+        zf.write('resources.pack')
+
     if args.obsolete:
         obsolete_file_path = os.path.join(os.path.dirname(sys.argv[0]), args.obsolete)
         with open(obsolete_file_path, 'r') as fd:
@@ -24,6 +24,7 @@ namespace Pinetime {
       OnNewHour,
       OnNewHalfHour,
       OnChargingEvent,
+      OnMotionInterrupt,
       OnPairing,
       SetOffAlarm,
       StopRinging,
@@ -31,7 +32,10 @@ namespace Pinetime {
       BatteryPercentageUpdated,
       StartFileTransfer,
       StopFileTransfer,
-      BleRadioEnableToggle
+      BleRadioEnableToggle,
+      SaveSettings,
+      SaveHeartRateHistory,
+      ReadHeartRateHistory
     };
   }
 }
@@ -17,6 +17,7 @@
 #include "main.h"
 #include "BootErrors.h"
 
+#include <algorithm>
 #include <memory>
 
 using namespace Pinetime::System;
@@ -65,6 +66,7 @@ SystemTask::SystemTask(Drivers::SpiMaster& spi,
                        Pinetime::Drivers::Bma421& motionSensor,
                        Controllers::Settings& settingsController,
                        Pinetime::Controllers::HeartRateController& heartRateController,
+                       Pinetime::Controllers::HeartRateHistory& heartRateHistory,
                        Pinetime::Applications::DisplayApp& displayApp,
                        Pinetime::Applications::HeartRateTask& heartRateApp,
                        Pinetime::Controllers::FS& fs,
@@ -88,6 +90,7 @@ SystemTask::SystemTask(Drivers::SpiMaster& spi,
     motionSensor {motionSensor},
     settingsController {settingsController},
     heartRateController {heartRateController},
+    heartRateHistory {heartRateHistory},
     motionController {motionController},
     displayApp {displayApp},
     heartRateApp(heartRateApp),
@@ -101,6 +104,7 @@ SystemTask::SystemTask(Drivers::SpiMaster& spi,
                      batteryController,
                      spiNorFlash,
                      heartRateController,
+                     heartRateHistory,
                      motionController,
                      fs) {
 }
@@ -131,6 +135,10 @@ void SystemTask::Work() {
   spiNorFlash.Wakeup();
 
   fs.Init();
+#ifndef PINETIME_IS_RECOVERY
+  // A pack uploaded before the last reset
+  isInstallingResourcePack = true;
+#endif
 
   nimbleController.Init();
   lcd.Init();
@@ -158,7 +166,8 @@ void SystemTask::Work() {
 
   motionSensor.Init();
   motionController.Init(motionSensor.DeviceType());
-  settingsController.Init();
+  settingsController.Init(this);
+  heartRateHistory.Init(this);
 
   displayApp.Register(this);
   displayApp.Start(bootError);
@@ -195,6 +204,12 @@ void SystemTask::Work() {
   nrfx_gpiote_in_init(PinMap::PowerPresent, &pinConfig, nrfx_gpiote_evt_handler);
   nrfx_gpiote_in_event_enable(PinMap::PowerPresent, true);
 
+  // Motion sensor (FIFO watermark)
+  pinConfig.sense = NRF_GPIOTE_POLARITY_LOTOHI;
+  pinConfig.pull = NRF_GPIO_PIN_NOPULL;
+  nrfx_gpiote_in_init(PinMap::Bma421Irq, &pinConfig, nrfx_gpiote_evt_handler);
+  nrfx_gpiote_in_event_enable(PinMap::Bma421Irq, true);
+
   batteryController.MeasureVoltage();
 
   idleTimer = xTimerCreate("idleTimer", pdMS_TO_TICKS(2000), pdFALSE, this, IdleTimerCallback);
@@ -209,7 +224,11 @@ void SystemTask::Work() {
     UpdateMotion();
 
     uint8_t msg;
-    if (xQueueReceive(systemTasksMsgQueue, &msg, 100)) {
+    bool messageReceived = xQueueReceive(systemTasksMsgQueue, &msg, PollingPeriod());
+    if (state == SystemTaskState::Sleeping) {
+      sleepingWakeUpCount++;
+    }
+    if (messageReceived) {
       Messages message = static_cast<Messages>(msg);
       switch (message) {
         case Messages::EnableSleeping:
@@ -227,6 +246,7 @@ void SystemTask::Work() {
           xTimerChangePeriod(dimTimer, pdMS_TO_TICKS(settingsController.GetScreenTimeOut() - 2000), 0);
           break;
         case Messages::GoToRunning:
+          NRF_LOG_INFO("[systemtask] Waking up (%lu wake-ups while sleeping)", sleepingWakeUpCount);
           spi.Wakeup();
 
           // Double Tap needs the touch screen to be in normal mode
@@ -311,6 +331,7 @@ void SystemTask::Work() {
           ReloadIdleTimer();
           isBleDiscoveryTimerRunning = true;
           bleDiscoveryTimer = 5;
+          displayApp.PushMessage(Pinetime::Applications::Display::Messages::UpdateBleConnection);
           break;
         case Messages::BleFirmwareUpdateStarted:
           doNotGoToSleep = true;
@@ -326,9 +347,43 @@ void SystemTask::Work() {
           doNotGoToSleep = false;
           xTimerStart(dimTimer, 0);
           break;
+        case Messages::SaveSettings:
+          if (state == SystemTaskState::Running) {
+            settingsController.CommitSettings();
+          }
+          break;
+        case Messages::SaveHeartRateHistory:
+          if (state == SystemTaskState::Running) {
+            heartRateHistory.Commit();
+          } else if (state == SystemTaskState::Sleeping) {
+            // Background measurements are mostly done while sleeping: wake the flash memory up for the write
+            spi.Wakeup();
+            spiNorFlash.Wakeup();
+            heartRateHistory.Commit();
+            if (BootloaderVersion::IsValid()) {
+              spiNorFlash.Sleep();
+            }
+            spi.Sleep();
+          }
+          break;
+        case Messages::ReadHeartRateHistory:
+          if (IsSleeping()) {
+            // Only wake the flash memory up for the read: the display stays off
+            spi.Wakeup();
+            spiNorFlash.Wakeup();
+            heartRateHistory.ProcessReadRequests();
+            if (BootloaderVersion::IsValid()) {
+              spiNorFlash.Sleep();
+            }
+            spi.Sleep();
+          } else {
+            heartRateHistory.ProcessReadRequests();
+          }
+          break;
         case Messages::StartFileTransfer:
           NRF_LOG_INFO("[systemtask] FS Started");
           doNotGoToSleep = true;
+          isFileTransferRunning = true;
           if (state == SystemTaskState::Sleeping) {
             GoToRunning();
           }
@@ -337,6 +392,11 @@ void SystemTask::Work() {
         case Messages::StopFileTransfer:
           NRF_LOG_INFO("[systemtask] FS Stopped");
           doNotGoToSleep = false;
+          isFileTransferRunning = false;
+#ifndef PINETIME_IS_RECOVERY
+          // The transfer may have completed the upload of a resource pack
+          isInstallingResourcePack = true;
+#endif
           xTimerStart(dimTimer, 0);
           // TODO add intent of fs access icon or something
           break;
@@ -367,6 +427,22 @@ void SystemTask::Work() {
           HandleButtonAction(action);
         } break;
         case Messages::OnDisplayTaskSleeping:
+          // Write the pending settings and records before the flash memory goes to sleep
+          settingsController.CommitSettings();
+          heartRateHistory.Commit();
+#ifdef DEBUG
+          {
+            const auto spiStatistics = spi.GetStatistics();
+            NRF_LOG_INFO("[SPI] transfers=%lu interrupts=%lu last=%lu",
+                         spiStatistics.transfers,
+                         spiStatistics.interrupts,
+                         spiStatistics.lastTransferInterrupts);
+            const auto& cacheStatistics = fs.GetCacheStatistics();
+            NRF_LOG_INFO("[FS] cache hits=%lu misses=%lu", cacheStatistics.hits, cacheStatistics.misses);
+            const auto& writeStatistics = spiNorFlash.GetWriteStatistics();
+            NRF_LOG_INFO("[Flash] written=%lu pages=%lu time=%luus", writeStatistics.bytes, writeStatistics.pages, writeStatistics.time);
+          }
+#endif
           if (BootloaderVersion::IsValid()) {
             // First versions of the bootloader do not expose their version and cannot initialize the SPI NOR FLASH
             // if it's in sleep mode. Avoid bricked device by disabling sleep mode on these versions.
@@ -417,6 +493,8 @@ void SystemTask::Work() {
           ReloadIdleTimer();
           if (state == SystemTaskState::Sleeping) {
             GoToRunning();
+          } else {
+            displayApp.PushMessage(Pinetime::Applications::Display::Messages::UpdateBatteryLevel);
           }
           break;
         case Messages::MeasureBatteryTimerExpired:
@@ -424,6 +502,7 @@ void SystemTask::Work() {
           break;
         case Messages::BatteryPercentageUpdated:
           nimbleController.NotifyBatteryLevel(batteryController.PercentRemaining());
+          displayApp.PushMessage(Pinetime::Applications::Display::Messages::UpdateBatteryLevel);
           break;
         case Messages::OnPairing:
           if (state == SystemTaskState::Sleeping) {
@@ -455,6 +534,11 @@ void SystemTask::Work() {
       }
     }
 
+    // The resource pack is installed by steps, between the messages, and never during a file transfer
+    if (isInstallingResourcePack && !isFileTransferRunning) {
+      InstallResourcePackStep();
+    }
+
     monitor.Process();
     uint32_t systick_counter = nrf_rtc_counter_get(portNRF_RTC_REG);
     dateTimeController.UpdateTime(systick_counter);
@@ -466,6 +550,42 @@ void SystemTask::Work() {
 #pragma clang diagnostic pop
 }
 
+void SystemTask::InstallResourcePackStep() {
+  // Like the other writes done while sleeping, wake the flash memory up for the step only
+  const bool sleeping = IsSleeping();
+  if (sleeping) {
+    spi.Wakeup();
+    spiNorFlash.Wakeup();
+  }
+  isInstallingResourcePack = fs.InstallResourcePack();
+  if (sleeping) {
+    if (BootloaderVersion::IsValid()) {
+      spiNorFlash.Sleep();
+    }
+    spi.Sleep();
+  }
+}
+
+TickType_t SystemTask::PollingPeriod() const {
+  // The BLE discovery delay is counted in iterations of the main loop
+  if (isBleDiscoveryTimerRunning) {
+    return pdMS_TO_TICKS(100);
+  }
+  // Only yield to the other tasks between two steps of the installation of a resource pack
+  if (isInstallingResourcePack && !isFileTransferRunning) {
+    return 1;
+  }
+  if (state != SystemTaskState::Sleeping) {
+    return pdMS_TO_TICKS(100);
+  }
+
+  // While sleeping, the motion sensor wakes the task up (OnMotionInterrupt) when its FIFO must be read.
+  // Otherwise, wake up at the beginning of the next minute so that UpdateTime() sends the
+  // hour/half-hour messages on time, or earlier if the watchdog must be kicked.
+  TickType_t untilNextMinute = pdMS_TO_TICKS((60 - dateTimeController.Seconds()) * 1000);
+  return std::min(untilNextMinute, watchdogKickPeriod);
+}
+
 void SystemTask::UpdateMotion() {
   if (state == SystemTaskState::GoingToSleep || state == SystemTaskState::WakingUp) {
     return;
@@ -485,6 +605,7 @@ void SystemTask::UpdateMotion() {
 
   motionController.IsSensorOk(motionSensor.IsOk());
   motionController.Update(motionValues.x, motionValues.y, motionValues.z, motionValues.steps);
+  motionController.AddSamples(motionValues.samples, motionValues.nbSamples);
 
   if (settingsController.GetNotificationStatus() != Controllers::Settings::Notification::Sleep) {
     if ((settingsController.isWakeUpModeOn(Pinetime::Controllers::Settings::WakeUpMode::RaiseWrist) &&
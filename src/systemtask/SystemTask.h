@@ -8,6 +8,7 @@
 #include <timers.h>
 #include <heartratetask/HeartRateTask.h>
 #include <components/settings/Settings.h>
+#include <components/heartrate/HeartRateHistory.h>
 #include <drivers/Bma421.h>
 #include <drivers/PinMap.h>
 #include <components/motion/MotionController.h>
@@ -73,6 +74,7 @@ namespace Pinetime {
                  Pinetime::Drivers::Bma421& motionSensor,
                  Controllers::Settings& settingsController,
                  Pinetime::Controllers::HeartRateController& heartRateController,
+                 Pinetime::Controllers::HeartRateHistory& heartRateHistory,
                  Pinetime::Applications::DisplayApp& displayApp,
                  Pinetime::Applications::HeartRateTask& heartRateApp,
                  Pinetime::Controllers::FS& fs,
@@ -95,6 +97,11 @@ namespace Pinetime {
         return state == SystemTaskState::Sleeping || state == SystemTaskState::WakingUp;
       }
 
+      // Number of iterations of the main loop while the watch was sleeping, since boot
+      uint32_t SleepingWakeUpCount() const {
+        return sleepingWakeUpCount;
+      }
+
     private:
       TaskHandle_t taskHandle;
 
@@ -118,6 +125,7 @@ namespace Pinetime {
       Pinetime::Drivers::Bma421& motionSensor;
       Pinetime::Controllers::Settings& settingsController;
       Pinetime::Controllers::HeartRateController& heartRateController;
+      Pinetime::Controllers::HeartRateHistory& heartRateHistory;
       Pinetime::Controllers::MotionController& motionController;
 
       Pinetime::Applications::DisplayApp& displayApp;
@@ -131,6 +139,9 @@ namespace Pinetime {
       void Work();
       void ReloadIdleTimer();
       bool isBleDiscoveryTimerRunning = false;
+      bool isFileTransferRunning = false;
+      bool isInstallingResourcePack = false;
+      void InstallResourcePackStep();
       uint8_t bleDiscoveryTimer = 0;
       TimerHandle_t dimTimer;
       TimerHandle_t idleTimer;
@@ -147,6 +158,10 @@ namespace Pinetime {
       bool stepCounterMustBeReset = false;
       static constexpr TickType_t batteryMeasurementPeriod = pdMS_TO_TICKS(10 * 60 * 1000);
 
+      TickType_t PollingPeriod() const;
+      static constexpr TickType_t watchdogKickPeriod = pdMS_TO_TICKS(5 * 1000); // The watchdog timeout is 7s
+      uint32_t sleepingWakeUpCount = 0;
+
       SystemMonitor monitor;
     };
   }
@@ -0,0 +1,40 @@
+#!/usr/bin/env python3
+# Generates a synthetic trace in the CSV format of ppg-replay, to check the tool and the extreme cases of the
+# algorithm. It does not replace traces recorded on the wrist.
+import argparse
+import math
+import random
+
+# HeartRateTask waits 40 ticks of the 1024 Hz FreeRTOS tick between the samples
+SAMPLE_PERIOD = 40 / 1024
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Generate a synthetic HRS3300 trace')
+    parser.add_argument('output', help='CSV file to create')
+    parser.add_argument('--bpm', type=float, default=70, help='heart rate at the start of the trace')
+    parser.add_argument('--end-bpm', type=float, help='heart rate at the end of the trace (default: --bpm)')
+    parser.add_argument('--duration', type=float, default=60, help='duration in seconds')
+    parser.add_argument('--level', type=int, default=20000, help='DC level of the signal')
+    parser.add_argument('--amplitude', type=float, default=60, help='amplitude of the pulses')
+    parser.add_argument('--noise', type=float, default=3, help='standard deviation of the noise')
+    parser.add_argument('--seed', type=int, default=0)
+    args = parser.parse_args()
+
+    random.seed(args.seed)
+    end_bpm = args.end_bpm if args.end_bpm is not None else args.bpm
+    samples = int(args.duration / SAMPLE_PERIOD)
+    phase = 0.0
+    with open(args.output, 'w') as output:
+        output.write('# hrs,als,reference_bpm (synthetic: bpm=%g..%g noise=%g)\n' % (args.bpm, end_bpm, args.noise))
+        for n in range(samples + 1):
+            bpm = args.bpm + (end_bpm - args.bpm) * n / samples
+            phase = (phase + bpm / 60 * SAMPLE_PERIOD) % 1.0
+            # Systolic peak and dicrotic wave, slow drift of the baseline (respiration, movements)
+            pulse = math.exp(-((phase - 0.2) / 0.08) ** 2) + 0.4 * math.exp(-((phase - 0.5) / 0.1) ** 2)
+            value = args.level + 200 * math.sin(n * 0.03) + args.amplitude * pulse + random.gauss(0, args.noise)
+            output.write('%d,%d,%d\n' % (max(0, int(value)), 0, round(bpm)))
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,425 @@
+/*
+ * Offline replay of recorded HRS3300 traces through the heart rate algorithm of the firmware (components/heartrate).
+ *
+ * The samples go through the same sequence of calls as HeartRateTask: the first sample of the trace is the offset read
+ * when the measurement starts, then each sample (one every 40 ticks, ~39 ms) is preprocessed before asking for the heart rate.
+ * The reported value is the last non-zero heart rate, as sent to HeartRateController. The samples also go through the
+ * beat detector, which gives the RR intervals.
+ *
+ * The floating point algorithm that preceded the fixed-point one is kept in reference/ (without beat detector), so that
+ * both can be run on the same traces (--against-reference).
+ *
+ * See README.md for the format of the traces and of the report.
+ */
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "components/heartrate/Ppg.h"
+#if PPG_REPLAY_BEAT_DETECTOR
+  #include "components/heartrate/BeatDetector.h"
+#endif
+#include "reference/Ppg.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+  #include <x86intrin.h>
+  #define HAS_CYCLE_COUNTER 1
+#else
+  #define HAS_CYCLE_COUNTER 0
+#endif
+
+namespace {
+  // HeartRateTask waits 40 ticks of the 1024 Hz FreeRTOS tick between the samples
+  constexpr uint32_t sampleTicks = 40;
+  constexpr double samplePeriod = sampleTicks / 1024.0;
+  constexpr const char* reportHeader = "trace,samples,first_reading_s,readings,compared,mae_bpm,rmse_bpm,within_10pct,ns_per_sample,"
+                                       "cycles_per_sample,beats,beats_compared,rr_mae_bpm";
+  constexpr const char* againstReferenceHeader = "trace,samples,first_reading_s,reference_first_reading_s,mae_bpm,reference_mae_bpm,"
+                                                 "both_readings,mean_difference_bpm,max_difference_bpm,ns_per_sample,"
+                                                 "reference_ns_per_sample";
+
+  // The algorithm of the firmware (INFINITIME_SRC), with the calls done by HeartRateTask. The calls compile with the
+  // API of the fixed-point Ppg (integer samples and heart rate) and with the API of the float one (Preprocess(float),
+  // float HeartRate(), SetOffset(uint16_t)), so that the trees before and after the change can be compared.
+  // The beat detector is left out with detectBeats = false, to compare the processing time with the reference.
+  template <bool detectBeats>
+  class FirmwareAlgorithm {
+  public:
+    void SetOffset(uint32_t offset) {
+      ppg.SetOffset(offset);
+#if PPG_REPLAY_BEAT_DETECTOR
+      if (detectBeats) {
+        beatDetector.SetOffset(offset);
+      }
+#endif
+    }
+
+    // Returns the heart rate known after the sample (0 if none), and the RR interval ending with it (0 if none)
+    int Step(uint32_t spl, uint32_t timestamp, uint16_t& interval) {
+      ppg.Preprocess(spl);
+      interval = 0;
+#if PPG_REPLAY_BEAT_DETECTOR
+      Pinetime::Controllers::BeatDetector::Beat beat;
+      if (detectBeats && beatDetector.Step(spl, timestamp, beat)) {
+        interval = beat.interval;
+      }
+#else
+      (void) timestamp;
+#endif
+      return static_cast<int>(ppg.HeartRate());
+    }
+
+  private:
+    Pinetime::Controllers::Ppg ppg;
+#if PPG_REPLAY_BEAT_DETECTOR
+    Pinetime::Controllers::BeatDetector beatDetector;
+#endif
+  };
+
+  // The floating point algorithm of reference/
+  class ReferenceAlgorithm {
+  public:
+    void SetOffset(uint32_t offset) {
+      ppg.SetOffset(static_cast<uint16_t>(offset));
+    }
+
+    int Step(uint32_t spl, uint32_t /*timestamp*/, uint16_t& interval) {
+      ppg.Preprocess(static_cast<float>(spl));
+      interval = 0;
+      return static_cast<int>(ppg.HeartRate());
+    }
+
+  private:
+    PpgReference::Ppg ppg;
+  };
+
+  struct Sample {
+    uint32_t hrs;
+    uint32_t als;
+    uint32_t reference; // 0 if unknown
+  };
+
+  struct Result {
+    std::string trace;
+    size_t samples = 0;
+    double firstReading = -1; // Seconds since the start of the measurement, -1 if no reading
+    size_t readings = 0;
+    size_t compared = 0;
+    double mae = 0;
+    double rmse = 0;
+    double within10 = 0;
+    double nsPerSample = 0;
+    double cyclesPerSample = 0;
+    size_t beats = 0;
+    size_t beatsCompared = 0;
+    double rrMae = 0; // Heart rate given by each RR interval (60 / interval) compared with the reference
+  };
+
+  bool EndsWith(const std::string& value, const char* suffix) {
+    const size_t length = std::strlen(suffix);
+    return value.size() >= length && value.compare(value.size() - length, length, suffix) == 0;
+  }
+
+  bool LoadTrace(const std::string& path, std::vector<Sample>& samples) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+      return false;
+    }
+
+    if (EndsWith(path, ".bin")) {
+      uint8_t record[12];
+      while (file.read(reinterpret_cast<char*>(record), sizeof(record))) {
+        uint32_t values[3];
+        for (int i = 0; i < 3; i++) {
+          const uint8_t* data = record + (i * 4);
+          values[i] = data[0] | (data[1] << 8) | (data[2] << 16) | (static_cast<uint32_t>(data[3]) << 24);
+        }
+        samples.push_back({values[0], values[1], values[2]});
+      }
+      return true;
+    }
+
+    std::string line;
+    while (std::getline(file, line)) {
+      if (line.empty() || line[0] == '#' || !std::isdigit(static_cast<unsigned char>(line[0]))) {
+        continue;
+      }
+      Sample sample {0, 0, 0};
+      std::replace(line.begin(), line.end(), ',', ' ');
+      std::istringstream fields(line);
+      fields >> sample.hrs >> sample.als;
+      if (!(fields >> sample.reference)) {
+        sample.reference = 0;
+      }
+      samples.push_back(sample);
+    }
+    return true;
+  }
+
+  // 'reported' receives the heart rate reported after each sample
+  template <class Algorithm>
+  Result Replay(const std::string& trace, const std::vector<Sample>& samples, int repeat, std::vector<int>& reported) {
+    Result result;
+    result.trace = trace;
+    reported.assign(samples.size(), 0);
+    if (samples.size() < 2) {
+      return result;
+    }
+    result.samples = samples.size() - 1;
+
+    std::vector<uint16_t> intervals(samples.size(), 0);
+    uint64_t nanoseconds = 0;
+    uint64_t cycles = 0;
+    for (int run = 0; run < repeat; run++) {
+      Algorithm algorithm;
+      algorithm.SetOffset(samples[0].hrs);
+      int lastBpm = 0;
+
+      const auto start = std::chrono::steady_clock::now();
+#if HAS_CYCLE_COUNTER
+      const uint64_t startCycles = __rdtsc();
+#endif
+      for (size_t i = 1; i < samples.size(); i++) {
+        const int bpm = algorithm.Step(samples[i].hrs, static_cast<uint32_t>(i * sampleTicks), intervals[i]);
+        if (bpm != 0) {
+          lastBpm = bpm;
+        }
+        reported[i] = lastBpm;
+      }
+#if HAS_CYCLE_COUNTER
+      cycles += __rdtsc() - startCycles;
+#endif
+      nanoseconds += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+    }
+    result.nsPerSample = static_cast<double>(nanoseconds) / (repeat * result.samples);
+    result.cyclesPerSample = static_cast<double>(cycles) / (repeat * result.samples);
+
+    double absoluteErrors = 0;
+    double squaredErrors = 0;
+    size_t within10 = 0;
+    for (size_t i = 1; i < samples.size(); i++) {
+      if (reported[i] == 0) {
+        continue;
+      }
+      if (result.firstReading < 0) {
+        result.firstReading = i * samplePeriod;
+      }
+      result.readings++;
+      if (samples[i].reference == 0) {
+        continue;
+      }
+      const double error = reported[i] - static_cast<double>(samples[i].reference);
+      absoluteErrors += std::abs(error);
+      squaredErrors += error * error;
+      if (std::abs(error) <= samples[i].reference * 0.1) {
+        within10++;
+      }
+      result.compared++;
+    }
+    if (result.compared > 0) {
+      result.mae = absoluteErrors / result.compared;
+      result.rmse = std::sqrt(squaredErrors / result.compared);
+      result.within10 = static_cast<double>(within10) / result.compared;
+    }
+
+    double rrAbsoluteErrors = 0;
+    for (size_t i = 1; i < samples.size(); i++) {
+      if (intervals[i] == 0) {
+        continue;
+      }
+      result.beats++;
+      if (samples[i].reference == 0) {
+        continue;
+      }
+      rrAbsoluteErrors += std::abs(60.0 * 1024 / intervals[i] - samples[i].reference);
+      result.beatsCompared++;
+    }
+    if (result.beatsCompared > 0) {
+      result.rrMae = rrAbsoluteErrors / result.beatsCompared;
+    }
+    return result;
+  }
+
+  void PrintResult(FILE* output, const Result& result) {
+    std::fprintf(output,
+                 "%s,%zu,%.2f,%zu,%zu,%.2f,%.2f,%.3f,%.1f,%.1f,%zu,%zu,%.2f\n",
+                 result.trace.c_str(),
+                 result.samples,
+                 result.firstReading,
+                 result.readings,
+                 result.compared,
+                 result.mae,
+                 result.rmse,
+                 result.within10,
+                 result.nsPerSample,
+                 result.cyclesPerSample,
+                 result.beats,
+                 result.beatsCompared,
+                 result.rrMae);
+  }
+
+  bool LoadReport(const char* path, std::map<std::string, Result>& results) {
+    std::ifstream file(path);
+    if (!file) {
+      return false;
+    }
+    std::string line;
+    while (std::getline(file, line)) {
+      if (line.empty() || line.compare(0, 6, "trace,") == 0) {
+        continue;
+      }
+      Result result;
+      const size_t separator = line.find(',');
+      result.trace = line.substr(0, separator);
+      std::replace(line.begin(), line.end(), ',', ' ');
+      std::istringstream fields(line.substr(separator + 1));
+      fields >> result.samples >> result.firstReading >> result.readings >> result.compared >> result.mae >> result.rmse >>
+        result.within10 >> result.nsPerSample >> result.cyclesPerSample >> result.beats >> result.beatsCompared >> result.rrMae;
+      results[result.trace] = result;
+    }
+    return true;
+  }
+
+  int Compare(const char* before, const char* after) {
+    std::map<std::string, Result> a;
+    std::map<std::string, Result> b;
+    if (!LoadReport(before, a) || !LoadReport(after, b)) {
+      std::fprintf(stderr, "Cannot read the reports\n");
+      return 1;
+    }
+
+    std::printf("%-32s %17s %17s %17s %21s\n", "trace", "first reading (s)", "MAE (bpm)", "within 10%", "ns per sample");
+    for (const auto& entry : b) {
+      const auto previous = a.find(entry.first);
+      if (previous == a.end()) {
+        std::printf("%-32s (not in %s)\n", entry.first.c_str(), before);
+        continue;
+      }
+      const Result& x = previous->second;
+      const Result& y = entry.second;
+      std::printf("%-32s %7.2f -> %6.2f %7.2f -> %6.2f %7.3f -> %6.3f %9.1f -> %8.1f\n",
+                  entry.first.c_str(),
+                  x.firstReading,
+                  y.firstReading,
+                  x.mae,
+                  y.mae,
+                  x.within10,
+                  y.within10,
+                  x.nsPerSample,
+                  y.nsPerSample);
+    }
+    return 0;
+  }
+
+  // Runs the firmware and the reference algorithms on the same trace, and compares their readings
+  void PrintAgainstReference(FILE* output, const std::string& trace, const std::vector<Sample>& samples, int repeat) {
+    std::vector<int> firmwareReadings;
+    std::vector<int> referenceReadings;
+    const Result firmware = Replay<FirmwareAlgorithm<false>>(trace, samples, repeat, firmwareReadings);
+    const Result reference = Replay<ReferenceAlgorithm>(trace, samples, repeat, referenceReadings);
+
+    size_t both = 0;
+    double absoluteDifferences = 0;
+    int maxDifference = 0;
+    for (size_t i = 1; i < samples.size(); i++) {
+      if (firmwareReadings[i] == 0 || referenceReadings[i] == 0) {
+        continue;
+      }
+      const int difference = std::abs(firmwareReadings[i] - referenceReadings[i]);
+      absoluteDifferences += difference;
+      maxDifference = std::max(maxDifference, difference);
+      both++;
+    }
+
+    std::fprintf(output,
+                 "%s,%zu,%.2f,%.2f,%.2f,%.2f,%zu,%.2f,%d,%.1f,%.1f\n",
+                 trace.c_str(),
+                 firmware.samples,
+                 firmware.firstReading,
+                 reference.firstReading,
+                 firmware.mae,
+                 reference.mae,
+                 both,
+                 (both > 0) ? absoluteDifferences / both : 0.0,
+                 maxDifference,
+                 firmware.nsPerSample,
+                 reference.nsPerSample);
+  }
+
+  void Usage() {
+    std::fprintf(stderr,
+                 "Usage: ppg-replay [--repeat N] [--output report.csv] [--against-reference] trace...\n"
+                 "       ppg-replay --compare before.csv after.csv\n");
+  }
+}
+
+int main(int argc, char** argv) {
+  int repeat = 1;
+  const char* outputPath = nullptr;
+  bool againstReference = false;
+  std::vector<std::string> traces;
+
+  for (int i = 1; i < argc; i++) {
+    if (std::strcmp(argv[i], "--compare") == 0) {
+      if (i + 2 >= argc) {
+        Usage();
+        return 1;
+      }
+      return Compare(argv[i + 1], argv[i + 2]);
+    }
+    if (std::strcmp(argv[i], "--repeat") == 0 && i + 1 < argc) {
+      repeat = std::max(1, std::atoi(argv[++i]));
+    } else if (std::strcmp(argv[i], "--output") == 0 && i + 1 < argc) {
+      outputPath = argv[++i];
+    } else if (std::strcmp(argv[i], "--against-reference") == 0) {
+      againstReference = true;
+    } else if (argv[i][0] == '-') {
+      Usage();
+      return 1;
+    } else {
+      traces.emplace_back(argv[i]);
+    }
+  }
+  if (traces.empty()) {
+    Usage();
+    return 1;
+  }
+
+  FILE* output = stdout;
+  if (outputPath != nullptr && (output = std::fopen(outputPath, "w")) == nullptr) {
+    std::fprintf(stderr, "Cannot create %s\n", outputPath);
+    return 1;
+  }
+
+  int status = 0;
+  std::fprintf(output, "%s\n", againstReference ? againstReferenceHeader : reportHeader);
+  for (const auto& trace : traces) {
+    std::vector<Sample> samples;
+    if (!LoadTrace(trace, samples)) {
+      std::fprintf(stderr, "Cannot read %s\n", trace.c_str());
+      status = 1;
+      continue;
+    }
+    if (againstReference) {
+      PrintAgainstReference(output, trace, samples, repeat);
+    } else {
+      std::vector<int> readings;
+      PrintResult(output, Replay<FirmwareAlgorithm<true>>(trace, samples, repeat, readings));
+    }
+  }
+
+  if (output != stdout) {
+    std::fclose(output);
+  }
+  return status;
+}
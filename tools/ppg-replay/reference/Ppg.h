@@ -0,0 +1,29 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include "reference/Biquad.h"
+#include "reference/Ptagc.h"
+
+namespace PpgReference {
+  class Ppg {
+  public:
+    Ppg();
+    int8_t Preprocess(float spl);
+    float HeartRate();
+
+    void SetOffset(uint16_t i);
+    void Reset();
+
+  private:
+    std::array<int8_t, 200> data;
+    size_t dataIndex = 0;
+    float offset;
+    Biquad hpf;
+    Ptagc agc;
+    Biquad lpf;
+
+    float ProcessHeartRate();
+  };
+}
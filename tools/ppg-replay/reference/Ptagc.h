@@ -0,0 +1,15 @@
+#pragma once
+
+namespace PpgReference {
+  class Ptagc {
+  public:
+    Ptagc(float start, float decay, float threshold);
+    float Step(float spl);
+
+  private:
+    float peak;
+    float decay;
+    float boost;
+    float threshold;
+  };
+}
@@ -0,0 +1,4 @@
+#pragma once
+
+// The sources of older trees log from the algorithm: the logs are not needed on the host
+#define NRF_LOG_INFO(...)
@@ -0,0 +1,255 @@
+/*
+ * Frame time of the display pipeline of the firmware (LittleVgl, St7789, Spi and SpiMaster), on a simulated nRF52832.
+ *
+ * The drivers run on the host, on the models of sim/: the SPIM at 8MHz with EasyDMA, the PPI and the TIMER used for the
+ * ArrayList transfers, the interrupts, FreeRTOS and the ST7789 with its RAM and vertical scrolling. LVGL is replaced
+ * by a model of its refresh (the parts of the areas, the two buffers and the calls to the driver): the content of the
+ * parts is a pattern drawn by this program, which charges a configurable rendering time per pixel.
+ *
+ * Each frame is checked on the panel of the model at the end: the pixels shown (RAM and scrolling) must be the ones
+ * rendered. The time of a frame goes from the start of the refresh to the end of the last transfer.
+ *
+ * See README.md for the scenarios and the report.
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "displayapp/LittleVgl.h"
+#include "drivers/Cst816s.h"
+#include "drivers/PinMap.h"
+#include "drivers/Spi.h"
+#include "drivers/SpiMaster.h"
+#include "drivers/St7789.h"
+#include "drivers/TwiMaster.h"
+#include "sim/Interrupts.h"
+#include "sim/Lvgl.h"
+#include "sim/Peripherals.h"
+#include "sim/Simulator.h"
+#include "sim/St7789Model.h"
+
+using Pinetime::Components::LittleVgl;
+
+namespace {
+  constexpr const char* reportHeader = "buffers,render_ns_per_px,scenario,frame_us,refresh_us,wait_us,lvgl_ms,areas,dma_transfers,"
+                                       "interrupts,address_windows,bytes,panel_ok";
+  constexpr uint16_t screenSize = 240;
+
+  struct Scenario {
+    const char* name;
+    LittleVgl::FullRefreshDirections direction;
+    std::vector<lv_area_t> areas;
+  };
+
+  // A full screen refresh, the transitions between the screens (the direction of the swipe), and the update of a label
+  const std::vector<Scenario> scenarios = {
+    {"full", LittleVgl::FullRefreshDirections::None, {{0, 0, 239, 239}}},
+    {"scroll-up", LittleVgl::FullRefreshDirections::Up, {{0, 0, 239, 239}}},
+    {"scroll-down", LittleVgl::FullRefreshDirections::Down, {{0, 0, 239, 239}}},
+    {"label", LittleVgl::FullRefreshDirections::None, {{40, 100, 199, 139}}},
+    {"two-labels", LittleVgl::FullRefreshDirections::None, {{20, 20, 119, 49}, {140, 190, 219, 219}}},
+  };
+
+  struct Options {
+    std::vector<uint32_t> renderCosts {0, 250, 500, 1000, 2000};
+    uint32_t frames = 4;
+    const char* outputPath = nullptr;
+  };
+
+  // The colors of the pixels change with each frame, so that a part that is not sent is detected
+  uint16_t Pattern(uint16_t x, uint16_t y, uint32_t frame) {
+    uint32_t value = (x * 2654435761U) ^ (y * 40503U) ^ (frame * 2246822519U);
+    return static_cast<uint16_t>(value ^ (value >> 16));
+  }
+
+  class Bench {
+  public:
+    Bench(nrfsim::St7789Model& panel, Pinetime::Drivers::Spi& lcdSpi, bool singleBuffer)
+      : panel {panel}, expected(screenSize * screenSize, 0) {
+      lvsim::SetSingleBuffer(singleBuffer);
+      lcd.reset(new Pinetime::Drivers::St7789(lcdSpi, Pinetime::PinMap::LcdDataCommand));
+      lvgl.reset(new LittleVgl(*lcd, touchPanel));
+      lcd->Init();
+      lvgl->Init();
+      for (uint16_t y = 0; y < screenSize; y++) {
+        for (uint16_t x = 0; x < screenSize; x++) {
+          expected[y * screenSize + x] = panel.Panel(x, y);
+        }
+      }
+    }
+
+    // Returns the line of the report
+    std::string Run(const Scenario& scenario, uint32_t renderCost) {
+      frame++;
+      const auto start = nrfsim::Now();
+      const auto startWait = lvsim::WaitTime();
+      const auto startSpim = nrfsim::GetSpimStatistics();
+      const auto startInterrupts = nrfsim::GetInterruptStatistics();
+      const auto startPanel = panel.GetStatistics();
+
+      if (scenario.direction != LittleVgl::FullRefreshDirections::None) {
+        lvgl->SetFullRefresh(scenario.direction);
+      }
+      for (const auto& area : scenario.areas) {
+        lvsim::Invalidate(area);
+      }
+      lvsim::Refresh([this, renderCost](const lv_area_t& area, lv_color_t* buffer) {
+        Render(area, buffer, renderCost);
+      });
+      const auto refreshEnd = nrfsim::Now();
+      nrfsim::WaitUntil(
+        []() {
+          return !lvsim::Flushing();
+        },
+        nrfsim::Forever);
+      const auto end = nrfsim::Now();
+
+      const auto& spim = nrfsim::GetSpimStatistics();
+      const auto& interrupts = nrfsim::GetInterruptStatistics();
+      const auto& flush = lvgl->GetFlushStatistics();
+      const bool ok = CheckPanel();
+      if (!ok) {
+        fprintf(stderr, "%s: the panel does not show the rendered frame\n", scenario.name);
+      }
+
+      std::ostringstream line;
+      line << scenario.name << ',' << (end - start) / 1000 << ',' << (refreshEnd - start) / 1000 << ','
+           << (lvsim::WaitTime() - startWait) / 1000 << ',' << flush.time << ',' << flush.areas << ','
+           << spim.transfers - startSpim.transfers << ','
+           << (interrupts.spim0 - startInterrupts.spim0) + (interrupts.timer3 - startInterrupts.timer3) << ','
+           << panel.GetStatistics().addressWindows - startPanel.addressWindows << ',' << spim.bytes - startSpim.bytes << ','
+           << (ok ? 1 : 0);
+      return line.str();
+    }
+
+  private:
+    void Render(const lv_area_t& area, lv_color_t* buffer, uint32_t renderCost) {
+      const uint16_t width = area.x2 - area.x1 + 1;
+      for (lv_coord_t y = area.y1; y <= area.y2; y++) {
+        for (lv_coord_t x = area.x1; x <= area.x2; x++) {
+          const auto value = Pattern(x, y, frame);
+          expected[y * screenSize + x] = value;
+          // LV_COLOR_16_SWAP: the high byte first in memory
+          auto& pixel = buffer[(y - area.y1) * width + (x - area.x1)];
+          auto* bytes = reinterpret_cast<uint8_t*>(&pixel);
+          bytes[0] = static_cast<uint8_t>(value >> 8);
+          bytes[1] = static_cast<uint8_t>(value & 0xff);
+        }
+      }
+      const uint32_t pixels = width * (area.y2 - area.y1 + 1);
+      nrfsim::Compute(static_cast<nrfsim::Nanoseconds>(pixels) * renderCost);
+    }
+
+    bool CheckPanel() const {
+      for (uint16_t y = 0; y < screenSize; y++) {
+        for (uint16_t x = 0; x < screenSize; x++) {
+          if (panel.Panel(x, y) != expected[y * screenSize + x]) {
+            return false;
+          }
+        }
+      }
+      return true;
+    }
+
+    nrfsim::St7789Model& panel;
+    std::vector<uint16_t> expected;
+    uint32_t frame = 0;
+
+    Pinetime::Drivers::TwiMaster twiMaster {nullptr, 0, Pinetime::PinMap::TwiSda, Pinetime::PinMap::TwiScl};
+    Pinetime::Drivers::Cst816S touchPanel {twiMaster, 0x15};
+    std::unique_ptr<Pinetime::Drivers::St7789> lcd;
+    std::unique_ptr<LittleVgl> lvgl;
+  };
+
+  std::vector<uint32_t> ParseList(const char* text) {
+    std::vector<uint32_t> values;
+    std::istringstream stream(text);
+    std::string value;
+    while (std::getline(stream, value, ',')) {
+      values.push_back(static_cast<uint32_t>(std::strtoul(value.c_str(), nullptr, 10)));
+    }
+    return values;
+  }
+
+  void Usage() {
+    fprintf(stderr,
+            "Usage: display-flush-bench [--render-cost ns,...] [--frames N] [--interrupt-cost ns] [--output report.csv]\n"
+            "  --render-cost    rendering time per pixel, in ns (default: 0,250,500,1000,2000)\n"
+            "  --frames         frames per scenario, the median frame is reported (default: 4)\n"
+            "  --interrupt-cost time spent in each interrupt handler, in ns (default: 2000)\n");
+    exit(1);
+  }
+}
+
+int main(int argc, char** argv) {
+  Options options;
+  for (int i = 1; i < argc; i++) {
+    if (std::strcmp(argv[i], "--render-cost") == 0 && i + 1 < argc) {
+      options.renderCosts = ParseList(argv[++i]);
+    } else if (std::strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+      options.frames = std::max(1, std::atoi(argv[++i]));
+    } else if (std::strcmp(argv[i], "--interrupt-cost") == 0 && i + 1 < argc) {
+      nrfsim::GetConfiguration().interruptCost = std::strtoul(argv[++i], nullptr, 10);
+    } else if (std::strcmp(argv[i], "--output") == 0 && i + 1 < argc) {
+      options.outputPath = argv[++i];
+    } else {
+      Usage();
+    }
+  }
+  if (options.renderCosts.empty()) {
+    Usage();
+  }
+
+  FILE* output = stdout;
+  if (options.outputPath != nullptr) {
+    output = fopen(options.outputPath, "w");
+    if (output == nullptr) {
+      perror(options.outputPath);
+      return 1;
+    }
+  }
+
+  // The hardware and the SPI driver of main.cpp
+  Pinetime::Drivers::SpiMaster spi {Pinetime::Drivers::SpiMaster::SpiModule::SPI0,
+                                    {Pinetime::Drivers::SpiMaster::BitOrder::Msb_Lsb,
+                                     Pinetime::Drivers::SpiMaster::Modes::Mode3,
+                                     Pinetime::Drivers::SpiMaster::Frequencies::Freq8Mhz,
+                                     Pinetime::PinMap::SpiSck,
+                                     Pinetime::PinMap::SpiMosi,
+                                     Pinetime::PinMap::SpiMiso}};
+  Pinetime::Drivers::Spi lcdSpi {spi, Pinetime::PinMap::SpiLcdCsn};
+  nrfsim::St7789Model panel;
+  nrfsim::AttachSpiDevice(panel, Pinetime::PinMap::SpiLcdCsn, Pinetime::PinMap::LcdDataCommand);
+  nrfsim::ConnectSpiMasterInterrupts(spi);
+  spi.Init();
+
+  bool allOk = true;
+  fprintf(output, "%s\n", reportHeader);
+  for (bool singleBuffer : {true, false}) {
+    for (auto renderCost : options.renderCosts) {
+      Bench bench(panel, lcdSpi, singleBuffer);
+      for (const auto& scenario : scenarios) {
+        // The frames are identical but for the first one, which may wait for the end of the previous scenario:
+        // the median is reported
+        std::vector<std::pair<uint64_t, std::string>> lines;
+        for (uint32_t i = 0; i < options.frames; i++) {
+          auto line = bench.Run(scenario, renderCost);
+          allOk &= line.back() == '1';
+          lines.emplace_back(std::strtoull(line.c_str() + line.find(',') + 1, nullptr, 10), line);
+        }
+        std::sort(lines.begin(), lines.end());
+        fprintf(output, "%s,%u,%s\n", singleBuffer ? "1" : "2", renderCost, lines[lines.size() / 2].second.c_str());
+      }
+    }
+  }
+
+  if (output != stdout) {
+    fclose(output);
+  }
+  return allOk ? 0 : 2;
+}
@@ -0,0 +1,564 @@
+/*
+ * Time spent reading the file system of the firmware (FS, its read cache, SpiNorFlash, Spi and SpiMaster) to mount it,
+ * look up the resources, and load and draw the fonts of the watch faces, on a simulated nRF52832.
+ *
+ * The drivers run on the host, on the models of sim/: the SPIM at 8MHz with EasyDMA, the interrupts, FreeRTOS and the
+ * NOR flash memory. littlefs is replaced by a model of its read path (sim/Littlefs.h), which asks FS for the same
+ * reads as littlefs would: the file system is generated by this program, with the fonts of the watch faces in the
+ * format of lv_font_conv (the glyphs are synthetic) and the images. The fonts are read by StreamingFont, the images
+ * through the lv_fs driver of FS, like the image decoder of LVGL.
+ *
+ * Each scenario is run on a newly mounted file system, then run again: the second run shows the effect of the lines
+ * left in the cache. The reads that littlefs asked to FS are then replayed directly on SpiNorFlash, which gives the
+ * time without the cache. Only the time of the bus and of the drivers is simulated: the time spent by the CPU in
+ * littlefs and in StreamingFont is not counted.
+ *
+ * The data read is checked against the content of the generated files.
+ *
+ * See README.md for the scenarios and the report.
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "components/fs/FS.h"
+#include "displayapp/StreamingFont.h"
+#include "drivers/PinMap.h"
+#include "drivers/Spi.h"
+#include "drivers/SpiMaster.h"
+#include "drivers/SpiNorFlash.h"
+#include "sim/Interrupts.h"
+#include "sim/Littlefs.h"
+#include "sim/Peripherals.h"
+#include "sim/Simulator.h"
+#include "sim/SpiNorFlashModel.h"
+
+using Pinetime::Components::StreamingFont;
+using Pinetime::Controllers::FS;
+
+namespace {
+  constexpr const char* reportHeader =
+    "scenario,run,time_us,sector_reads,flash_reads,flash_bytes,hits,misses,uncached_us,uncached_reads,uncached_bytes,ok";
+  // Start of the file system in the flash memory (FS.h)
+  constexpr uint32_t fsAddress = 0x0B4000;
+
+  struct Options {
+    const char* outputPath = nullptr;
+  };
+
+  uint32_t Hash(uint32_t a, uint32_t b, uint32_t c = 0) {
+    uint32_t value = (a * 2654435761U) ^ (b * 40503U) ^ (c * 2246822519U);
+    return value ^ (value >> 15);
+  }
+
+  void AppendLe(std::vector<uint8_t>& data, uint32_t value, uint8_t size) {
+    for (uint8_t i = 0; i < size; i++) {
+      data.push_back(static_cast<uint8_t>(value >> (8 * i)));
+    }
+  }
+
+  void Align(std::vector<uint8_t>& data) {
+    while (data.size() % 4 != 0) {
+      data.push_back(0);
+    }
+  }
+
+  // Bits written MSB first, as in the glyph table of lv_font_conv
+  class BitWriter {
+  public:
+    explicit BitWriter(std::vector<uint8_t>& data) : data {data} {
+    }
+
+    void Write(uint32_t value, uint8_t nbBits) {
+      for (uint8_t i = nbBits; i > 0; i--) {
+        if (position % 8 == 0) {
+          data.push_back(0);
+        }
+        if (((value >> (i - 1)) & 1) != 0) {
+          data.back() |= 0x80 >> (position % 8);
+        }
+        position++;
+      }
+    }
+
+  private:
+    std::vector<uint8_t>& data;
+    uint32_t position = 0;
+  };
+
+  /*
+   * Font in the binary format of lv_font_conv (--format bin --bpp 1 --no-compress): the tables head, cmap (a sparse
+   * range), loca (16 bits offsets) and glyf, without kerning. The glyphs of the symbols have the size of the glyphs of
+   * a real font, their pixels are a pattern.
+   */
+  class FontFile {
+  public:
+    FontFile(const char* path, uint16_t size, const char* symbols) : path {path}, size {size} {
+      for (const char* symbol = symbols; *symbol != '\0'; symbol++) {
+        if (std::strchr(codes.c_str(), *symbol) == nullptr) {
+          codes.push_back(*symbol);
+        }
+      }
+      std::sort(codes.begin(), codes.end());
+    }
+
+    struct Glyph {
+      uint16_t advanceWidth;
+      uint16_t width;
+      uint16_t height;
+      int16_t offsetX;
+      int16_t offsetY;
+    };
+
+    Glyph GetGlyph(char code) const {
+      if (code == ' ') {
+        return {static_cast<uint16_t>(size / 4), 0, 0, 0, 0};
+      }
+      const uint32_t hash = Hash(size, code);
+      const uint16_t width = size * (35 + hash % 25) / 100;
+      const uint16_t height = size * (60 + (hash >> 8) % 15) / 100;
+      return {static_cast<uint16_t>(width + size / 10), width, height, static_cast<int16_t>((hash >> 16) % 4),
+              static_cast<int16_t>(-static_cast<int16_t>((hash >> 20) % 8))};
+    }
+
+    bool Pixel(char code, uint16_t x, uint16_t y) const {
+      return (Hash(code, x, y + size) & 0x10) != 0;
+    }
+
+    std::vector<uint8_t> Bitmap(char code) const {
+      std::vector<uint8_t> bitmap;
+      BitWriter writer(bitmap);
+      const Glyph glyph = GetGlyph(code);
+      for (uint16_t y = 0; y < glyph.height; y++) {
+        for (uint16_t x = 0; x < glyph.width; x++) {
+          writer.Write(Pixel(code, x, y) ? 1 : 0, 1);
+        }
+      }
+      return bitmap;
+    }
+
+    std::vector<uint8_t> Content() const {
+      std::vector<uint8_t> data;
+      AppendTable(data, "head", [this](std::vector<uint8_t>& table) {
+        AppendLe(table, 1, 4);                       // version
+        AppendLe(table, 3, 2);                       // tablesCount
+        AppendLe(table, size, 2);                    // fontSize
+        AppendLe(table, size * 8 / 10, 2);           // ascent
+        AppendLe(table, -(size * 2 / 10), 2);        // descent
+        AppendLe(table, size * 8 / 10, 2);           // typoAscent
+        AppendLe(table, -(size * 2 / 10), 2);        // typoDescent
+        AppendLe(table, 0, 2);                       // typoLineGap
+        AppendLe(table, -(size * 2 / 10), 2);        // minY
+        AppendLe(table, size * 8 / 10, 2);           // maxY
+        AppendLe(table, 0, 2);                       // defaultAdvanceWidth
+        AppendLe(table, 0, 2);                       // kerningScale
+        table.insert(table.end(), {0, 0, 0, 1});     // indexToLocFormat, glyphIdFormat, advanceWidthFormat, bpp
+        table.insert(table.end(), {xyBits, whBits}); // xyBits, whBits
+        table.insert(table.end(), {advanceWidthBits, 0, 0, 0});
+        AppendLe(table, -2, 2); // underlinePosition
+        AppendLe(table, 1, 2);  // underlineThickness
+      });
+      AppendTable(data, "cmap", [this](std::vector<uint8_t>& table) {
+        AppendLe(table, 1, 4);
+        // The data of the cmap follows its header, the offset is from the start of the table
+        const uint8_t rangeStart = codes.front();
+        AppendLe(table, 8 + 4 + 16, 4);
+        AppendLe(table, rangeStart, 4);
+        AppendLe(table, codes.back() - rangeStart + 1, 2);
+        AppendLe(table, 1, 2);
+        AppendLe(table, codes.size(), 2);
+        table.insert(table.end(), {3, 0}); // SparseTiny
+        for (char code : codes) {
+          AppendLe(table, code - rangeStart, 2);
+        }
+      });
+      std::vector<uint8_t> glyphs;
+      std::vector<uint16_t> locations;
+      AppendTable(glyphs, "glyf", [this, &locations](std::vector<uint8_t>& table) {
+        // The glyph 0 is reserved. The locations are relative to the start of the table, label included.
+        locations.push_back(8);
+        for (char code : codes) {
+          locations.push_back(8 + table.size());
+          std::vector<uint8_t> glyph;
+          BitWriter writer(glyph);
+          const Glyph description = GetGlyph(code);
+          writer.Write(description.advanceWidth, advanceWidthBits);
+          writer.Write(description.offsetX, xyBits);
+          writer.Write(description.offsetY, xyBits);
+          writer.Write(description.width, whBits);
+          writer.Write(description.height, whBits);
+          for (uint16_t y = 0; y < description.height; y++) {
+            for (uint16_t x = 0; x < description.width; x++) {
+              writer.Write(Pixel(code, x, y) ? 1 : 0, 1);
+            }
+          }
+          table.insert(table.end(), glyph.begin(), glyph.end());
+        }
+      });
+      AppendTable(data, "loca", [&locations](std::vector<uint8_t>& table) {
+        AppendLe(table, locations.size(), 4);
+        for (uint16_t location : locations) {
+          AppendLe(table, location, 2);
+        }
+      });
+      data.insert(data.end(), glyphs.begin(), glyphs.end());
+      return data;
+    }
+
+    const char* path;
+
+  private:
+    static constexpr uint8_t xyBits = 5;
+    static constexpr uint8_t whBits = 8;
+    static constexpr uint8_t advanceWidthBits = 8;
+
+    static void AppendTable(std::vector<uint8_t>& data, const char* label, const std::function<void(std::vector<uint8_t>&)>& fill) {
+      std::vector<uint8_t> table;
+      fill(table);
+      Align(table);
+      AppendLe(data, 8 + table.size(), 4);
+      data.insert(data.end(), label, label + 4);
+      data.insert(data.end(), table.begin(), table.end());
+    }
+
+    uint16_t size;
+    std::string codes;
+  };
+
+  // The fonts of resources/fonts.json
+  const std::vector<FontFile> fonts = {
+    {"/fonts/teko.bin", 28, "0123456789:/ampMonTueWdhFriSt "},
+    {"/fonts/bebas.bin", 120, "0123456789:"},
+    {"/fonts/lv_font_dots_40.bin", 40, "0123456789-MONTUEWEDTHUFRISATSUN WK"},
+    {"/fonts/7segments_40.bin", 40, "0123456789: -"},
+    {"/fonts/7segments_115.bin", 115, "0123456789: -"},
+  };
+
+  // The image of resources/images.json: LVGL image header, then 23x31 pixels of 3 bytes (CF_TRUE_COLOR_ALPHA)
+  constexpr const char* imagePath = "/images/pine_small.bin";
+  constexpr uint16_t imageWidth = 23;
+  constexpr uint16_t imageHeight = 31;
+  constexpr uint8_t imagePixelSize = 3;
+
+  std::vector<uint8_t> ImageContent() {
+    std::vector<uint8_t> data;
+    AppendLe(data, 5 | (imageWidth << 10) | (imageHeight << 21), 4);
+    for (uint32_t i = 0; i < imageWidth * imageHeight * imagePixelSize; i++) {
+      data.push_back(static_cast<uint8_t>(Hash(i, 7)));
+    }
+    return data;
+  }
+
+  // CRC32 of zlib, computed independently from FS
+  uint32_t Crc32(const std::vector<uint8_t>& data) {
+    uint32_t crc = 0xffffffff;
+    for (uint8_t byte : data) {
+      crc ^= byte;
+      for (uint8_t i = 0; i < 8; i++) {
+        crc = (crc >> 1) ^ ((crc & 1) != 0 ? 0xedb88320 : 0);
+      }
+    }
+    return crc ^ 0xffffffff;
+  }
+
+  const FontFile* FindFont(const char* path) {
+    for (const auto& font : fonts) {
+      if (std::strcmp(font.path, path) == 0) {
+        return &font;
+      }
+    }
+    return nullptr;
+  }
+
+  // Loads the font and draws the text as an LVGL label does: the description of each letter, then its bitmap
+  bool DrawText(FS& fs, const char* path, const char* text) {
+    const FontFile* expected = FindFont(path);
+    StreamingFont streamingFont(fs);
+    const lv_font_t* font = streamingFont.Load(path);
+    if (font == nullptr || expected == nullptr) {
+      fprintf(stderr, "%s: the font cannot be loaded\n", path);
+      return false;
+    }
+    bool ok = true;
+    for (const char* letter = text; *letter != '\0'; letter++) {
+      lv_font_glyph_dsc_t dsc;
+      if (!font->get_glyph_dsc(font, &dsc, *letter, letter[1])) {
+        fprintf(stderr, "%s: no glyph for '%c'\n", path, *letter);
+        ok = false;
+        continue;
+      }
+      const auto glyph = expected->GetGlyph(*letter);
+      if (dsc.adv_w != glyph.advanceWidth || dsc.box_w != glyph.width || dsc.box_h != glyph.height ||
+          dsc.ofs_x != glyph.offsetX || dsc.ofs_y != glyph.offsetY || dsc.bpp != 1) {
+        fprintf(stderr, "%s: wrong description of '%c'\n", path, *letter);
+        ok = false;
+        continue;
+      }
+      if (dsc.box_w * dsc.box_h == 0) {
+        continue;
+      }
+      const uint8_t* bitmap = font->get_glyph_bitmap(font, *letter);
+      const auto expectedBitmap = expected->Bitmap(*letter);
+      if (bitmap == nullptr || std::memcmp(bitmap, expectedBitmap.data(), expectedBitmap.size()) != 0) {
+        fprintf(stderr, "%s: wrong bitmap of '%c'\n", path, *letter);
+        ok = false;
+      }
+    }
+    return ok;
+  }
+
+  // Reads the image through the lv_fs driver as the image decoder of LVGL 7 does: the header when the source is set
+  // (info), then each line when the image is drawn
+  bool DrawImage(const std::vector<uint8_t>& expected) {
+    lv_fs_file_t file;
+    uint8_t header[4];
+    uint32_t read = 0;
+    if (lv_fs_open(&file, "F:/images/pine_small.bin", LV_FS_MODE_RD) != LV_FS_RES_OK) {
+      fprintf(stderr, "%s: the image cannot be opened\n", imagePath);
+      return false;
+    }
+    bool ok = lv_fs_read(&file, header, sizeof(header), &read) == LV_FS_RES_OK && read == sizeof(header) &&
+              std::memcmp(header, expected.data(), sizeof(header)) == 0;
+    lv_fs_close(&file);
+
+    if (lv_fs_open(&file, "F:/images/pine_small.bin", LV_FS_MODE_RD) != LV_FS_RES_OK) {
+      return false;
+    }
+    uint8_t line[imageWidth * imagePixelSize];
+    for (uint16_t y = 0; y < imageHeight && ok; y++) {
+      const uint32_t position = sizeof(header) + y * sizeof(line);
+      ok = lv_fs_seek(&file, position) == LV_FS_RES_OK && lv_fs_read(&file, line, sizeof(line), &read) == LV_FS_RES_OK &&
+           read == sizeof(line) && std::memcmp(line, expected.data() + position, sizeof(line)) == 0;
+    }
+    lv_fs_close(&file);
+    if (!ok) {
+      fprintf(stderr, "%s: wrong content\n", imagePath);
+    }
+    return ok;
+  }
+
+  struct Scenario {
+    const char* name;
+    // The scenario mounts the file system: it is run once
+    bool mount;
+    std::function<bool(FS&)> run;
+  };
+
+  bool Available(FS& fs, std::initializer_list<const char*> paths) {
+    bool ok = true;
+    for (const char* path : paths) {
+      if (!fs.ResourceAvailable(path)) {
+        fprintf(stderr, "%s: not available\n", path);
+        ok = false;
+      }
+    }
+    return ok;
+  }
+
+  std::vector<Scenario> Scenarios(const std::vector<uint8_t>& image, uint32_t bebasCrc, uint32_t bebasSize) {
+    return {
+      {"mount", true, [](FS& fs) {
+         fs.Init();
+         return true;
+       }},
+      {"stat", false, [](FS& fs) {
+         return Available(fs, {"/fonts/teko.bin", "/fonts/bebas.bin", imagePath});
+       }},
+      {"teko", false, [](FS& fs) {
+         return DrawText(fs, "/fonts/teko.bin", "Tue 14");
+       }},
+      {"bebas", false, [](FS& fs) {
+         return DrawText(fs, "/fonts/bebas.bin", "1042");
+       }},
+      {"dots-40", false, [](FS& fs) {
+         return DrawText(fs, "/fonts/lv_font_dots_40.bin", "TUE WK 42");
+       }},
+      {"7segments-40", false, [](FS& fs) {
+         return DrawText(fs, "/fonts/7segments_40.bin", " 14-10");
+       }},
+      {"7segments-115", false, [](FS& fs) {
+         return DrawText(fs, "/fonts/7segments_115.bin", "10:42");
+       }},
+      // The screens of the watch faces (WatchFaceInfineat, WatchFaceCasioStyleG7710) when they are opened
+      {"infineat", false, [&image](FS& fs) {
+         bool ok = Available(fs, {"/fonts/teko.bin", "/fonts/bebas.bin", imagePath});
+         ok &= DrawText(fs, "/fonts/bebas.bin", "10");
+         ok &= DrawText(fs, "/fonts/bebas.bin", "42");
+         ok &= DrawText(fs, "/fonts/teko.bin", "Tue 14");
+         return ok & DrawImage(image);
+       }},
+      {"casio", false, [](FS& fs) {
+         bool ok = Available(fs, {"/fonts/lv_font_dots_40.bin", "/fonts/7segments_40.bin", "/fonts/7segments_115.bin"});
+         ok &= DrawText(fs, "/fonts/7segments_115.bin", "10:42");
+         ok &= DrawText(fs, "/fonts/7segments_40.bin", " 14-10");
+         ok &= DrawText(fs, "/fonts/lv_font_dots_40.bin", "TUE");
+         return ok & DrawText(fs, "/fonts/lv_font_dots_40.bin", "287- 78");
+       }},
+      // The companion application asks the hash of a file before uploading it
+      {"file-hash", false, [bebasCrc, bebasSize](FS& fs) {
+         uint32_t hash = 0;
+         uint32_t size = 0;
+         const bool ok = fs.FileHash("/fonts/bebas.bin", hash, size) == 0 && hash == bebasCrc && size == bebasSize;
+         if (!ok) {
+           fprintf(stderr, "/fonts/bebas.bin: wrong hash\n");
+         }
+         return ok;
+       }},
+      {"list", false, [](FS& fs) {
+         lfs_dir_t dir;
+         lfs_info info;
+         uint32_t entries = 0;
+         if (fs.DirOpen("/fonts", &dir) != 0) {
+           return false;
+         }
+         while (fs.DirRead(&dir, &info) > 0) {
+           entries++;
+         }
+         fs.DirClose(&dir);
+         // ".", ".." and the fonts
+         const bool ok = entries == 2 + fonts.size();
+         if (!ok) {
+           fprintf(stderr, "/fonts: wrong list\n");
+         }
+         return ok;
+       }},
+    };
+  }
+
+  class Bench {
+  public:
+    Bench(Pinetime::Drivers::SpiNorFlash& flashDriver, nrfsim::SpiNorFlashModel& flash)
+      : flashDriver {flashDriver}, flash {flash} {
+    }
+
+    // Returns the lines of the report
+    std::vector<std::string> Run(const Scenario& scenario) {
+      std::unique_ptr<FS> fs(new FS(flashDriver));
+      if (!scenario.mount) {
+        fs->Init();
+      }
+      std::vector<std::string> lines;
+      for (uint32_t run = 1; run <= (scenario.mount ? 1 : 2); run++) {
+        std::vector<lfssim::BlockRead> trace;
+        const auto start = nrfsim::Now();
+        const auto startFlash = flash.GetStatistics();
+        const auto startCache = fs->GetCacheStatistics();
+        lfssim::TraceReads(&trace);
+        const bool ok = scenario.run(*fs);
+        lfssim::TraceReads(nullptr);
+        const auto end = nrfsim::Now();
+        const auto& flashStatistics = flash.GetStatistics();
+        const auto& cache = fs->GetCacheStatistics();
+
+        std::ostringstream line;
+        line << scenario.name << ',' << run << ',' << (end - start) / 1000 << ',' << trace.size() << ','
+             << flashStatistics.reads - startFlash.reads << ',' << flashStatistics.readBytes - startFlash.readBytes << ','
+             << cache.hits - startCache.hits << ',' << cache.misses - startCache.misses << ',' << Replay(trace) << ','
+             << (ok ? 1 : 0);
+        lines.push_back(line.str());
+      }
+      return lines;
+    }
+
+  private:
+    // The same reads, directly on the flash memory: returns the time, the number of reads and the bytes read
+    std::string Replay(const std::vector<lfssim::BlockRead>& trace) {
+      std::vector<uint8_t> buffer;
+      uint64_t bytes = 0;
+      const auto start = nrfsim::Now();
+      for (const auto& read : trace) {
+        buffer.resize(read.size);
+        flashDriver.Read(fsAddress + read.block * FS::getBlockSize() + read.off, buffer.data(), read.size);
+        bytes += read.size;
+      }
+      std::ostringstream result;
+      result << (nrfsim::Now() - start) / 1000 << ',' << trace.size() << ',' << bytes;
+      return result.str();
+    }
+
+    Pinetime::Drivers::SpiNorFlash& flashDriver;
+    nrfsim::SpiNorFlashModel& flash;
+  };
+
+  void Usage() {
+    fprintf(stderr,
+            "Usage: fs-cache-bench [--interrupt-cost ns] [--output report.csv]\n"
+            "  --interrupt-cost time spent in each interrupt handler, in ns (default: 2000)\n");
+    exit(1);
+  }
+}
+
+int main(int argc, char** argv) {
+  Options options;
+  for (int i = 1; i < argc; i++) {
+    if (std::strcmp(argv[i], "--interrupt-cost") == 0 && i + 1 < argc) {
+      nrfsim::GetConfiguration().interruptCost = std::strtoul(argv[++i], nullptr, 10);
+    } else if (std::strcmp(argv[i], "--output") == 0 && i + 1 < argc) {
+      options.outputPath = argv[++i];
+    } else {
+      Usage();
+    }
+  }
+
+  FILE* output = stdout;
+  if (options.outputPath != nullptr) {
+    output = fopen(options.outputPath, "w");
+    if (output == nullptr) {
+      perror(options.outputPath);
+      return 1;
+    }
+  }
+
+  // The hardware and the drivers of main.cpp
+  Pinetime::Drivers::SpiMaster spi {Pinetime::Drivers::SpiMaster::SpiModule::SPI0,
+                                    {Pinetime::Drivers::SpiMaster::BitOrder::Msb_Lsb,
+                                     Pinetime::Drivers::SpiMaster::Modes::Mode3,
+                                     Pinetime::Drivers::SpiMaster::Frequencies::Freq8Mhz,
+                                     Pinetime::PinMap::SpiSck,
+                                     Pinetime::PinMap::SpiMosi,
+                                     Pinetime::PinMap::SpiMiso}};
+  Pinetime::Drivers::Spi flashSpi {spi, Pinetime::PinMap::SpiFlashCsn};
+  nrfsim::SpiNorFlashModel flash;
+  nrfsim::AttachSpiDevice(flash, Pinetime::PinMap::SpiFlashCsn, nrfsim::NoPin);
+  nrfsim::ConnectSpiMasterInterrupts(spi);
+  spi.Init();
+  Pinetime::Drivers::SpiNorFlash flashDriver {flashSpi};
+  flashDriver.Init();
+
+  // The resources installed by the companion application, and the settings
+  lfssim::Image image(FS::getBlockSize(), FS::getSize() / FS::getBlockSize());
+  image.AddDirectory("/fonts");
+  image.AddDirectory("/images");
+  std::vector<uint8_t> bebas;
+  for (const auto& font : fonts) {
+    image.AddFile(font.path, font.Content());
+    if (std::strcmp(font.path, "/fonts/bebas.bin") == 0) {
+      bebas = font.Content();
+    }
+  }
+  const auto pine = ImageContent();
+  image.AddFile(imagePath, pine);
+  image.AddFile("/settings.dat", std::vector<uint8_t>(64, 0x5a));
+  image.Write(flash.Memory() + fsAddress);
+
+  bool allOk = true;
+  fprintf(output, "%s\n", reportHeader);
+  Bench bench(flashDriver, flash);
+  for (const auto& scenario : Scenarios(pine, Crc32(bebas), bebas.size())) {
+    for (const auto& line : bench.Run(scenario)) {
+      allOk &= line.back() == '1';
+      fprintf(output, "%s\n", line.c_str());
+    }
+  }
+
+  if (output != stdout) {
+    fclose(output);
+  }
+  return allOk ? 0 : 2;
+}
@@ -0,0 +1,132 @@
+#include <FreeRTOS.h>
+#include <libraries/delay/nrf_delay.h>
+#include <semphr.h>
+#include <task.h>
+#include <memory>
+#include <vector>
+#include "sim/Simulator.h"
+
+using namespace nrfsim;
+
+struct tskTaskControlBlock {
+  uint32_t notifications = 0;
+};
+
+struct QueueDefinition {
+  UBaseType_t count;
+  UBaseType_t maxCount;
+};
+
+namespace {
+  // The task of the program (the display task, for the firmware)
+  tskTaskControlBlock task;
+  std::vector<std::unique_ptr<QueueDefinition>> semaphores;
+
+  Nanoseconds TicksToNanoseconds(TickType_t ticks) {
+    if (ticks == portMAX_DELAY) {
+      return Forever;
+    }
+    return static_cast<Nanoseconds>(ticks) * 1000000000ULL / configTICK_RATE_HZ;
+  }
+
+  SemaphoreHandle_t CreateSemaphore(UBaseType_t maxCount, UBaseType_t initialCount) {
+    semaphores.push_back(std::unique_ptr<QueueDefinition>(new QueueDefinition {initialCount, maxCount}));
+    return semaphores.back().get();
+  }
+}
+
+void vPortEnterCritical() {
+  EnterCritical();
+}
+
+void vPortExitCritical() {
+  ExitCritical();
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle() {
+  return &task;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t xClearCountOnExit, TickType_t xTicksToWait) {
+  WaitUntil(
+    []() {
+      return task.notifications > 0;
+    },
+    TicksToNanoseconds(xTicksToWait));
+  auto value = task.notifications;
+  if (value > 0) {
+    task.notifications = xClearCountOnExit ? 0 : value - 1;
+  }
+  return value;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t xTaskToNotify) {
+  xTaskToNotify->notifications++;
+  return pdPASS;
+}
+
+void vTaskNotifyGiveFromISR(TaskHandle_t xTaskToNotify, BaseType_t* pxHigherPriorityTaskWoken) {
+  xTaskToNotify->notifications++;
+  if (pxHigherPriorityTaskWoken != nullptr) {
+    *pxHigherPriorityTaskWoken = pdTRUE;
+  }
+}
+
+void vTaskDelay(TickType_t xTicksToDelay) {
+  WaitUntil(
+    []() {
+      return false;
+    },
+    TicksToNanoseconds(xTicksToDelay));
+}
+
+TickType_t xTaskGetTickCount() {
+  return static_cast<TickType_t>(Now() * configTICK_RATE_HZ / 1000000000ULL);
+}
+
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t uxMaxCount, UBaseType_t uxInitialCount) {
+  return CreateSemaphore(uxMaxCount, uxInitialCount);
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary() {
+  return CreateSemaphore(1, 0);
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex() {
+  return CreateSemaphore(1, 1);
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t xSemaphore, TickType_t xBlockTime) {
+  if (!WaitUntil(
+        [xSemaphore]() {
+          return xSemaphore->count > 0;
+        },
+        TicksToNanoseconds(xBlockTime))) {
+    return pdFAIL;
+  }
+  xSemaphore->count--;
+  return pdPASS;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t xSemaphore) {
+  if (xSemaphore->count >= xSemaphore->maxCount) {
+    return pdFAIL;
+  }
+  xSemaphore->count++;
+  return pdPASS;
+}
+
+BaseType_t xSemaphoreGiveFromISR(SemaphoreHandle_t xSemaphore, BaseType_t* pxHigherPriorityTaskWoken) {
+  if (pxHigherPriorityTaskWoken != nullptr) {
+    *pxHigherPriorityTaskWoken = pdFALSE;
+  }
+  return xSemaphoreGive(xSemaphore);
+}
+
+void nrf_delay_us(uint32_t us) {
+  Compute(static_cast<Nanoseconds>(us) * 1000);
+}
+
+void nrf_delay_ms(uint32_t ms) {
+  Compute(static_cast<Nanoseconds>(ms) * 1000000);
+}
@@ -0,0 +1,47 @@
+#include <array>
+#include <hal/nrf_gpio.h>
+#include "sim/Peripherals.h"
+
+namespace {
+  // The pins are high until they are driven: the SPI devices are not selected before their CS pin is configured
+  std::array<bool, 32> levels = [] {
+    std::array<bool, 32> result;
+    result.fill(true);
+    return result;
+  }();
+
+  void Drive(uint32_t pin, bool level) {
+    if (pin >= levels.size()) {
+      nrfsim::Fail(__FILE__, __LINE__, "invalid pin");
+    }
+    if (levels[pin] != level) {
+      levels[pin] = level;
+      nrfsim::OnPinChange(pin, level);
+    }
+  }
+}
+
+bool nrfsim::PinLevel(uint8_t pin) {
+  return pin < levels.size() && levels[pin];
+}
+
+void nrf_gpio_cfg_output(uint32_t /*pin*/) {
+}
+
+void nrf_gpio_cfg_input(uint32_t /*pin*/, nrf_gpio_pin_pull_t /*pull*/) {
+}
+
+void nrf_gpio_cfg_default(uint32_t /*pin*/) {
+}
+
+void nrf_gpio_pin_set(uint32_t pin) {
+  Drive(pin, true);
+}
+
+void nrf_gpio_pin_clear(uint32_t pin) {
+  Drive(pin, false);
+}
+
+uint32_t nrf_gpio_pin_read(uint32_t pin) {
+  return nrfsim::PinLevel(pin) ? 1 : 0;
+}
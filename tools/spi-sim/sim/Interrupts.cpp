@@ -0,0 +1,30 @@
+#include "sim/Interrupts.h"
+#include "drivers/SpiMaster.h"
+#include "sim/Simulator.h"
+
+void nrfsim::ConnectSpiMasterInterrupts(Pinetime::Drivers::SpiMaster& spi) {
+  // SPIM0_SPIS0_TWIM0_TWIS0_SPI0_TWI0_IRQHandler() of main.cpp
+  ConnectInterrupt(SPIM0_SPIS0_TWIM0_TWIS0_SPI0_TWI0_IRQn, [&spi]() {
+    if (((NRF_SPIM0->INTENSET & (1 << 6)) != 0) && NRF_SPIM0->EVENTS_END == 1) {
+      NRF_SPIM0->EVENTS_END = 0;
+      spi.OnEndEvent();
+    }
+
+    if (((NRF_SPIM0->INTENSET & (1 << 19)) != 0) && NRF_SPIM0->EVENTS_STARTED == 1) {
+      NRF_SPIM0->EVENTS_STARTED = 0;
+      spi.OnStartedEvent();
+    }
+
+    if (((NRF_SPIM0->INTENSET & (1 << 1)) != 0) && NRF_SPIM0->EVENTS_STOPPED == 1) {
+      NRF_SPIM0->EVENTS_STOPPED = 0;
+    }
+  });
+
+  // TIMER3_IRQHandler() of main.cpp
+  ConnectInterrupt(TIMER3_IRQn, [&spi]() {
+    if (NRF_TIMER3->EVENTS_COMPARE[1] == 1) {
+      NRF_TIMER3->EVENTS_COMPARE[1] = 0;
+      spi.OnArrayListEndEvent();
+    }
+  });
+}
@@ -0,0 +1,12 @@
+#pragma once
+
+namespace Pinetime {
+  namespace Drivers {
+    class SpiMaster;
+  }
+}
+
+namespace nrfsim {
+  // Connects the interrupt handlers of the SPIM0 and the TIMER3 to the driver, like main.cpp does
+  void ConnectSpiMasterInterrupts(Pinetime::Drivers::SpiMaster& spi);
+}
@@ -0,0 +1,922 @@
+#include "sim/Littlefs.h"
+#include <littlefs/lfs_util.h>
+#include <nrf.h>
+#include <algorithm>
+#include <cstring>
+#include <map>
+#include <memory>
+
+using namespace lfssim;
+
+namespace {
+  // Tags: bit 31 is 0 for a valid tag, then the type (11 bits), the id (10 bits) and the size of the data (10 bits).
+  // On the flash memory, each tag is big endian and XORed with the previous one (0xffffffff for the first one), so
+  // that the tags can be walked backward from the end of the commit, and that the erased memory ends the commit.
+  enum Types : uint16_t {
+    Superblock = 0x0ff,
+    DirStruct = 0x200,
+    InlineStruct = 0x201,
+    CtzStruct = 0x202,
+    UserAttribute = 0x300,
+    SoftTail = 0x600,
+    Crc = 0x500,
+    MoveState = 0x7ff,
+  };
+  // Masks of the types: the family (name, struct, attribute,...), and the exact type
+  constexpr uint16_t familyMask = 0x700;
+  constexpr uint16_t nameMask = 0x780;
+  constexpr uint16_t typeMask = 0x7ff;
+
+  constexpr uint16_t noId = 0x3ff;
+  constexpr lfs_block_t noBlock = 0xffffffff;
+  constexpr uint32_t superblockVersion = 0x00020000;
+  constexpr lfs_size_t superblockSize = 24;
+  // lfs_file_t::flags: the position of the file in the CTZ list (block and off) is known
+  constexpr uint32_t fileReading = 0x100000;
+
+  std::vector<BlockRead>* trace = nullptr;
+  // The firmware never unmounts the file system: the read cache of each lfs_t is kept here, and replaced when it is
+  // mounted again
+  std::map<const lfs_t*, std::unique_ptr<uint8_t[]>> readCaches;
+
+  uint32_t MakeTag(uint16_t type, uint16_t id, lfs_size_t size) {
+    return (static_cast<uint32_t>(type) << 20) | (static_cast<uint32_t>(id) << 10) | size;
+  }
+
+  bool TagValid(uint32_t tag) {
+    return (tag & 0x80000000) == 0;
+  }
+
+  uint16_t TagType(uint32_t tag) {
+    return (tag & 0x7ff00000) >> 20;
+  }
+
+  uint16_t TagId(uint32_t tag) {
+    return (tag & 0x000ffc00) >> 10;
+  }
+
+  lfs_size_t TagSize(uint32_t tag) {
+    return tag & 0x3ff;
+  }
+
+  lfs_size_t TagDiskSize(uint32_t tag) {
+    return sizeof(tag) + TagSize(tag);
+  }
+
+  uint32_t FromBe32(const uint8_t* data) {
+    return (static_cast<uint32_t>(data[0]) << 24) | (data[1] << 16) | (data[2] << 8) | data[3];
+  }
+
+  void ToBe32(uint8_t* data, uint32_t value) {
+    data[0] = value >> 24;
+    data[1] = value >> 16;
+    data[2] = value >> 8;
+    data[3] = value;
+  }
+
+  uint32_t FromLe32(const uint8_t* data) {
+    return data[0] | (data[1] << 8) | (data[2] << 16) | (static_cast<uint32_t>(data[3]) << 24);
+  }
+
+  void ToLe32(uint8_t* data, uint32_t value) {
+    data[0] = value;
+    data[1] = value >> 8;
+    data[2] = value >> 16;
+    data[3] = value >> 24;
+  }
+
+  /*
+   * Block device (lfs_bd_read and its users)
+   */
+
+  int DeviceRead(lfs_t* lfs, lfs_block_t block, lfs_off_t off, void* buffer, lfs_size_t size) {
+    if (trace != nullptr) {
+      trace->push_back({block, off, size});
+    }
+    return lfs->cfg->read(lfs->cfg, block, off, buffer, size);
+  }
+
+  // Reads through the cache. hint is the size that the caller is likely to read from off: the reads smaller than
+  // hint load the cache (read_size aligned, cache_size at most), the others are read directly.
+  int BdRead(lfs_t* lfs, lfs_cache_t* rcache, lfs_size_t hint, lfs_block_t block, lfs_off_t off, void* buffer, lfs_size_t size) {
+    const lfs_config* cfg = lfs->cfg;
+    auto* data = static_cast<uint8_t*>(buffer);
+    if (block >= cfg->block_count || off + size > cfg->block_size) {
+      return LFS_ERR_CORRUPT;
+    }
+
+    while (size > 0) {
+      lfs_size_t diff = size;
+      if (block == rcache->block && off < rcache->off + rcache->size) {
+        if (off >= rcache->off) {
+          diff = lfs_min(diff, rcache->size - (off - rcache->off));
+          std::memcpy(data, &rcache->buffer[off - rcache->off], diff);
+          data += diff;
+          off += diff;
+          size -= diff;
+          continue;
+        }
+        // The cache holds the data that follows
+        diff = lfs_min(diff, rcache->off - off);
+      }
+
+      if (size >= hint && off % cfg->read_size == 0 && size >= cfg->read_size) {
+        diff = lfs_aligndown(diff, cfg->read_size);
+        int err = DeviceRead(lfs, block, off, data, diff);
+        if (err != 0) {
+          return err;
+        }
+        data += diff;
+        off += diff;
+        size -= diff;
+        continue;
+      }
+
+      rcache->block = block;
+      rcache->off = lfs_aligndown(off, cfg->read_size);
+      rcache->size = lfs_min(lfs_min(lfs_alignup(off + hint, cfg->read_size), cfg->block_size) - rcache->off, cfg->cache_size);
+      int err = DeviceRead(lfs, rcache->block, rcache->off, rcache->buffer, rcache->size);
+      if (err != 0) {
+        rcache->block = noBlock;
+        return err;
+      }
+    }
+    return 0;
+  }
+
+  int BdCrc(lfs_t* lfs, lfs_cache_t* rcache, lfs_size_t hint, lfs_block_t block, lfs_off_t off, lfs_size_t size, uint32_t& crc) {
+    for (lfs_off_t i = 0; i < size; i += 8) {
+      uint8_t data[8];
+      const lfs_size_t diff = lfs_min(size - i, sizeof(data));
+      int err = BdRead(lfs, rcache, hint - i, block, off + i, data, diff);
+      if (err != 0) {
+        return err;
+      }
+      crc = lfs_crc(crc, data, diff);
+    }
+    return 0;
+  }
+
+  // Returns 0 if the data on the flash memory is equal to buffer, 1 if not, or an error
+  int BdCompare(lfs_t* lfs, lfs_cache_t* rcache, lfs_size_t hint, lfs_block_t block, lfs_off_t off, const void* buffer, lfs_size_t size) {
+    const auto* expected = static_cast<const uint8_t*>(buffer);
+    for (lfs_off_t i = 0; i < size; i += 8) {
+      uint8_t data[8];
+      const lfs_size_t diff = lfs_min(size - i, sizeof(data));
+      int err = BdRead(lfs, rcache, hint - i, block, off + i, data, diff);
+      if (err != 0) {
+        return err;
+      }
+      if (std::memcmp(data, expected + i, diff) != 0) {
+        return 1;
+      }
+    }
+    return 0;
+  }
+
+  /*
+   * Metadata pairs (lfs_dir_fetchmatch, lfs_dir_getslice, lfs_dir_find)
+   */
+
+  // Fetches the last valid commit of the pair. While reading the tags, the names of the entries (or the name of the
+  // superblock) are compared with name. Returns the tag of the name found, 0 if none is found, or an error.
+  int32_t Fetch(lfs_t* lfs, lfs_mdir_t* dir, const lfs_block_t pair[2], bool superblock, const char* name, lfs_size_t nameSize) {
+    const lfs_config* cfg = lfs->cfg;
+    uint8_t revisions[2][4];
+    int newest = 0;
+    for (int i = 0; i < 2; i++) {
+      int err = BdRead(lfs, &lfs->rcache, sizeof(revisions[i]), pair[i], 0, revisions[i], sizeof(revisions[i]));
+      if (err != 0) {
+        return err;
+      }
+      if (i == 1 && static_cast<int32_t>(FromLe32(revisions[1]) - FromLe32(revisions[0])) > 0) {
+        newest = 1;
+      }
+    }
+
+    for (int i = 0; i < 2; i++) {
+      const int index = (newest + i) % 2;
+      const lfs_block_t block = pair[index];
+      lfs_off_t off = sizeof(revisions[index]);
+      uint32_t ptag = 0xffffffff;
+      uint32_t crc = lfs_crc(0xffffffff, revisions[index], sizeof(revisions[index]));
+      uint16_t count = 0;
+      int32_t found = 0;
+      lfs_block_t tail[2] = {noBlock, noBlock};
+      bool valid = false;
+
+      while (true) {
+        uint8_t raw[4];
+        if (BdRead(lfs, &lfs->rcache, cfg->block_size, block, off, raw, sizeof(raw)) != 0) {
+          break;
+        }
+        crc = lfs_crc(crc, raw, sizeof(raw));
+        const uint32_t tag = FromBe32(raw) ^ ptag;
+        if (!TagValid(tag) || off + TagDiskSize(tag) > cfg->block_size) {
+          break;
+        }
+        ptag = tag;
+
+        if (TagType(tag) == Crc) {
+          uint8_t expected[4];
+          if (BdRead(lfs, &lfs->rcache, cfg->block_size, block, off + sizeof(tag), expected, sizeof(expected)) != 0 ||
+              FromLe32(expected) != crc) {
+            break;
+          }
+          // The commit is valid
+          dir->pair[0] = block;
+          dir->pair[1] = pair[(index + 1) % 2];
+          dir->rev = FromLe32(revisions[index]);
+          dir->off = off + TagDiskSize(tag);
+          dir->etag = ptag;
+          dir->count = count;
+          dir->tail[0] = tail[0];
+          dir->tail[1] = tail[1];
+          valid = true;
+          crc = 0xffffffff;
+          off += TagDiskSize(tag);
+          continue;
+        }
+
+        int err = BdCrc(lfs, &lfs->rcache, cfg->block_size, block, off + sizeof(tag), TagSize(tag), crc);
+        if (err != 0) {
+          return err;
+        }
+        if (TagId(tag) != noId && TagId(tag) >= count) {
+          count = TagId(tag) + 1;
+        }
+        if (TagType(tag) == SoftTail) {
+          uint8_t data[8];
+          err = BdRead(lfs, &lfs->rcache, cfg->block_size, block, off + sizeof(tag), data, sizeof(data));
+          if (err != 0) {
+            return err;
+          }
+          tail[0] = FromLe32(data);
+          tail[1] = FromLe32(data + 4);
+        }
+
+        const bool nameTag = superblock ? TagType(tag) == Superblock : (TagType(tag) & nameMask) == 0;
+        if (name != nullptr && nameTag) {
+          const lfs_size_t diff = lfs_min(nameSize, TagSize(tag));
+          const int res = BdCompare(lfs, &lfs->rcache, diff, block, off + sizeof(tag), name, diff);
+          if (res < 0) {
+            return res;
+          }
+          if (res == 0 && nameSize == TagSize(tag)) {
+            found = tag;
+          }
+        }
+        off += TagDiskSize(tag);
+      }
+
+      if (valid) {
+        return found;
+      }
+    }
+    return LFS_ERR_CORRUPT;
+  }
+
+  // Looks for the last tag of the entry id with the given type, walking the tags backward from the end of the commit,
+  // and reads its data. Returns the tag or an error.
+  int32_t Get(lfs_t* lfs, const lfs_mdir_t* dir, uint16_t mask, uint16_t type, uint16_t id, void* buffer, lfs_size_t size) {
+    lfs_off_t off = dir->off;
+    uint32_t ntag = dir->etag;
+    while (off >= sizeof(ntag) + TagDiskSize(ntag)) {
+      off -= TagDiskSize(ntag);
+      const uint32_t tag = ntag;
+      uint8_t raw[4];
+      int err = BdRead(lfs, &lfs->rcache, sizeof(raw), dir->pair[0], off, raw, sizeof(raw));
+      if (err != 0) {
+        return err;
+      }
+      ntag = (FromBe32(raw) ^ tag) & 0x7fffffff;
+
+      if (TagId(tag) == id && (TagType(tag) & mask) == type) {
+        const lfs_size_t diff = lfs_min(TagSize(tag), size);
+        err = BdRead(lfs, &lfs->rcache, diff, dir->pair[0], off + sizeof(tag), buffer, diff);
+        if (err != 0) {
+          return err;
+        }
+        std::memset(static_cast<uint8_t*>(buffer) + diff, 0, size - diff);
+        return tag;
+      }
+    }
+    return LFS_ERR_NOENT;
+  }
+
+  int32_t GetPair(lfs_t* lfs, const lfs_mdir_t* dir, uint16_t id, lfs_block_t pair[2]) {
+    uint8_t data[8];
+    const int32_t tag = Get(lfs, dir, typeMask, DirStruct, id, data, sizeof(data));
+    if (tag >= 0) {
+      pair[0] = FromLe32(data);
+      pair[1] = FromLe32(data + 4);
+    }
+    return tag;
+  }
+
+  // Returns the tag of the name of the entry at path, and the metadata pair holding it in dir. The id of the tag is
+  // noId for the root directory.
+  int32_t Find(lfs_t* lfs, lfs_mdir_t* dir, const char* path) {
+    const char* name = path;
+    int32_t tag = MakeTag(LFS_TYPE_DIR, noId, 0);
+    lfs_block_t pair[2] = {lfs->root[0], lfs->root[1]};
+
+    while (true) {
+      name += std::strspn(name, "/");
+      const lfs_size_t nameSize = std::strcspn(name, "/");
+      if (nameSize == 0) {
+        return tag;
+      }
+      if (TagType(tag) != LFS_TYPE_DIR) {
+        return LFS_ERR_NOTDIR;
+      }
+      if (TagId(tag) != noId) {
+        const int32_t res = GetPair(lfs, dir, TagId(tag), pair);
+        if (res < 0) {
+          return res;
+        }
+      }
+
+      tag = Fetch(lfs, dir, pair, false, name, nameSize);
+      if (tag < 0) {
+        return tag;
+      }
+      if (tag == 0) {
+        return LFS_ERR_NOENT;
+      }
+      name += nameSize;
+    }
+  }
+
+  int GetInfo(lfs_t* lfs, const lfs_mdir_t* dir, uint16_t id, lfs_info* info) {
+    std::memset(info, 0, sizeof(*info));
+    if (id == noId) {
+      std::strcpy(info->name, "/");
+      info->type = LFS_TYPE_DIR;
+      return 0;
+    }
+
+    // The name of the superblock (id 0 of the root) is not in the family of the names: LFS_ERR_NOENT
+    int32_t tag = Get(lfs, dir, nameMask, 0, id, info->name, lfs_min(lfs->cfg->name_max + 1, sizeof(info->name)));
+    if (tag < 0) {
+      return tag;
+    }
+    info->type = TagType(tag);
+
+    uint8_t ctz[8];
+    tag = Get(lfs, dir, familyMask, DirStruct, id, ctz, sizeof(ctz));
+    if (tag < 0) {
+      return tag;
+    }
+    if (TagType(tag) == CtzStruct) {
+      info->size = FromLe32(ctz + 4);
+    }
+    return 0;
+  }
+
+  /*
+   * CTZ skip-lists (lfs_ctz_index, lfs_ctz_find)
+   *
+   * Block n of the content of a file starts with ctz(n) + 1 pointers to the blocks n - 2^i (none for block 0), followed
+   * by the data. The metadata point to the last block.
+   */
+
+  // Returns the index of the block holding the byte at off, and converts off to the offset in this block
+  uint32_t CtzIndex(lfs_t* lfs, lfs_off_t& off) {
+    const lfs_off_t size = off;
+    const lfs_off_t b = lfs->cfg->block_size - 2 * 4;
+    lfs_off_t i = size / b;
+    if (i == 0) {
+      return 0;
+    }
+    i = (size - 4 * (lfs_popc(i - 1) + 2)) / b;
+    off = size - b * i - 4 * lfs_popc(i);
+    return i;
+  }
+
+  int CtzFind(lfs_t* lfs, lfs_cache_t* rcache, lfs_block_t head, lfs_size_t size, lfs_off_t pos, lfs_block_t& block, lfs_off_t& off) {
+    if (size == 0) {
+      block = noBlock;
+      off = 0;
+      return 0;
+    }
+
+    lfs_off_t last = size - 1;
+    uint32_t current = CtzIndex(lfs, last);
+    const uint32_t target = CtzIndex(lfs, pos);
+    while (current > target) {
+      const uint32_t skip = lfs_min(lfs_npw2(current - target + 1) - 1, lfs_ctz(current));
+      uint8_t pointer[4];
+      int err = BdRead(lfs, rcache, sizeof(pointer), head, 4 * skip, pointer, sizeof(pointer));
+      if (err != 0) {
+        return err;
+      }
+      head = FromLe32(pointer);
+      current -= 1 << skip;
+    }
+
+    block = head;
+    off = pos;
+    return 0;
+  }
+
+  /*
+   * Image
+   */
+
+  // A single commit in a block
+  class Commit {
+  public:
+    Commit(uint8_t* block, lfs_size_t blockSize, uint32_t revision) : block {block}, blockSize {blockSize} {
+      ToLe32(block, revision);
+      off = 4;
+      crc = lfs_crc(0xffffffff, block, 4);
+    }
+
+    void Add(uint16_t type, uint16_t id, const void* data, lfs_size_t size) {
+      // The CRC tag must fit after the tag
+      if (size >= 0x3ff || off + 4 + size + 8 > blockSize) {
+        nrfsim::Fail(__FILE__, __LINE__, "the entries of a directory do not fit in a block");
+      }
+      const uint32_t tag = MakeTag(type, id, size);
+      ToBe32(block + off, tag ^ ptag);
+      ptag = tag;
+      std::memcpy(block + off + 4, data, size);
+      crc = lfs_crc(crc, block + off, TagDiskSize(tag));
+      off += TagDiskSize(tag);
+    }
+
+    void End() {
+      const uint32_t tag = MakeTag(Crc, noId, 4);
+      ToBe32(block + off, tag ^ ptag);
+      crc = lfs_crc(crc, block + off, 4);
+      ToLe32(block + off + 4, crc);
+      off += TagDiskSize(tag);
+    }
+
+  private:
+    uint8_t* block;
+    const lfs_size_t blockSize;
+    lfs_off_t off;
+    uint32_t ptag = 0xffffffff;
+    uint32_t crc;
+  };
+}
+
+uint32_t lfs_crc(uint32_t crc, const void* buffer, size_t size) {
+  static const uint32_t table[16] = {
+    0x00000000,
+    0x1db71064,
+    0x3b6e20c8,
+    0x26d930ac,
+    0x76dc4190,
+    0x6b6b51f4,
+    0x4db26158,
+    0x5005713c,
+    0xedb88320,
+    0xf00f9344,
+    0xd6d6a3e8,
+    0xcb61b38c,
+    0x9b64c2b0,
+    0x86d3d2d4,
+    0xa00ae278,
+    0xbdbdf21c,
+  };
+
+  const auto* data = static_cast<const uint8_t*>(buffer);
+  for (size_t i = 0; i < size; i++) {
+    crc = (crc >> 4) ^ table[(crc ^ (data[i] >> 0)) & 0xf];
+    crc = (crc >> 4) ^ table[(crc ^ (data[i] >> 4)) & 0xf];
+  }
+  return crc;
+}
+
+int lfs_format(lfs_t* /*lfs*/, const lfs_config* /*config*/) {
+  return LFS_ERR_IO;
+}
+
+int lfs_mount(lfs_t* lfs, const lfs_config* config) {
+  lfs->cfg = config;
+  lfs->rcache.block = noBlock;
+  lfs->rcache.off = 0;
+  lfs->rcache.size = 0;
+  auto& readCache = readCaches[lfs];
+  readCache.reset(new uint8_t[config->cache_size]);
+  lfs->rcache.buffer = readCache.get();
+  lfs->root[0] = 0;
+  lfs->root[1] = 1;
+
+  // Each metadata pair of the list is fetched, looking for the superblock, and its global state is read
+  lfs_mdir_t dir;
+  lfs_block_t tail[2] = {lfs->root[0], lfs->root[1]};
+  bool superblockFound = false;
+  int err = 0;
+  while (err == 0 && tail[0] != noBlock) {
+    int32_t tag = Fetch(lfs, &dir, tail, true, "littlefs", 8);
+    if (tag < 0) {
+      err = tag;
+      break;
+    }
+
+    if (tag != 0) {
+      uint8_t superblock[superblockSize];
+      tag = Get(lfs, &dir, typeMask, InlineStruct, 0, superblock, sizeof(superblock));
+      if (tag < 0) {
+        err = tag;
+        break;
+      }
+      if ((FromLe32(superblock) >> 16) != (superblockVersion >> 16) || FromLe32(superblock + 4) != config->block_size ||
+          FromLe32(superblock + 8) != config->block_count) {
+        err = LFS_ERR_INVAL;
+        break;
+      }
+      superblockFound = true;
+    }
+
+    uint8_t state[12];
+    tag = Get(lfs, &dir, typeMask, MoveState, noId, state, sizeof(state));
+    if (tag < 0 && tag != LFS_ERR_NOENT) {
+      err = tag;
+      break;
+    }
+    tail[0] = dir.tail[0];
+    tail[1] = dir.tail[1];
+  }
+
+  if (err == 0 && !superblockFound) {
+    err = LFS_ERR_INVAL;
+  }
+  if (err != 0) {
+    lfs_unmount(lfs);
+  }
+  return err;
+}
+
+int lfs_unmount(lfs_t* lfs) {
+  readCaches.erase(lfs);
+  lfs->rcache.buffer = nullptr;
+  return 0;
+}
+
+int lfs_remove(lfs_t* /*lfs*/, const char* /*path*/) {
+  return LFS_ERR_IO;
+}
+
+int lfs_rename(lfs_t* /*lfs*/, const char* /*oldpath*/, const char* /*newpath*/) {
+  return LFS_ERR_IO;
+}
+
+int lfs_stat(lfs_t* lfs, const char* path, lfs_info* info) {
+  lfs_mdir_t cwd;
+  const int32_t tag = Find(lfs, &cwd, path);
+  if (tag < 0) {
+    return tag;
+  }
+  return GetInfo(lfs, &cwd, TagId(tag), info);
+}
+
+lfs_ssize_t lfs_getattr(lfs_t* lfs, const char* path, uint8_t type, void* buffer, lfs_size_t size) {
+  lfs_mdir_t cwd;
+  int32_t tag = Find(lfs, &cwd, path);
+  if (tag < 0) {
+    return tag;
+  }
+
+  uint16_t id = TagId(tag);
+  if (id == noId) {
+    // The attributes of the root are those of the superblock
+    id = 0;
+    const int32_t res = Fetch(lfs, &cwd, lfs->root, false, nullptr, 0);
+    if (res < 0) {
+      return res;
+    }
+  }
+
+  tag = Get(lfs, &cwd, typeMask, UserAttribute + type, id, buffer, lfs_min(size, lfs->cfg->attr_max));
+  if (tag < 0) {
+    return (tag == LFS_ERR_NOENT) ? LFS_ERR_NOATTR : tag;
+  }
+  return TagSize(tag);
+}
+
+int lfs_setattr(lfs_t* /*lfs*/, const char* /*path*/, uint8_t /*type*/, const void* /*buffer*/, lfs_size_t /*size*/) {
+  return LFS_ERR_IO;
+}
+
+int lfs_removeattr(lfs_t* /*lfs*/, const char* /*path*/, uint8_t /*type*/) {
+  return LFS_ERR_IO;
+}
+
+int lfs_file_open(lfs_t* lfs, lfs_file_t* file, const char* path, int flags) {
+  file->type = 0;
+  if ((flags & LFS_O_RDWR) != LFS_O_RDONLY) {
+    return LFS_ERR_IO;
+  }
+
+  int32_t tag = Find(lfs, &file->m, path);
+  if (tag < 0) {
+    return tag;
+  }
+  if (TagType(tag) != LFS_TYPE_REG) {
+    return LFS_ERR_ISDIR;
+  }
+  file->id = TagId(tag);
+
+  uint8_t ctz[8];
+  tag = Get(lfs, &file->m, familyMask, DirStruct, file->id, ctz, sizeof(ctz));
+  if (tag < 0) {
+    return tag;
+  }
+  file->ctz.head = FromLe32(ctz);
+  file->ctz.size = FromLe32(ctz + 4);
+  file->flags = flags;
+  file->pos = 0;
+  file->block = noBlock;
+  file->off = 0;
+  file->cache.block = noBlock;
+  file->cache.off = 0;
+  file->cache.size = 0;
+  file->cache.buffer = new uint8_t[lfs->cfg->cache_size];
+  file->type = LFS_TYPE_REG;
+  return 0;
+}
+
+int lfs_file_close(lfs_t* /*lfs*/, lfs_file_t* file) {
+  delete[] file->cache.buffer;
+  file->cache.buffer = nullptr;
+  return 0;
+}
+
+lfs_ssize_t lfs_file_read(lfs_t* lfs, lfs_file_t* file, void* buffer, lfs_size_t size) {
+  if (file->pos >= file->ctz.size) {
+    return 0;
+  }
+
+  auto* data = static_cast<uint8_t*>(buffer);
+  size = lfs_min(size, file->ctz.size - file->pos);
+  lfs_size_t remaining = size;
+  while (remaining > 0) {
+    if ((file->flags & fileReading) == 0 || file->off == lfs->cfg->block_size) {
+      int err = CtzFind(lfs, &file->cache, file->ctz.head, file->ctz.size, file->pos, file->block, file->off);
+      if (err != 0) {
+        return err;
+      }
+      file->flags |= fileReading;
+    }
+
+    const lfs_size_t diff = lfs_min(remaining, lfs->cfg->block_size - file->off);
+    int err = BdRead(lfs, &file->cache, lfs->cfg->block_size, file->block, file->off, data, diff);
+    if (err != 0) {
+      return err;
+    }
+    file->pos += diff;
+    file->off += diff;
+    data += diff;
+    remaining -= diff;
+  }
+  return size;
+}
+
+lfs_ssize_t lfs_file_write(lfs_t* /*lfs*/, lfs_file_t* /*file*/, const void* /*buffer*/, lfs_size_t /*size*/) {
+  return LFS_ERR_IO;
+}
+
+lfs_soff_t lfs_file_seek(lfs_t* lfs, lfs_file_t* file, lfs_soff_t off, int whence) {
+  lfs_soff_t position = off;
+  if (whence == LFS_SEEK_CUR) {
+    position = file->pos + off;
+  } else if (whence == LFS_SEEK_END) {
+    position = file->ctz.size + off;
+  }
+  if (position < 0) {
+    return LFS_ERR_INVAL;
+  }
+
+  const lfs_off_t newPosition = position;
+  if (newPosition == file->pos) {
+    return position;
+  }
+  // The position stays in the cache of the file: the CTZ list does not need to be walked again
+  if ((file->flags & fileReading) != 0 && file->off != lfs->cfg->block_size) {
+    lfs_off_t currentOff = file->pos;
+    const uint32_t currentIndex = CtzIndex(lfs, currentOff);
+    lfs_off_t newOff = newPosition;
+    const uint32_t newIndex = CtzIndex(lfs, newOff);
+    if (currentIndex == newIndex && newOff >= file->cache.off && newOff < file->cache.off + file->cache.size) {
+      file->pos = newPosition;
+      file->off = newOff;
+      return position;
+    }
+  }
+
+  file->flags &= ~fileReading;
+  file->pos = newPosition;
+  return position;
+}
+
+lfs_soff_t lfs_file_size(lfs_t* /*lfs*/, lfs_file_t* file) {
+  return file->ctz.size;
+}
+
+int lfs_mkdir(lfs_t* /*lfs*/, const char* /*path*/) {
+  return LFS_ERR_IO;
+}
+
+int lfs_dir_open(lfs_t* lfs, lfs_dir_t* dir, const char* path) {
+  const int32_t tag = Find(lfs, &dir->m, path);
+  if (tag < 0) {
+    return tag;
+  }
+  if (TagType(tag) != LFS_TYPE_DIR) {
+    return LFS_ERR_NOTDIR;
+  }
+
+  if (TagId(tag) == noId) {
+    dir->head[0] = lfs->root[0];
+    dir->head[1] = lfs->root[1];
+  } else {
+    const int32_t res = GetPair(lfs, &dir->m, TagId(tag), dir->head);
+    if (res < 0) {
+      return res;
+    }
+  }
+  return lfs_dir_rewind(lfs, dir);
+}
+
+int lfs_dir_close(lfs_t* /*lfs*/, lfs_dir_t* /*dir*/) {
+  return 0;
+}
+
+// Returns 1 if an entry was read, 0 at the end of the directory
+int lfs_dir_read(lfs_t* lfs, lfs_dir_t* dir, lfs_info* info) {
+  std::memset(info, 0, sizeof(*info));
+  if (dir->pos < 2) {
+    info->type = LFS_TYPE_DIR;
+    std::strcpy(info->name, (dir->pos == 0) ? "." : "..");
+    dir->pos++;
+    return 1;
+  }
+
+  while (true) {
+    if (dir->id == dir->m.count) {
+      return 0;
+    }
+    const int err = GetInfo(lfs, &dir->m, dir->id, info);
+    if (err != 0 && err != LFS_ERR_NOENT) {
+      return err;
+    }
+    dir->id++;
+    if (err == 0) {
+      break;
+    }
+  }
+  dir->pos++;
+  return 1;
+}
+
+int lfs_dir_rewind(lfs_t* lfs, lfs_dir_t* dir) {
+  const int32_t res = Fetch(lfs, &dir->m, dir->head, false, nullptr, 0);
+  if (res < 0) {
+    return res;
+  }
+  dir->id = 0;
+  dir->pos = 0;
+  return 0;
+}
+
+lfs_ssize_t lfs_fs_size(lfs_t* /*lfs*/) {
+  return LFS_ERR_IO;
+}
+
+void lfssim::TraceReads(std::vector<BlockRead>* readTrace) {
+  trace = readTrace;
+}
+
+Image::Image(lfs_size_t blockSize, lfs_size_t blockCount) : blockSize {blockSize}, blockCount {blockCount} {
+  root.directory = true;
+}
+
+Image::Entry& Image::Parent(const std::string& path, std::string& name) {
+  Entry* parent = &root;
+  size_t start = path.find_first_not_of('/');
+  size_t end = path.find('/', start);
+  while (end != std::string::npos) {
+    const std::string directory = path.substr(start, end - start);
+    auto entry = std::find_if(parent->entries.begin(), parent->entries.end(), [&directory](const Entry& entry) {
+      return entry.name == directory;
+    });
+    if (entry == parent->entries.end() || !entry->directory) {
+      nrfsim::Fail(__FILE__, __LINE__, "the parent directory does not exist");
+    }
+    parent = &*entry;
+    start = end + 1;
+    end = path.find('/', start);
+  }
+  name = path.substr(start);
+  return *parent;
+}
+
+void Image::AddDirectory(const std::string& path) {
+  std::string name;
+  auto& parent = Parent(path, name);
+  // The entries of a directory are sorted by name
+  auto position = std::find_if(parent.entries.begin(), parent.entries.end(), [&name](const Entry& entry) {
+    return entry.name > name;
+  });
+  parent.entries.insert(position, Entry {name, true, {}, {}});
+}
+
+void Image::AddFile(const std::string& path, const std::vector<uint8_t>& content) {
+  std::string name;
+  auto& parent = Parent(path, name);
+  auto position = std::find_if(parent.entries.begin(), parent.entries.end(), [&name](const Entry& entry) {
+    return entry.name > name;
+  });
+  parent.entries.insert(position, Entry {name, false, content, {}});
+}
+
+void Image::Write(uint8_t* memory) const {
+  std::fill(memory, memory + blockSize * blockCount, 0xff);
+
+  // The metadata pairs come first, in the order of their list: the root, then the other directories, depth first
+  std::vector<const Entry*> directories;
+  std::vector<const Entry*> pending {&root};
+  while (!pending.empty()) {
+    const Entry* directory = pending.back();
+    pending.pop_back();
+    directories.push_back(directory);
+    for (auto entry = directory->entries.rbegin(); entry != directory->entries.rend(); ++entry) {
+      if (entry->directory) {
+        pending.push_back(&*entry);
+      }
+    }
+  }
+  auto pairOf = [&directories](const Entry* directory) {
+    return static_cast<lfs_block_t>(2 * (std::find(directories.begin(), directories.end(), directory) - directories.begin()));
+  };
+  lfs_block_t nextBlock = 2 * directories.size();
+
+  for (size_t i = 0; i < directories.size(); i++) {
+    Commit commit(memory + pairOf(directories[i]) * blockSize, blockSize, 1);
+    uint16_t id = 0;
+    if (directories[i] == &root) {
+      uint8_t superblock[superblockSize] = {};
+      ToLe32(superblock, superblockVersion);
+      ToLe32(superblock + 4, blockSize);
+      ToLe32(superblock + 8, blockCount);
+      ToLe32(superblock + 12, 50);
+      ToLe32(superblock + 16, 0x7fffffff);
+      ToLe32(superblock + 20, 50);
+      commit.Add(Superblock, id, "littlefs", 8);
+      commit.Add(InlineStruct, id, superblock, sizeof(superblock));
+      id++;
+    }
+
+    for (const auto& entry : directories[i]->entries) {
+      uint8_t data[8];
+      if (entry.directory) {
+        const lfs_block_t pair = pairOf(&entry);
+        ToLe32(data, pair);
+        ToLe32(data + 4, pair + 1);
+        commit.Add(LFS_TYPE_DIR, id, entry.name.data(), entry.name.size());
+        commit.Add(DirStruct, id, data, sizeof(data));
+      } else {
+        // The content, in a CTZ list of blocks
+        std::vector<lfs_block_t> blocks;
+        size_t position = 0;
+        while (position < entry.content.size()) {
+          if (nextBlock >= blockCount) {
+            nrfsim::Fail(__FILE__, __LINE__, "the files do not fit in the file system");
+          }
+          const auto index = static_cast<uint32_t>(blocks.size());
+          uint8_t* block = memory + nextBlock * blockSize;
+          lfs_off_t off = 0;
+          if (index > 0) {
+            for (uint32_t skip = 0; skip <= lfs_ctz(index); skip++) {
+              ToLe32(block + off, blocks[index - (1U << skip)]);
+              off += 4;
+            }
+          }
+          const size_t length = std::min(static_cast<size_t>(blockSize - off), entry.content.size() - position);
+          std::memcpy(block + off, entry.content.data() + position, length);
+          position += length;
+          blocks.push_back(nextBlock++);
+        }
+        ToLe32(data, blocks.empty() ? noBlock : blocks.back());
+        ToLe32(data + 4, entry.content.size());
+        commit.Add(LFS_TYPE_REG, id, entry.name.data(), entry.name.size());
+        commit.Add(CtzStruct, id, data, sizeof(data));
+      }
+      id++;
+    }
+
+    if (i + 1 < directories.size()) {
+      uint8_t tail[8];
+      const lfs_block_t pair = pairOf(directories[i + 1]);
+      ToLe32(tail, pair);
+      ToLe32(tail + 4, pair + 1);
+      commit.Add(SoftTail, noId, tail, sizeof(tail));
+    }
+    commit.End();
+  }
+}
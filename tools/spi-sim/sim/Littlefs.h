@@ -0,0 +1,53 @@
+#pragma once
+#include <littlefs/lfs.h>
+#include <string>
+#include <vector>
+
+// Model of the read path of littlefs 2 (sim/Littlefs.cpp): the reads it asks to the block device (lfs_config::read)
+// to mount the file system, look up a path, list a directory and read a file.
+//
+// The model follows the algorithms of littlefs: the read cache of cache_size bytes of the file system (metadata) and of
+// each file (content), the fetch of the metadata pairs (their revision, then each tag and its data read to check the
+// CRC of the commits, the names compared on the flash memory), the lookup of a tag by walking the tags backward from
+// the end of the commit, and the CTZ skip-lists of the contents of the files.
+//
+// The format on the flash memory is close to the one of littlefs, but simplified: each metadata pair is a single commit
+// in its first block, the files are never inlined in the metadata, and there are no moves or deletions. The file system
+// is read-only: the images are generated by Image, the functions that modify the file system return LFS_ERR_IO.
+namespace lfssim {
+  struct BlockRead {
+    lfs_block_t block;
+    lfs_off_t off;
+    lfs_size_t size;
+  };
+
+  // The reads of the block device are appended to trace, until TraceReads(nullptr)
+  void TraceReads(std::vector<BlockRead>* trace);
+
+  // A file system, written to the memory in the format of the model
+  class Image {
+  public:
+    Image(lfs_size_t blockSize, lfs_size_t blockCount);
+
+    // The parent directory must exist
+    void AddDirectory(const std::string& path);
+    void AddFile(const std::string& path, const std::vector<uint8_t>& content);
+
+    // Writes the image to memory (blockSize * blockCount bytes). The blocks that are not used are erased.
+    void Write(uint8_t* memory) const;
+
+  private:
+    struct Entry {
+      std::string name;
+      bool directory;
+      std::vector<uint8_t> content;
+      std::vector<Entry> entries;
+    };
+
+    Entry& Parent(const std::string& path, std::string& name);
+
+    const lfs_size_t blockSize;
+    const lfs_size_t blockCount;
+    Entry root;
+  };
+}
@@ -0,0 +1,247 @@
+#include "sim/Lvgl.h"
+#include <algorithm>
+#include <vector>
+#include "sim/Simulator.h"
+
+struct _disp_t {
+  lv_disp_drv_t driver;
+  int direction = 0;
+  std::vector<lv_area_t> invalidatedAreas;
+};
+
+struct _lv_indev_t {
+  lv_indev_drv_t driver;
+};
+
+lv_font_t jetbrains_mono_bold_20 = []() {
+  lv_font_t font {};
+  font.line_height = 20;
+  return font;
+}();
+
+namespace {
+  _disp_t display;
+  _lv_indev_t inputDevice;
+  lv_theme_t theme;
+  bool displayRegistered = false;
+  bool singleBuffer = false;
+  nrfsim::Nanoseconds waitTime = 0;
+
+  bool IsDoubleBuffered() {
+    const auto* buffer = display.driver.buffer;
+    return buffer->buf1 != nullptr && buffer->buf2 != nullptr;
+  }
+
+  uint32_t TickGet() {
+    return static_cast<uint32_t>(nrfsim::Now() / 1000000);
+  }
+
+  void WaitWhileFlushing() {
+    const auto start = nrfsim::Now();
+    while (display.driver.buffer->flushing) {
+      if (display.driver.wait_cb != nullptr) {
+        display.driver.wait_cb(&display.driver);
+      } else {
+        nrfsim::PollEvent();
+      }
+    }
+    waitTime += nrfsim::Now() - start;
+  }
+
+  // lv_refr_vdb_flush()
+  void FlushBuffer() {
+    auto* buffer = display.driver.buffer;
+    // In double buffered mode wait until the other buffer is flushed before flushing the current one
+    if (IsDoubleBuffered()) {
+      WaitWhileFlushing();
+    }
+    buffer->flushing = 1;
+    buffer->flushing_last = (buffer->last_area && buffer->last_part) ? 1 : 0;
+    display.driver.flush_cb(&display.driver, &buffer->area, static_cast<lv_color_t*>(buffer->buf_act));
+    if (IsDoubleBuffered()) {
+      buffer->buf_act = buffer->buf_act == buffer->buf1 ? buffer->buf2 : buffer->buf1;
+    }
+  }
+
+  // lv_refr_area_part()
+  void RefreshPart(const lv_area_t& part, const lvsim::RenderFunction& render) {
+    auto* buffer = display.driver.buffer;
+    // In non double buffered mode, before rendering the next part wait until the previous image is flushed
+    if (!IsDoubleBuffered()) {
+      WaitWhileFlushing();
+    }
+    buffer->area = part;
+    render(part, static_cast<lv_color_t*>(buffer->buf_act));
+    FlushBuffer();
+  }
+
+  // lv_refr_area(): the area is refreshed in parts of as many lines as the buffer can hold
+  void RefreshArea(const lv_area_t& area, const lvsim::RenderFunction& render) {
+    auto* buffer = display.driver.buffer;
+    const lv_coord_t width = area.x2 - area.x1 + 1;
+    const lv_coord_t height = area.y2 - area.y1 + 1;
+    lv_coord_t maxRows = std::min<lv_coord_t>(static_cast<lv_coord_t>(buffer->size / width), height);
+
+    // Round down the lines of the buffer if the rounder adds some
+    if (display.driver.rounder_cb != nullptr) {
+      lv_area_t tmp;
+      tmp.x1 = 0;
+      tmp.x2 = 0;
+      tmp.y1 = 0;
+      lv_coord_t rows = maxRows;
+      do {
+        tmp.y2 = rows - 1;
+        display.driver.rounder_cb(&display.driver, &tmp);
+        if (tmp.y2 - tmp.y1 + 1 <= maxRows) {
+          break;
+        }
+        rows--;
+      } while (rows > 0);
+      if (rows > 0) {
+        maxRows = tmp.y2 + 1;
+      }
+    }
+
+    buffer->last_part = 0;
+    lv_area_t part {area.x1, 0, area.x2, 0};
+    if (display.direction == 1) {
+      // Bottom to top
+      for (lv_coord_t row = area.y2; row >= area.y1; row -= maxRows) {
+        part.y2 = row;
+        part.y1 = std::max<lv_coord_t>(area.y1, row - maxRows + 1);
+        buffer->last_part = part.y1 == area.y1 ? 1 : 0;
+        RefreshPart(part, render);
+      }
+    } else {
+      for (lv_coord_t row = area.y1; row <= area.y2; row += maxRows) {
+        part.y1 = row;
+        part.y2 = std::min<lv_coord_t>(area.y2, row + maxRows - 1);
+        buffer->last_part = part.y2 == area.y2 ? 1 : 0;
+        RefreshPart(part, render);
+      }
+    }
+  }
+}
+
+void lvsim::Invalidate(lv_area_t area) {
+  // lv_inv_area()
+  area.x1 = std::max<lv_coord_t>(area.x1, 0);
+  area.y1 = std::max<lv_coord_t>(area.y1, 0);
+  area.x2 = std::min<lv_coord_t>(area.x2, display.driver.hor_res - 1);
+  area.y2 = std::min<lv_coord_t>(area.y2, display.driver.ver_res - 1);
+  if (area.x1 > area.x2 || area.y1 > area.y2) {
+    return;
+  }
+  if (display.driver.rounder_cb != nullptr) {
+    display.driver.rounder_cb(&display.driver, &area);
+  }
+  for (const auto& invalidated : display.invalidatedAreas) {
+    if (area.x1 >= invalidated.x1 && area.y1 >= invalidated.y1 && area.x2 <= invalidated.x2 && area.y2 <= invalidated.y2) {
+      return;
+    }
+  }
+  display.invalidatedAreas.push_back(area);
+}
+
+void lvsim::Refresh(const RenderFunction& render) {
+  // _lv_disp_refr_task()
+  if (display.invalidatedAreas.empty()) {
+    return;
+  }
+  const auto start = TickGet();
+  uint32_t pixels = 0;
+  auto* buffer = display.driver.buffer;
+  buffer->last_area = 0;
+  for (size_t i = 0; i < display.invalidatedAreas.size(); i++) {
+    const auto& area = display.invalidatedAreas[i];
+    buffer->last_area = i + 1 == display.invalidatedAreas.size() ? 1 : 0;
+    RefreshArea(area, render);
+    pixels += (area.x2 - area.x1 + 1) * (area.y2 - area.y1 + 1);
+  }
+  display.invalidatedAreas.clear();
+  // The monitor is called when the last part is given to the driver, not when it is flushed
+  if (display.driver.monitor_cb != nullptr) {
+    display.driver.monitor_cb(&display.driver, TickGet() - start, pixels);
+  }
+}
+
+void lvsim::SetSingleBuffer(bool enable) {
+  singleBuffer = enable;
+}
+
+bool lvsim::Flushing() {
+  return displayRegistered && display.driver.buffer->flushing;
+}
+
+nrfsim::Nanoseconds lvsim::WaitTime() {
+  return waitTime;
+}
+
+void lv_init() {
+}
+
+void lv_disp_buf_init(lv_disp_buf_t* disp_buf, void* buf1, void* buf2, uint32_t size_in_px_cnt) {
+  *disp_buf = {};
+  disp_buf->buf1 = buf1;
+  disp_buf->buf2 = singleBuffer ? nullptr : buf2;
+  disp_buf->buf_act = buf1;
+  disp_buf->size = size_in_px_cnt;
+}
+
+void lv_disp_drv_init(lv_disp_drv_t* driver) {
+  *driver = {};
+  driver->hor_res = LV_HOR_RES_MAX;
+  driver->ver_res = LV_VER_RES_MAX;
+}
+
+lv_disp_t* lv_disp_drv_register(lv_disp_drv_t* driver) {
+  display.driver = *driver;
+  display.direction = 0;
+  display.invalidatedAreas.clear();
+  displayRegistered = true;
+  return &display;
+}
+
+lv_disp_t* lv_disp_get_default() {
+  return displayRegistered ? &display : nullptr;
+}
+
+lv_coord_t lv_disp_get_hor_res(lv_disp_t* /*disp*/) {
+  return display.driver.hor_res;
+}
+
+lv_coord_t lv_disp_get_ver_res(lv_disp_t* /*disp*/) {
+  return display.driver.ver_res;
+}
+
+void lv_disp_set_direction(lv_disp_t* disp, int direction) {
+  disp->direction = direction;
+}
+
+void lv_disp_flush_ready(lv_disp_drv_t* disp_drv) {
+  disp_drv->buffer->flushing = 0;
+  disp_drv->buffer->flushing_last = 0;
+}
+
+void lv_indev_drv_init(lv_indev_drv_t* driver) {
+  *driver = {};
+}
+
+lv_indev_t* lv_indev_drv_register(lv_indev_drv_t* driver) {
+  inputDevice.driver = *driver;
+  return &inputDevice;
+}
+
+void lv_theme_set_act(lv_theme_t* /*th*/) {
+}
+
+lv_theme_t* lv_pinetime_theme_init(lv_color_t /*color_primary*/,
+                                   lv_color_t /*color_secondary*/,
+                                   uint32_t /*flags*/,
+                                   const lv_font_t* font_small,
+                                   const lv_font_t* /*font_normal*/,
+                                   const lv_font_t* /*font_subtitle*/,
+                                   const lv_font_t* /*font_title*/) {
+  theme.font = font_small;
+  return &theme;
+}
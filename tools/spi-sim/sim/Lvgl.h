@@ -0,0 +1,23 @@
+#pragma once
+#include <functional>
+#include <lvgl/lvgl.h>
+#include "sim/Simulator.h"
+
+// Model of the refresh of LVGL 7 (lv_refr.c), with the direction added by the fork used by InfiniTime. The areas are
+// rendered by the benchmark: Refresh() calls render() for each part of the areas, in the order of LVGL, and calls
+// the driver (rounder_cb, flush_cb, wait_cb and monitor_cb) like LVGL does.
+namespace lvsim {
+  using RenderFunction = std::function<void(const lv_area_t& area, lv_color_t* buffer)>;
+
+  // Invalidates an area, as an object that changes does (the rounder of the driver is applied)
+  void Invalidate(lv_area_t area);
+  // Refreshes the invalidated areas, like lv_task_handler()
+  void Refresh(const RenderFunction& render);
+  // The second buffer given to lv_disp_buf_init() is ignored: LVGL waits for the end of the flush of the buffer
+  // before rendering the next part into it.
+  void SetSingleBuffer(bool singleBuffer);
+  // A buffer is given to the driver and not released yet by lv_disp_flush_ready()
+  bool Flushing();
+  // Total time spent by LVGL waiting for the driver to release a buffer (in wait_cb)
+  nrfsim::Nanoseconds WaitTime();
+}
@@ -0,0 +1,112 @@
+#include <lvgl/lvgl.h>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+// The file system interface of LVGL 7 (lv_fs.c): the drivers are selected by the letter of the path, and receive the
+// path without the letter and the separators that follow it ("F:/fonts/font.bin" -> "fonts/font.bin").
+// The heap of LVGL (lv_mem.c) is the heap of the host.
+
+namespace {
+  std::vector<lv_fs_drv_t> drivers;
+
+  lv_fs_drv_t* GetDriver(char letter) {
+    for (auto& driver : drivers) {
+      if (driver.letter == letter) {
+        return &driver;
+      }
+    }
+    return nullptr;
+  }
+}
+
+void lv_fs_drv_init(lv_fs_drv_t* drv) {
+  std::memset(drv, 0, sizeof(*drv));
+}
+
+void lv_fs_drv_register(lv_fs_drv_t* drv_p) {
+  // The driver is copied: the caller may release it
+  lv_fs_drv_t* driver = GetDriver(drv_p->letter);
+  if (driver != nullptr) {
+    *driver = *drv_p;
+  } else {
+    drivers.push_back(*drv_p);
+  }
+}
+
+lv_fs_res_t lv_fs_open(lv_fs_file_t* file_p, const char* path, lv_fs_mode_t mode) {
+  file_p->drv = nullptr;
+  file_p->file_d = nullptr;
+  if (path == nullptr || path[0] == '\0') {
+    return LV_FS_RES_INV_PARAM;
+  }
+  lv_fs_drv_t* driver = GetDriver(path[0]);
+  if (driver == nullptr || driver->open_cb == nullptr) {
+    return LV_FS_RES_NOT_EX;
+  }
+
+  const char* realPath = path + 1;
+  while (*realPath == ':' || *realPath == '/' || *realPath == '\\') {
+    realPath++;
+  }
+
+  file_p->drv = driver;
+  file_p->file_d = std::calloc(1, driver->file_size);
+  const lv_fs_res_t res = driver->open_cb(driver, file_p->file_d, realPath, mode);
+  if (res != LV_FS_RES_OK) {
+    std::free(file_p->file_d);
+    file_p->file_d = nullptr;
+    file_p->drv = nullptr;
+  }
+  return res;
+}
+
+lv_fs_res_t lv_fs_close(lv_fs_file_t* file_p) {
+  if (file_p->drv == nullptr) {
+    return LV_FS_RES_INV_PARAM;
+  }
+  lv_fs_res_t res = LV_FS_RES_NOT_IMP;
+  if (file_p->drv->close_cb != nullptr) {
+    res = file_p->drv->close_cb(file_p->drv, file_p->file_d);
+  }
+  std::free(file_p->file_d);
+  file_p->file_d = nullptr;
+  file_p->drv = nullptr;
+  return res;
+}
+
+lv_fs_res_t lv_fs_read(lv_fs_file_t* file_p, void* buf, uint32_t btr, uint32_t* br) {
+  uint32_t read = 0;
+  if (br != nullptr) {
+    *br = 0;
+  }
+  if (file_p->drv == nullptr) {
+    return LV_FS_RES_INV_PARAM;
+  }
+  if (file_p->drv->read_cb == nullptr) {
+    return LV_FS_RES_NOT_IMP;
+  }
+  const lv_fs_res_t res = file_p->drv->read_cb(file_p->drv, file_p->file_d, buf, btr, &read);
+  if (br != nullptr) {
+    *br = read;
+  }
+  return res;
+}
+
+lv_fs_res_t lv_fs_seek(lv_fs_file_t* file_p, uint32_t pos) {
+  if (file_p->drv == nullptr) {
+    return LV_FS_RES_INV_PARAM;
+  }
+  if (file_p->drv->seek_cb == nullptr) {
+    return LV_FS_RES_NOT_IMP;
+  }
+  return file_p->drv->seek_cb(file_p->drv, file_p->file_d, pos);
+}
+
+void* lv_mem_alloc(size_t size) {
+  return std::malloc(size);
+}
+
+void lv_mem_free(const void* data) {
+  std::free(const_cast<void*>(data));
+}
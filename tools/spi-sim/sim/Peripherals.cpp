@@ -0,0 +1,359 @@
+#include "sim/Peripherals.h"
+#include <algorithm>
+#include <vector>
+
+NRF_SPIM_Type nrfsim::spim0;
+NRF_SPIM_Type nrfsim::spim1;
+NRF_TIMER_Type nrfsim::timer3;
+NRF_PPI_Type nrfsim::ppi;
+NRF_GPIOTE_Type nrfsim::gpiote;
+DWT_Type nrfsim::dwt;
+CoreDebug_Type nrfsim::coreDebug;
+
+using namespace nrfsim;
+
+namespace {
+  template <typename T> bool Contains(const T& peripheral, const Register* reg) {
+    auto begin = reinterpret_cast<const char*>(&peripheral);
+    auto address = reinterpret_cast<const char*>(reg);
+    return address >= begin && address < begin + sizeof(T);
+  }
+
+  template <size_t N> int IndexOf(const Register (&registers)[N], const Register* reg) {
+    for (size_t i = 0; i < N; i++) {
+      if (&registers[i] == reg) {
+        return static_cast<int>(i);
+      }
+    }
+    return -1;
+  }
+
+  struct AttachedDevice {
+    SpiDevice* device;
+    uint8_t pinCsn;
+    uint8_t pinDataCommand;
+  };
+
+  std::vector<AttachedDevice> devices;
+  SpimConfiguration spimConfiguration;
+  SpimStatistics spimStatistics;
+  const Register* lastPolledEvent = nullptr;
+
+  void TriggerTask(Register* task);
+
+  // Sets an event register and triggers the tasks connected to it by the PPI
+  void Raise(Register& event) {
+    event.value = 1;
+    for (size_t channel = 0; channel < 20; channel++) {
+      if ((ppi.CHEN.value & (1U << channel)) != 0 && ppi.CH[channel].EEP.value == reinterpret_cast<uintptr_t>(&event) &&
+          ppi.CH[channel].TEP.value != 0) {
+        TriggerTask(reinterpret_cast<Register*>(ppi.CH[channel].TEP.value));
+      }
+    }
+  }
+
+  class Spim {
+  public:
+    explicit Spim(NRF_SPIM_Type& regs) : regs {regs} {
+    }
+
+    void Write(const Register* reg) {
+      if (reg == &regs.TASKS_START) {
+        Start();
+      } else if (reg == &regs.TASKS_STOP) {
+        if (busy) {
+          stopRequested = true;
+        } else {
+          Raise(regs.EVENTS_STOPPED);
+        }
+      } else if (reg == &regs.INTENSET) {
+        regs.INTENSET.value = regs.INTENCLR.value = (regs.INTENCLR.value | regs.INTENSET.value);
+      } else if (reg == &regs.INTENCLR) {
+        regs.INTENSET.value = regs.INTENCLR.value = (regs.INTENSET.value & ~regs.INTENCLR.value);
+      }
+    }
+
+    bool IsEvent(const Register* reg) const {
+      return reg == &regs.EVENTS_STOPPED || reg == &regs.EVENTS_ENDRX || reg == &regs.EVENTS_END || reg == &regs.EVENTS_ENDTX ||
+             reg == &regs.EVENTS_STARTED;
+    }
+
+    bool InterruptPending() const {
+      const auto inten = regs.INTENSET.value;
+      return ((inten & (1U << 1)) != 0 && regs.EVENTS_STOPPED.value != 0) || ((inten & (1U << 4)) != 0 && regs.EVENTS_ENDRX.value != 0) ||
+             ((inten & (1U << 6)) != 0 && regs.EVENTS_END.value != 0) || ((inten & (1U << 8)) != 0 && regs.EVENTS_ENDTX.value != 0) ||
+             ((inten & (1U << 19)) != 0 && regs.EVENTS_STARTED.value != 0);
+    }
+
+    void OnDeselect(const SpiDevice* device) const {
+      if (busy && transfer.device == device) {
+        Fail(__FILE__, __LINE__, "CS released during a transfer");
+      }
+    }
+
+  private:
+    struct Transfer {
+      uintptr_t txPtr;
+      size_t txCount;
+      uintptr_t rxPtr;
+      size_t rxCount;
+      size_t bytes;
+      AttachedDevice* attached;
+      SpiDevice* device;
+      bool dataCommand;
+    };
+
+    void Start() {
+      if (regs.ENABLE.value != SPIM_ENABLE_ENABLE_Enabled) {
+        Fail(__FILE__, __LINE__, "START while the SPIM is disabled");
+      }
+      if (busy) {
+        Fail(__FILE__, __LINE__, "START while a transfer is running");
+      }
+      transfer = {};
+      transfer.txPtr = regs.TXD.PTR.value;
+      transfer.txCount = regs.TXD.MAXCNT.value;
+      transfer.rxPtr = regs.RXD.PTR.value;
+      transfer.rxCount = regs.RXD.MAXCNT.value;
+      if (transfer.txCount > 0xff || transfer.rxCount > 0xff) {
+        Fail(__FILE__, __LINE__, "MAXCNT is 8 bits wide on the nRF52832");
+      }
+      if ((transfer.txCount > 0 && transfer.txPtr == 0) || (transfer.rxCount > 0 && transfer.rxPtr == 0)) {
+        Fail(__FILE__, __LINE__, "EasyDMA transfer without buffer");
+      }
+      for (auto& attached : devices) {
+        if (!PinLevel(attached.pinCsn)) {
+          if (transfer.device != nullptr) {
+            Fail(__FILE__, __LINE__, "several devices are selected");
+          }
+          transfer.attached = &attached;
+          transfer.device = attached.device;
+          transfer.dataCommand = attached.pinDataCommand == NoPin || PinLevel(attached.pinDataCommand);
+        }
+      }
+      busy = true;
+      Raise(regs.EVENTS_STARTED);
+
+      // SCK toggles at the start of the transfer (the workaround for FTPAN-58 stops the SPIM on this event)
+      for (size_t channel = 0; channel < 8; channel++) {
+        auto config = gpiote.CONFIG[channel].value;
+        if ((config & 0x03) == GPIOTE_CONFIG_MODE_Event && ((config >> GPIOTE_CONFIG_PSEL_Pos) & 0x1f) == regs.PSEL.SCK.value) {
+          Raise(gpiote.EVENTS_IN[channel]);
+        }
+      }
+
+      transfer.bytes = std::max(transfer.txCount, transfer.rxCount);
+      if (stopRequested) {
+        // STOP ends the transfer after the current byte
+        transfer.bytes = std::min<size_t>(transfer.bytes, 1);
+      } else if (transfer.rxCount == 1 && transfer.txCount <= 1) {
+        transfer.bytes = 2;
+        spimStatistics.extraBytes++;
+      }
+
+      const auto duration = transfer.bytes * spimConfiguration.byteTime;
+      spimStatistics.transfers++;
+      spimStatistics.busyTime += duration;
+      Schedule(duration, [this]() {
+        End();
+      });
+    }
+
+    void End() {
+      // The data is read from (and written to) the memory at the end of the transfer: a buffer that is modified
+      // before the end of the transfer is detected on the device side
+      auto txData = reinterpret_cast<const uint8_t*>(transfer.txPtr);
+      auto rxData = reinterpret_cast<uint8_t*>(transfer.rxPtr);
+      for (size_t i = 0; i < transfer.bytes; i++) {
+        uint8_t mosi = i < transfer.txCount ? txData[i] : static_cast<uint8_t>(regs.ORC.value);
+        uint8_t miso = transfer.device != nullptr ? transfer.device->Transfer(mosi, transfer.dataCommand) : 0xff;
+        if (i < transfer.rxCount) {
+          rxData[i] = miso;
+        }
+      }
+      spimStatistics.bytes += transfer.bytes;
+
+      busy = false;
+      regs.TXD.AMOUNT.value = std::min(transfer.txCount, transfer.bytes);
+      regs.RXD.AMOUNT.value = std::min(transfer.rxCount, transfer.bytes);
+      if (regs.TXD.LIST.value == SPIM_TXD_LIST_LIST_ArrayList) {
+        regs.TXD.PTR.value += transfer.txCount;
+      }
+      if (regs.RXD.LIST.value == SPIM_TXD_LIST_LIST_ArrayList) {
+        regs.RXD.PTR.value += transfer.rxCount;
+      }
+      Raise(regs.EVENTS_ENDTX);
+      Raise(regs.EVENTS_ENDRX);
+      Raise(regs.EVENTS_END);
+      if (stopRequested) {
+        stopRequested = false;
+        Raise(regs.EVENTS_STOPPED);
+      }
+    }
+
+    NRF_SPIM_Type& regs;
+    bool busy = false;
+    bool stopRequested = false;
+    Transfer transfer {};
+  };
+
+  class Timer {
+  public:
+    explicit Timer(NRF_TIMER_Type& regs) : regs {regs} {
+    }
+
+    void Write(const Register* reg) {
+      if (reg == &regs.TASKS_START) {
+        running = true;
+      } else if (reg == &regs.TASKS_STOP || reg == &regs.TASKS_SHUTDOWN) {
+        running = false;
+      } else if (reg == &regs.TASKS_CLEAR) {
+        counter = 0;
+      } else if (reg == &regs.TASKS_COUNT) {
+        Count();
+      } else if (reg == &regs.INTENSET) {
+        regs.INTENSET.value = regs.INTENCLR.value = (regs.INTENCLR.value | regs.INTENSET.value);
+      } else if (reg == &regs.INTENCLR) {
+        regs.INTENSET.value = regs.INTENCLR.value = (regs.INTENSET.value & ~regs.INTENCLR.value);
+      }
+    }
+
+    bool IsEvent(const Register* reg) const {
+      return IndexOf(regs.EVENTS_COMPARE, reg) >= 0;
+    }
+
+    bool InterruptPending() const {
+      for (size_t i = 0; i < 6; i++) {
+        if ((regs.INTENSET.value & (1U << (16 + i))) != 0 && regs.EVENTS_COMPARE[i].value != 0) {
+          return true;
+        }
+      }
+      return false;
+    }
+
+  private:
+    void Count() {
+      if (!running || regs.MODE.value == TIMER_MODE_MODE_Timer) {
+        return;
+      }
+      static constexpr uint8_t bitModeWidths[] = {16, 8, 24, 32};
+      const auto width = bitModeWidths[regs.BITMODE.value & 0x03];
+      counter = static_cast<uint32_t>((static_cast<uint64_t>(counter) + 1) & ((1ULL << width) - 1));
+      for (size_t i = 0; i < 6; i++) {
+        if (counter == regs.CC[i].value) {
+          Raise(regs.EVENTS_COMPARE[i]);
+          if ((regs.SHORTS.value & (1U << i)) != 0) {
+            counter = 0;
+          }
+          if ((regs.SHORTS.value & (1U << (8 + i))) != 0) {
+            running = false;
+          }
+        }
+      }
+    }
+
+    NRF_TIMER_Type& regs;
+    bool running = false;
+    uint32_t counter = 0;
+  };
+
+  Spim spimModel0 {spim0};
+  Spim spimModel1 {spim1};
+  Timer timerModel3 {timer3};
+
+  void WritePpi(const Register* reg) {
+    auto& channels = ppi.CHEN.value;
+    if (reg == &ppi.CHENSET) {
+      channels |= ppi.CHENSET.value;
+    } else if (reg == &ppi.CHENCLR) {
+      channels &= ~ppi.CHENCLR.value;
+    } else {
+      for (size_t group = 0; group < 6; group++) {
+        if (reg == &ppi.TASKS_CHG[group].EN) {
+          channels |= ppi.CHG[group].value;
+        } else if (reg == &ppi.TASKS_CHG[group].DIS) {
+          channels &= ~ppi.CHG[group].value;
+        }
+      }
+    }
+    ppi.CHENSET.value = ppi.CHENCLR.value = channels;
+  }
+
+  void Dispatch(Register* reg) {
+    if (Contains(spim0, reg)) {
+      spimModel0.Write(reg);
+    } else if (Contains(spim1, reg)) {
+      spimModel1.Write(reg);
+    } else if (Contains(timer3, reg)) {
+      timerModel3.Write(reg);
+    } else if (Contains(ppi, reg)) {
+      WritePpi(reg);
+    }
+  }
+
+  void TriggerTask(Register* task) {
+    task->value = 1;
+    Dispatch(task);
+  }
+}
+
+void nrfsim::OnRegisterWrite(Register* reg) {
+  lastPolledEvent = nullptr;
+  Dispatch(reg);
+  CheckInterrupts();
+}
+
+void nrfsim::OnRegisterRead(const Register* reg) {
+  const bool event = spimModel0.IsEvent(reg) || spimModel1.IsEvent(reg) || timerModel3.IsEvent(reg) || IndexOf(gpiote.EVENTS_IN, reg) >= 0;
+  if (!event || reg->value != 0) {
+    lastPolledEvent = nullptr;
+    return;
+  }
+  // The event is read again while it is not set: this is a busy-wait
+  if (reg == lastPolledEvent) {
+    PollEvent();
+  }
+  lastPolledEvent = reg;
+}
+
+bool nrfsim::InterruptPending(IRQn_Type irq) {
+  switch (irq) {
+    case SPIM0_SPIS0_TWIM0_TWIS0_SPI0_TWI0_IRQn:
+      return spimModel0.InterruptPending();
+    case SPIM1_SPIS1_TWIM1_TWIS1_SPI1_TWI1_IRQn:
+      return spimModel1.InterruptPending();
+    case TIMER3_IRQn:
+      return timerModel3.InterruptPending();
+    default:
+      return false;
+  }
+}
+
+nrfsim::CycleCounter::operator uint32_t() const {
+  return static_cast<uint32_t>(Now() * 64 / 1000);
+}
+
+void nrfsim::AttachSpiDevice(SpiDevice& device, uint8_t pinCsn, uint8_t pinDataCommand) {
+  devices.push_back({&device, pinCsn, pinDataCommand});
+}
+
+void nrfsim::OnPinChange(uint8_t pin, bool level) {
+  for (auto& attached : devices) {
+    if (attached.pinCsn == pin) {
+      if (level) {
+        spimModel0.OnDeselect(attached.device);
+        attached.device->Deselect();
+      } else {
+        attached.device->Select();
+      }
+    }
+  }
+}
+
+SpimConfiguration& nrfsim::GetSpimConfiguration() {
+  return spimConfiguration;
+}
+
+const SpimStatistics& nrfsim::GetSpimStatistics() {
+  return spimStatistics;
+}
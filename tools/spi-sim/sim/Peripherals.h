@@ -0,0 +1,49 @@
+#pragma once
+#include <cstdint>
+#include <nrf.h>
+#include "sim/Simulator.h"
+
+// Models of the SPIM, TIMER, PPI and GPIOTE peripherals of the nRF52832, as far as the SPI drivers use them, and of the
+// devices connected to the SPI bus.
+namespace nrfsim {
+  class SpiDevice {
+  public:
+    virtual ~SpiDevice() = default;
+    // The CS pin of the device went low
+    virtual void Select() {
+    }
+    // The CS pin of the device went high
+    virtual void Deselect() {
+    }
+    // Exchanges a byte. dataCommand is the level of the data/command pin of the device when the transfer started.
+    virtual uint8_t Transfer(uint8_t mosi, bool dataCommand) = 0;
+  };
+
+  // The device is selected by pinCsn (active low). pinDataCommand is NoPin if the device does not have one.
+  void AttachSpiDevice(SpiDevice& device, uint8_t pinCsn, uint8_t pinDataCommand);
+  constexpr uint8_t NoPin = 0xff;
+
+  struct SpimConfiguration {
+    // 8MHz
+    Nanoseconds byteTime = 1000;
+  };
+
+  struct SpimStatistics {
+    // EasyDMA transfers (each chunk of an ArrayList is a transfer)
+    uint32_t transfers = 0;
+    uint64_t bytes = 0;
+    Nanoseconds busyTime = 0;
+    // Bytes clocked out because of FTPAN-58 (RXD.MAXCNT = 1 and TXD.MAXCNT <= 1, without the workaround)
+    uint32_t extraBytes = 0;
+  };
+
+  SpimConfiguration& GetSpimConfiguration();
+  const SpimStatistics& GetSpimStatistics();
+
+  // Level of the interrupt line of the peripheral (its events and INTENSET)
+  bool InterruptPending(IRQn_Type irq);
+
+  // Level of a GPIO pin (sim/Gpio.cpp)
+  bool PinLevel(uint8_t pin);
+  void OnPinChange(uint8_t pin, bool level);
+}
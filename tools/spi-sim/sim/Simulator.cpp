@@ -0,0 +1,185 @@
+#include "sim/Simulator.h"
+#include "sim/Peripherals.h"
+#include <queue>
+#include <vector>
+
+using namespace nrfsim;
+
+namespace {
+  struct Event {
+    Nanoseconds time;
+    uint64_t sequence;
+    std::function<void()> callback;
+
+    bool operator>(const Event& other) const {
+      return time != other.time ? time > other.time : sequence > other.sequence;
+    }
+  };
+
+  struct Interrupt {
+    IRQn_Type irq;
+    bool enabled;
+    std::function<void()> handler;
+  };
+
+  Configuration configuration;
+  Nanoseconds now = 0;
+  uint64_t nextSequence = 0;
+  std::priority_queue<Event, std::vector<Event>, std::greater<Event>> events;
+  std::vector<Interrupt> interrupts;
+  InterruptStatistics interruptStatistics;
+  int criticalNesting = 0;
+  bool inInterrupt = false;
+  uint32_t idlePolls = 0;
+
+  void RunNextEvent() {
+    auto event = events.top();
+    events.pop();
+    if (event.time > now) {
+      now = event.time;
+    }
+    event.callback();
+    CheckInterrupts();
+  }
+
+  // The hardware runs for this time, the CPU is busy (in the task or in an interrupt handler)
+  void AdvanceHardware(Nanoseconds duration) {
+    const auto end = now + duration;
+    while (!events.empty() && events.top().time <= end) {
+      RunNextEvent();
+    }
+    if (now < end) {
+      now = end;
+    }
+  }
+}
+
+Configuration& nrfsim::GetConfiguration() {
+  return configuration;
+}
+
+Nanoseconds nrfsim::Now() {
+  return now;
+}
+
+void nrfsim::Schedule(Nanoseconds delay, std::function<void()> callback) {
+  events.push({now + delay, nextSequence++, std::move(callback)});
+}
+
+void nrfsim::Compute(Nanoseconds duration) {
+  // The time spent in the interrupt handlers that run in the meantime is not part of the duration
+  while (duration > 0) {
+    if (events.empty() || events.top().time >= now + duration) {
+      now += duration;
+      return;
+    }
+    const auto next = events.top().time;
+    if (next > now) {
+      duration -= next - now;
+      now = next;
+    }
+    RunNextEvent();
+  }
+}
+
+bool nrfsim::WaitUntil(const std::function<bool()>& condition, Nanoseconds timeout) {
+  if (inInterrupt || criticalNesting > 0) {
+    Fail(__FILE__, __LINE__, "blocking call from an interrupt handler or a critical section");
+  }
+  const auto deadline = timeout == Forever ? Forever : now + timeout;
+  while (!condition()) {
+    if (events.empty() || events.top().time > deadline) {
+      if (deadline == Forever) {
+        Fail(__FILE__, __LINE__, "the task waits forever: no event is pending");
+      }
+      now = deadline;
+      return condition();
+    }
+    RunNextEvent();
+  }
+  return true;
+}
+
+void nrfsim::CheckInterrupts() {
+  if (inInterrupt || criticalNesting > 0) {
+    return;
+  }
+  // The interrupts are level-triggered: the handler runs again as long as an enabled event is set
+  bool handled;
+  do {
+    handled = false;
+    for (auto& interrupt : interrupts) {
+      if (interrupt.enabled && interrupt.handler && InterruptPending(interrupt.irq)) {
+        inInterrupt = true;
+        interrupt.handler();
+        switch (interrupt.irq) {
+          case SPIM0_SPIS0_TWIM0_TWIS0_SPI0_TWI0_IRQn:
+            interruptStatistics.spim0++;
+            break;
+          case TIMER3_IRQn:
+            interruptStatistics.timer3++;
+            break;
+          default:
+            break;
+        }
+        AdvanceHardware(configuration.interruptCost);
+        inInterrupt = false;
+        handled = true;
+      }
+    }
+  } while (handled);
+}
+
+void nrfsim::EnterCritical() {
+  criticalNesting++;
+}
+
+void nrfsim::ExitCritical() {
+  criticalNesting--;
+  if (criticalNesting == 0) {
+    CheckInterrupts();
+  }
+}
+
+bool nrfsim::InInterrupt() {
+  return inInterrupt;
+}
+
+void nrfsim::ConnectInterrupt(IRQn_Type irq, std::function<void()> handler) {
+  for (auto& interrupt : interrupts) {
+    if (interrupt.irq == irq) {
+      interrupt.handler = std::move(handler);
+      return;
+    }
+  }
+  interrupts.push_back({irq, false, std::move(handler)});
+}
+
+void nrfsim::IrqEnable(IRQn_Type irq) {
+  for (auto& interrupt : interrupts) {
+    if (interrupt.irq == irq) {
+      interrupt.enabled = true;
+      return;
+    }
+  }
+  interrupts.push_back({irq, true, nullptr});
+}
+
+const InterruptStatistics& nrfsim::GetInterruptStatistics() {
+  return interruptStatistics;
+}
+
+void nrfsim::Fail(const char* file, int line, const char* message) {
+  fprintf(stderr, "%s:%d: %s (at %llu ns)\n", file, line, message, static_cast<unsigned long long>(now));
+  abort();
+}
+
+void nrfsim::PollEvent() {
+  // A busy-wait: the hardware runs while the CPU polls the register
+  if (!events.empty()) {
+    idlePolls = 0;
+  } else if (++idlePolls > 1000000) {
+    Fail(__FILE__, __LINE__, "busy-wait on an event that is never raised");
+  }
+  AdvanceHardware(configuration.pollCost);
+}
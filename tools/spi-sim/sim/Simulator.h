@@ -0,0 +1,51 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <nrf.h>
+
+// Discrete event simulation of the CPU and the peripherals used by the SPI drivers.
+//
+// The code of the firmware runs on the host CPU, but the time is simulated: it only passes when the firmware waits
+// (blocking FreeRTOS calls, nrf_delay_us(), busy-waits on an event register) or when the benchmark charges the
+// execution time of its own code (Compute()). The peripherals schedule their events on this clock, and the interrupt
+// handlers run when their event is raised, unless the CPU is in a critical section or already in an interrupt handler.
+namespace nrfsim {
+  using Nanoseconds = uint64_t;
+
+  struct Configuration {
+    // Time spent in each interrupt handler (entry, handler, exit), during which the task does not run
+    Nanoseconds interruptCost = 2000;
+    // Time spent by each iteration of a busy-wait on an event register
+    Nanoseconds pollCost = 100;
+  };
+
+  struct InterruptStatistics {
+    uint32_t spim0 = 0;
+    uint32_t timer3 = 0;
+  };
+
+  Configuration& GetConfiguration();
+  Nanoseconds Now();
+
+  // Schedules a call from the simulated hardware, delay nanoseconds from now
+  void Schedule(Nanoseconds delay, std::function<void()> callback);
+
+  // The task executes code that takes this time (it is preempted by the interrupt handlers)
+  void Compute(Nanoseconds duration);
+  // The task is blocked until condition() is true or until the timeout. Returns condition().
+  bool WaitUntil(const std::function<bool()>& condition, Nanoseconds timeout);
+  constexpr Nanoseconds Forever = UINT64_MAX;
+
+  // Called when the events or the interrupt enable registers of a peripheral change
+  void CheckInterrupts();
+  void EnterCritical();
+  void ExitCritical();
+  bool InInterrupt();
+  // One iteration of a busy-wait on an event register
+  void PollEvent();
+
+  // The interrupt handlers of the firmware (see main.cpp) are defined by the program using the simulator. They are
+  // called when the interrupt is enabled (NRFX_IRQ_ENABLE) and the line of the peripheral is pending.
+  void ConnectInterrupt(IRQn_Type irq, std::function<void()> handler);
+  const InterruptStatistics& GetInterruptStatistics();
+}
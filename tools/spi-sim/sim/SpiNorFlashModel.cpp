@@ -0,0 +1,101 @@
+#include "sim/SpiNorFlashModel.h"
+
+using namespace nrfsim;
+
+namespace {
+  enum Commands : uint8_t {
+    Read = 0x03,
+    ReadStatusRegister = 0x05,
+    WriteEnable = 0x06,
+    ReadConfigurationRegister = 0x15,
+    ReadSecurityRegister = 0x2b,
+    ReadIdentification = 0x9f,
+    ReleaseFromDeepPowerDown = 0xab,
+    DeepPowerDown = 0xb9,
+  };
+
+  constexpr uint8_t identification[3] = {0x0b, 0x40, 0x16};
+  constexpr uint8_t deviceId = 0x15;
+  constexpr uint8_t statusWriteEnabled = 0x02;
+  // Level of MISO when the memory does not drive it
+  constexpr uint8_t released = 0xff;
+}
+
+SpiNorFlashModel::SpiNorFlashModel() : memory(Size, 0xff) {
+}
+
+void SpiNorFlashModel::Select() {
+  position = 0;
+}
+
+void SpiNorFlashModel::Deselect() {
+  if (position == 0) {
+    return;
+  }
+  switch (command) {
+    case WriteEnable:
+      writeEnabled = !deepPowerDown;
+      break;
+    case DeepPowerDown:
+      deepPowerDown = true;
+      break;
+    case ReleaseFromDeepPowerDown:
+      deepPowerDown = false;
+      break;
+    default:
+      break;
+  }
+}
+
+uint8_t SpiNorFlashModel::Transfer(uint8_t mosi, bool /*dataCommand*/) {
+  const uint32_t index = position++;
+  if (index == 0) {
+    command = mosi;
+    if (deepPowerDown && command != ReleaseFromDeepPowerDown) {
+      // Ignored until the memory is released from the deep power down mode
+      command = 0;
+      return released;
+    }
+    statistics.commands++;
+    switch (command) {
+      case Read:
+        statistics.reads++;
+        address = 0;
+        break;
+      case ReadStatusRegister:
+      case WriteEnable:
+      case ReadConfigurationRegister:
+      case ReadSecurityRegister:
+      case ReadIdentification:
+      case ReleaseFromDeepPowerDown:
+      case DeepPowerDown:
+      case 0:
+        break;
+      default:
+        Fail(__FILE__, __LINE__, "command of the flash memory not modelled");
+    }
+    return released;
+  }
+
+  switch (command) {
+    case Read:
+      if (index < 4) {
+        address = (address << 8) | mosi;
+        return released;
+      }
+      statistics.readBytes++;
+      return memory[address++ % Size];
+    case ReadStatusRegister:
+      return writeEnabled ? statusWriteEnabled : 0;
+    case ReadConfigurationRegister:
+    case ReadSecurityRegister:
+      return 0;
+    case ReadIdentification:
+      return (index <= sizeof(identification)) ? identification[index - 1] : released;
+    case ReleaseFromDeepPowerDown:
+      // The device ID follows 3 dummy bytes
+      return (index >= 4) ? deviceId : released;
+    default:
+      return released;
+  }
+}
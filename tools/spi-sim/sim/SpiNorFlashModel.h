@@ -0,0 +1,45 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "sim/Peripherals.h"
+
+namespace nrfsim {
+  // The 4MB NOR flash memory of the PineTime (XT25F32B), for the reads: the read command, the identification, the
+  // status, configuration and security registers, and the deep power down mode. The programs write the content
+  // directly in Memory(). The commands that program or erase the memory are not modelled.
+  class SpiNorFlashModel : public SpiDevice {
+  public:
+    static constexpr uint32_t Size = 4 * 1024 * 1024;
+
+    struct Statistics {
+      uint32_t commands = 0;
+      uint32_t reads = 0;
+      uint64_t readBytes = 0;
+    };
+
+    SpiNorFlashModel();
+
+    void Select() override;
+    void Deselect() override;
+    uint8_t Transfer(uint8_t mosi, bool dataCommand) override;
+
+    uint8_t* Memory() {
+      return memory.data();
+    }
+
+    const Statistics& GetStatistics() const {
+      return statistics;
+    }
+
+  private:
+    std::vector<uint8_t> memory;
+    Statistics statistics;
+
+    uint8_t command = 0;
+    // Bytes received since the device was selected
+    uint32_t position = 0;
+    uint32_t address = 0;
+    bool writeEnabled = false;
+    bool deepPowerDown = false;
+  };
+}
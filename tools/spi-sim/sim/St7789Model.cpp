@@ -0,0 +1,157 @@
+#include "sim/St7789Model.h"
+
+using namespace nrfsim;
+
+namespace {
+  enum Commands : uint8_t {
+    SoftwareReset = 0x01,
+    ColumnAddressSet = 0x2a,
+    RowAddressSet = 0x2b,
+    WriteToRam = 0x2c,
+    VerticalScrollDefinition = 0x33,
+    VerticalScrollStartAddress = 0x37,
+    WriteMemoryContinue = 0x3c,
+  };
+
+  uint16_t Word(const std::array<uint8_t, 6>& parameters, size_t index) {
+    return static_cast<uint16_t>((parameters[index] << 8) | parameters[index + 1]);
+  }
+}
+
+St7789Model::St7789Model() : ram(Width * Height, 0) {
+}
+
+void St7789Model::Select() {
+}
+
+void St7789Model::Deselect() {
+  // The serial interface is reset: a pixel that was half sent is lost
+  if (pixelHighByteValid) {
+    statistics.truncatedPixels++;
+    pixelHighByteValid = false;
+  }
+}
+
+uint8_t St7789Model::Transfer(uint8_t mosi, bool dataCommand) {
+  if (dataCommand) {
+    Parameter(mosi);
+  } else {
+    Command(mosi);
+  }
+  return 0;
+}
+
+void St7789Model::Command(uint8_t value) {
+  statistics.commands++;
+  command = value;
+  parameterCount = 0;
+  pixelHighByteValid = false;
+
+  switch (command) {
+    case SoftwareReset:
+      // The registers are reset, the content of the RAM is kept
+      columnStart = 0;
+      columnEnd = Width - 1;
+      rowStart = 0;
+      rowEnd = Height - 1;
+      x = 0;
+      y = 0;
+      topFixedLines = 0;
+      scrollLines = Height;
+      scrollStart = 0;
+      break;
+    case WriteToRam:
+      statistics.memoryWrites++;
+      x = columnStart;
+      y = rowStart;
+      pointerWrapped = false;
+      break;
+    case WriteMemoryContinue:
+      // Continues from the position following the last pixel written
+      statistics.memoryWrites++;
+      break;
+    default:
+      break;
+  }
+}
+
+void St7789Model::Parameter(uint8_t value) {
+  switch (command) {
+    case WriteToRam:
+    case WriteMemoryContinue:
+      if (!pixelHighByteValid) {
+        pixelHighByte = value;
+        pixelHighByteValid = true;
+      } else {
+        pixelHighByteValid = false;
+        WritePixel(static_cast<uint16_t>((pixelHighByte << 8) | value));
+      }
+      return;
+    default:
+      break;
+  }
+
+  if (parameterCount < parameters.size()) {
+    parameters[parameterCount] = value;
+  }
+  parameterCount++;
+
+  switch (command) {
+    case ColumnAddressSet:
+      if (parameterCount == 4) {
+        columnStart = Word(parameters, 0);
+        columnEnd = Word(parameters, 2);
+      }
+      break;
+    case RowAddressSet:
+      if (parameterCount == 4) {
+        rowStart = Word(parameters, 0);
+        rowEnd = Word(parameters, 2);
+        statistics.addressWindows++;
+      }
+      break;
+    case VerticalScrollDefinition:
+      if (parameterCount == 6) {
+        topFixedLines = Word(parameters, 0);
+        scrollLines = Word(parameters, 2);
+      }
+      break;
+    case VerticalScrollStartAddress:
+      if (parameterCount == 2) {
+        scrollStart = Word(parameters, 0);
+        statistics.scrollCommands++;
+      }
+      break;
+    default:
+      break;
+  }
+}
+
+void St7789Model::WritePixel(uint16_t value) {
+  statistics.pixels++;
+  if (pointerWrapped) {
+    statistics.wrappedPixels++;
+  }
+  if (x < Width && y < Height) {
+    ram[y * Width + x] = value;
+  }
+  if (x < columnEnd) {
+    x++;
+    return;
+  }
+  x = columnStart;
+  if (y < rowEnd) {
+    y++;
+  } else {
+    y = rowStart;
+    pointerWrapped = true;
+  }
+}
+
+uint16_t St7789Model::Panel(uint16_t column, uint16_t line) const {
+  uint16_t ramLine = line;
+  if (line >= topFixedLines && line < topFixedLines + scrollLines && scrollStart >= topFixedLines) {
+    ramLine = topFixedLines + (line - topFixedLines + scrollStart - topFixedLines) % scrollLines;
+  }
+  return Ram(column, ramLine);
+}
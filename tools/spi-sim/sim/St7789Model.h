@@ -0,0 +1,70 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <vector>
+#include "sim/Peripherals.h"
+
+namespace nrfsim {
+  // The display controller: the commands used by the driver, the 240x320 RAM of 16 bits pixels and the vertical
+  // scrolling. The panel of the PineTime shows 240 lines.
+  class St7789Model : public SpiDevice {
+  public:
+    static constexpr uint16_t Width = 240;
+    static constexpr uint16_t Height = 320;
+    static constexpr uint16_t VisibleLines = 240;
+
+    struct Statistics {
+      uint32_t commands = 0;
+      uint32_t addressWindows = 0; // RASET
+      uint32_t memoryWrites = 0;   // RAMWR and RAMWRC
+      uint32_t scrollCommands = 0; // VSCSAD
+      uint64_t pixels = 0;
+      // Pixels written outside the columns of the address window, or after its last line
+      uint32_t wrappedPixels = 0;
+      // The CS pin went high between the two bytes of a pixel
+      uint32_t truncatedPixels = 0;
+    };
+
+    St7789Model();
+
+    void Select() override;
+    void Deselect() override;
+    uint8_t Transfer(uint8_t mosi, bool dataCommand) override;
+
+    uint16_t Ram(uint16_t x, uint16_t y) const {
+      return ram[y * Width + x];
+    }
+    // The pixel shown on the panel, taking the vertical scrolling into account
+    uint16_t Panel(uint16_t x, uint16_t y) const;
+
+    const Statistics& GetStatistics() const {
+      return statistics;
+    }
+
+  private:
+    void Command(uint8_t command);
+    void Parameter(uint8_t value);
+    void WritePixel(uint16_t value);
+
+    std::vector<uint16_t> ram;
+    Statistics statistics;
+
+    uint8_t command = 0;
+    std::array<uint8_t, 6> parameters {};
+    size_t parameterCount = 0;
+    bool pixelHighByteValid = false;
+    uint8_t pixelHighByte = 0;
+
+    uint16_t columnStart = 0;
+    uint16_t columnEnd = Width - 1;
+    uint16_t rowStart = 0;
+    uint16_t rowEnd = Height - 1;
+    uint16_t x = 0;
+    uint16_t y = 0;
+    bool pointerWrapped = false;
+
+    uint16_t topFixedLines = 0;
+    uint16_t scrollLines = Height;
+    uint16_t scrollStart = 0;
+  };
+}
@@ -0,0 +1,26 @@
+#include "drivers/TwiMaster.h"
+
+// The touch panel is not simulated: the TWI transactions fail, as if the touch controller did not answer.
+
+using namespace Pinetime::Drivers;
+
+TwiMaster::TwiMaster(NRF_TWIM_Type* module, uint32_t frequency, uint8_t pinSda, uint8_t pinScl)
+  : module {module}, frequency {frequency}, pinSda {pinSda}, pinScl {pinScl} {
+}
+
+void TwiMaster::Init() {
+}
+
+TwiMaster::ErrorCodes TwiMaster::Read(uint8_t /*deviceAddress*/, uint8_t /*registerAddress*/, uint8_t* /*buffer*/, size_t /*size*/) {
+  return ErrorCodes::TransactionFailed;
+}
+
+TwiMaster::ErrorCodes TwiMaster::Write(uint8_t /*deviceAddress*/, uint8_t /*registerAddress*/, const uint8_t* /*data*/, size_t /*size*/) {
+  return ErrorCodes::TransactionFailed;
+}
+
+void TwiMaster::Sleep() {
+}
+
+void TwiMaster::Wakeup() {
+}
@@ -0,0 +1,25 @@
+#pragma once
+#include <cstdint>
+#include <nrf.h>
+
+// FreeRTOS on the simulated clock (sim/FreeRtos.cpp). There is a single task, the one of the benchmark: blocking calls
+// let the simulated time pass (and the interrupt handlers run) until they return.
+
+typedef long BaseType_t;
+typedef unsigned long UBaseType_t;
+typedef uint32_t TickType_t;
+
+#define pdFALSE ((BaseType_t) 0)
+#define pdTRUE ((BaseType_t) 1)
+#define pdPASS (pdTRUE)
+#define pdFAIL (pdFALSE)
+#define portMAX_DELAY ((TickType_t) 0xffffffffUL)
+#define configTICK_RATE_HZ ((TickType_t) 1024)
+#define pdMS_TO_TICKS(xTimeInMs) ((TickType_t) (((TickType_t) (xTimeInMs) * (TickType_t) configTICK_RATE_HZ) / (TickType_t) 1000))
+
+void vPortEnterCritical();
+void vPortExitCritical();
+
+#define taskENTER_CRITICAL() vPortEnterCritical()
+#define taskEXIT_CRITICAL() vPortExitCritical()
+#define portYIELD_FROM_ISR(x) ((void) (x))
@@ -0,0 +1,4 @@
+#pragma once
+
+// The touch panel is not simulated (see sim/TwiMaster.cpp)
+struct NRF_TWIM_Type;
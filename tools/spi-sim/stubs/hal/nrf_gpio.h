@@ -0,0 +1,13 @@
+#pragma once
+#include <cstdint>
+
+// The pins are simulated by sim/Gpio.cpp: the SPI devices are selected by the level of their CS pin
+
+typedef enum { NRF_GPIO_PIN_NOPULL, NRF_GPIO_PIN_PULLDOWN, NRF_GPIO_PIN_PULLUP = 3 } nrf_gpio_pin_pull_t;
+
+void nrf_gpio_cfg_output(uint32_t pin);
+void nrf_gpio_cfg_input(uint32_t pin, nrf_gpio_pin_pull_t pull);
+void nrf_gpio_cfg_default(uint32_t pin);
+void nrf_gpio_pin_set(uint32_t pin);
+void nrf_gpio_pin_clear(uint32_t pin);
+uint32_t nrf_gpio_pin_read(uint32_t pin);
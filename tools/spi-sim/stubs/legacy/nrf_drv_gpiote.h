@@ -0,0 +1,2 @@
+#pragma once
+#include <hal/nrf_gpio.h>
@@ -0,0 +1,6 @@
+#pragma once
+#include <cstdint>
+
+// Busy-waits on the simulated clock
+void nrf_delay_us(uint32_t us);
+void nrf_delay_ms(uint32_t ms);
@@ -0,0 +1,152 @@
+#pragma once
+#include <cstdint>
+#include <littlefs/lfs_util.h>
+
+// The API of littlefs 2 used by the firmware, implemented by the model of sim/Littlefs.cpp. The types keep the names
+// and the fields of littlefs that the model needs.
+
+typedef uint32_t lfs_size_t;
+typedef uint32_t lfs_off_t;
+typedef int32_t lfs_ssize_t;
+typedef int32_t lfs_soff_t;
+typedef uint32_t lfs_block_t;
+
+#define LFS_NAME_MAX 255
+
+enum lfs_error {
+  LFS_ERR_OK = 0,
+  LFS_ERR_IO = -5,
+  LFS_ERR_CORRUPT = -84,
+  LFS_ERR_NOENT = -2,
+  LFS_ERR_EXIST = -17,
+  LFS_ERR_NOTDIR = -20,
+  LFS_ERR_ISDIR = -21,
+  LFS_ERR_NOTEMPTY = -39,
+  LFS_ERR_BADF = -9,
+  LFS_ERR_FBIG = -27,
+  LFS_ERR_INVAL = -22,
+  LFS_ERR_NOSPC = -28,
+  LFS_ERR_NOMEM = -12,
+  LFS_ERR_NOATTR = -61,
+  LFS_ERR_NAMETOOLONG = -36,
+};
+
+enum lfs_type {
+  LFS_TYPE_REG = 0x001,
+  LFS_TYPE_DIR = 0x002,
+};
+
+enum lfs_open_flags {
+  LFS_O_RDONLY = 1,
+  LFS_O_WRONLY = 2,
+  LFS_O_RDWR = 3,
+  LFS_O_CREAT = 0x0100,
+  LFS_O_EXCL = 0x0200,
+  LFS_O_TRUNC = 0x0400,
+  LFS_O_APPEND = 0x0800,
+};
+
+enum lfs_whence_flags {
+  LFS_SEEK_SET = 0,
+  LFS_SEEK_CUR = 1,
+  LFS_SEEK_END = 2,
+};
+
+struct lfs_config {
+  void* context;
+  int (*read)(const struct lfs_config* c, lfs_block_t block, lfs_off_t off, void* buffer, lfs_size_t size);
+  int (*prog)(const struct lfs_config* c, lfs_block_t block, lfs_off_t off, const void* buffer, lfs_size_t size);
+  int (*erase)(const struct lfs_config* c, lfs_block_t block);
+  int (*sync)(const struct lfs_config* c);
+  lfs_size_t read_size;
+  lfs_size_t prog_size;
+  lfs_size_t block_size;
+  lfs_size_t block_count;
+  int32_t block_cycles;
+  lfs_size_t cache_size;
+  lfs_size_t lookahead_size;
+  void* read_buffer;
+  void* prog_buffer;
+  void* lookahead_buffer;
+  lfs_size_t name_max;
+  lfs_size_t file_max;
+  lfs_size_t attr_max;
+};
+
+struct lfs_info {
+  uint8_t type;
+  lfs_size_t size;
+  char name[LFS_NAME_MAX + 1];
+};
+
+typedef struct lfs_cache {
+  lfs_block_t block;
+  lfs_off_t off;
+  lfs_size_t size;
+  uint8_t* buffer;
+} lfs_cache_t;
+
+// A metadata pair, as fetched: the block holding the last commit, the end of the commit, its last tag, and the next
+// metadata pair of the file system
+typedef struct lfs_mdir {
+  lfs_block_t pair[2];
+  uint32_t rev;
+  lfs_off_t off;
+  uint32_t etag;
+  uint16_t count;
+  lfs_block_t tail[2];
+} lfs_mdir_t;
+
+typedef struct lfs_dir {
+  lfs_mdir_t m;
+  uint16_t id;
+  lfs_off_t pos;
+  lfs_block_t head[2];
+} lfs_dir_t;
+
+typedef struct lfs_file {
+  uint16_t id;
+  uint8_t type;
+  lfs_mdir_t m;
+  struct lfs_ctz {
+    lfs_block_t head;
+    lfs_size_t size;
+  } ctz;
+  uint32_t flags;
+  lfs_off_t pos;
+  lfs_block_t block;
+  lfs_off_t off;
+  lfs_cache_t cache;
+} lfs_file_t;
+
+typedef struct lfs {
+  lfs_cache_t rcache;
+  lfs_block_t root[2];
+  const struct lfs_config* cfg;
+} lfs_t;
+
+int lfs_format(lfs_t* lfs, const struct lfs_config* config);
+int lfs_mount(lfs_t* lfs, const struct lfs_config* config);
+int lfs_unmount(lfs_t* lfs);
+
+int lfs_remove(lfs_t* lfs, const char* path);
+int lfs_rename(lfs_t* lfs, const char* oldpath, const char* newpath);
+int lfs_stat(lfs_t* lfs, const char* path, struct lfs_info* info);
+lfs_ssize_t lfs_getattr(lfs_t* lfs, const char* path, uint8_t type, void* buffer, lfs_size_t size);
+int lfs_setattr(lfs_t* lfs, const char* path, uint8_t type, const void* buffer, lfs_size_t size);
+int lfs_removeattr(lfs_t* lfs, const char* path, uint8_t type);
+
+int lfs_file_open(lfs_t* lfs, lfs_file_t* file, const char* path, int flags);
+int lfs_file_close(lfs_t* lfs, lfs_file_t* file);
+lfs_ssize_t lfs_file_read(lfs_t* lfs, lfs_file_t* file, void* buffer, lfs_size_t size);
+lfs_ssize_t lfs_file_write(lfs_t* lfs, lfs_file_t* file, const void* buffer, lfs_size_t size);
+lfs_soff_t lfs_file_seek(lfs_t* lfs, lfs_file_t* file, lfs_soff_t off, int whence);
+lfs_soff_t lfs_file_size(lfs_t* lfs, lfs_file_t* file);
+
+int lfs_mkdir(lfs_t* lfs, const char* path);
+int lfs_dir_open(lfs_t* lfs, lfs_dir_t* dir, const char* path);
+int lfs_dir_close(lfs_t* lfs, lfs_dir_t* dir);
+int lfs_dir_read(lfs_t* lfs, lfs_dir_t* dir, struct lfs_info* info);
+int lfs_dir_rewind(lfs_t* lfs, lfs_dir_t* dir);
+
+lfs_ssize_t lfs_fs_size(lfs_t* lfs);
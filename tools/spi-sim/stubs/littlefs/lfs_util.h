@@ -0,0 +1,38 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// The utilities of littlefs used by the firmware and by the model of sim/Littlefs.cpp
+
+static inline uint32_t lfs_max(uint32_t a, uint32_t b) {
+  return (a > b) ? a : b;
+}
+
+static inline uint32_t lfs_min(uint32_t a, uint32_t b) {
+  return (a < b) ? a : b;
+}
+
+static inline uint32_t lfs_aligndown(uint32_t a, uint32_t alignment) {
+  return a - (a % alignment);
+}
+
+static inline uint32_t lfs_alignup(uint32_t a, uint32_t alignment) {
+  return lfs_aligndown(a + alignment - 1, alignment);
+}
+
+// Smallest power of 2 greater than or equal to a
+static inline uint32_t lfs_npw2(uint32_t a) {
+  return 32 - __builtin_clz(a - 1);
+}
+
+// Trailing zeros, the number of skip pointers of a block of a CTZ list is lfs_ctz(index) + 1
+static inline uint32_t lfs_ctz(uint32_t a) {
+  return __builtin_ctz(a);
+}
+
+static inline uint32_t lfs_popc(uint32_t a) {
+  return __builtin_popcount(a);
+}
+
+// CRC32 with the polynomial 0x04c11db7 (reflected), without the initial and final inversions
+uint32_t lfs_crc(uint32_t crc, const void* buffer, size_t size);
@@ -0,0 +1,174 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// The part of the LVGL 7 API used by LittleVgl, implemented by the refresh model of sim/Lvgl.cpp
+// (the configuration of src/libs/lv_conf.h: 240x240 pixels, 16 bits colors with swapped bytes), and the file system
+// interface and the heap used by FS and StreamingFont, implemented by sim/LvglFs.cpp.
+
+#define LV_HOR_RES_MAX (240)
+#define LV_VER_RES_MAX (240)
+#define LV_HOR_RES lv_disp_get_hor_res(nullptr)
+#define LV_VER_RES lv_disp_get_ver_res(nullptr)
+
+typedef int16_t lv_coord_t;
+
+typedef struct {
+  lv_coord_t x1;
+  lv_coord_t y1;
+  lv_coord_t x2;
+  lv_coord_t y2;
+} lv_area_t;
+
+typedef struct {
+  lv_coord_t x;
+  lv_coord_t y;
+} lv_point_t;
+
+// LV_COLOR_16_SWAP: the high byte of the RGB565 value is the first one in memory
+typedef struct {
+  uint16_t full;
+} lv_color_t;
+
+#define LV_COLOR_MAKE(r8, g8, b8)                                                                                                          \
+  lv_color_t {                                                                                                                             \
+    static_cast<uint16_t>(((((g8) >> 5) & 0x07) | (((r8) >> 3) << 3) | (((b8) >> 3) << 8) | ((((g8) >> 2) & 0x07) << 13)))                 \
+  }
+#define LV_COLOR_WHITE LV_COLOR_MAKE(0xFF, 0xFF, 0xFF)
+#define LV_COLOR_SILVER LV_COLOR_MAKE(0xC0, 0xC0, 0xC0)
+#define LV_COLOR_BLACK LV_COLOR_MAKE(0x00, 0x00, 0x00)
+
+typedef struct {
+  uint16_t adv_w;
+  uint16_t box_w;
+  uint16_t box_h;
+  int16_t ofs_x;
+  int16_t ofs_y;
+  uint8_t bpp;
+} lv_font_glyph_dsc_t;
+
+typedef struct _lv_font_struct {
+  bool (*get_glyph_dsc)(const struct _lv_font_struct* font, lv_font_glyph_dsc_t* dsc, uint32_t letter, uint32_t letter_next);
+  const uint8_t* (*get_glyph_bitmap)(const struct _lv_font_struct* font, uint32_t letter);
+  lv_coord_t line_height;
+  lv_coord_t base_line;
+  uint8_t subpx : 2;
+  int8_t underline_position;
+  int8_t underline_thickness;
+  void* dsc;
+  void* user_data;
+} lv_font_t;
+
+typedef struct {
+  const lv_font_t* font;
+} lv_theme_t;
+
+typedef struct {
+  uint8_t dummy;
+} lv_style_t;
+
+typedef struct {
+  void* buf1;
+  void* buf2;
+  void* buf_act;
+  uint32_t size;
+  lv_area_t area;
+  volatile int flushing;
+  volatile int flushing_last;
+  volatile uint32_t last_area : 1;
+  volatile uint32_t last_part : 1;
+} lv_disp_buf_t;
+
+typedef struct _disp_drv_t {
+  lv_coord_t hor_res;
+  lv_coord_t ver_res;
+  lv_disp_buf_t* buffer;
+  void (*flush_cb)(struct _disp_drv_t* disp_drv, const lv_area_t* area, lv_color_t* color_p);
+  void (*rounder_cb)(struct _disp_drv_t* disp_drv, lv_area_t* area);
+  void (*monitor_cb)(struct _disp_drv_t* disp_drv, uint32_t time, uint32_t px);
+  void (*wait_cb)(struct _disp_drv_t* disp_drv);
+  void* user_data;
+} lv_disp_drv_t;
+
+typedef struct _disp_t lv_disp_t;
+
+typedef enum { LV_INDEV_STATE_REL = 0, LV_INDEV_STATE_PR } lv_indev_state_t;
+typedef enum { LV_INDEV_TYPE_NONE, LV_INDEV_TYPE_POINTER } lv_indev_type_t;
+
+typedef struct {
+  lv_point_t point;
+  lv_indev_state_t state;
+} lv_indev_data_t;
+
+typedef struct _lv_indev_drv_t {
+  lv_indev_type_t type;
+  bool (*read_cb)(struct _lv_indev_drv_t* indev_drv, lv_indev_data_t* data);
+  void* user_data;
+} lv_indev_drv_t;
+
+typedef struct _lv_indev_t lv_indev_t;
+
+void lv_init();
+void lv_disp_buf_init(lv_disp_buf_t* disp_buf, void* buf1, void* buf2, uint32_t size_in_px_cnt);
+void lv_disp_drv_init(lv_disp_drv_t* driver);
+lv_disp_t* lv_disp_drv_register(lv_disp_drv_t* driver);
+lv_disp_t* lv_disp_get_default();
+lv_coord_t lv_disp_get_hor_res(lv_disp_t* disp);
+lv_coord_t lv_disp_get_ver_res(lv_disp_t* disp);
+// Added by the fork of LVGL used by InfiniTime: 0 = top to bottom, 1 = bottom to top, 2 to 5 = horizontal
+void lv_disp_set_direction(lv_disp_t* disp, int direction);
+void lv_disp_flush_ready(lv_disp_drv_t* disp_drv);
+void lv_indev_drv_init(lv_indev_drv_t* driver);
+lv_indev_t* lv_indev_drv_register(lv_indev_drv_t* driver);
+void lv_theme_set_act(lv_theme_t* th);
+
+extern lv_font_t jetbrains_mono_bold_20;
+
+typedef uint8_t lv_fs_res_t;
+enum {
+  LV_FS_RES_OK = 0,
+  LV_FS_RES_HW_ERR,
+  LV_FS_RES_FS_ERR,
+  LV_FS_RES_NOT_EX,
+  LV_FS_RES_FULL,
+  LV_FS_RES_LOCKED,
+  LV_FS_RES_DENIED,
+  LV_FS_RES_BUSY,
+  LV_FS_RES_TOUT,
+  LV_FS_RES_NOT_IMP,
+  LV_FS_RES_OUT_OF_MEM,
+  LV_FS_RES_INV_PARAM,
+  LV_FS_RES_UNKNOWN,
+};
+
+typedef uint8_t lv_fs_mode_t;
+enum {
+  LV_FS_MODE_WR = 0x01,
+  LV_FS_MODE_RD = 0x02,
+};
+
+typedef struct _lv_fs_drv_t {
+  char letter;
+  uint16_t file_size;
+  lv_fs_res_t (*open_cb)(struct _lv_fs_drv_t* drv, void* file_p, const char* path, lv_fs_mode_t mode);
+  lv_fs_res_t (*close_cb)(struct _lv_fs_drv_t* drv, void* file_p);
+  lv_fs_res_t (*read_cb)(struct _lv_fs_drv_t* drv, void* file_p, void* buf, uint32_t btr, uint32_t* br);
+  lv_fs_res_t (*seek_cb)(struct _lv_fs_drv_t* drv, void* file_p, uint32_t pos);
+  lv_fs_res_t (*tell_cb)(struct _lv_fs_drv_t* drv, void* file_p, uint32_t* pos_p);
+  void* user_data;
+} lv_fs_drv_t;
+
+typedef struct {
+  void* file_d;
+  lv_fs_drv_t* drv;
+} lv_fs_file_t;
+
+void lv_fs_drv_init(lv_fs_drv_t* drv);
+void lv_fs_drv_register(lv_fs_drv_t* drv_p);
+lv_fs_res_t lv_fs_open(lv_fs_file_t* file_p, const char* path, lv_fs_mode_t mode);
+lv_fs_res_t lv_fs_close(lv_fs_file_t* file_p);
+lv_fs_res_t lv_fs_read(lv_fs_file_t* file_p, void* buf, uint32_t btr, uint32_t* br);
+lv_fs_res_t lv_fs_seek(lv_fs_file_t* file_p, uint32_t pos);
+
+void* lv_mem_alloc(size_t size);
+void lv_mem_free(const void* data);
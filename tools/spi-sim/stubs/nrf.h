@@ -0,0 +1,204 @@
+#pragma once
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+
+// Registers of the nRF52832 peripherals used by the SPI drivers. The registers are objects that notify the simulated
+// peripherals (sim/Peripherals.cpp) when they are written (tasks, INTENSET,...) or read (busy-waits on an event).
+// The pointers written in the registers (TXD.PTR, PPI EEP/TEP) are host pointers, so the registers are as wide as a pointer.
+
+namespace nrfsim {
+  class Register;
+  void OnRegisterWrite(Register* reg);
+  void OnRegisterRead(const Register* reg);
+
+  class Register {
+  public:
+    Register() = default;
+    Register(const Register&) = delete;
+    Register& operator=(const Register&) = delete;
+
+    Register& operator=(uintptr_t newValue) {
+      value = newValue;
+      OnRegisterWrite(this);
+      return *this;
+    }
+
+    operator uintptr_t() const {
+      OnRegisterRead(this);
+      return value;
+    }
+
+    Register& operator|=(uintptr_t bits) {
+      return *this = static_cast<uintptr_t>(*this) | bits;
+    }
+
+    Register& operator&=(uintptr_t bits) {
+      return *this = static_cast<uintptr_t>(*this) & bits;
+    }
+
+    // Access from the simulated hardware, without notification
+    uintptr_t value = 0;
+  };
+
+  // DWT->CYCCNT counts the cycles of the 64MHz CPU on the simulated clock
+  class CycleCounter {
+  public:
+    operator uint32_t() const;
+  };
+
+  [[noreturn]] void Fail(const char* file, int line, const char* message);
+}
+
+#define ASSERT(expr)                                                                                                                       \
+  if (!(expr)) {                                                                                                                           \
+    nrfsim::Fail(__FILE__, __LINE__, #expr);                                                                                               \
+  }
+
+using nrfsim::Register;
+
+struct NRF_SPIM_Type {
+  Register TASKS_START;
+  Register TASKS_STOP;
+  Register TASKS_SUSPEND;
+  Register TASKS_RESUME;
+  Register EVENTS_STOPPED;
+  Register EVENTS_ENDRX;
+  Register EVENTS_END;
+  Register EVENTS_ENDTX;
+  Register EVENTS_STARTED;
+  Register SHORTS;
+  Register INTENSET;
+  Register INTENCLR;
+  Register ENABLE;
+
+  struct {
+    Register SCK;
+    Register MOSI;
+    Register MISO;
+  } PSEL;
+
+  Register FREQUENCY;
+
+  struct {
+    Register PTR;
+    Register MAXCNT;
+    Register AMOUNT;
+    Register LIST;
+  } RXD, TXD;
+
+  Register CONFIG;
+  Register ORC;
+};
+
+#define PSELSCK PSEL.SCK
+#define PSELMOSI PSEL.MOSI
+#define PSELMISO PSEL.MISO
+
+struct NRF_TIMER_Type {
+  Register TASKS_START;
+  Register TASKS_STOP;
+  Register TASKS_COUNT;
+  Register TASKS_CLEAR;
+  Register TASKS_SHUTDOWN;
+  Register TASKS_CAPTURE[6];
+  Register EVENTS_COMPARE[6];
+  Register SHORTS;
+  Register INTENSET;
+  Register INTENCLR;
+  Register MODE;
+  Register BITMODE;
+  Register PRESCALER;
+  Register CC[6];
+};
+
+struct PPI_TASKS_CHG_Type {
+  Register EN;
+  Register DIS;
+};
+
+struct PPI_CH_Type {
+  Register EEP;
+  Register TEP;
+};
+
+struct NRF_PPI_Type {
+  PPI_TASKS_CHG_Type TASKS_CHG[6];
+  Register CHEN;
+  Register CHENSET;
+  Register CHENCLR;
+  PPI_CH_Type CH[20];
+  Register CHG[6];
+};
+
+struct NRF_GPIOTE_Type {
+  Register TASKS_OUT[8];
+  Register TASKS_SET[8];
+  Register TASKS_CLR[8];
+  Register EVENTS_IN[8];
+  Register EVENTS_PORT;
+  Register INTENSET;
+  Register INTENCLR;
+  Register CONFIG[8];
+};
+
+struct DWT_Type {
+  Register CTRL;
+  nrfsim::CycleCounter CYCCNT;
+};
+
+struct CoreDebug_Type {
+  Register DEMCR;
+};
+
+namespace nrfsim {
+  extern NRF_SPIM_Type spim0;
+  extern NRF_SPIM_Type spim1;
+  extern NRF_TIMER_Type timer3;
+  extern NRF_PPI_Type ppi;
+  extern NRF_GPIOTE_Type gpiote;
+  extern DWT_Type dwt;
+  extern CoreDebug_Type coreDebug;
+}
+
+#define NRF_SPIM0 (&nrfsim::spim0)
+#define NRF_SPIM1 (&nrfsim::spim1)
+#define NRF_TIMER3 (&nrfsim::timer3)
+#define NRF_PPI (&nrfsim::ppi)
+#define NRF_GPIOTE (&nrfsim::gpiote)
+#define DWT (&nrfsim::dwt)
+#define CoreDebug (&nrfsim::coreDebug)
+
+#define DWT_CTRL_CYCCNTENA_Msk (1UL)
+#define CoreDebug_DEMCR_TRCENA_Msk (1UL << 24)
+
+typedef enum {
+  SPIM0_SPIS0_TWIM0_TWIS0_SPI0_TWI0_IRQn = 3,
+  SPIM1_SPIS1_TWIM1_TWIS1_SPI1_TWI1_IRQn = 4,
+  TIMER3_IRQn = 26,
+} IRQn_Type;
+
+namespace nrfsim {
+  void IrqEnable(IRQn_Type irq);
+}
+
+#define NRFX_IRQ_PRIORITY_SET(irq, priority) ((void) (priority))
+#define NRFX_IRQ_ENABLE(irq) nrfsim::IrqEnable(irq)
+
+#define SPIM_ENABLE_ENABLE_Pos (0UL)
+#define SPIM_ENABLE_ENABLE_Disabled (0UL)
+#define SPIM_ENABLE_ENABLE_Enabled (7UL)
+#define SPIM_TXD_LIST_LIST_ArrayList (1UL)
+
+#define TIMER_MODE_MODE_Timer (0UL)
+#define TIMER_MODE_MODE_Counter (1UL)
+#define TIMER_MODE_MODE_LowPowerCounter (2UL)
+#define TIMER_BITMODE_BITMODE_16Bit (0UL)
+#define TIMER_SHORTS_COMPARE1_STOP_Msk (1UL << 9)
+#define TIMER_INTENSET_COMPARE1_Msk (1UL << 17)
+
+#define GPIOTE_CONFIG_MODE_Pos (0UL)
+#define GPIOTE_CONFIG_MODE_Event (1UL)
+#define GPIOTE_CONFIG_PSEL_Pos (8UL)
+#define GPIOTE_CONFIG_POLARITY_Pos (16UL)
+#define GPIOTE_CONFIG_POLARITY_Toggle (3UL)
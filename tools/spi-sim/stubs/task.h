@@ -0,0 +1,11 @@
+#pragma once
+#include <FreeRTOS.h>
+
+typedef struct tskTaskControlBlock* TaskHandle_t;
+
+TaskHandle_t xTaskGetCurrentTaskHandle();
+uint32_t ulTaskNotifyTake(BaseType_t xClearCountOnExit, TickType_t xTicksToWait);
+BaseType_t xTaskNotifyGive(TaskHandle_t xTaskToNotify);
+void vTaskNotifyGiveFromISR(TaskHandle_t xTaskToNotify, BaseType_t* pxHigherPriorityTaskWoken);
+void vTaskDelay(TickType_t xTicksToDelay);
+TickType_t xTaskGetTickCount();